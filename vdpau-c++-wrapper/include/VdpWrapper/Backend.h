@@ -0,0 +1,106 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_BACKEND_H
+#define VW_BACKEND_H
+
+#include <string>
+
+#include <X11/Xlib.h>
+#include <vdpau/vdpau.h>
+
+namespace vw {
+    class Display;
+
+    /**
+     * @brief Backend provides a VdpDevice and the VDPAU entry points
+     *
+     * The Device creates the VdpDevice through a Backend and fills the VdpFunctions
+     * with the VdpGetProcAddress returned by the backend. Hence, the wrapper classes
+     * work the same way with a hardware driver or with an in-process implementation.
+     *
+     * The backend must outlive the Device created from it.
+     */
+    class Backend {
+    public:
+        virtual ~Backend() = default;
+
+        /**
+         * @brief Create a new VdpDevice
+         *
+         * @param ppGetProcAddress Filled with the function used to retrieve the VDPAU entry points
+         * @return VdpDevice The opaque VDPAU handle of the new device
+         */
+        virtual VdpDevice createDevice(VdpGetProcAddress** ppGetProcAddress) = 0;
+
+        /**
+         * @brief Get the backend name
+         *
+         * @return std::string The name used in the logs
+         */
+        virtual std::string getName() const = 0;
+    };
+
+    /**
+     * @brief X11Backend creates the VdpDevice from the VDPAU driver of a X11 display
+     *
+     * The VDPAU driver only needs a connection to the X server, so the backend
+     * can also be used headless: it opens its own connection without any window.
+     */
+    class X11Backend : public Backend {
+    public:
+        /**
+         * @brief Construct a new X11Backend
+         *
+         * @param display The reference of current Display
+         */
+        X11Backend(Display& display);
+        /**
+         * @brief Construct a new X11Backend without window
+         *
+         * The connection to the X server is opened by the backend and closed
+         * when it is destroyed.
+         *
+         * @param szDisplayName The X11 display name, the DISPLAY environment variable is used if empty
+         */
+        X11Backend(const std::string& szDisplayName);
+        /**
+         * @brief Destroy the X11Backend
+         */
+        ~X11Backend();
+
+        X11Backend(const X11Backend&) = delete;
+        X11Backend(X11Backend&&) = delete;
+
+        X11Backend& operator=(const X11Backend&) = delete;
+        X11Backend& operator=(X11Backend&&) = delete;
+
+        VdpDevice createDevice(VdpGetProcAddress** ppGetProcAddress) override;
+        std::string getName() const override;
+
+    private:
+        ::Display* m_pXDisplay;
+        int m_iXScreen;
+        bool m_bOwnsXDisplay;
+    };
+}
+
+#endif // VW_BACKEND_H
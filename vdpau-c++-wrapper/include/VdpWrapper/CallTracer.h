@@ -0,0 +1,157 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_CALL_TRACER_H
+#define VW_CALL_TRACER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vdpau/vdpau.h>
+
+namespace vw {
+    /**
+     * @brief TraceRecord is the binary representation of a traced VDPAU call
+     *
+     * The meaning of the handles, values and argument fields depends on the
+     * function, they are the parameters needed to reissue the call. The handles
+     * of the created objects are stored in handles[0]. The handles are only unique
+     * for a given deviceID: several devices, possibly on different backends, can
+     * return the same values.
+     */
+    struct TraceRecord {
+        uint32_t functionID;    ///< VdpFuncId of the called function
+        uint16_t status;        ///< VdpStatus returned by the function
+        uint16_t deviceID;      ///< Identifier of the traced device, unique for the trace
+        uint64_t startTime;     ///< Time of the call in nanoseconds since the start of the trace
+        uint64_t duration;      ///< Duration of the call in nanoseconds
+        uint64_t argument;      ///< 64 bits parameter (presentation times)
+        uint32_t handles[4];    ///< Handles of the objects used by the call
+        uint32_t values[4];     ///< Sizes, counts and formats used by the call
+    };
+
+    static_assert(sizeof(TraceRecord) == 64, "The trace records must be packed");
+
+    /**
+     * @brief Trace is the content of a trace file
+     *
+     * The payloads are indexed like the records, they are empty for the calls
+     * without recorded data.
+     */
+    struct Trace {
+        std::vector<TraceRecord> records;               ///< Records in call order
+        std::vector<std::vector<uint8_t>> payloads;     ///< Data recorded after each record
+    };
+
+    /**
+     * @brief CallTracer records the VDPAU calls made by the wrapper to a binary file
+     *
+     * When the tracer is started, VdpFunctions replaces the entry points of the next created
+     * devices by shims which log every call (device, function, handles, sizes, timestamps and
+     * status) before returning the result of the real function. The tracer is opt-in: it is started
+     * either by start() or by setting the VW_TRACE_FILE environment variable.
+     *
+     * The file starts with the "VWTR" magic and the format version, followed by the TraceRecord
+     * structures in host byte order. The records can be read back with readFile().
+     *
+     * The DecoderRender calls of the H.264 decoders are followed by a payload so they can be
+     * replayed faithfully: the VdpPictureInfoH264 structure (values[2] bytes) then the concatenated
+     * bitstream buffers (values[3] bytes). The traces grow by the size of the decoded stream.
+     *
+     * The shims are plain function pointers, so each traced device is attached to one of the
+     * MaxTracedDevices slots holding its own shims and real entry points. The devices can use
+     * different backends, each call is forwarded to the backend of its device.
+     */
+    class CallTracer {
+    public:
+        static constexpr uint32_t FormatVersion = 3;        ///< Version of the binary format
+        static constexpr uint32_t MaxTracedDevices = 8;     ///< Number of devices traced at once
+        static constexpr uint32_t NoSlot = UINT32_MAX;      ///< Slot of the devices left untraced
+
+        /**
+         * @brief Start recording to a file
+         *
+         * @param szFilename The path of the trace file, it's overwritten
+         */
+        static void start(const std::string& szFilename);
+
+        /**
+         * @brief Stop recording and close the file
+         *
+         * The shims already installed become transparent.
+         */
+        static void stop();
+
+        /**
+         * @brief Check if the tracer records the calls
+         *
+         * @return true If a trace file is opened
+         * @return false Otherwise
+         */
+        static bool isActive();
+
+        /**
+         * @brief Reserve a slot for a new traced device
+         *
+         * The device gets a new identifier written in its records. When all the
+         * slots are used, a warning is logged and the device isn't traced.
+         *
+         * @return uint32_t The slot of the device, or NoSlot
+         */
+        static uint32_t attachDevice();
+
+        /**
+         * @brief Release the slot of a destroyed device
+         *
+         * @param iSlot The slot returned by attachDevice()
+         */
+        static void detachDevice(uint32_t iSlot);
+
+        /**
+         * @brief Replace a VDPAU entry point by its tracing shim
+         *
+         * @param iSlot The slot of the device returned by attachDevice()
+         * @param functionID The VdpFuncId of the function
+         * @param pFunction The real entry point
+         * @return void* The shim, or pFunction if the function isn't traced
+         */
+        static void* wrapFunction(uint32_t iSlot, VdpFuncId functionID, void* pFunction);
+
+        /**
+         * @brief Read all the records of a trace file
+         *
+         * @param szFilename The path of the trace file
+         * @return Trace The records in call order and their payloads
+         */
+        static Trace readFile(const std::string& szFilename);
+
+        /**
+         * @brief Get a readable name of a VDPAU function
+         *
+         * @param functionID The VdpFuncId of the function
+         * @return std::string The function name
+         */
+        static std::string getFunctionName(uint32_t functionID);
+    };
+}
+
+#endif // VW_CALL_TRACER_H
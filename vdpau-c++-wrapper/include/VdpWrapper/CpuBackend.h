@@ -0,0 +1,60 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_CPU_BACKEND_H
+#define VW_CPU_BACKEND_H
+
+#include "Backend.h"
+
+namespace vw {
+    /**
+     * @brief CpuBackend is an in-process VDPAU implementation in system memory
+     *
+     * This reference backend allows to run and profile the wrapper without GPU
+     * nor X server. It implements all the entry points used by VdpFunctions:
+     *  - the video and output surfaces are stored in system memory
+     *  - the put/get bits functions copy the NV12, YV12 and BGRA/RGBA images
+     *  - the video mixer converts the NV12 surfaces to RGB (BT.601) and scales them
+     *  - the presentation queue follows the presentation times on the steady clock
+     *
+     * The decoder doesn't decode the bitstream: it checks the parameters and fills
+     * the target surface with a mid-grey picture, so the pipeline cost stays realistic
+     * for the memory traffic but the images are meaningless.
+     *
+     * The handle tables are shared by all the devices, but the pixel work runs under
+     * the lock of each surface, so the calls on different surfaces run in parallel.
+     */
+    class CpuBackend : public Backend {
+    public:
+        CpuBackend() = default;
+
+        CpuBackend(const CpuBackend&) = delete;
+        CpuBackend(CpuBackend&&) = delete;
+
+        CpuBackend& operator=(const CpuBackend&) = delete;
+        CpuBackend& operator=(CpuBackend&&) = delete;
+
+        VdpDevice createDevice(VdpGetProcAddress** ppGetProcAddress) override;
+        std::string getName() const override;
+    };
+}
+
+#endif // VW_CPU_BACKEND_H
@@ -97,6 +97,7 @@ namespace vw {
          * @brief Create the next available decoded surface
          *
          * The buffer acts like a ring buffer, we get here the next available surface.
+         * If the surface is pinned, the call blocks until it's released.
          *
          * @param device A reference to a valid Device
          * @param infos The usefull H264 bitstream informations
@@ -121,6 +122,25 @@ namespace vw {
          */
         void clear();
 
+        /**
+         * @brief Take over the surfaces of a previous buffer
+         *
+         * Used to reuse the surfaces of a DecoderSession, the references are cleared.
+         * The surfaces must have the size of the next pictures.
+         *
+         * @param pictures The decoded pictures to reuse
+         */
+        void adoptSurfacePool(std::vector<DecodedPicture>&& pictures);
+
+        /**
+         * @brief Give away the surfaces of the buffer
+         *
+         * The buffer is left empty, it allocates a new pool on the next picture.
+         *
+         * @return std::vector<DecodedPicture> The decoded pictures
+         */
+        std::vector<DecodedPicture> releaseSurfacePool();
+
     private:
         /**
          * @brief Initialize the surface pool
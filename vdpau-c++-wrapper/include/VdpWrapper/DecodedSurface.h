@@ -22,6 +22,9 @@
 #ifndef VW_DECODED_SURFACE_H
 #define VW_DECODED_SURFACE_H
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -29,9 +32,13 @@
 
 #include "Device.h"
 #include "ImageBuffer.h"
+#include "ImageBufferPool.h"
 #include "Size.h"
+#include "Timestamp.h"
 
 namespace vw {
+    class VdpFunctions;
+
     /**
      * @brief DecodedSurface encapsules a VdpVideoSurface
      *
@@ -103,21 +110,133 @@ namespace vw {
          * @return int The current POC value
          */
         int getPictureOrderCount() const;
+        /**
+         * @brief Set the Presentation Time Stamp (PTS)
+         *
+         * @param presentationTimeStamp New PTS value in nanoseconds or NoTimestamp
+         */
+        void setPresentationTimeStamp(VdpTime presentationTimeStamp);
+        /**
+         * @brief Get the Presentation Time Stamp (PTS)
+         *
+         * @return VdpTime The PTS in nanoseconds or NoTimestamp if unknown
+         */
+        VdpTime getPresentationTimeStamp() const;
+
+        /**
+         * @brief Copy an image to the GPU memory
+         *
+         * The planes are read in place, so uploading a view over external memory
+         * doesn't copy anything on the CPU side. An I420 image is first converted
+         * to NV12 in a temporary buffer.
+         *
+         * @param buffer A NV12 or I420 image, owned or a view
+         */
+        void upload(const ImageBuffer& buffer);
+
+        /**
+         * @brief Copy an image to the GPU memory through a staging buffer
+         *
+         * An I420 image is converted in the staging buffer, which keeps its
+         * allocation from one upload to the next.
+         *
+         * @param buffer A NV12 or I420 image, owned or a view
+         * @param stagingBuffer A NV12 buffer, resized when needed
+         */
+        void upload(const ImageBuffer& buffer, ImageBuffer& stagingBuffer);
 
         /**
          * @brief Copy the GPU data to an ImageBuffer
          *
+         * The image buffer has the storage size reported by the driver, which
+         * may be larger than getSize() when the surface is padded.
+         *
          * @return ImageBuffer The image buffer filled with GPU data
          */
         ImageBuffer copyHardwareMemory();
 
+        /**
+         * @brief Copy the GPU data to an existing ImageBuffer
+         *
+         * The buffer is resized to the surface storage layout, its allocation is
+         * reused when it is large enough. An I420 or YUYV buffer keeps its format:
+         * the surface is read back as NV12 in a temporary buffer and converted on
+         * the CPU.
+         *
+         * @param buffer The image buffer to fill with GPU data
+         */
+        void copyHardwareMemory(ImageBuffer& buffer);
+
+        /**
+         * @brief Copy the GPU data to an existing ImageBuffer through a staging buffer
+         *
+         * An I420 or YUYV buffer is filled from the NV12 readback made in the
+         * staging buffer, which keeps its allocation from one copy to the next.
+         *
+         * @param buffer The image buffer to fill with GPU data
+         * @param stagingBuffer A NV12 buffer, resized when needed
+         */
+        void copyHardwareMemory(ImageBuffer& buffer, ImageBuffer& stagingBuffer);
+
+        /**
+         * @brief Copy the GPU data to a buffer taken from a pool
+         *
+         * The NV12 staging buffer of an I420 or YUYV copy is taken from the pool too.
+         *
+         * @param pool The pool providing the image buffer
+         * @param format The format of the copy (NV12, I420 or YUYV)
+         * @return ImageFrame The frame filled with GPU data, its buffer goes back to the pool on release
+         */
+        ImageFrame copyHardwareMemory(ImageBufferPool& pool, PixelFormat format = PixelFormat::NV12);
+
+        /**
+         * @brief Pin the surface while another thread reads it
+         *
+         * A pinned surface isn't reused by the DecodedPictureBuffer and its destruction
+         * waits for the last unpin(). The pins can be nested. The surface must not be
+         * moved while it is pinned.
+         */
+        void pin();
+
+        /**
+         * @brief Release a pin taken by pin()
+         *
+         * This method can be called from any thread.
+         */
+        void unpin();
+
+        /**
+         * @brief Check if the surface is pinned
+         *
+         * @return bool True if a pin is held
+         */
+        bool isPinned() const;
+
+        /**
+         * @brief Block until all the pins are released
+         */
+        void waitUntilUnpinned() const;
+
+    private:
+        struct PinState {
+            std::mutex mutex;
+            std::condition_variable condition;
+            int iPins = 0;
+        };
+
     private:
         void allocateVdpSurface(Device& device, const SizeU& size);
+        void putNV12Bits(const ImageBuffer& buffer);
+        void getNV12Bits(ImageBuffer& buffer);
 
     private:
+        const VdpFunctions* m_pFunctions;
         VdpVideoSurface m_vdpVideoSurface;
         SizeU m_size;
+        SizeU m_storageSize;
         int m_iPictureOrderCount;
+        VdpTime m_presentationTimeStamp;
+        std::shared_ptr<PinState> m_pPinState;
     };
 }
 
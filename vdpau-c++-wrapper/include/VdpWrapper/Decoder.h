@@ -25,6 +25,8 @@
 #include <vdpau/vdpau.h>
 
 #include "DecodedPictureBuffer.h"
+#include "DecoderSessionPool.h"
+#include "NalUnit.h"
 
 namespace vw {
     class Device;
@@ -48,6 +50,9 @@ namespace vw {
         Decoder(Device& device);
         /**
          * @brief Destroy the Decoder object
+         *
+         * With a session pool, the VdpDecoder and its surfaces are given back to the
+         * pool instead of being destroyed.
          */
         ~Decoder();
 
@@ -61,16 +66,50 @@ namespace vw {
          * @brief Send a nal unit to be decoded
          *
          * The function expects that the nal unit is a coded slice (not a SPS, PPS or SEI nal)
+         * selected by the current decode mode.
          *
          * @param nal A coded slice nal
          * @return DecodedSurface& A reference on the new decoded surface
          */
         DecodedSurface& decode(const NalUnit& nal);
 
+        /**
+         * @brief Set the decode mode
+         *
+         * For trick-play, only the reference or the intra pictures can be decoded.
+         * The other pictures must not be sent to decode(), isDecodable() allows to
+         * filter them.
+         *
+         * @param mode The new decode mode
+         */
+        void setDecodeMode(DecodeMode mode);
+
+        /**
+         * @brief Check if the nal unit is decoded with the current decode mode
+         *
+         * @param nal A coded slice nal
+         * @return true If the nal can be sent to decode()
+         * @return false If the picture must be dropped
+         */
+        bool isDecodable(const NalUnit& nal) const;
+
+        /**
+         * @brief Set the pool providing warm decoder sessions
+         *
+         * The pool is used when the VdpDecoder is created on the first decoded picture,
+         * hence it must be set before. The pool must outlive the decoder.
+         *
+         * @param pSessionPool The session pool or nullptr to disable it
+         */
+        void setSessionPool(DecoderSessionPool* pSessionPool);
+
     private:
         Device& m_device;
         VdpDecoder m_decoder;
         DecodedPictureBuffer m_decodedPicturesBuffer;
+        DecodeMode m_decodeMode;
+        DecoderSessionPool* m_pSessionPool;
+        DecoderSessionKey m_sessionKey;
     };
 }
 
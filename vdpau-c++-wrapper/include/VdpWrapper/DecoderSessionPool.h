@@ -0,0 +1,159 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_DECODER_SESSION_POOL_H
+#define VW_DECODER_SESSION_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vdpau/vdpau.h>
+
+#include "DecodedPictureBuffer.h"
+#include "Size.h"
+
+namespace vw {
+    class Device;
+
+    /**
+     * @brief DecoderSessionKey identifies the decoder sessions which can be exchanged
+     */
+    struct DecoderSessionKey {
+        VdpDecoderProfile profile;  ///< The VDPAU decoder profile
+        SizeU size;                 ///< The size of the decoded pictures
+        uint32_t maxReferences;     ///< The num_ref_frames of the SPS
+
+        bool operator==(const DecoderSessionKey& other) const;
+        bool operator!=(const DecoderSessionKey& other) const;
+    };
+
+    /**
+     * @brief DecoderSession is a warm VdpDecoder with its decoded picture surfaces
+     *
+     * The session is exchanged between a Decoder and a DecoderSessionPool, the
+     * VdpDecoder is destroyed by one of them.
+     */
+    struct DecoderSession {
+        DecoderSessionKey key;                  ///< The parameters of the session
+        VdpDecoder decoder;                     ///< The VDPAU decoder
+        std::vector<DecodedPicture> pictures;   ///< The surfaces of the decoded picture buffer
+    };
+
+    /**
+     * @brief SessionPoolStatistics is a snapshot of the DecoderSessionPool usage
+     */
+    struct SessionPoolStatistics {
+        std::size_t availableSessions;  ///< Number of sessions waiting in the pool
+        std::size_t memoryUsage;        ///< Estimated memory of the available sessions in bytes
+        std::size_t hits;               ///< Number of acquire() calls served by a warm session
+        std::size_t misses;             ///< Number of acquire() calls without a matching session
+        std::size_t evictions;          ///< Number of sessions destroyed to stay within the memory budget
+    };
+
+    /**
+     * @brief DecoderSessionPool keeps warm decoder sessions for the next streams
+     *
+     * Without a pool, each new stream pays the VdpDecoder creation and the allocation
+     * of its decoded picture buffer. When a Decoder using the pool is destroyed, its
+     * session is reset and kept in the pool, then handed to the next Decoder whose
+     * stream has the same profile, size and number of reference frames.
+     *
+     * The available sessions are evicted in least recently used order to stay within
+     * a memory budget. The memory of a session is estimated from its NV12 surfaces,
+     * the internal memory of the VdpDecoder is unknown.
+     *
+     * The class is thread-safe, and must outlive the decoders using it.
+     *
+     * @sa Decoder::setSessionPool
+     */
+    class DecoderSessionPool {
+    public:
+        /**
+         * @brief Construct a new empty DecoderSessionPool
+         *
+         * @param device A reference to a valid Device
+         * @param iMemoryBudget Maximal estimated memory of the available sessions in bytes
+         */
+        DecoderSessionPool(Device& device, std::size_t iMemoryBudget);
+        /**
+         * @brief Destroy the DecoderSessionPool and all the available sessions
+         */
+        ~DecoderSessionPool();
+
+        DecoderSessionPool(const DecoderSessionPool&) = delete;
+        DecoderSessionPool(DecoderSessionPool&&) = delete;
+
+        DecoderSessionPool& operator=(const DecoderSessionPool&) = delete;
+        DecoderSessionPool& operator=(DecoderSessionPool&&) = delete;
+
+        /**
+         * @brief Take a warm session matching the key
+         *
+         * @param key The parameters of the new stream
+         * @return std::unique_ptr<DecoderSession> The most recently used matching session, or nullptr
+         */
+        std::unique_ptr<DecoderSession> acquire(const DecoderSessionKey& key);
+
+        /**
+         * @brief Give back a session to the pool
+         *
+         * The least recently used sessions are destroyed until the pool fits in the
+         * memory budget, the given session included.
+         *
+         * @param pSession The session of a destroyed Decoder
+         */
+        void release(std::unique_ptr<DecoderSession> pSession);
+
+        /**
+         * @brief Get the current pool statistics
+         *
+         * @return SessionPoolStatistics The statistics snapshot
+         */
+        SessionPoolStatistics getStatistics() const;
+
+        /**
+         * @brief Estimate the memory used by a session
+         *
+         * @param key The parameters of the session
+         * @return std::size_t The size of its NV12 surfaces in bytes
+         */
+        static std::size_t estimateMemory(const DecoderSessionKey& key);
+
+    private:
+        void destroySession(DecoderSession& session);
+
+    private:
+        Device& m_device;
+        std::size_t m_iMemoryBudget;
+        mutable std::mutex m_mutex;
+        std::list<std::unique_ptr<DecoderSession>> m_availableSessions; // Least recently used first
+        std::size_t m_iMemoryUsage;
+        std::size_t m_iHits;
+        std::size_t m_iMisses;
+        std::size_t m_iEvictions;
+    };
+}
+
+#endif // VW_DECODER_SESSION_POOL_H
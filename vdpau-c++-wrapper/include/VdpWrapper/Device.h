@@ -22,10 +22,14 @@
 #ifndef VW_DEVICE_H
 #define VW_DEVICE_H
 
+#include <memory>
+
 #include <vdpau/vdpau.h>
 
 namespace vw {
+    class Backend;
     class Display;
+    class VdpFunctions;
 
     /**
      * @brief Device encapsules a VdpDevice
@@ -34,21 +38,32 @@ namespace vw {
      * respect the RAII programming idiom hence when a new object is created is owning
      * a VdpVideoSurface and when it is destroyed the VdpDevice is freed.
      *
-     * Moreover, the class will instantiate the VdpFunctions singleton for the other
-     * classes which use VDPAU API. When Device is destroyed, the VdpFunctions singelton
-     * come back to an invalid state.
+     * Moreover, each device owns the table of VDPAU functions retrieved for it, and the
+     * other classes which use VDPAU API call the functions through their Device. Hence,
+     * several devices can live in the same process, even with different backends.
      *
-     * @todo Change the VdpFunctions singleton by an overriding operator->.
+     * The function table is immutable once the device is constructed and the VDPAU API
+     * is thread-safe, so a Device can be used from several threads at once. The objects
+     * created from a Device must be destroyed before it.
      */
     class Device {
     public:
         /**
          * @brief Construct a new Device object
          *
+         * The device is created by the VDPAU driver of the X11 display.
+         *
          * @param display The reference of current Display
          */
         Device(Display& display);
 
+        /**
+         * @brief Construct a new Device object from a Backend
+         *
+         * @param backend The backend providing the VDPAU implementation (must outlive the Device)
+         */
+        Device(Backend& backend);
+
         /**
          * @brief Destroy the Device object
          */
@@ -67,8 +82,27 @@ namespace vw {
          */
         VdpDevice getVdpHandle() const;
 
+        /**
+         * @brief Get the VDPAU functions of this device
+         *
+         * @return const VdpFunctions& The function table
+         */
+        const VdpFunctions& getFunctions() const;
+
+        /**
+         * @brief Call a VDPAU function of this device
+         *
+         * @return const VdpFunctions* The function table
+         */
+        const VdpFunctions* operator->() const;
+
+    private:
+        void initialize(Backend& backend);
+
     private:
+        std::unique_ptr<Backend> m_pOwnedBackend;
         VdpDevice m_VdpDevice;
+        std::unique_ptr<VdpFunctions> m_pFunctions;
     };
 }
 
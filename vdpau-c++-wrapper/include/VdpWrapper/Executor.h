@@ -0,0 +1,226 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_EXECUTOR_H
+#define VW_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Task.h"
+
+namespace vw {
+    /**
+     * @brief Executor runs the coroutines of the asynchronous API on a few threads
+     *
+     * The ready coroutines are resumed by a small pool of worker threads. A coroutine
+     * waiting for the device (e.g. a surface leaving the presentation queue) doesn't
+     * block a thread: its condition is registered with poll() and an idle worker checks
+     * all the pending conditions without blocking, then resumes the satisfied ones.
+     * Thousands of stream tasks can therefore share a handful of threads.
+     *
+     * @sa Task, decodeAsync, processAsync, enqueueAsync
+     */
+    class Executor {
+    public:
+        /**
+         * @brief Construct a new Executor and start its workers
+         *
+         * @param iThreadCount Number of worker threads
+         * @param pollInterval Delay between two checks of the pending conditions
+         */
+        Executor(std::size_t iThreadCount, std::chrono::microseconds pollInterval = std::chrono::microseconds(500));
+        /**
+         * @brief Stop the workers
+         *
+         * The spawned tasks must be finished, see waitIdle().
+         */
+        ~Executor();
+
+        Executor(const Executor&) = delete;
+        Executor(Executor&&) = delete;
+
+        Executor& operator=(const Executor&) = delete;
+        Executor& operator=(Executor&&) = delete;
+
+        /**
+         * @brief Start a task, the executor owns it until its end
+         *
+         * @param task The task to run
+         */
+        void spawn(Task<void> task);
+
+        /**
+         * @brief Wait for the end of all the spawned tasks
+         *
+         * @throw The first exception thrown by a spawned task
+         */
+        void waitIdle();
+
+        /**
+         * @brief Continue the awaiting coroutine on a worker thread
+         *
+         * @code
+         * co_await executor.schedule();
+         * @endcode
+         */
+        auto schedule() noexcept {
+            struct Awaiter {
+                Executor& executor;
+
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<> handle) {
+                    executor.resume(handle);
+                }
+
+                void await_resume() const noexcept {
+                }
+            };
+
+            return Awaiter{ *this };
+        }
+
+        /**
+         * @brief Suspend the awaiting coroutine until a condition is true
+         *
+         * The condition is checked right away, then by the workers at each poll
+         * interval. It must not block and may be called from any worker thread.
+         *
+         * @code
+         * co_await executor.poll([&] { return isSurfaceIdle(); });
+         * @endcode
+         *
+         * @param condition The non-blocking condition
+         */
+        auto poll(std::function<bool()> condition) {
+            struct Awaiter {
+                Executor& executor;
+                std::function<bool()> condition;
+
+                bool await_ready() {
+                    return condition();
+                }
+
+                void await_suspend(std::coroutine_handle<> handle) {
+                    executor.addPendingCondition(std::move(condition), handle);
+                }
+
+                void await_resume() const noexcept {
+                }
+            };
+
+            return Awaiter{ *this, std::move(condition) };
+        }
+
+        /**
+         * @brief Queue a suspended coroutine to be resumed by a worker
+         *
+         * @param handle The coroutine handle
+         */
+        void resume(std::coroutine_handle<> handle);
+
+    private:
+        struct PendingCondition {
+            std::function<bool()> condition;
+            std::coroutine_handle<> handle;
+        };
+
+        struct DetachedTask;
+
+        static DetachedTask runDetached(Executor& executor, Task<void> task);
+        void addPendingCondition(std::function<bool()> condition, std::coroutine_handle<> handle);
+        void runWorker();
+        void checkPendingConditions(std::unique_lock<std::mutex>& lock);
+        void finishTask(std::exception_ptr error);
+
+    private:
+        std::chrono::microseconds m_pollInterval;
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workCondition;
+        std::condition_variable m_idleCondition;
+        std::deque<std::coroutine_handle<>> m_readyCoroutines;
+        std::vector<PendingCondition> m_pendingConditions;
+        std::size_t m_iRunningTasks;
+        std::exception_ptr m_firstError;
+        bool m_bStop;
+    };
+
+    class Decoder;
+    class DecodedSurface;
+    class NalUnit;
+    class PresentationQueue;
+    class RenderSurface;
+    class VideoMixer;
+
+    /**
+     * @brief Decode a coded slice on a worker of the executor
+     *
+     * @code
+     * vw::DecodedSurface& surface = co_await vw::decodeAsync(executor, decoder, nalUnit);
+     * @endcode
+     *
+     * @param executor The executor running the call
+     * @param decoder The decoder of the stream, only used by one task at a time
+     * @param nal A coded slice nal
+     * @return Task<DecodedSurface&> The new decoded surface, see Decoder::decode()
+     */
+    Task<DecodedSurface&> decodeAsync(Executor& executor, Decoder& decoder, const NalUnit& nal);
+
+    /**
+     * @brief Post-process a decoded surface on a worker of the executor
+     *
+     * @param executor The executor running the call
+     * @param mixer The mixer of the stream, only used by one task at a time
+     * @param inputSurface The decoded surface
+     * @return Task<RenderSurface> The output surface, see VideoMixer::process()
+     */
+    Task<RenderSurface> processAsync(Executor& executor, VideoMixer& mixer, DecodedSurface& inputSurface);
+
+    /**
+     * @brief Enqueue a surface and wait until the presentation queue can take the next one
+     *
+     * Instead of blocking the thread on the presentation queue, the task is suspended
+     * while the queue is scheduled more than maxAhead in the future. The queue clock
+     * is polled without blocking by the executor.
+     *
+     * @param executor The executor polling the queue
+     * @param queue The presentation queue
+     * @param surface The surface to display
+     * @param maxAhead The maximal delay between the current time and the end of the schedule
+     * @return Task<bool> The value returned by PresentationQueue::enqueue()
+     */
+    Task<bool> enqueueAsync(Executor& executor, PresentationQueue& queue, RenderSurface surface, std::chrono::nanoseconds maxAhead = std::chrono::milliseconds(100));
+}
+
+#endif // VW_EXECUTOR_H
@@ -0,0 +1,76 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_FRAME_CHECKSUM_H
+#define VW_FRAME_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ImageBuffer.h"
+#include "Size.h"
+
+namespace vw {
+    /**
+     * @brief Enumeration of the frame checksum algorithms
+     */
+    enum class ChecksumAlgorithm {
+        MD5,    ///< Same values as the ffmpeg framemd5 muxer
+        CRC32C, ///< Castagnoli CRC, computed with the SSE 4.2 instruction when available
+    };
+
+    /**
+     * @brief Get the algorithm name written in the checksum logs
+     *
+     * @param algorithm The checksum algorithm
+     * @return const char* "MD5" or "CRC32C"
+     */
+    const char* getChecksumName(ChecksumAlgorithm algorithm);
+
+    /**
+     * @brief Update a CRC32C with a block of data
+     *
+     * The initial value is 0, the result of a call is the initial value of the next one.
+     *
+     * @param crc The CRC of the previous blocks
+     * @param pData The data to add
+     * @param size The size in bytes of the data
+     * @return uint32_t The CRC of all the blocks
+     */
+    uint32_t updateCrc32c(uint32_t crc, const void* pData, std::size_t size);
+
+    /**
+     * @brief Compute the checksum of the visible area of an image
+     *
+     * The planes are hashed one after the other, line by line, without the
+     * line padding nor the storage area beyond the visible size, so the value
+     * matches the checksum of the packed raw frame.
+     *
+     * @param image The image, NV12, I420 or YUYV
+     * @param visibleSize The size of the picture inside the image storage
+     * @param algorithm The checksum algorithm
+     * @return std::string The checksum as a lowercase hexadecimal string
+     */
+    std::string computeFrameChecksum(const ImageBuffer& image, SizeU visibleSize, ChecksumAlgorithm algorithm);
+}
+
+#endif // VW_FRAME_CHECKSUM_H
@@ -0,0 +1,130 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_FRAMERATE_H
+#define VW_FRAMERATE_H
+
+#include <cstdint>
+#include <numeric>
+
+namespace vw {
+    /**
+     * @brief Framerate is an utility class to handle a rational framerate
+     *
+     * The framerate is stored as a reduced fraction (e.g. 30000/1001 for
+     * 29.97 fps) to compute exact presentation times without accumulating a
+     * rounding error frame after frame.
+     */
+    struct Framerate {
+        /**
+         * @brief Construct a new Framerate object
+         *
+         * The fraction is reduced by the greatest common divisor of its terms.
+         *
+         * @param numerator Number of frames
+         * @param denominator Duration in seconds of the numerator frames
+         */
+        Framerate(uint32_t numerator = 25, uint32_t denominator = 1)
+        : numerator(numerator)
+        , denominator(denominator) {
+            uint32_t divisor = std::gcd(numerator, denominator);
+            if (divisor > 1) {
+                this->numerator /= divisor;
+                this->denominator /= divisor;
+            }
+        }
+
+        uint32_t numerator; ///< Number of frames
+        uint32_t denominator; ///< Number of seconds
+
+        /**
+         * @brief Check if the framerate can be used
+         *
+         * @return bool True if the numerator and denominator are not null
+         */
+        inline bool isValid() const {
+            return numerator != 0 && denominator != 0;
+        }
+
+        /**
+         * @brief Get the start time of a frame relative to the first one
+         *
+         * The time is computed from the frame index and rounded down, so the
+         * error is less than one nanosecond as long as the result fits in 64 bits
+         * (about 584 years). The product of the remainder is done on 128 bits, it
+         * can't overflow whatever the terms of the fraction.
+         *
+         * @param iFrameIndex Index of the frame
+         * @return uint64_t The time in nanoseconds
+         */
+        inline uint64_t getFrameTime(uint64_t iFrameIndex) const {
+            const uint64_t secondAsNanoseconds = 1000000000;
+            uint64_t quotient = iFrameIndex / numerator;
+            uint64_t remainder = iFrameIndex % numerator;
+
+            // remainder * denominator * 10^9 < 2^94
+            unsigned __int128 remainderTime = static_cast<unsigned __int128>(remainder) * denominator * secondAsNanoseconds;
+            return quotient * denominator * secondAsNanoseconds + static_cast<uint64_t>(remainderTime / numerator);
+        }
+
+        /**
+         * @brief Get the duration of one frame
+         *
+         * @return uint64_t The duration in nanoseconds (rounded down)
+         */
+        inline uint64_t getFrameDuration() const {
+            return getFrameTime(1);
+        }
+
+        /**
+         * @brief Get the framerate as a floating point value
+         *
+         * @return double Number of frames per second
+         */
+        inline double toDouble() const {
+            return static_cast<double>(numerator) / static_cast<double>(denominator);
+        }
+    };
+
+    /**
+     * @brief Equality operator
+     *
+     * @param lhs Framerate
+     * @param rhs Another framerate
+     * @return bool Check equality of the rational values
+     */
+    inline bool operator==(const Framerate& lhs, const Framerate& rhs) {
+        return static_cast<uint64_t>(lhs.numerator) * rhs.denominator == static_cast<uint64_t>(rhs.numerator) * lhs.denominator;
+    }
+
+    /**
+     * @brief Inequality operator
+     *
+     * @param lhs Framerate
+     * @param rhs Another framerate
+     * @return bool Check inequality of the rational values
+     */
+    inline bool operator!=(const Framerate& lhs, const Framerate& rhs) {
+        return !(lhs == rhs);
+    }
+}
+
+#endif // VW_FRAMERATE_H
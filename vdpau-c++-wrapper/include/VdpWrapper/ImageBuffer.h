@@ -22,12 +22,26 @@
 #ifndef VW_IMAGE_BUFFER_H
 #define VW_IMAGE_BUFFER_H
 
+#include <cstddef>
+#include <memory>
+#include <vector>
+
 #include <opencv2/imgcodecs.hpp>
 
 #include "Size.h"
 
 namespace vw {
-    using Plane = std::vector<uint8_t>;
+    class MappedFile;
+
+    /**
+     * @brief Enumeration of the pixel formats an ImageBuffer can hold
+     */
+    enum class PixelFormat {
+        B8G8R8A8, ///< One interleaved plane, 4 bytes per pixel (VDP_RGBA_FORMAT_B8G8R8A8)
+        NV12,     ///< One luma plane followed by one interleaved half-height chroma plane (VDP_YCBCR_FORMAT_NV12)
+        I420,     ///< One luma plane followed by the U and V planes, both subsampled by 2 in each direction
+        YUYV,     ///< One interleaved plane, Y0 U Y1 V for each pair of pixels (VDP_YCBCR_FORMAT_YUYV)
+    };
 
     /**
      * @brief ImageBuffer is an utilty class to encapsule a raw image
@@ -35,9 +49,33 @@ namespace vw {
      * This class represents a raw image of any type (BGRA or YUV). Depending of
      * the real format, the number of planes must be different. Moreover, this
      * class can be read raw YUV file or image file.
+     *
+     * All the planes live in a single allocation aligned on ImageBuffer::Alignment
+     * bytes. Each plane starts on an aligned offset and each line is padded to an
+     * aligned pitch, so the line size of a plane may be greater than its visible
+     * width.
+     *
+     * An ImageBuffer can also be a view: it then describes planes owned by someone
+     * else (a mapped file, an OpenCV matrix, a shared memory segment...) and keeps
+     * the owner alive through a shared pointer. Copying a view shares the memory,
+     * and a view can't be resized. Views are read-only unless created from
+     * writable memory.
      */
     class ImageBuffer {
     public:
+        static constexpr std::size_t Alignment = 64; ///< Alignment in bytes of the allocation, the planes and the lines
+
+        /**
+         * @brief Construct a new uninitialized ImageBuffer
+         *
+         * The pitch of each plane is the visible line size rounded up to
+         * ImageBuffer::Alignment.
+         *
+         * @param format Pixel format of the image
+         * @param imageSize Image size, typically the real size reported by the surface parameters
+         */
+        ImageBuffer(PixelFormat format, SizeU imageSize);
+
         /**
          * @brief Construct a new ImageBuffer form a OpenCV matrix (aka. from a image file)
          *
@@ -53,16 +91,120 @@ namespace vw {
          */
         ImageBuffer(SizeU imageSize, const std::vector<uint8_t> &rawBytes);
 
-        ImageBuffer(std::vector<Plane>&& planes, std::vector<uint32_t>&& linesizes);
+        /**
+         * @brief Create a view over externally owned planes
+         *
+         * @param format Pixel format of the image
+         * @param imageSize Image size
+         * @param planes Pointer to each plane, in the getPlane() order
+         * @param lineSizes Line size in bytes of each plane
+         * @param pOwner Object keeping the memory valid, released with the last copy of the view
+         * @param bWritable If false, the non-const getPlane() throws
+         * @return ImageBuffer The view
+         */
+        static ImageBuffer view(PixelFormat format, SizeU imageSize, const std::vector<const uint8_t*>& planes, const std::vector<uint32_t>& lineSizes, std::shared_ptr<const void> pOwner, bool bWritable = false);
 
         /**
-         * @brief Get the line size for the specified plane
+         * @brief Create a view over a tightly packed image stored in a mapped file
+         *
+         * The planes follow each other without padding, as in a raw YUV file.
+         *
+         * @param format Pixel format of the image
+         * @param imageSize Image size
+         * @param pFile The mapped file
+         * @param offset Offset of the image in the file
+         * @return ImageBuffer The read-only view
+         */
+        static ImageBuffer view(PixelFormat format, SizeU imageSize, std::shared_ptr<const MappedFile> pFile, std::size_t offset = 0);
+
+        /**
+         * @brief Create a view over a BGRA OpenCV matrix
+         *
+         * The matrix must have 4 channels of 8 bits. The view shares the matrix
+         * data through the OpenCV reference count.
+         *
+         * @param image The BGRA image
+         * @return ImageBuffer The writable view
+         */
+        static ImageBuffer view(const cv::Mat& image);
+
+        /**
+         * @brief Get the size in bytes of a tightly packed image
+         *
+         * @param format Pixel format of the image
+         * @param imageSize Image size
+         * @return std::size_t The size without any padding, as in a raw file
+         */
+        static std::size_t getPackedSize(PixelFormat format, SizeU imageSize);
+
+        /**
+         * @brief Get the size in bytes of the visible part of a line
+         *
+         * @param format Pixel format of the image
+         * @param imageSize Image size
+         * @param index Index of plane
+         * @return uint32_t The line size without any padding
+         */
+        static uint32_t getPackedLineSize(PixelFormat format, SizeU imageSize, uint32_t index);
+
+        ImageBuffer(const ImageBuffer& other);
+        ImageBuffer& operator=(const ImageBuffer& other);
+
+        ImageBuffer(ImageBuffer&& other) = default;
+        ImageBuffer& operator=(ImageBuffer&& other) = default;
+
+        /**
+         * @brief Change the format and the size of the image
+         *
+         * The current allocation is kept when it is large enough for the new
+         * layout, so a buffer can be reused for pictures of any size without
+         * reaching the heap once it has grown to the largest one. The content
+         * is undefined after the call.
+         *
+         * @param format New pixel format
+         * @param imageSize New image size
+         * @return bool True if a new allocation was needed
+         * @throw std::runtime_error If the buffer is a view and the layout changes
+         */
+        bool resize(PixelFormat format, SizeU imageSize);
+
+        /**
+         * @brief Get the pixel format
+         *
+         * @return PixelFormat The pixel format
+         */
+        PixelFormat getFormat() const;
+
+        /**
+         * @brief Get the image size
+         *
+         * @return SizeU The image size
+         */
+        SizeU getSize() const;
+
+        /**
+         * @brief Get the number of planes
+         *
+         * @return uint32_t The number of planes (1 for BGRA and YUYV, 2 for NV12, 3 for I420)
+         */
+        uint32_t getPlaneCount() const;
+
+        /**
+         * @brief Get the line size (pitch) for the specified plane
          *
          * @param index Index of plane (default is 0)
-         * @return uint32_t The plane size
+         * @return uint32_t The distance in bytes between two lines of the plane
          */
         uint32_t getLineSize(uint32_t index = 0) const;
 
+        /**
+         * @brief Get the number of lines for the specified plane
+         *
+         * @param index Index of plane (default is 0)
+         * @return uint32_t The plane height
+         */
+        uint32_t getPlaneHeight(uint32_t index = 0) const;
+
         /**
          * @brief Get the specified plane data
          *
@@ -71,13 +213,68 @@ namespace vw {
          */
         const uint8_t* getPlane(uint32_t index = 0) const;
 
+        /**
+         * @brief Get the specified plane data
+         *
+         * @param index Index of plane (default is 0)
+         * @return uint8_t* The pointer to the plane data
+         * @throw std::runtime_error If the buffer is a read-only view
+         */
+        uint8_t* getPlane(uint32_t index = 0);
+
+        /**
+         * @brief Check if the buffer is a view over external memory
+         *
+         * @return bool True for a view
+         */
+        bool isView() const;
+
+        /**
+         * @brief Get the size of the image data, padding included
+         *
+         * @return std::size_t The size in bytes
+         */
+        std::size_t getDataSize() const;
+
+        /**
+         * @brief Get the size of the underlying allocation
+         *
+         * @return std::size_t The size in bytes, greater or equal to getDataSize()
+         */
+        std::size_t getCapacity() const;
+
     private:
+        struct AlignedDeleter {
+            void operator()(uint8_t* pData) const;
+        };
+
+        struct PlaneLayout {
+            uint8_t* pData;
+            std::size_t offset;
+            uint32_t lineSize;
+            uint32_t height;
+        };
+
+    private:
+        ImageBuffer();
+
+        static std::vector<PlaneLayout> getPackedPlanes(PixelFormat format, SizeU imageSize);
+
+        void setLayout(PixelFormat format, SizeU imageSize);
+        void bindPlanes();
+        void allocate(PixelFormat format, SizeU imageSize);
         void storeBGRAImage(cv::Mat &decodedImage);
         void storeNV12Image(SizeU imageSize, const std::vector<uint8_t> &rawBytes);
 
     private:
-        std::vector<Plane> m_planes;
-        std::vector<uint32_t> m_lineSizes;
+        PixelFormat m_format;
+        SizeU m_size;
+        std::vector<PlaneLayout> m_planes;
+        std::size_t m_dataSize;
+        std::size_t m_capacity;
+        std::unique_ptr<uint8_t[], AlignedDeleter> m_pData;
+        std::shared_ptr<const void> m_pOwner;
+        bool m_bWritable;
     };
 }
 
@@ -0,0 +1,187 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_IMAGE_BUFFER_POOL_H
+#define VW_IMAGE_BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ImageBuffer.h"
+#include "Size.h"
+
+namespace vw {
+    class ImageBufferPool;
+
+    /**
+     * @brief ImageBufferPoolStatistics is a snapshot of the ImageBufferPool usage
+     */
+    struct ImageBufferPoolStatistics {
+        std::size_t allocatedBuffers;   ///< Number of ImageBuffer owned by the pool
+        std::size_t availableBuffers;   ///< Number of buffers waiting in the pool to be reused
+        std::size_t usedBuffers;        ///< Number of buffers currently referenced by an ImageFrame
+        std::size_t peakUsedBuffers;    ///< Highest value reached by usedBuffers
+        std::size_t allocations;        ///< Number of pixel storage allocations (new buffers and regrowths)
+        std::size_t allocatedBytes;     ///< Sum of the buffer capacities
+    };
+
+    /**
+     * @brief ImageFrame is a reference counted handle on an ImageBuffer owned by an ImageBufferPool
+     *
+     * Copying a frame shares the same buffer. The buffer goes back to the pool
+     * when the last frame referencing it is destroyed. Copying and releasing a
+     * frame never allocate.
+     */
+    class ImageFrame {
+    public:
+        /**
+         * @brief Construct an empty frame
+         */
+        ImageFrame() noexcept;
+        /**
+         * @brief Drop the reference and give back the buffer to the pool if it was the last one
+         */
+        ~ImageFrame();
+
+        ImageFrame(const ImageFrame& other) noexcept;
+        ImageFrame(ImageFrame&& other) noexcept;
+
+        ImageFrame& operator=(const ImageFrame& other) noexcept;
+        ImageFrame& operator=(ImageFrame&& other) noexcept;
+
+        /**
+         * @brief Access to the referenced buffer
+         *
+         * @return ImageBuffer& The buffer, the frame must not be empty
+         */
+        ImageBuffer& operator*() const;
+        /**
+         * @brief Access to the referenced buffer
+         *
+         * @return ImageBuffer* The buffer or nullptr if the frame is empty
+         */
+        ImageBuffer* operator->() const;
+        /**
+         * @brief Get the referenced buffer
+         *
+         * @return ImageBuffer* The buffer or nullptr if the frame is empty
+         */
+        ImageBuffer* get() const;
+        /**
+         * @brief Check if the frame references a buffer
+         */
+        explicit operator bool() const;
+        /**
+         * @brief Drop the reference before the destruction of the frame
+         */
+        void reset();
+
+    private:
+        friend class ImageBufferPool;
+
+        struct Slot {
+            ImageBufferPool* pPool;
+            std::atomic<uint32_t> references;
+            ImageBuffer buffer;
+        };
+
+        explicit ImageFrame(Slot* pSlot) noexcept;
+
+    private:
+        Slot* m_pSlot;
+    };
+
+    /**
+     * @brief ImageBufferPool recycles the ImageBuffer used for GPU readback
+     *
+     * Without a pool, each DecodedSurface::copyHardwareMemory() or
+     * RenderSurface::copyHardwareMemory() call allocates a whole picture and
+     * pays the page faults of the fresh memory. The pool keeps the released
+     * buffers and hands them back on the next acquire() call. A reused buffer
+     * keeps its allocation when the requested layout fits in it, so once the
+     * pool has as many buffers as frames in flight no more allocation happens.
+     *
+     * The class is thread-safe: frames can be acquired and released from any
+     * thread. The pool must outlive all the frames it handed out.
+     *
+     * @sa DecodedSurface::copyHardwareMemory, RenderSurface::copyHardwareMemory
+     */
+    class ImageBufferPool {
+    public:
+        /**
+         * @brief Construct a new empty ImageBufferPool
+         */
+        ImageBufferPool();
+        /**
+         * @brief Destroy the ImageBufferPool and all the available buffers
+         */
+        ~ImageBufferPool() = default;
+
+        ImageBufferPool(const ImageBufferPool&) = delete;
+        ImageBufferPool(ImageBufferPool&&) = delete;
+
+        ImageBufferPool& operator=(const ImageBufferPool&) = delete;
+        ImageBufferPool& operator=(ImageBufferPool&&) = delete;
+
+        /**
+         * @brief Get a buffer with the specified layout
+         *
+         * The most recently released buffer is reused, growing its allocation
+         * if needed. A new buffer is allocated only if none is available.
+         *
+         * @param format The requested pixel format
+         * @param imageSize The requested image size
+         * @return ImageFrame A frame referencing the buffer, its content is undefined
+         *         and it must not be resized by the caller
+         */
+        ImageFrame acquire(PixelFormat format, SizeU imageSize);
+
+        /**
+         * @brief Free all the available buffers
+         */
+        void trim();
+
+        /**
+         * @brief Get the current pool statistics
+         *
+         * @return ImageBufferPoolStatistics The statistics snapshot
+         */
+        ImageBufferPoolStatistics getStatistics() const;
+
+    private:
+        friend class ImageFrame;
+
+        void recycle(ImageFrame::Slot* pSlot);
+
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<std::unique_ptr<ImageFrame::Slot>> m_slots;
+        std::vector<ImageFrame::Slot*> m_availableSlots;
+        std::size_t m_peakUsedBuffers;
+        std::size_t m_allocations;
+        std::size_t m_allocatedBytes;
+    };
+}
+
+#endif // VW_IMAGE_BUFFER_POOL_H
@@ -0,0 +1,91 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_IMAGE_METRICS_H
+#define VW_IMAGE_METRICS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageBuffer.h"
+#include "Size.h"
+
+namespace vw {
+    /**
+     * @brief Quality of a plane compared to a reference
+     */
+    struct PlaneQuality {
+        uint64_t squaredError;  ///< Sum of the squared sample differences
+        uint64_t samples;       ///< Number of compared samples
+        double ssim;            ///< Mean structural similarity, 1 for identical planes
+    };
+
+    /**
+     * @brief Compute the sum of the squared differences of two 8 bits planes
+     *
+     * @param pFirst The first plane
+     * @param firstLineSize The line size in bytes of the first plane
+     * @param pSecond The second plane
+     * @param secondLineSize The line size in bytes of the second plane
+     * @param width The number of samples per line
+     * @param height The number of lines
+     * @return uint64_t The sum of the squared differences
+     */
+    uint64_t computeSquaredError(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Compute the mean SSIM of two 8 bits planes
+     *
+     * The SSIM is computed on 8x8 windows spaced by 4 samples, without
+     * weighting, like the x264 and ffmpeg implementations, so the values
+     * can be compared to the ffmpeg ssim filter.
+     *
+     * @param pFirst The first plane
+     * @param firstLineSize The line size in bytes of the first plane
+     * @param pSecond The second plane
+     * @param secondLineSize The line size in bytes of the second plane
+     * @param width The number of samples per line (at least 8)
+     * @param height The number of lines (at least 8)
+     * @return double The mean SSIM, between -1 and 1
+     */
+    double computeSsim(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Convert a squared error to a PSNR for 8 bits samples
+     *
+     * @param squaredError The sum of the squared differences
+     * @param samples The number of compared samples
+     * @return double The PSNR in dB, infinity for identical samples
+     */
+    double computePsnr(uint64_t squaredError, uint64_t samples);
+
+    /**
+     * @brief Compare the visible area of two I420 images plane by plane
+     *
+     * @param image The image to evaluate
+     * @param reference The reference image
+     * @param visibleSize The compared area, starting at the top-left corner
+     * @return std::vector<PlaneQuality> The Y, U and V qualities
+     */
+    std::vector<PlaneQuality> compareImages(const ImageBuffer& image, const ImageBuffer& reference, SizeU visibleSize);
+}
+
+#endif // VW_IMAGE_METRICS_H
@@ -0,0 +1,88 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_MAPPED_FILE_H
+#define VW_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vw {
+    /**
+     * @brief MappedFile maps a whole file read-only in memory
+     *
+     * The pages are loaded by the kernel on first access and shared with the page
+     * cache, so the file content can be handed to VDPAU without being read into a
+     * heap buffer first. The mapping is released on destruction.
+     *
+     * @sa ImageBuffer::view
+     */
+    class MappedFile {
+    public:
+        /**
+         * @brief Map the specified file
+         *
+         * @param szFilename The file to map
+         */
+        MappedFile(const std::string& szFilename);
+        /**
+         * @brief Unmap the file
+         */
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        /**
+         * @brief Get the mapped bytes
+         *
+         * @return const uint8_t* The beginning of the file content
+         */
+        const uint8_t* getData() const;
+
+        /**
+         * @brief Get the size of the file
+         *
+         * @return std::size_t The file size in bytes
+         */
+        std::size_t getSize() const;
+
+        /**
+         * @brief Tell the kernel a range of the file will be needed soon
+         *
+         * The call doesn't block, the pages are read ahead in background.
+         *
+         * @param offset Offset of the range in bytes
+         * @param length Length of the range in bytes
+         */
+        void prefetch(std::size_t offset, std::size_t length) const;
+
+    private:
+        uint8_t* m_pData;
+        std::size_t m_size;
+    };
+}
+
+#endif // VW_MAPPED_FILE_H
@@ -0,0 +1,180 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_MOCK_BACKEND_H
+#define VW_MOCK_BACKEND_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include "CpuBackend.h"
+
+namespace vw {
+    /**
+     * @brief The VDPAU calls slowed down by the MockBackend
+     */
+    enum class MockCall {
+        DecoderRender,      ///< VdpDecoderRender
+        VideoMixerRender,   ///< VdpVideoMixerRender
+        GetBits,            ///< VdpVideoSurfaceGetBitsYCbCr and VdpOutputSurfaceGetBitsNative
+    };
+
+    /**
+     * @brief LatencyDistribution describes the duration of a simulated GPU call
+     */
+    class LatencyDistribution {
+    public:
+        /**
+         * @brief Construct a distribution without latency
+         */
+        LatencyDistribution();
+
+        /**
+         * @brief Create a distribution always returning the same latency
+         *
+         * @param latency The latency of each call
+         * @return LatencyDistribution The constant distribution
+         */
+        static LatencyDistribution constant(std::chrono::microseconds latency);
+        /**
+         * @brief Create a distribution with latencies uniformly spread in [minimum, maximum]
+         *
+         * @param minimum The minimal latency
+         * @param maximum The maximal latency
+         * @return LatencyDistribution The uniform distribution
+         */
+        static LatencyDistribution uniform(std::chrono::microseconds minimum, std::chrono::microseconds maximum);
+        /**
+         * @brief Create a normal distribution, the negative samples are clamped to zero
+         *
+         * @param mean The mean latency
+         * @param standardDeviation The standard deviation of the latency
+         * @return LatencyDistribution The normal distribution
+         */
+        static LatencyDistribution normal(std::chrono::microseconds mean, std::chrono::microseconds standardDeviation);
+
+        /**
+         * @brief Draw a latency
+         *
+         * @param engine The random engine
+         * @return std::chrono::microseconds The sampled latency
+         */
+        std::chrono::microseconds sample(std::mt19937& engine) const;
+
+    private:
+        enum class Type {
+            Constant,
+            Uniform,
+            Normal,
+        };
+
+        LatencyDistribution(Type type, std::chrono::microseconds first, std::chrono::microseconds second);
+
+    private:
+        Type m_type;
+        std::chrono::microseconds m_first;
+        std::chrono::microseconds m_second;
+    };
+
+    /**
+     * @brief Latencies applied by the MockBackend
+     */
+    struct MockLatencyModel {
+        LatencyDistribution decoderRender;      ///< Latency of each decoded picture
+        LatencyDistribution videoMixerRender;   ///< Latency of each post-processed picture
+        LatencyDistribution getBits;            ///< Latency of each copy from GPU memory
+        uint32_t seed = 0;                      ///< Seed of the random engines
+    };
+
+    /**
+     * @brief Counters of the calls slowed down by the MockBackend
+     */
+    struct MockCallStatistics {
+        uint64_t calls = 0;                     ///< Number of calls
+        std::chrono::microseconds totalLatency = std::chrono::microseconds(0); ///< Sum of the simulated latencies
+    };
+
+    /**
+     * @brief MockBackend simulates a slow GPU to study the pipeline without hardware
+     *
+     * The backend exposes the entry points of a CpuBackend, but the decoder render,
+     * the video mixer render and the get bits calls block for a latency drawn from the
+     * model before doing their work. Each call kind has its own random engine seeded
+     * from the model seed, hence the sequence of latencies of a call kind is the same
+     * from a run to another, even when the calls are made from several threads.
+     *
+     * Since the VDPAU entry points have no context, only one MockBackend can be
+     * alive at a time.
+     */
+    class MockBackend : public Backend {
+    public:
+        /**
+         * @brief Construct a new MockBackend
+         *
+         * @param model The latency model
+         */
+        MockBackend(const MockLatencyModel& model);
+        /**
+         * @brief Destroy the MockBackend
+         */
+        ~MockBackend();
+
+        MockBackend(const MockBackend&) = delete;
+        MockBackend(MockBackend&&) = delete;
+
+        MockBackend& operator=(const MockBackend&) = delete;
+        MockBackend& operator=(MockBackend&&) = delete;
+
+        VdpDevice createDevice(VdpGetProcAddress** ppGetProcAddress) override;
+        std::string getName() const override;
+
+        /**
+         * @brief Get the counters of a call kind
+         *
+         * @param call The call kind
+         * @return MockCallStatistics The number of calls and the cumulated latency
+         */
+        MockCallStatistics getStatistics(MockCall call) const;
+
+        /**
+         * @brief Wait for the simulated latency of a call
+         *
+         * This is used by the mocked entry points.
+         *
+         * @param call The call kind
+         */
+        void simulateLatency(MockCall call);
+
+    private:
+        static constexpr std::size_t CallCount = 3;
+
+        CpuBackend m_cpuBackend;
+        std::array<LatencyDistribution, CallCount> m_distributions;
+        std::array<std::mt19937, CallCount> m_engines;
+        std::array<MockCallStatistics, CallCount> m_statistics;
+        mutable std::mutex m_mutex;
+    };
+}
+
+#endif // VW_MOCK_BACKEND_H
@@ -29,6 +29,7 @@
 #include <vdpau/vdpau.h>
 
 #include "Size.h"
+#include "Timestamp.h"
 
 namespace vw {
     /**
@@ -140,6 +141,17 @@ namespace vw {
         return "";
     }
 
+    /**
+     * @brief Selection of the coded pictures sent to the decoder
+     *
+     * The modes other than AllPictures are used for trick-play (fast-forward).
+     */
+    enum class DecodeMode {
+        AllPictures,            ///< All the coded pictures are decoded
+        ReferencePictures,      ///< Only the reference pictures are decoded (nal_ref_idc != 0)
+        IntraPictures,          ///< Only the IDR and I pictures are decoded
+    };
+
     /**
      * @brief H264Infos inherits of attribute of VdpPictureInfoH264 and add
      * other inforamtions for the Decoder
@@ -162,8 +174,25 @@ namespace vw {
         bool bFirstSPSReceived; ///< Indicate if a SPS has been received
         bool bFirstPPSReceived; ///< Indicate if a PPS has been received
         PictureReferenceType referenceType; ///< The type of picture structure
+        SliceType sliceType; ///< The type of the current slice
+        bool bFirstSliceOfPicture; ///< Indicate if the slice starts a coded picture (first_mb_in_slice is 0)
+
+        // For presentation
+        VdpTime presentationTimeStamp; ///< PTS of the current picture in nanoseconds (NoTimestamp if unknown)
+        int iReorderDepth; ///< Maximum number of pictures preceding any picture in decode order and following it in output order
     };
 
+    /**
+     * @brief Check if a coded picture is selected by a decode mode
+     *
+     * @param infos The H264 informations of the coded picture
+     * @param type The NAL type (must be a coded slice)
+     * @param mode The decode mode
+     * @return true If the picture must be decoded
+     * @return false If the picture is dropped
+     */
+    bool isPictureSelected(const H264Infos& infos, NalType type, DecodeMode mode);
+
     /**
      * @brief NalUnit represents a NAL unit
      *
@@ -204,6 +233,35 @@ namespace vw {
          * @return const std::vector<uint8_t>& The coded data
          */
         const std::vector<uint8_t>& getBitstream() const;
+        /**
+         * @brief Get the Picture Order Count (POC) of the coded picture
+         *
+         * The value is the same as the one set on the DecodedSurface by the Decoder.
+         *
+         * @return int The picture order count
+         */
+        int getPictureOrderCount() const;
+        /**
+         * @brief Check if the coded picture is used as reference (nal_ref_idc != 0)
+         *
+         * @return true If the picture is a reference picture
+         * @return false Otherwise
+         */
+        bool isReference() const;
+        /**
+         * @brief Get the Presentation Time Stamp (PTS) of the coded picture
+         *
+         * @return VdpTime The PTS in nanoseconds or NoTimestamp if unknown
+         */
+        VdpTime getPresentationTimeStamp() const;
+        /**
+         * @brief Check if the coded picture is selected by a decode mode
+         *
+         * @param mode The decode mode
+         * @return true If the picture must be decoded
+         * @return false If the picture is dropped
+         */
+        bool isSelected(DecodeMode mode) const;
 
     private:
         H264Infos m_h264Infos;
@@ -0,0 +1,133 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_PIXEL_CONVERSION_H
+#define VW_PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ImageBuffer.h"
+
+namespace vw {
+    /**
+     * @brief Enumeration of the instruction sets used by the conversion kernels
+     */
+    enum class SimdLevel {
+        Scalar, ///< Portable C++ loops
+        SSSE3,  ///< 128 bits x86 kernels
+        AVX2,   ///< 256 bits x86 kernels
+    };
+
+    /**
+     * @brief Get the best instruction set supported by the CPU
+     *
+     * @return SimdLevel The level detected at runtime
+     */
+    SimdLevel getSupportedSimdLevel();
+
+    /**
+     * @brief Get the instruction set currently used by the kernels
+     *
+     * @return SimdLevel The current level, getSupportedSimdLevel() by default
+     */
+    SimdLevel getSimdLevel();
+
+    /**
+     * @brief Force the instruction set used by the kernels
+     *
+     * Mainly useful to compare the kernels in benchmarks. The level is clamped
+     * to the one supported by the CPU.
+     *
+     * @param level The requested level
+     */
+    void setSimdLevel(SimdLevel level);
+
+    /**
+     * @brief Get a printable name of an instruction set
+     *
+     * @param level The level
+     * @return const char* The name
+     */
+    const char* getSimdLevelName(SimdLevel level);
+
+    /**
+     * @brief Expand a line of BGR pixels to opaque BGRA
+     *
+     * @param pSource The BGR pixels (3 bytes each)
+     * @param pDestination The BGRA pixels (4 bytes each)
+     * @param pixels Number of pixels
+     */
+    void convertBGRToBGRA(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels);
+
+    /**
+     * @brief Expand a line of RGB pixels to opaque BGRA
+     *
+     * @param pSource The RGB pixels (3 bytes each)
+     * @param pDestination The BGRA pixels (4 bytes each)
+     * @param pixels Number of pixels
+     */
+    void convertRGBToBGRA(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels);
+
+    /**
+     * @brief Split a line of interleaved U/V samples (NV12 chroma) in two planes
+     *
+     * @param pUV The interleaved samples
+     * @param pU The U samples
+     * @param pV The V samples
+     * @param pairs Number of U/V pairs
+     */
+    void deinterleaveUV(const uint8_t* pUV, uint8_t* pU, uint8_t* pV, std::size_t pairs);
+
+    /**
+     * @brief Merge a line of U samples and a line of V samples (I420 chroma) in one interleaved line
+     *
+     * @param pU The U samples
+     * @param pV The V samples
+     * @param pUV The interleaved samples
+     * @param pairs Number of U/V pairs
+     */
+    void interleaveUV(const uint8_t* pU, const uint8_t* pV, uint8_t* pUV, std::size_t pairs);
+
+    /**
+     * @brief Pack a line of NV12 luma with its chroma line to YUYV
+     *
+     * @param pY The luma samples
+     * @param pUV The interleaved chroma samples of the line
+     * @param pYUYV The packed pixels, 2 bytes per pixel rounded up to a pair
+     * @param pixels Number of pixels
+     */
+    void convertNV12ToYUYV(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t pixels);
+
+    /**
+     * @brief Convert an image to the format of another buffer
+     *
+     * Supported conversions are NV12 to I420, I420 to NV12, NV12 to YUYV and
+     * any format to itself. The destination keeps its format and gets the
+     * source size; a view destination must already have this size.
+     *
+     * @param source The image to convert
+     * @param destination The converted image
+     */
+    void convertImage(const ImageBuffer& source, ImageBuffer& destination);
+}
+
+#endif // VW_PIXEL_CONVERSION_H
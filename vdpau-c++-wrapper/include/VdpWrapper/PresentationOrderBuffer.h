@@ -0,0 +1,129 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_PRESENTATION_ORDER_BUFFER_H
+#define VW_PRESENTATION_ORDER_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+namespace vw {
+    /**
+     * @brief PresentationOrderBuffer puts the decoded pictures back in presentation order
+     *
+     * The pictures are inserted in decoding order with their picture order count and
+     * released in presentation order once more than the reorder depth of the stream
+     * are waiting. A picture order count of 0 (IDR picture) starts a new sequence, the
+     * pictures of the previous one are released first.
+     *
+     * The released pictures are handed to a callback. A picture is removed from the
+     * buffer before its callback is called, so the callback may block or throw.
+     *
+     * @tparam T Type of the buffered pictures
+     */
+    template<typename T>
+    class PresentationOrderBuffer {
+    public:
+        /**
+         * @brief Construct a new PresentationOrderBuffer object
+         *
+         * @param iReorderDepth Number of pictures kept before releasing the first one
+         */
+        explicit PresentationOrderBuffer(int iReorderDepth = 0)
+        : m_iReorderDepth(0) {
+            setReorderDepth(iReorderDepth);
+        }
+
+        /**
+         * @brief Set the reorder depth given by the SPS
+         *
+         * @param iReorderDepth Number of pictures kept, a negative value is handled as 0
+         */
+        void setReorderDepth(int iReorderDepth) {
+            m_iReorderDepth = static_cast<std::size_t>(std::max(iReorderDepth, 0));
+        }
+
+        /**
+         * @brief Insert a decoded picture and release the pictures whose turn has come
+         *
+         * @param iPictureOrderCount The picture order count of the picture
+         * @param picture The picture
+         * @param release Callback called with each released picture (T&&), in presentation order
+         */
+        template<typename Release>
+        void push(int iPictureOrderCount, T picture, Release&& release) {
+            if (iPictureOrderCount == 0) {
+                flush(release);
+            }
+
+            auto position = std::upper_bound(m_pictures.begin(), m_pictures.end(), iPictureOrderCount, [](int iValue, const Entry& other) {
+                return iValue < other.iPictureOrderCount;
+            });
+            m_pictures.insert(position, { iPictureOrderCount, std::move(picture) });
+
+            while (m_pictures.size() > m_iReorderDepth) {
+                releaseFront(release);
+            }
+        }
+
+        /**
+         * @brief Release all the buffered pictures, at the end of the stream
+         *
+         * @param release Callback called with each released picture (T&&), in presentation order
+         */
+        template<typename Release>
+        void flush(Release&& release) {
+            while (!m_pictures.empty()) {
+                releaseFront(release);
+            }
+        }
+
+        /**
+         * @brief Check if pictures are waiting
+         *
+         * @return bool True if the buffer is empty
+         */
+        bool isEmpty() const {
+            return m_pictures.empty();
+        }
+
+    private:
+        struct Entry {
+            int iPictureOrderCount;
+            T picture;
+        };
+
+        template<typename Release>
+        void releaseFront(Release& release) {
+            T picture = std::move(m_pictures.front().picture);
+            m_pictures.pop_front();
+            release(std::move(picture));
+        }
+
+    private:
+        std::deque<Entry> m_pictures;
+        std::size_t m_iReorderDepth;
+    };
+}
+
+#endif // VW_PRESENTATION_ORDER_BUFFER_H
@@ -22,15 +22,23 @@
 #ifndef VW_PRESENTATION_QUEUE_H
 #define VW_PRESENTATION_QUEUE_H
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #include <vdpau/vdpau.h>
 
+#include "Framerate.h"
 #include "RenderSurface.h"
+#include "Timestamp.h"
 
 namespace vw {
     class Device;
     class Display;
+    class RenderSurfacePool;
 
     /**
      * @brief QueuedSurface represents a surface waiting to be displayed
@@ -83,9 +91,25 @@ namespace vw {
         /**
          * @brief Set the video framerate
          *
-         * @param iFPS Number of Frame Per Second
+         * The presentation times are computed from the frame index with
+         * the rational framerate, so non integer framerates like 30000/1001
+         * are played without drift.
+         *
+         * @param framerate Number of Frame Per Second
+         */
+        void setFramerate(Framerate framerate);
+
+        /**
+         * @brief Set the playback speed for the trick-play
+         *
+         * The presentation step is divided by the speed factor, hence
+         * the timeline of the video is played faster. The pictures
+         * dropped by the decoder must be reported with skip() to keep
+         * their time slot.
+         *
+         * @param iSpeed Speed factor (1 for normal playback)
          */
-        void setFramerate(int iFPS);
+        void setPlaybackSpeed(int iSpeed);
 
         /**
          * @brief Set the order of displayed images
@@ -108,11 +132,14 @@ namespace vw {
          * object to its intern queue.
          *
          * When a surface is added, the queue is sorted by surface
-         * presentation times. This time is computed form the Picture
-         * Order Count if it's specified otherwise the presentation time
-         * is set to the current time.
+         * presentation times. This time is computed from the Presentation
+         * Time Stamp (PTS) of the surface if it's known, otherwise from the
+         * Picture Order Count if it's specified, otherwise the presentation
+         * time is set to the current time.
          *
          * The sort is mandatory by VDPAU to keep the right display order.
+         * With PTS, a surface is sent to VDPAU as soon as more surfaces than
+         * the reorder depth are waiting.
          *
          * @param surface
          * @return true
@@ -120,10 +147,83 @@ namespace vw {
          */
         bool enqueue(RenderSurface surface);
 
-    private:
+        /**
+         * @brief Skip a picture which will not be enqueued
+         *
+         * The time slot of the picture is reserved as if the surface was enqueued,
+         * so the following pictures keep their presentation time and the end of
+         * the schedule moves forward. Moreover, the pictures waiting for the
+         * skipped one in presentation order are released.
+         *
+         * @param iPictureOrderCount The Picture Order Count of the dropped picture
+         * @param presentationTimeStamp The PTS of the dropped picture (NoTimestamp if unknown)
+         */
+        void skip(int iPictureOrderCount, VdpTime presentationTimeStamp = NoTimestamp);
+
+        /**
+         * @brief Set the size of the reorder window used with the PTS
+         *
+         * This is the maximum number of pictures which can precede any picture
+         * in decode order and follow it in presentation order.
+         *
+         * @param iReorderDepth The number of surfaces kept before being displayed
+         */
+        void setReorderDepth(int iReorderDepth);
+
+        /**
+         * @brief Send all the waiting surfaces to VDPAU
+         *
+         * This must be called at the end of the stream since some surfaces
+         * may wait for pictures that will never come.
+         */
+        void flush();
+
+        /**
+         * @brief Get the current time of the VDPAU presentation clock
+         *
+         * @return VdpTime The current time in nanoseconds
+         */
         VdpTime getCurrentTime();
 
+        /**
+         * @brief Get the time when the last scheduled picture leaves the screen
+         *
+         * If the current time is greater than this value, the queue is empty
+         * and the pictures are late.
+         *
+         * @return VdpTime The end of the presentation schedule in nanoseconds
+         */
+        VdpTime getScheduleEndTime() const;
+
+        /**
+         * @brief Start a worker which gives back the idle surfaces to a pool
+         *
+         * By default, the displayed surfaces are only freed during the next
+         * enqueue() call. When the reclaim worker is enabled, a dedicated thread
+         * polls the status of queued surfaces and releases them to the pool as
+         * soon as they leave the screen, even if the decoder stalls. If the
+         * worker fails, the surfaces are released to the pool by enqueue() again.
+         *
+         * The pool must outlive the PresentationQueue.
+         *
+         * @param surfacePool The pool receiving the idle surfaces
+         * @param pollInterval The delay between two surface status polls
+         */
+        void enableSurfaceReclaim(RenderSurfacePool& surfacePool, std::chrono::microseconds pollInterval = std::chrono::milliseconds(2));
+
     private:
+        void updateFramerate();
+        VdpTime computePresentationTime(int iPOC);
+        VdpTime computeTimestampPresentationTime(VdpTime streamTimestamp);
+        void enableTimestampMode();
+        void displayPendingSurfaces();
+        void displayTimestampedSurfaces(std::size_t maxPendingSurfaces);
+        VdpPresentationQueueStatus querySurfaceStatus(VdpOutputSurface surface);
+        void releaseIdleSurfaces();
+        void reclaimSurfaces();
+
+    private:
+        Device& m_device;
         VdpPresentationQueueTarget m_vdpQueueTarget;
         VdpPresentationQueue m_vdpQueue;
         std::deque<QueuedSurface> m_queuedSurfaces;
@@ -132,9 +232,29 @@ namespace vw {
         bool m_bDirectOutput;
         VdpTime m_beginTime;
         VdpTime m_endTime;
-        VdpTime m_framerateStep;
+        VdpTime m_originTime;
+        uint64_t m_iFrameIndex;
+        Framerate m_framerate;
+        Framerate m_scaledFramerate;
+        int m_iPlaybackSpeed;
 
         int m_iNextPOC;
+        std::set<int> m_skippedPOCs;
+
+        // Presentation from the stream timestamps
+        bool m_bTimestampMode;
+        std::size_t m_iReorderDepth;
+        VdpTime m_timestampOriginTime;
+        VdpTime m_firstTimestamp;
+
+        // Surface reclaim worker
+        RenderSurfacePool* m_pSurfacePool;
+        std::chrono::microseconds m_reclaimPollInterval;
+        std::mutex m_queueMutex;
+        std::condition_variable m_reclaimCondition;
+        std::thread m_reclaimThread;
+        bool m_bStopReclaim;
+        bool m_bReclaimFailed;
     };
 }
 
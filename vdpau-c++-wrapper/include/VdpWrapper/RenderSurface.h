@@ -27,10 +27,13 @@
 #include <vdpau/vdpau.h>
 
 #include "ImageBuffer.h"
+#include "ImageBufferPool.h"
 #include "Size.h"
+#include "Timestamp.h"
 
 namespace vw {
     class Device;
+    class VdpFunctions;
 
     /**
      * @brief DecodedSurface encapsules a VdpOutputSurface
@@ -80,6 +83,12 @@ namespace vw {
          */
         RenderSurface& operator=(RenderSurface&& other);
 
+        /**
+         * @brief Get the sufrace size
+         *
+         * @return SizeU The surface size
+         */
+        SizeU getSize() const;
         /**
          * @brief Get the opaque VDPAU handle value
          *
@@ -98,21 +107,67 @@ namespace vw {
          * @return int The current POC value
          */
         int getPictureOrderCount() const;
+        /**
+         * @brief Set the Presentation Time Stamp (PTS)
+         *
+         * @param presentationTimeStamp New PTS value in nanoseconds or NoTimestamp
+         */
+        void setPresentationTimeStamp(VdpTime presentationTimeStamp);
+        /**
+         * @brief Get the Presentation Time Stamp (PTS)
+         *
+         * @return VdpTime The PTS in nanoseconds or NoTimestamp if unknown
+         */
+        VdpTime getPresentationTimeStamp() const;
+
+        /**
+         * @brief Copy an image to the GPU memory
+         *
+         * The planes are read in place, so uploading a view over external memory
+         * doesn't copy anything on the CPU side.
+         *
+         * @param buffer A BGRA image, owned or a view
+         */
+        void upload(const ImageBuffer& buffer);
 
         /**
          * @brief Copy the GPU data to an ImageBuffer
          *
+         * The image buffer has the storage size reported by the driver, which
+         * may be larger than getSize() when the surface is padded.
+         *
          * @return ImageBuffer The image buffer filled with GPU data
          */
         ImageBuffer copyHardwareMemory();
 
+        /**
+         * @brief Copy the GPU data to an existing ImageBuffer
+         *
+         * The buffer is resized to the surface storage layout, its allocation is
+         * reused when it is large enough.
+         *
+         * @param buffer The image buffer to fill with GPU data
+         */
+        void copyHardwareMemory(ImageBuffer& buffer);
+
+        /**
+         * @brief Copy the GPU data to a buffer taken from a pool
+         *
+         * @param pool The pool providing the image buffer
+         * @return ImageFrame The frame filled with GPU data, its buffer goes back to the pool on release
+         */
+        ImageFrame copyHardwareMemory(ImageBufferPool& pool);
+
     private:
         void allocateVdpSurface(Device& device, const SizeU& size);
 
     private:
+        const VdpFunctions* m_pFunctions;
         VdpOutputSurface m_vdpOutputSurface;
         SizeU m_size;
+        SizeU m_storageSize;
         int m_iPictureOrderCount;
+        VdpTime m_presentationTimeStamp;
     };
 }
 
@@ -0,0 +1,112 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_RENDER_SURFACE_POOL_H
+#define VW_RENDER_SURFACE_POOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "RenderSurface.h"
+#include "Size.h"
+
+namespace vw {
+    class Device;
+
+    /**
+     * @brief PoolOccupancy is a snapshot of the RenderSurfacePool usage
+     */
+    struct PoolOccupancy {
+        std::size_t allocatedSurfaces;  ///< Number of VdpOutputSurface currently allocated by the pool
+        std::size_t availableSurfaces;  ///< Number of surfaces waiting in the pool to be reused
+        std::size_t usedSurfaces;       ///< Number of surfaces currently handed out (mixed, queued or displayed)
+        std::size_t peakUsedSurfaces;   ///< Highest value reached by usedSurfaces
+    };
+
+    /**
+     * @brief RenderSurfacePool recycles the RenderSurface used as VideoMixer output
+     *
+     * Without a pool, a new VdpOutputSurface is allocated for each post-processed
+     * picture and freed when the PresentationQueue drops it. The pool keeps the
+     * released surfaces and hands them back on the next acquire() call when the
+     * requested size matches.
+     *
+     * The class is thread-safe: surfaces are acquired by the decoding thread and
+     * released by the PresentationQueue reclaim worker.
+     *
+     * @sa VideoMixer::setSurfacePool, PresentationQueue::enableSurfaceReclaim
+     */
+    class RenderSurfacePool {
+    public:
+        /**
+         * @brief Construct a new empty RenderSurfacePool
+         *
+         * @param device A reference to a valid Device
+         */
+        RenderSurfacePool(Device& device);
+        /**
+         * @brief Destroy the RenderSurfacePool and all the available surfaces
+         */
+        ~RenderSurfacePool() = default;
+
+        RenderSurfacePool(const RenderSurfacePool&) = delete;
+        RenderSurfacePool(RenderSurfacePool&&) = delete;
+
+        RenderSurfacePool& operator=(const RenderSurfacePool&) = delete;
+        RenderSurfacePool& operator=(RenderSurfacePool&&) = delete;
+
+        /**
+         * @brief Get a surface of the specified size
+         *
+         * An available surface is reused if its size matches, otherwise a new
+         * one is allocated. Available surfaces with another size (e.g. after a
+         * window resize) are freed.
+         *
+         * @param size The requested surface size
+         * @return RenderSurface A surface owned by the caller until release()
+         */
+        RenderSurface acquire(const SizeU& size);
+
+        /**
+         * @brief Give back a surface to the pool
+         *
+         * @param surface The surface that is no longer displayed
+         */
+        void release(RenderSurface surface);
+
+        /**
+         * @brief Get the current pool occupancy
+         *
+         * @return PoolOccupancy The occupancy snapshot
+         */
+        PoolOccupancy getOccupancy() const;
+
+    private:
+        Device& m_device;
+        mutable std::mutex m_mutex;
+        std::vector<RenderSurface> m_availableSurfaces;
+        std::size_t m_allocatedSurfaces;
+        std::size_t m_peakUsedSurfaces;
+    };
+}
+
+#endif // VW_RENDER_SURFACE_POOL_H
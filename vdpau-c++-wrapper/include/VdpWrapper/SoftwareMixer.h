@@ -0,0 +1,216 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_SOFTWARE_MIXER_H
+#define VW_SOFTWARE_MIXER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ImageBuffer.h"
+#include "ImageBufferPool.h"
+#include "Size.h"
+
+namespace vw {
+    class Device;
+    class DecodedSurface;
+    class RenderSurface;
+
+    /**
+     * @brief Enumeration of the YCbCr to RGB conversion matrices
+     */
+    enum class ColorStandard {
+        BT601,  ///< SD video (the VideoMixer default)
+        BT709,  ///< HD video
+    };
+
+    /**
+     * @brief Enumeration of the scaling filters
+     */
+    enum class ScalingFilter {
+        Bilinear,   ///< 2x2 taps
+        Bicubic,    ///< 4x4 taps, Catmull-Rom spline
+    };
+
+    /**
+     * @brief SoftwareMixer converts NV12 pictures to scaled BGRA pictures on the CPU
+     *
+     * This class does what VideoMixer::process() does on the GPU: the limited range
+     * YCbCr samples are converted to full range RGB and the picture is scaled to the
+     * output size. It's a fallback when the device has no usable video mixer, and a
+     * way to get BGRA pictures in memory without an output surface readback.
+     *
+     * The filter is separable: each output line is first filtered vertically from
+     * the source lines, then horizontally. The output lines are split in stripes
+     * processed by a pool of worker threads, the calling thread taking its share.
+     * The vertical pass and the color conversion use AVX2 when the SIMD level set
+     * in PixelConversion allows it.
+     *
+     * @note The filters aren't widened when downscaling, as the VideoMixer without
+     * high quality scaling feature.
+     */
+    class SoftwareMixer {
+    public:
+        /**
+         * @brief Construct a new SoftwareMixer object
+         *
+         * @param outputSize The output picture size
+         * @param iThreadCount Number of threads sharing the work, 0 for one per core
+         */
+        SoftwareMixer(SizeU outputSize, std::size_t iThreadCount = 0);
+        /**
+         * @brief Stop the worker threads
+         */
+        ~SoftwareMixer();
+
+        SoftwareMixer(const SoftwareMixer&) = delete;
+        SoftwareMixer(SoftwareMixer&&) = delete;
+
+        SoftwareMixer& operator=(const SoftwareMixer&) = delete;
+        SoftwareMixer& operator=(SoftwareMixer&&) = delete;
+
+        /**
+         * @brief Set the output picture size
+         *
+         * @param outputSize New output picture size
+         */
+        void setOutputSize(SizeU outputSize);
+
+        /**
+         * @brief Set the YCbCr to RGB conversion matrix
+         *
+         * @param standard The color standard of the input pictures (default: BT601)
+         */
+        void setColorStandard(ColorStandard standard);
+
+        /**
+         * @brief Set the scaling filter
+         *
+         * @param filter The filter (default: Bilinear)
+         */
+        void setScalingFilter(ScalingFilter filter);
+
+        /**
+         * @brief Get the number of threads sharing the work
+         *
+         * @return std::size_t The number of threads, the calling one included
+         */
+        std::size_t getThreadCount() const;
+
+        /**
+         * @brief Convert and scale a NV12 picture
+         *
+         * @param input The NV12 picture
+         * @param output The BGRA picture, resized to the output size
+         */
+        void process(const ImageBuffer& input, ImageBuffer& output);
+
+        /**
+         * @brief Convert and scale the visible part of a NV12 picture
+         *
+         * @param input The NV12 picture, possibly padded
+         * @param inputSize The size of the visible part, from the top left corner
+         * @param output The BGRA picture, resized to the output size
+         */
+        void process(const ImageBuffer& input, SizeU inputSize, ImageBuffer& output);
+
+        /**
+         * @brief Convert and scale a NV12 picture to a buffer taken from a pool
+         *
+         * @param input The NV12 picture
+         * @param pool The pool providing the output buffer
+         * @return ImageFrame The BGRA picture
+         */
+        ImageFrame process(const ImageBuffer& input, ImageBufferPool& pool);
+
+        /**
+         * @brief Post-process a decoded surface like VideoMixer::process()
+         *
+         * The surface is read back, converted on the CPU and uploaded to a new
+         * output surface. The POC and the PTS are forwarded.
+         *
+         * @param device The device owning the surfaces
+         * @param inputSurface Raw input surface
+         * @return RenderSurface The post-processed surface
+         */
+        RenderSurface process(Device& device, DecodedSurface& inputSurface);
+
+    private:
+        struct Taps {
+            std::size_t count = 0;
+            std::vector<uint32_t> indices;
+            std::vector<float> weights;
+        };
+
+        struct Scratch {
+            std::vector<float> luma;
+            std::vector<float> chroma;
+            std::vector<float> y;
+            std::vector<float> u;
+            std::vector<float> v;
+        };
+
+        void updateTaps(SizeU inputSize);
+        void processStripe(std::size_t iStripe);
+        void processLine(const ImageBuffer& input, ImageBuffer& output, uint32_t line, Scratch& scratch);
+        void runWorker(std::size_t iWorker);
+
+        static Taps computeTaps(ScalingFilter filter, uint32_t sourceSize, double scaleSource, uint32_t destinationSize);
+
+    private:
+        SizeU m_outputSize;
+        ColorStandard m_standard;
+        ScalingFilter m_filter;
+
+        // Filter taps, recomputed when the sizes or the filter change
+        SizeU m_tapsInputSize;
+        SizeU m_tapsOutputSize;
+        ScalingFilter m_tapsFilter;
+        bool m_bTapsValid;
+        Taps m_lumaColumns;
+        Taps m_lumaLines;
+        Taps m_chromaColumns;
+        Taps m_chromaLines;
+
+        // Current job, shared with the workers
+        const ImageBuffer* m_pInput;
+        ImageBuffer* m_pOutput;
+        std::vector<Scratch> m_scratches;
+        ImageBuffer m_readbackBuffer;
+        ImageBuffer m_outputBuffer;
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_workCondition;
+        std::condition_variable m_doneCondition;
+        uint64_t m_iGeneration;
+        std::size_t m_iStripeCount;
+        std::size_t m_iNextStripe;
+        std::size_t m_iFinishedStripes;
+        bool m_bStopping;
+    };
+}
+
+#endif // VW_SOFTWARE_MIXER_H
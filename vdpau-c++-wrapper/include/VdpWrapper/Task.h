@@ -0,0 +1,216 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_TASK_H
+#define VW_TASK_H
+
+#if __cplusplus < 202002L
+#error "The VdpWrapper coroutine API needs C++20, configure with -DVW_ENABLE_COROUTINES=ON"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace vw {
+    template<typename T>
+    class Task;
+
+    namespace detail {
+        /**
+         * @brief Common part of the Task promises
+         *
+         * The coroutine resumes its awaiter when it's done (symmetric transfer),
+         * so a chain of tasks doesn't grow the stack.
+         */
+        struct TaskPromiseBase {
+            struct FinalAwaiter {
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {
+                }
+            };
+
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() const noexcept {
+                return {};
+            }
+
+            void unhandled_exception() noexcept {
+                error = std::current_exception();
+            }
+
+            void rethrowIfFailed() const {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+        };
+
+        template<typename T>
+        struct TaskPromise : public TaskPromiseBase {
+            Task<T> get_return_object() noexcept;
+
+            void return_value(T newValue) {
+                value.emplace(std::move(newValue));
+            }
+
+            T takeResult() {
+                rethrowIfFailed();
+                return std::move(*value);
+            }
+
+            std::optional<T> value;
+        };
+
+        template<typename T>
+        struct TaskPromise<T&> : public TaskPromiseBase {
+            Task<T&> get_return_object() noexcept;
+
+            void return_value(T& newValue) noexcept {
+                pValue = &newValue;
+            }
+
+            T& takeResult() {
+                rethrowIfFailed();
+                return *pValue;
+            }
+
+            T* pValue = nullptr;
+        };
+
+        template<>
+        struct TaskPromise<void> : public TaskPromiseBase {
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {
+            }
+
+            void takeResult() {
+                rethrowIfFailed();
+            }
+        };
+    }
+
+    /**
+     * @brief Task is the coroutine type of the asynchronous API
+     *
+     * The task is lazy: its body starts when it's awaited, or when it's given to
+     * Executor::spawn(). Its arguments taken by reference must live until the end
+     * of the task, which is the case when the task is awaited right away.
+     *
+     * @tparam T The type of the co_return value
+     */
+    template<typename T = void>
+    class Task {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+
+        explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle) {
+
+        }
+
+        ~Task() {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+        }
+
+        Task(const Task&) = delete;
+        Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {
+
+        }
+
+        Task& operator=(const Task&) = delete;
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (m_handle) {
+                    m_handle.destroy();
+                }
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Start the task and suspend the awaiting coroutine until it's done
+         */
+        auto operator co_await() && noexcept {
+            struct Awaiter {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept {
+                    return !handle || handle.done();
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaitingHandle) noexcept {
+                    handle.promise().continuation = awaitingHandle;
+                    return handle;
+                }
+
+                decltype(auto) await_resume() {
+                    return handle.promise().takeResult();
+                }
+            };
+
+            return Awaiter{ m_handle };
+        }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    namespace detail {
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        template<typename T>
+        Task<T&> TaskPromise<T&>::get_return_object() noexcept {
+            return Task<T&>(std::coroutine_handle<TaskPromise<T&>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+    }
+}
+
+#endif // VW_TASK_H
@@ -22,6 +22,7 @@
 #ifndef VW_VDP_FUNCTIONS_H
 #define VW_VDP_FUNCTIONS_H
 
+#include <cstdint>
 #include <string>
 
 #include <vdpau/vdpau.h>
@@ -31,7 +32,10 @@ namespace vw {
     /**
      * @brief VdpFunctions initializes all API function pointers
      *
-     * This class holds all function pointers provide by VDPAU API.
+     * This class holds all function pointers provide by VDPAU API for a VdpDevice.
+     * Each Device owns its VdpFunctions, the table is never modified after the
+     * construction so it can be shared by several threads. When the CallTracer is
+     * active, the table holds the tracing shims of the device slot.
      */
     class VdpFunctions {
     public:
@@ -42,7 +46,7 @@ namespace vw {
          * @param pGetProcAddress Function pointer created by vdp_device_create_x11
          */
         VdpFunctions(VdpDevice& vdpDevice, VdpGetProcAddress* pGetProcAddress);
-        ~VdpFunctions() = default;
+        ~VdpFunctions();
 
         VdpFunctions(const VdpFunctions&) = delete;
         VdpFunctions(VdpFunctions&&) = delete;
@@ -64,7 +68,7 @@ namespace vw {
          * @param vdpStatus Status of VDPAU function call
          * @param message Contextual error message
          */
-        void throwExceptionOnFail(VdpStatus vdpStatus, const std::string& message);
+        void throwExceptionOnFail(VdpStatus vdpStatus, const std::string& message) const;
 
         /*
          * All this fields are function pointers initalized by the constructor
@@ -102,57 +106,8 @@ namespace vw {
     private:
         VdpGetProcAddress* m_pGetProcAddress;
         VdpGetErrorString* m_pGetErrorString;
+        uint32_t m_iTraceSlot;
     };
-
-    /**
-     * @brief VdpFunctionsInstance is a singleton of VdpFunctions
-     *
-     * This class aims to provide access at the VDPAU fonctions for all classes.
-     * The gVdpFunctionsInstance is created during the creation of a Device object et
-     * disposed when it's destroyed.
-     */
-    class VdpFunctionsInstance {
-    public:
-        /**
-         * @brief Initialize the sigleton with a null pointer
-         */
-        VdpFunctionsInstance();
-
-        /**
-         * @brief Release the singleton
-         */
-        ~VdpFunctionsInstance();
-
-        VdpFunctionsInstance(const VdpFunctionsInstance&) = delete;
-        VdpFunctionsInstance(VdpFunctionsInstance&&) = delete;
-
-        VdpFunctionsInstance& operator=(const VdpFunctionsInstance&) = delete;
-        VdpFunctionsInstance& operator=(VdpFunctionsInstance&&) = delete;
-
-        /**
-         * @brief Effective instantiation of VdpFunctions object
-         *
-         * @param vdpDevice A valid handle of VdpDevice
-         * @param pGetProcAddress Function pointer created by vdp_device_create_x11
-         */
-        void create(VdpDevice& vdpDevice, VdpGetProcAddress* pGetProcAddress);
-        /**
-         * @brief Destroy the instance of VdpFunctions
-         */
-        void dispose();
-
-        /**
-         * @brief Accessor to the instance of VdpFunctions
-         *
-         * @return VdpFunctions* The pointer to VdpFunctions instance
-         */
-        VdpFunctions* operator()();
-
-    private:
-        VdpFunctions *m_pVdpFunction;
-    };
-
-    extern VdpFunctionsInstance gVdpFunctionsInstance; ///< Global VdpFunctionsInstance singleton access
 }
 
 #endif // VW_VDP_FUNCTIONS_H
@@ -30,6 +30,7 @@ namespace vw {
     class Device;
     class RenderSurface;
     class DecodedSurface;
+    class RenderSurfacePool;
 
     /**
      * @brief VideoMixer class encapsules a VdpVideoMixer
@@ -66,6 +67,17 @@ namespace vw {
          */
         void setOutputSize(SizeU outputSize);
 
+        /**
+         * @brief Set the pool used to get the output surfaces
+         *
+         * By default, a new RenderSurface is allocated on each process() call.
+         * When a pool is set, the output surfaces are taken from it instead.
+         * The pool must outlive the VideoMixer.
+         *
+         * @param pSurfacePool The surface pool or nullptr to disable it
+         */
+        void setSurfacePool(RenderSurfacePool* pSurfacePool);
+
         /**
          * @brief Post-process an input surface and return a processed surface
          *
@@ -89,6 +101,7 @@ namespace vw {
         Device& m_device;
         VdpVideoMixer m_mixer;
         SizeU m_outputSize;
+        RenderSurfacePool* m_pSurfacePool;
     };
 }
 
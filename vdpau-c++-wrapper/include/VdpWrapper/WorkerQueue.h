@@ -0,0 +1,261 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_WORKER_QUEUE_H
+#define VW_WORKER_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vw {
+    /**
+     * @brief Statistics of a WorkerQueue
+     */
+    struct WorkerQueueStatistics {
+        uint64_t stalls;                    ///< Number of push() calls which waited for a free slot
+        std::chrono::nanoseconds stallTime; ///< Total time spent waiting for a free slot
+    };
+
+    /**
+     * @brief WorkerQueue runs jobs on worker threads with a bounded queue
+     *
+     * At most depth jobs are waiting or running: push() blocks beyond, so the
+     * producer can't get more than depth jobs ahead of the workers and the memory
+     * held by the jobs is bounded.
+     *
+     * The handler either takes the jobs one at a time, on one or several threads,
+     * or takes all the waiting jobs at once on a single thread. A job is destroyed
+     * before its slot is released. An exception thrown by the handler doesn't stop
+     * the workers: the first error is kept for getError() and the following jobs
+     * are still handled.
+     *
+     * @tparam Job Type of the queued jobs
+     */
+    template<typename Job>
+    class WorkerQueue {
+    public:
+        using JobHandler = std::function<void(Job& job)>;
+        using BatchHandler = std::function<void(std::vector<Job>& batch)>;
+
+        /**
+         * @brief Start workers handling the jobs one at a time
+         *
+         * The jobs are started in push order, but with several threads they may
+         * complete in any order.
+         *
+         * @param iDepth Maximum number of waiting and running jobs
+         * @param iThreadCount Number of worker threads
+         * @param handler Function called on a worker thread for each job
+         */
+        WorkerQueue(std::size_t iDepth, std::size_t iThreadCount, JobHandler handler)
+        : m_iDepth(iDepth)
+        , m_iMaxBatchSize(1)
+        , m_handler([handler = std::move(handler)](std::vector<Job>& batch) {
+            handler(batch.front());
+        }) {
+            start(iThreadCount);
+        }
+
+        /**
+         * @brief Start a single worker handling all the waiting jobs at once
+         *
+         * @param iDepth Maximum number of waiting and running jobs
+         * @param handler Function called on the worker thread with the jobs in push order
+         */
+        WorkerQueue(std::size_t iDepth, BatchHandler handler)
+        : m_iDepth(iDepth)
+        , m_iMaxBatchSize(std::numeric_limits<std::size_t>::max())
+        , m_handler(std::move(handler)) {
+            start(1);
+        }
+
+        /**
+         * @brief Handle the remaining jobs and stop the workers
+         */
+        ~WorkerQueue() {
+            stop();
+        }
+
+        WorkerQueue(const WorkerQueue&) = delete;
+        WorkerQueue(WorkerQueue&&) = delete;
+
+        WorkerQueue& operator=(const WorkerQueue&) = delete;
+        WorkerQueue& operator=(WorkerQueue&&) = delete;
+
+        /**
+         * @brief Queue a job, block while all the slots are used
+         *
+         * @param job The job
+         */
+        void push(Job job) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (m_pendingJobs.size() + m_iRunningJobs >= m_iDepth) {
+                ++m_statistics.stalls;
+                auto startTime = std::chrono::steady_clock::now();
+                m_slotCondition.wait(lock, [this]() {
+                    return m_pendingJobs.size() + m_iRunningJobs < m_iDepth;
+                });
+                m_statistics.stallTime += std::chrono::steady_clock::now() - startTime;
+            }
+
+            m_pendingJobs.push_back(std::move(job));
+            m_workCondition.notify_one();
+        }
+
+        /**
+         * @brief Wait until all the queued jobs are handled
+         */
+        void flush() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_slotCondition.wait(lock, [this]() {
+                return m_pendingJobs.empty() && m_iRunningJobs == 0;
+            });
+        }
+
+        /**
+         * @brief Handle the remaining jobs and join the workers
+         *
+         * The owner calls it before destroying the state used by the handler.
+         * No job can be pushed afterwards.
+         */
+        void stop() {
+            flush();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_bStopping = true;
+            }
+            m_workCondition.notify_all();
+
+            for (auto& thread: m_threads) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+        }
+
+        /**
+         * @brief Get the first error thrown by the handler
+         *
+         * @return std::string The error message, empty if none
+         */
+        std::string getError() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_szError;
+        }
+
+        /**
+         * @brief Get the backpressure statistics
+         *
+         * @return WorkerQueueStatistics The counters
+         */
+        WorkerQueueStatistics getStatistics() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_statistics;
+        }
+
+    private:
+        void start(std::size_t iThreadCount) {
+            if (iThreadCount == 0) {
+                throw std::runtime_error("[WorkerQueue] The thread count must be positive");
+            }
+
+            if (m_iDepth == 0) {
+                throw std::runtime_error("[WorkerQueue] The depth must be positive");
+            }
+
+            for (std::size_t i = 0; i < iThreadCount; ++i) {
+                m_threads.emplace_back(&WorkerQueue::run, this);
+            }
+        }
+
+        void run() {
+            std::vector<Job> batch;
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            while (true) {
+                m_workCondition.wait(lock, [this]() {
+                    return m_bStopping || !m_pendingJobs.empty();
+                });
+
+                if (m_pendingJobs.empty()) {
+                    return;
+                }
+
+                while (!m_pendingJobs.empty() && batch.size() < m_iMaxBatchSize) {
+                    batch.push_back(std::move(m_pendingJobs.front()));
+                    m_pendingJobs.pop_front();
+                }
+                std::size_t iJobCount = batch.size();
+                m_iRunningJobs += iJobCount;
+                lock.unlock();
+
+                std::string szError;
+                try {
+                    m_handler(batch);
+                } catch (const std::exception& error) {
+                    szError = error.what();
+                }
+
+                // The jobs release their resources before waiting for the lock
+                batch.clear();
+
+                lock.lock();
+                if (!szError.empty() && m_szError.empty()) {
+                    m_szError = szError;
+                }
+
+                m_iRunningJobs -= iJobCount;
+                m_slotCondition.notify_all();
+            }
+        }
+
+    private:
+        std::size_t m_iDepth;
+        std::size_t m_iMaxBatchSize;
+        BatchHandler m_handler;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_workCondition;
+        std::condition_variable m_slotCondition;
+        std::deque<Job> m_pendingJobs;
+        std::size_t m_iRunningJobs = 0;
+        std::string m_szError;
+        WorkerQueueStatistics m_statistics = {0, {}};
+        bool m_bStopping = false;
+        std::vector<std::thread> m_threads;
+    };
+}
+
+#endif // VW_WORKER_QUEUE_H
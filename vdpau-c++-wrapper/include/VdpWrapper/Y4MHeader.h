@@ -0,0 +1,67 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VW_Y4M_HEADER_H
+#define VW_Y4M_HEADER_H
+
+#include <cstddef>
+#include <string>
+
+#include "Framerate.h"
+#include "ImageBuffer.h"
+#include "Size.h"
+
+namespace vw {
+    constexpr char Y4MSignature[] = "YUV4MPEG2 ";   ///< Start of the stream header line
+    constexpr char Y4MFrameMarker[] = "FRAME";      ///< Start of each frame header line
+    constexpr std::size_t Y4MMaxLineLength = 1024;  ///< Longest accepted header line, the parameters are only a few tokens
+
+    /**
+     * @brief Stream parameters of a YUV4MPEG2 (Y4M) header
+     */
+    struct Y4MHeader {
+        PixelFormat format;     ///< Layout of the frames
+        SizeU size;             ///< Picture size
+        Framerate framerate;    ///< Framerate, 0:0 if the header doesn't define it
+    };
+
+    /**
+     * @brief Check if a file starts with the Y4M signature
+     *
+     * @param pData The beginning of the file
+     * @param size The number of available bytes
+     * @return bool True if the data is a Y4M stream
+     */
+    bool hasY4MSignature(const void* pData, std::size_t size);
+
+    /**
+     * @brief Parse the stream header line of a Y4M file
+     *
+     * The 4:2:0 layouts only differ by the chroma siting, they are all stored as I420.
+     * The other colorspaces are rejected.
+     *
+     * @param szLine The header line, signature included and without the line feed
+     * @return Y4MHeader The stream parameters, the picture size is always defined
+     */
+    Y4MHeader parseY4MHeader(const std::string& szLine);
+}
+
+#endif // VW_Y4M_HEADER_H
@@ -0,0 +1,109 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FramePrefetcher.h"
+
+#include <algorithm>
+
+#include <unistd.h>
+
+FramePrefetcher::FramePrefetcher(const RawSequence& sequence, std::size_t iDepth, bool bLoop)
+: m_sequence(sequence)
+, m_iDepth(iDepth)
+, m_bLoop(bLoop)
+, m_pageSize(::sysconf(_SC_PAGESIZE))
+, m_iPosition(0)
+, m_iPrefetchedFrames(0)
+, m_bStopping(false) {
+    m_thread = std::thread(&FramePrefetcher::run, this);
+}
+
+FramePrefetcher::~FramePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+    m_condition.notify_one();
+
+    m_thread.join();
+}
+
+void FramePrefetcher::setPosition(uint64_t iFrameNumber) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_iPosition = iFrameNumber;
+    }
+    m_condition.notify_one();
+}
+
+uint64_t FramePrefetcher::getPrefetchedFrames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_iPrefetchedFrames;
+}
+
+void FramePrefetcher::run() {
+    uint64_t iNextFrame = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_condition.wait(lock, [&]() {
+            return m_bStopping || hasWork(std::max(iNextFrame, m_iPosition));
+        });
+
+        if (m_bStopping) {
+            return;
+        }
+
+        // The frames already played are not worth loading anymore
+        iNextFrame = std::max(iNextFrame, m_iPosition);
+
+        lock.unlock();
+        loadFrame(iNextFrame % m_sequence.getFrameCount());
+        lock.lock();
+
+        ++iNextFrame;
+        ++m_iPrefetchedFrames;
+    }
+}
+
+bool FramePrefetcher::hasWork(uint64_t iNextFrame) const {
+    if (!m_bLoop && iNextFrame >= m_sequence.getFrameCount()) {
+        return false;
+    }
+
+    return iNextFrame <= m_iPosition + m_iDepth;
+}
+
+void FramePrefetcher::loadFrame(std::size_t iFrameIndex) {
+    auto range = m_sequence.getFrameRange(iFrameIndex);
+    auto pFile = m_sequence.getFile();
+
+    // Start the read-ahead of the whole frame, then wait for each page
+    pFile->prefetch(range.offset, range.length);
+
+    const volatile uint8_t* pData = pFile->getData();
+    uint8_t checksum = 0;
+    for (std::size_t offset = range.offset; offset < range.offset + range.length; offset += m_pageSize) {
+        checksum ^= pData[offset];
+    }
+    checksum ^= pData[range.offset + range.length - 1];
+    (void)checksum;
+}
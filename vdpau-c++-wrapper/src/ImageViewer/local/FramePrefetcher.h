@@ -0,0 +1,100 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_FRAME_PREFETCHER_H
+#define LOCAL_FRAME_PREFETCHER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "RawSequence.h"
+
+/**
+ * @brief FramePrefetcher loads the next frames of a RawSequence in background
+ *
+ * The pages of a mapped file are read on the first access, so the upload of
+ * a cold frame would wait for the disk. A worker thread follows the playback
+ * position: it asks the kernel to read ahead the next frames, then touches
+ * one byte per page to be sure they are resident when the frame is uploaded.
+ */
+class FramePrefetcher {
+public:
+    /**
+     * @brief Start the prefetch worker
+     *
+     * The sequence must outlive the FramePrefetcher.
+     *
+     * @param sequence The played sequence
+     * @param iDepth Number of frames loaded ahead of the playback position
+     * @param bLoop If true, the first frames follow the last one
+     */
+    FramePrefetcher(const RawSequence& sequence, std::size_t iDepth, bool bLoop);
+    /**
+     * @brief Stop the prefetch worker
+     */
+    ~FramePrefetcher();
+
+    FramePrefetcher(const FramePrefetcher&) = delete;
+    FramePrefetcher(FramePrefetcher&&) = delete;
+
+    FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+    FramePrefetcher& operator=(FramePrefetcher&&) = delete;
+
+    /**
+     * @brief Update the playback position
+     *
+     * The position counts the played frames, it keeps increasing
+     * when the playback loops.
+     *
+     * @param iFrameNumber Number of the frame being uploaded since the start
+     */
+    void setPosition(uint64_t iFrameNumber);
+
+    /**
+     * @brief Get the number of frames loaded by the worker
+     *
+     * @return uint64_t The prefetched frame count
+     */
+    uint64_t getPrefetchedFrames() const;
+
+private:
+    void run();
+    bool hasWork(uint64_t iNextFrame) const;
+    void loadFrame(std::size_t iFrameIndex);
+
+private:
+    const RawSequence& m_sequence;
+    std::size_t m_iDepth;
+    bool m_bLoop;
+    std::size_t m_pageSize;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    uint64_t m_iPosition;
+    uint64_t m_iPrefetchedFrames;
+    bool m_bStopping;
+    std::thread m_thread;
+};
+
+#endif // LOCAL_FRAME_PREFETCHER_H
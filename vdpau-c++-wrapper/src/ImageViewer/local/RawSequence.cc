@@ -0,0 +1,147 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "RawSequence.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <VdpWrapper/Y4MHeader.h>
+
+RawSequence::RawSequence(const std::string& szFilename, vw::PixelFormat format, vw::SizeU size)
+: m_pFile(std::make_shared<const vw::MappedFile>(szFilename))
+, m_bY4M(false)
+, m_format(format)
+, m_size(size)
+, m_framerate(0, 0)
+, m_frameSize(0) {
+    if (vw::hasY4MSignature(m_pFile->getData(), m_pFile->getSize())) {
+        m_bY4M = true;
+
+        std::size_t offset = 0;
+        parseY4MHeader(offset);
+        m_frameSize = vw::ImageBuffer::getPackedSize(m_format, m_size);
+        indexY4MFrames(offset);
+    } else {
+        if (m_format != vw::PixelFormat::NV12 && m_format != vw::PixelFormat::I420) {
+            throw std::runtime_error("[RawSequence] Only NV12 and I420 raw files are supported");
+        }
+
+        if (m_size.width == 0 || m_size.height == 0) {
+            throw std::runtime_error("[RawSequence] The picture size of a raw file must be defined");
+        }
+
+        m_frameSize = vw::ImageBuffer::getPackedSize(m_format, m_size);
+        indexRawFrames();
+    }
+
+    if (m_frameOffsets.empty()) {
+        throw std::runtime_error("[RawSequence] '" + szFilename + "' doesn't contain a complete frame");
+    }
+}
+
+bool RawSequence::isY4M() const {
+    return m_bY4M;
+}
+
+vw::PixelFormat RawSequence::getFormat() const {
+    return m_format;
+}
+
+vw::SizeU RawSequence::getSize() const {
+    return m_size;
+}
+
+vw::Framerate RawSequence::getFramerate() const {
+    return m_framerate;
+}
+
+std::size_t RawSequence::getFrameCount() const {
+    return m_frameOffsets.size();
+}
+
+RawSequence::FrameRange RawSequence::getFrameRange(std::size_t index) const {
+    if (index >= m_frameOffsets.size()) {
+        throw std::runtime_error("[RawSequence] Frame index out of bounds");
+    }
+
+    return { m_frameOffsets[index], m_frameSize };
+}
+
+vw::ImageBuffer RawSequence::getFrame(std::size_t index) const {
+    return vw::ImageBuffer::view(m_format, m_size, m_pFile, getFrameRange(index).offset);
+}
+
+std::shared_ptr<const vw::MappedFile> RawSequence::getFile() const {
+    return m_pFile;
+}
+
+void RawSequence::parseY4MHeader(std::size_t& offset) {
+    const char* pHeader = reinterpret_cast<const char*>(m_pFile->getData());
+    std::size_t headerLength = std::min(m_pFile->getSize(), vw::Y4MMaxLineLength);
+    const char* pEndOfLine = static_cast<const char*>(std::memchr(pHeader, '\n', headerLength));
+    if (pEndOfLine == nullptr) {
+        throw std::runtime_error("[RawSequence] Invalid Y4M header");
+    }
+
+    vw::Y4MHeader header = vw::parseY4MHeader(std::string(pHeader, pEndOfLine));
+    m_format = header.format;
+    m_size = header.size;
+    m_framerate = header.framerate;
+
+    offset = pEndOfLine - pHeader + 1;
+}
+
+void RawSequence::indexRawFrames() {
+    std::size_t frameCount = m_pFile->getSize() / m_frameSize;
+    for (std::size_t i = 0; i < frameCount; ++i) {
+        m_frameOffsets.push_back(i * m_frameSize);
+    }
+}
+
+void RawSequence::indexY4MFrames(std::size_t offset) {
+    const uint8_t* pData = m_pFile->getData();
+    std::size_t fileSize = m_pFile->getSize();
+    const std::size_t markerLength = sizeof(vw::Y4MFrameMarker) - 1;
+
+    // Each frame starts with a FRAME line which may carry parameters
+    while (offset + markerLength < fileSize) {
+        if (std::memcmp(pData + offset, vw::Y4MFrameMarker, markerLength) != 0) {
+            throw std::runtime_error("[RawSequence] Invalid Y4M frame header");
+        }
+
+        std::size_t lineLength = std::min(fileSize - offset, vw::Y4MMaxLineLength);
+        const uint8_t* pEndOfLine = static_cast<const uint8_t*>(std::memchr(pData + offset, '\n', lineLength));
+        if (pEndOfLine == nullptr) {
+            throw std::runtime_error("[RawSequence] Invalid Y4M frame header");
+        }
+
+        std::size_t frameOffset = pEndOfLine - pData + 1;
+        if (frameOffset + m_frameSize > fileSize) {
+            // Truncated last frame
+            break;
+        }
+
+        m_frameOffsets.push_back(frameOffset);
+        offset = frameOffset + m_frameSize;
+    }
+}
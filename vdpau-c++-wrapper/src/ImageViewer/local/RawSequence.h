@@ -0,0 +1,141 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_RAW_SEQUENCE_H
+#define LOCAL_RAW_SEQUENCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <VdpWrapper/Framerate.h>
+#include <VdpWrapper/ImageBuffer.h>
+#include <VdpWrapper/MappedFile.h>
+#include <VdpWrapper/Size.h>
+
+/**
+ * @brief RawSequence gives access to the frames of a memory-mapped YUV file
+ *
+ * Two kinds of files are supported:
+ *  - raw files where the frames follow each other without header, the format
+ *    and the size must be provided
+ *  - YUV4MPEG2 (Y4M) files, where the size, the framerate and the chroma layout
+ *    come from the stream header (only the 8 bits 4:2:0 layouts are supported)
+ *
+ * The frames are never copied: each one is a read-only view over the mapping.
+ */
+class RawSequence {
+public:
+    /**
+     * @brief Byte range of a frame in the file
+     */
+    struct FrameRange {
+        std::size_t offset; ///< Offset of the first plane
+        std::size_t length; ///< Size of all the planes
+    };
+
+    /**
+     * @brief Open a raw or Y4M file
+     *
+     * The Y4M files are recognized by their signature, the format and
+     * the size are then ignored.
+     *
+     * @param szFilename The file to open
+     * @param format The pixel format of a raw file (NV12 or I420)
+     * @param size The picture size of a raw file
+     */
+    RawSequence(const std::string& szFilename, vw::PixelFormat format, vw::SizeU size);
+
+    /**
+     * @brief Check if the file is a Y4M stream
+     *
+     * @return bool True if the file has a YUV4MPEG2 header
+     */
+    bool isY4M() const;
+
+    /**
+     * @brief Get the pixel format of the frames
+     *
+     * @return vw::PixelFormat NV12 or I420
+     */
+    vw::PixelFormat getFormat() const;
+
+    /**
+     * @brief Get the picture size
+     *
+     * @return vw::SizeU The frame size
+     */
+    vw::SizeU getSize() const;
+
+    /**
+     * @brief Get the framerate of the Y4M header
+     *
+     * @return vw::Framerate The framerate, invalid for raw files
+     */
+    vw::Framerate getFramerate() const;
+
+    /**
+     * @brief Get the number of complete frames of the file
+     *
+     * @return std::size_t The frame count
+     */
+    std::size_t getFrameCount() const;
+
+    /**
+     * @brief Get the location of a frame in the file
+     *
+     * @param index The frame index
+     * @return FrameRange The bytes of the frame
+     */
+    FrameRange getFrameRange(std::size_t index) const;
+
+    /**
+     * @brief Get a frame
+     *
+     * @param index The frame index
+     * @return vw::ImageBuffer A read-only view over the mapped file
+     */
+    vw::ImageBuffer getFrame(std::size_t index) const;
+
+    /**
+     * @brief Get the mapped file
+     *
+     * @return std::shared_ptr<const vw::MappedFile> The mapping shared by the frames
+     */
+    std::shared_ptr<const vw::MappedFile> getFile() const;
+
+private:
+    void parseY4MHeader(std::size_t& offset);
+    void indexRawFrames();
+    void indexY4MFrames(std::size_t offset);
+
+private:
+    std::shared_ptr<const vw::MappedFile> m_pFile;
+    bool m_bY4M;
+    vw::PixelFormat m_format;
+    vw::SizeU m_size;
+    vw::Framerate m_framerate;
+    std::size_t m_frameSize;
+    std::vector<std::size_t> m_frameOffsets;
+};
+
+#endif // LOCAL_RAW_SEQUENCE_H
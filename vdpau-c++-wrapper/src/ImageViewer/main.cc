@@ -19,7 +19,10 @@
  * SOFTWARE.
  */
 
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #include <VdpWrapper/Device.h>
 #include <VdpWrapper/Display.h>
@@ -28,22 +31,39 @@
 #include <VdpWrapper/DecodedSurface.h>
 #include <VdpWrapper/VideoMixer.h>
 
+#include "local/FramePrefetcher.h"
+#include "local/RawSequence.h"
+
 namespace {
     void printUsage(const std::string& commandName, const std::string& message) {
         std::cerr << message << std::endl;
         std::cerr << "Usage:" << std::endl;
         std::cerr << "\t" << commandName << " [OPTION] --image-size <width>x<height> RAW_IMAGE_FILE" << std::endl;
+        std::cerr << "\t" << commandName << " [OPTION] Y4M_FILE" << std::endl;
         std::cerr << std::endl;
         std::cerr << "Options:" << std::endl;
         std::cerr << "\t--image-size <width>x<height>\t\tSet the source image size" << std::endl;
         std::cerr << "\t--initial-size <width>x<height>\t\tSet the initial screen size" << std::endl;
+        std::cerr << "\t--format <nv12|i420>\t\t\tSet the pixel format of a raw file (default: nv12)" << std::endl;
+        std::cerr << "\t--framerate <num>[/<den>]\t\tSet the playback framerate (default: Y4M header or 25)" << std::endl;
+        std::cerr << "\t--loop\t\t\t\t\tPlay the sequence in loop" << std::endl;
+        std::cerr << "\t--prefetch-depth <COUNT>\t\tSet the number of frames loaded ahead (default: 8)" << std::endl;
+        std::cerr << "\t--max-speed\t\t\t\tDisplay the frames as soon as they are ready to measure the throughput" << std::endl;
     }
+
+    // Number of frames scheduled in advance in the VDPAU presentation queue
+    const uint64_t PresentationDepth = 3;
 }
 
 int main(int argc, char *argv[]) {
     int iCurrentArg = 1;
     vw::SizeU screenSize(1280, 720);
     vw::SizeU sourceSize(0, 0);
+    vw::PixelFormat sourceFormat = vw::PixelFormat::NV12;
+    vw::Framerate framerate(0, 0);
+    bool bLoop = false;
+    bool bMaxSpeed = false;
+    int iPrefetchDepth = 8;
 
     while (iCurrentArg < argc - 1) {
         std::string szArg = std::string(argv[iCurrentArg]);
@@ -109,6 +129,56 @@ int main(int argc, char *argv[]) {
 
             std::cout << "[main] Set initial screen size: " << szWidth << "x" << szHeight << std::endl;
             iCurrentArg += 2;
+        } else if (szArg == "--format") {
+            std::string szFormat = std::string(argv[iCurrentArg + 1]);
+            if (szFormat == "nv12") {
+                sourceFormat = vw::PixelFormat::NV12;
+            } else if (szFormat == "i420") {
+                sourceFormat = vw::PixelFormat::I420;
+            } else {
+                printUsage(argv[0], "Wrong format value");
+                return 1;
+            }
+
+            std::cout << "[main] Set raw file format: " << szFormat << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--framerate") {
+            std::string szValue = std::string(argv[iCurrentArg + 1]);
+            std::size_t iDelimiterIndex = szValue.find_first_of("/");
+
+            try {
+                framerate.numerator = std::stoi(szValue.substr(0, iDelimiterIndex));
+                framerate.denominator = iDelimiterIndex != std::string::npos ? std::stoi(szValue.substr(iDelimiterIndex + 1)) : 1;
+            } catch (std::logic_error &e) {
+                framerate = vw::Framerate(0, 0);
+            }
+
+            if (!framerate.isValid()) {
+                printUsage(argv[0], "Wrong framerate value");
+                return 1;
+            }
+
+            std::cout << "[main] Set framerate: " << framerate.numerator << "/" << framerate.denominator << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--loop") {
+            bLoop = true;
+            iCurrentArg += 1;
+        } else if (szArg == "--prefetch-depth") {
+            try {
+                iPrefetchDepth = std::stoi(argv[iCurrentArg + 1]);
+            } catch (std::logic_error &e) {
+                iPrefetchDepth = -1;
+            }
+
+            if (iPrefetchDepth < 0) {
+                printUsage(argv[0], "Wrong prefetch depth");
+                return 1;
+            }
+
+            iCurrentArg += 2;
+        } else if (szArg == "--max-speed") {
+            bMaxSpeed = true;
+            iCurrentArg += 1;
         } else {
             printUsage(argv[0], "'" + szArg + "' unknown option");
             return 1;
@@ -120,19 +190,83 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    if (sourceSize == vw::SizeU(0u, 0u)) {
-        printUsage(argv[0], "The source image size must be defined");
+    std::string szRawImageFile(argv[iCurrentArg]);
+
+    // The Y4M files describe their content, the raw ones need the size
+    std::unique_ptr<RawSequence> pSequence;
+    try {
+        pSequence = std::make_unique<RawSequence>(szRawImageFile, sourceFormat, sourceSize);
+    } catch (std::runtime_error &e) {
+        printUsage(argv[0], e.what());
         return 1;
     }
 
-    std::string szRawImageFile(argv[iCurrentArg]);
+    const RawSequence& sequence = *pSequence;
+    if (!framerate.isValid()) {
+        framerate = sequence.getFramerate().isValid() ? sequence.getFramerate() : vw::Framerate(25, 1);
+    }
+
+    std::cout << "[main] " << sequence.getFrameCount() << " frame(s) of " << sequence.getSize().width << "x" << sequence.getSize().height
+        << (sequence.isY4M() ? " from a Y4M stream" : "") << " at " << framerate.toDouble() << " fps" << std::endl;
 
     vw::Display display(screenSize);
     vw::Device device(display);
     vw::PresentationQueue presentationQueue(display, device);
-    vw::DecodedSurface inputSurface(device, szRawImageFile, sourceSize);
+    vw::DecodedSurface inputSurface(device, sequence.getSize());
     vw::VideoMixer mixer(device, screenSize);
 
+    // The I420 frames of the Y4M streams are converted to NV12 in the same buffer before each upload
+    vw::ImageBuffer stagingBuffer(vw::PixelFormat::NV12, sequence.getSize());
+
+    // The frames are shown at their index on the timeline, late frames are displayed at once
+    presentationQueue.setFramerate(framerate);
+    presentationQueue.enablePresentationOrderDisplay(false);
+    presentationQueue.enableDirectOutput(bMaxSpeed);
+
+    FramePrefetcher prefetcher(sequence, iPrefetchDepth, bLoop);
+
+    std::chrono::nanoseconds uploadTime(0);
+    std::chrono::nanoseconds postProcessTime(0);
+    uint64_t iFrameNumber = 0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    while (display.isOpened() && (bLoop || iFrameNumber < sequence.getFrameCount())) {
+        display.processEvent();
+        mixer.setOutputSize(display.getScreenSize());
+
+        prefetcher.setPosition(iFrameNumber);
+
+        // The frame is uploaded straight from the mapped file
+        auto clockTime = std::chrono::steady_clock::now();
+        inputSurface.upload(sequence.getFrame(iFrameNumber % sequence.getFrameCount()), stagingBuffer);
+        uploadTime += std::chrono::steady_clock::now() - clockTime;
+
+        clockTime = std::chrono::steady_clock::now();
+        vw::RenderSurface outputSurface = mixer.process(inputSurface);
+        postProcessTime += std::chrono::steady_clock::now() - clockTime;
+
+        // Don't schedule more than a few frames ahead of the display
+        while (!bMaxSpeed && presentationQueue.getScheduleEndTime() > presentationQueue.getCurrentTime() + framerate.getFrameTime(PresentationDepth)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        presentationQueue.enqueue(std::move(outputSurface));
+        ++iFrameNumber;
+    }
+
+    if (iFrameNumber > 0) {
+        std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - startTime;
+        double frameBytes = static_cast<double>(sequence.getFrameRange(0).length);
+        double uploadSeconds = std::chrono::duration<double>(uploadTime).count();
+
+        std::cout << "[main] Played frames: " << iFrameNumber << " (" << iFrameNumber / elapsedTime.count() << " fps)" << std::endl;
+        std::cout << "[main] Mean upload time: " << std::chrono::duration_cast<std::chrono::microseconds>(uploadTime).count() / iFrameNumber << " µs"
+            << " (" << iFrameNumber * frameBytes / uploadSeconds / 1.0e6 << " MB/s)" << std::endl;
+        std::cout << "[main] Mean post-process time: " << std::chrono::duration_cast<std::chrono::microseconds>(postProcessTime).count() / iFrameNumber << " µs" << std::endl;
+        std::cout << "[main] Prefetched frames: " << prefetcher.getPrefetchedFrames() << std::endl;
+    }
+
+    // Keep the last frame on screen until the window is closed
     while (display.isOpened()) {
         // Update the output surface
         mixer.setOutputSize(display.getScreenSize());
@@ -0,0 +1,54 @@
+#include <VdpWrapper/Backend.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <vdpau/vdpau_x11.h>
+
+#include <VdpWrapper/Display.h>
+
+namespace vw {
+    X11Backend::X11Backend(Display& display)
+    : m_pXDisplay(display.getXDisplay())
+    , m_iXScreen(display.getXScreen())
+    , m_bOwnsXDisplay(false) {
+
+    }
+
+    X11Backend::X11Backend(const std::string& szDisplayName)
+    : m_pXDisplay(nullptr)
+    , m_iXScreen(0)
+    , m_bOwnsXDisplay(true) {
+        m_pXDisplay = XOpenDisplay(szDisplayName.empty() ? nullptr : szDisplayName.c_str());
+        if (m_pXDisplay == nullptr) {
+            throw std::runtime_error("[X11Backend] Couldn't open the X11 display '" + std::string(XDisplayName(szDisplayName.empty() ? nullptr : szDisplayName.c_str())) + "'");
+        }
+
+        m_iXScreen = DefaultScreen(m_pXDisplay);
+    }
+
+    X11Backend::~X11Backend() {
+        if (m_bOwnsXDisplay) {
+            XCloseDisplay(m_pXDisplay);
+        }
+    }
+
+    VdpDevice X11Backend::createDevice(VdpGetProcAddress** ppGetProcAddress) {
+        VdpDevice vdpDevice = VDP_INVALID_HANDLE;
+        VdpStatus vdpStatus = vdp_device_create_x11(
+            m_pXDisplay,
+            m_iXScreen,
+            &vdpDevice,
+            ppGetProcAddress
+        );
+        if (vdpStatus != VDP_STATUS_OK) {
+            throw std::runtime_error("[X11Backend] VDPAU device creation failed\n\tError code: " + std::to_string(vdpStatus));
+        }
+
+        return vdpDevice;
+    }
+
+    std::string X11Backend::getName() const {
+        return "X11";
+    }
+}
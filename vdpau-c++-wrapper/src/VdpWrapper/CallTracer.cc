@@ -0,0 +1,755 @@
+#include <VdpWrapper/CallTracer.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <vdpau/vdpau_x11.h>
+
+namespace vw {
+    namespace {
+        const char TraceMagic[4] = { 'V', 'W', 'T', 'R' };
+
+        struct TracerState {
+            std::mutex mutex;
+            std::ofstream file;
+            std::chrono::steady_clock::time_point originTime;
+            std::atomic<bool> bActive { false };
+        };
+
+        TracerState& getState() {
+            static TracerState state;
+            return state;
+        }
+
+        // Real entry points called by the shims of a traced device
+        struct TracedFunctions {
+            std::atomic<VdpGetInformationString*> getInformationString { nullptr };
+            std::atomic<VdpDeviceDestroy*> deviceDestroy { nullptr };
+            std::atomic<VdpDecoderCreate*> decoderCreate { nullptr };
+            std::atomic<VdpDecoderDestroy*> decoderDestroy { nullptr };
+            std::atomic<VdpDecoderRender*> decoderRender { nullptr };
+            std::atomic<VdpOutputSurfaceCreate*> outputSurfaceCreate { nullptr };
+            std::atomic<VdpOutputSurfaceDestroy*> outputSurfaceDestroy { nullptr };
+            std::atomic<VdpOutputSurfacePutBitsNative*> outputSurfacePutBitsNative { nullptr };
+            std::atomic<VdpOutputSurfaceGetBitsNative*> outputSurfaceGetBitsNative { nullptr };
+            std::atomic<VdpOutputSurfaceGetParameters*> outputSurfaceGetParameters { nullptr };
+            std::atomic<VdpVideoSurfaceCreate*> videoSurfaceCreate { nullptr };
+            std::atomic<VdpVideoSurfaceDestroy*> videoSurfaceDestroy { nullptr };
+            std::atomic<VdpVideoSurfacePutBitsYCbCr*> videoSurfacePutBitsYCbCr { nullptr };
+            std::atomic<VdpVideoSurfaceGetBitsYCbCr*> videoSurfaceGetBitsYCbCr { nullptr };
+            std::atomic<VdpVideoSurfaceGetParameters*> videoSurfaceGetParameters { nullptr };
+            std::atomic<VdpVideoMixerCreate*> videoMixerCreate { nullptr };
+            std::atomic<VdpVideoMixerDestroy*> videoMixerDestroy { nullptr };
+            std::atomic<VdpVideoMixerRender*> videoMixerRender { nullptr };
+            std::atomic<VdpPresentationQueueTargetCreateX11*> presentationQueueTargetCreateX11 { nullptr };
+            std::atomic<VdpPresentationQueueTargetDestroy*> presentationQueueTargetDestroy { nullptr };
+            std::atomic<VdpPresentationQueueCreate*> presentationQueueCreate { nullptr };
+            std::atomic<VdpPresentationQueueDestroy*> presentationQueueDestroy { nullptr };
+            std::atomic<VdpPresentationQueueSetBackgroundColor*> presentationQueueSetBackgroundColor { nullptr };
+            std::atomic<VdpPresentationQueueGetTime*> presentationQueueGetTime { nullptr };
+            std::atomic<VdpPresentationQueueDisplay*> presentationQueueDisplay { nullptr };
+            std::atomic<VdpPresentationQueueQuerySurfaceStatus*> presentationQueueQuerySurfaceStatus { nullptr };
+        };
+
+        /*
+         * The shims are plain function pointers without context, so each traced
+         * device gets a slot with its own copy of the shims (instantiated for
+         * the slot index) and of the real entry points
+         */
+        struct TracedDevice {
+            bool bUsed = false;         // Protected by the tracer mutex
+            std::atomic<uint16_t> deviceID { 0 };
+            TracedFunctions functions;
+            std::unordered_map<uint32_t, VdpDecoderProfile> decoderProfiles;     // Protected by the tracer mutex
+        };
+
+        TracedDevice gTracedDevices[CallTracer::MaxTracedDevices];
+        uint16_t gLastDeviceID = 0;     // Protected by the tracer mutex
+
+        /*
+         * Build a record around the real call: the start time is taken at the
+         * construction and the duration when the status is known
+         */
+        class TracedCall {
+        public:
+            TracedCall(uint32_t slot, VdpFuncId functionID)
+            : m_record()
+            , m_startTime(std::chrono::steady_clock::now()) {
+                m_record.functionID = functionID;
+                m_record.deviceID = gTracedDevices[slot].deviceID;
+            }
+
+            void setHandles(uint32_t handle0, uint32_t handle1 = 0, uint32_t handle2 = 0, uint32_t handle3 = 0) {
+                m_record.handles[0] = handle0;
+                m_record.handles[1] = handle1;
+                m_record.handles[2] = handle2;
+                m_record.handles[3] = handle3;
+            }
+
+            void setValues(uint32_t value0, uint32_t value1 = 0, uint32_t value2 = 0, uint32_t value3 = 0) {
+                m_record.values[0] = value0;
+                m_record.values[1] = value1;
+                m_record.values[2] = value2;
+                m_record.values[3] = value3;
+            }
+
+            void setArgument(uint64_t argument) {
+                m_record.argument = argument;
+            }
+
+            void setPayload(std::vector<uint8_t> payload) {
+                m_payload = std::move(payload);
+            }
+
+            VdpStatus finish(VdpStatus status, std::chrono::steady_clock::time_point endTime) {
+                auto& state = getState();
+                if (!state.bActive) {
+                    return status;
+                }
+
+                m_record.status = static_cast<uint16_t>(status);
+                m_record.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - m_startTime).count();
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (state.file.is_open()) {
+                    m_record.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(m_startTime - state.originTime).count();
+                    state.file.write(reinterpret_cast<const char*>(&m_record), sizeof(m_record));
+                    state.file.write(reinterpret_cast<const char*>(m_payload.data()), m_payload.size());
+                }
+
+                return status;
+            }
+
+        private:
+            TraceRecord m_record;
+            std::vector<uint8_t> m_payload;
+            std::chrono::steady_clock::time_point m_startTime;
+        };
+
+        std::chrono::steady_clock::time_point now() {
+            return std::chrono::steady_clock::now();
+        }
+
+        uint32_t readHandle(const uint32_t* pHandle) {
+            return pHandle != nullptr ? *pHandle : VDP_INVALID_HANDLE;
+        }
+
+        void setDecoderProfile(uint32_t slot, VdpDecoder decoder, VdpDecoderProfile profile) {
+            auto& state = getState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            gTracedDevices[slot].decoderProfiles[decoder] = profile;
+        }
+
+        void removeDecoderProfile(uint32_t slot, VdpDecoder decoder) {
+            auto& state = getState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            gTracedDevices[slot].decoderProfiles.erase(decoder);
+        }
+
+        // The layout of the picture infos depends on the profile, only the H.264 ones are recorded
+        uint32_t getPictureInfoSize(uint32_t slot, VdpDecoder decoder) {
+            auto& state = getState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+
+            auto& decoderProfiles = gTracedDevices[slot].decoderProfiles;
+            auto it = decoderProfiles.find(decoder);
+            if (it == decoderProfiles.end()) {
+                return 0;
+            }
+
+            switch (it->second) {
+            case VDP_DECODER_PROFILE_H264_BASELINE:
+            case VDP_DECODER_PROFILE_H264_MAIN:
+            case VDP_DECODER_PROFILE_H264_HIGH:
+            case VDP_DECODER_PROFILE_H264_EXTENDED:
+                return sizeof(VdpPictureInfoH264);
+            default:
+                break;
+            }
+
+            return 0;
+        }
+
+        void setRectValues(TracedCall& call, uint32_t value0, VdpRect const* rect) {
+            if (rect == nullptr) {
+                call.setValues(value0);
+            } else {
+                call.setValues(value0, rect->x1 - rect->x0, rect->y1 - rect->y0);
+            }
+        }
+
+        /*
+         * Shims
+         */
+        template<uint32_t Slot>
+        VdpStatus traceGetInformationString(char const** informationString) {
+            TracedCall call(Slot, VDP_FUNC_ID_GET_INFORMATION_STRING);
+            VdpStatus status = gTracedDevices[Slot].functions.getInformationString.load()(informationString);
+            return call.finish(status, now());
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceDeviceDestroy(VdpDevice device) {
+            TracedCall call(Slot, VDP_FUNC_ID_DEVICE_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.deviceDestroy.load()(device);
+            auto endTime = now();
+            call.setHandles(device);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceDecoderCreate(VdpDevice device, VdpDecoderProfile profile, uint32_t width, uint32_t height, uint32_t maxReferences, VdpDecoder* decoder) {
+            TracedCall call(Slot, VDP_FUNC_ID_DECODER_CREATE);
+            VdpStatus status = gTracedDevices[Slot].functions.decoderCreate.load()(device, profile, width, height, maxReferences, decoder);
+            auto endTime = now();
+            call.setHandles(readHandle(decoder), device);
+            call.setValues(profile, width, height, maxReferences);
+            if (status == VDP_STATUS_OK && decoder != nullptr) {
+                setDecoderProfile(Slot, *decoder, profile);
+            }
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceDecoderDestroy(VdpDecoder decoder) {
+            TracedCall call(Slot, VDP_FUNC_ID_DECODER_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.decoderDestroy.load()(decoder);
+            auto endTime = now();
+            removeDecoderProfile(Slot, decoder);
+            call.setHandles(decoder);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceDecoderRender(VdpDecoder decoder, VdpVideoSurface target, VdpPictureInfo const* pictureInfo, uint32_t bitstreamBufferCount, VdpBitstreamBuffer const* bitstreamBuffers) {
+            TracedCall call(Slot, VDP_FUNC_ID_DECODER_RENDER);
+            VdpStatus status = gTracedDevices[Slot].functions.decoderRender.load()(decoder, target, pictureInfo, bitstreamBufferCount, bitstreamBuffers);
+            auto endTime = now();
+
+            uint32_t iBitstreamBytes = 0;
+            for (uint32_t i = 0; bitstreamBuffers != nullptr && i < bitstreamBufferCount; ++i) {
+                iBitstreamBytes += bitstreamBuffers[i].bitstream_bytes;
+            }
+
+            call.setHandles(decoder, target);
+
+            // The picture infos and the bitstream are needed to replay the decoding
+            uint32_t iPictureInfoSize = 0;
+            if (getState().bActive && pictureInfo != nullptr) {
+                iPictureInfoSize = getPictureInfoSize(Slot, decoder);
+            }
+
+            if (iPictureInfoSize == 0) {
+                call.setValues(bitstreamBufferCount, iBitstreamBytes);
+                return call.finish(status, endTime);
+            }
+
+            std::vector<uint8_t> payload(iPictureInfoSize + iBitstreamBytes);
+            std::memcpy(payload.data(), pictureInfo, iPictureInfoSize);
+            uint8_t* pBitstream = payload.data() + iPictureInfoSize;
+            for (uint32_t i = 0; bitstreamBuffers != nullptr && i < bitstreamBufferCount; ++i) {
+                std::memcpy(pBitstream, bitstreamBuffers[i].bitstream, bitstreamBuffers[i].bitstream_bytes);
+                pBitstream += bitstreamBuffers[i].bitstream_bytes;
+            }
+
+            call.setValues(bitstreamBufferCount, iBitstreamBytes, iPictureInfoSize, iBitstreamBytes);
+            call.setPayload(std::move(payload));
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceOutputSurfaceCreate(VdpDevice device, VdpRGBAFormat format, uint32_t width, uint32_t height, VdpOutputSurface* surface) {
+            TracedCall call(Slot, VDP_FUNC_ID_OUTPUT_SURFACE_CREATE);
+            VdpStatus status = gTracedDevices[Slot].functions.outputSurfaceCreate.load()(device, format, width, height, surface);
+            auto endTime = now();
+            call.setHandles(readHandle(surface), device);
+            call.setValues(format, width, height);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceOutputSurfaceDestroy(VdpOutputSurface surface) {
+            TracedCall call(Slot, VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.outputSurfaceDestroy.load()(surface);
+            auto endTime = now();
+            call.setHandles(surface);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceOutputSurfacePutBitsNative(VdpOutputSurface surface, void const* const* data, uint32_t const* pitches, VdpRect const* destinationRect) {
+            TracedCall call(Slot, VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE);
+            VdpStatus status = gTracedDevices[Slot].functions.outputSurfacePutBitsNative.load()(surface, data, pitches, destinationRect);
+            auto endTime = now();
+            call.setHandles(surface);
+            setRectValues(call, pitches != nullptr ? pitches[0] : 0, destinationRect);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceOutputSurfaceGetBitsNative(VdpOutputSurface surface, VdpRect const* sourceRect, void* const* data, uint32_t const* pitches) {
+            TracedCall call(Slot, VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE);
+            VdpStatus status = gTracedDevices[Slot].functions.outputSurfaceGetBitsNative.load()(surface, sourceRect, data, pitches);
+            auto endTime = now();
+            call.setHandles(surface);
+            setRectValues(call, pitches != nullptr ? pitches[0] : 0, sourceRect);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceOutputSurfaceGetParameters(VdpOutputSurface surface, VdpRGBAFormat* format, uint32_t* width, uint32_t* height) {
+            TracedCall call(Slot, VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS);
+            VdpStatus status = gTracedDevices[Slot].functions.outputSurfaceGetParameters.load()(surface, format, width, height);
+            auto endTime = now();
+            call.setHandles(surface);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoSurfaceCreate(VdpDevice device, VdpChromaType chromaType, uint32_t width, uint32_t height, VdpVideoSurface* surface) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_SURFACE_CREATE);
+            VdpStatus status = gTracedDevices[Slot].functions.videoSurfaceCreate.load()(device, chromaType, width, height, surface);
+            auto endTime = now();
+            call.setHandles(readHandle(surface), device);
+            call.setValues(chromaType, width, height);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoSurfaceDestroy(VdpVideoSurface surface) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_SURFACE_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.videoSurfaceDestroy.load()(surface);
+            auto endTime = now();
+            call.setHandles(surface);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoSurfacePutBitsYCbCr(VdpVideoSurface surface, VdpYCbCrFormat format, void const* const* data, uint32_t const* pitches) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR);
+            VdpStatus status = gTracedDevices[Slot].functions.videoSurfacePutBitsYCbCr.load()(surface, format, data, pitches);
+            auto endTime = now();
+            call.setHandles(surface);
+            call.setValues(format, pitches != nullptr ? pitches[0] : 0);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoSurfaceGetBitsYCbCr(VdpVideoSurface surface, VdpYCbCrFormat format, void* const* data, uint32_t const* pitches) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR);
+            VdpStatus status = gTracedDevices[Slot].functions.videoSurfaceGetBitsYCbCr.load()(surface, format, data, pitches);
+            auto endTime = now();
+            call.setHandles(surface);
+            call.setValues(format, pitches != nullptr ? pitches[0] : 0);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoSurfaceGetParameters(VdpVideoSurface surface, VdpChromaType* chromaType, uint32_t* width, uint32_t* height) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS);
+            VdpStatus status = gTracedDevices[Slot].functions.videoSurfaceGetParameters.load()(surface, chromaType, width, height);
+            auto endTime = now();
+            call.setHandles(surface);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoMixerCreate(VdpDevice device, uint32_t featureCount, VdpVideoMixerFeature const* features, uint32_t parameterCount, VdpVideoMixerParameter const* parameters, void const* const* parameterValues, VdpVideoMixer* mixer) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_MIXER_CREATE);
+            VdpStatus status = gTracedDevices[Slot].functions.videoMixerCreate.load()(device, featureCount, features, parameterCount, parameters, parameterValues, mixer);
+            auto endTime = now();
+
+            uint32_t iWidth = 0;
+            uint32_t iHeight = 0;
+            for (uint32_t i = 0; parameters != nullptr && parameterValues != nullptr && i < parameterCount; ++i) {
+                if (parameters[i] == VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_WIDTH) {
+                    iWidth = *static_cast<const uint32_t*>(parameterValues[i]);
+                } else if (parameters[i] == VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_HEIGHT) {
+                    iHeight = *static_cast<const uint32_t*>(parameterValues[i]);
+                }
+            }
+
+            call.setHandles(readHandle(mixer), device);
+            call.setValues(featureCount, parameterCount, iWidth, iHeight);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoMixerDestroy(VdpVideoMixer mixer) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_MIXER_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.videoMixerDestroy.load()(mixer);
+            auto endTime = now();
+            call.setHandles(mixer);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus traceVideoMixerRender(
+            VdpVideoMixer mixer,
+            VdpOutputSurface backgroundSurface,
+            VdpRect const* backgroundSourceRect,
+            VdpVideoMixerPictureStructure currentPictureStructure,
+            uint32_t videoSurfacePastCount,
+            VdpVideoSurface const* videoSurfacePast,
+            VdpVideoSurface videoSurfaceCurrent,
+            uint32_t videoSurfaceFutureCount,
+            VdpVideoSurface const* videoSurfaceFuture,
+            VdpRect const* videoSourceRect,
+            VdpOutputSurface destinationSurface,
+            VdpRect const* destinationRect,
+            VdpRect const* destinationVideoRect,
+            uint32_t layerCount,
+            VdpLayer const* layers
+        ) {
+            TracedCall call(Slot, VDP_FUNC_ID_VIDEO_MIXER_RENDER);
+            VdpStatus status = gTracedDevices[Slot].functions.videoMixerRender.load()(
+                mixer, backgroundSurface, backgroundSourceRect, currentPictureStructure,
+                videoSurfacePastCount, videoSurfacePast, videoSurfaceCurrent, videoSurfaceFutureCount, videoSurfaceFuture,
+                videoSourceRect, destinationSurface, destinationRect, destinationVideoRect, layerCount, layers
+            );
+            auto endTime = now();
+            call.setHandles(mixer, videoSurfaceCurrent, destinationSurface, backgroundSurface);
+            if (destinationVideoRect == nullptr) {
+                call.setValues(currentPictureStructure, 0, 0, layerCount);
+            } else {
+                call.setValues(currentPictureStructure, destinationVideoRect->x1 - destinationVideoRect->x0, destinationVideoRect->y1 - destinationVideoRect->y0, layerCount);
+            }
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueTargetCreateX11(VdpDevice device, Drawable drawable, VdpPresentationQueueTarget* target) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueTargetCreateX11.load()(device, drawable, target);
+            auto endTime = now();
+            call.setHandles(readHandle(target), device);
+            call.setArgument(drawable);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueTargetDestroy(VdpPresentationQueueTarget target) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueTargetDestroy.load()(target);
+            auto endTime = now();
+            call.setHandles(target);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueCreate(VdpDevice device, VdpPresentationQueueTarget target, VdpPresentationQueue* queue) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueCreate.load()(device, target, queue);
+            auto endTime = now();
+            call.setHandles(readHandle(queue), device, target);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueDestroy(VdpPresentationQueue queue) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueDestroy.load()(queue);
+            auto endTime = now();
+            call.setHandles(queue);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueSetBackgroundColor(VdpPresentationQueue queue, VdpColor* const backgroundColor) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueSetBackgroundColor.load()(queue, backgroundColor);
+            auto endTime = now();
+            call.setHandles(queue);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueGetTime(VdpPresentationQueue queue, VdpTime* currentTime) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueGetTime.load()(queue, currentTime);
+            auto endTime = now();
+            call.setHandles(queue);
+            call.setArgument(currentTime != nullptr ? *currentTime : 0);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueDisplay(VdpPresentationQueue queue, VdpOutputSurface surface, uint32_t clipWidth, uint32_t clipHeight, VdpTime earliestPresentationTime) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueDisplay.load()(queue, surface, clipWidth, clipHeight, earliestPresentationTime);
+            auto endTime = now();
+            call.setHandles(queue, surface);
+            call.setValues(clipWidth, clipHeight);
+            call.setArgument(earliestPresentationTime);
+            return call.finish(status, endTime);
+        }
+
+        template<uint32_t Slot>
+        VdpStatus tracePresentationQueueQuerySurfaceStatus(VdpPresentationQueue queue, VdpOutputSurface surface, VdpPresentationQueueStatus* surfaceStatus, VdpTime* firstPresentationTime) {
+            TracedCall call(Slot, VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS);
+            VdpStatus status = gTracedDevices[Slot].functions.presentationQueueQuerySurfaceStatus.load()(queue, surface, surfaceStatus, firstPresentationTime);
+            auto endTime = now();
+            call.setHandles(queue, surface);
+            call.setValues(surfaceStatus != nullptr ? *surfaceStatus : 0);
+            call.setArgument(firstPresentationTime != nullptr ? *firstPresentationTime : 0);
+            return call.finish(status, endTime);
+        }
+
+        template<typename Function>
+        void* installShim(std::atomic<Function*>& pRealFunction, void* pFunction, Function* pShim) {
+            pRealFunction = reinterpret_cast<Function*>(pFunction);
+            return reinterpret_cast<void*>(pShim);
+        }
+
+        template<uint32_t Slot>
+        void* wrapSlotFunction(VdpFuncId functionID, void* pFunction) {
+            auto& functions = gTracedDevices[Slot].functions;
+
+            switch (functionID) {
+            case VDP_FUNC_ID_GET_INFORMATION_STRING:
+                return installShim(functions.getInformationString, pFunction, &traceGetInformationString<Slot>);
+            case VDP_FUNC_ID_DEVICE_DESTROY:
+                return installShim(functions.deviceDestroy, pFunction, &traceDeviceDestroy<Slot>);
+            case VDP_FUNC_ID_DECODER_CREATE:
+                return installShim(functions.decoderCreate, pFunction, &traceDecoderCreate<Slot>);
+            case VDP_FUNC_ID_DECODER_DESTROY:
+                return installShim(functions.decoderDestroy, pFunction, &traceDecoderDestroy<Slot>);
+            case VDP_FUNC_ID_DECODER_RENDER:
+                return installShim(functions.decoderRender, pFunction, &traceDecoderRender<Slot>);
+            case VDP_FUNC_ID_OUTPUT_SURFACE_CREATE:
+                return installShim(functions.outputSurfaceCreate, pFunction, &traceOutputSurfaceCreate<Slot>);
+            case VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY:
+                return installShim(functions.outputSurfaceDestroy, pFunction, &traceOutputSurfaceDestroy<Slot>);
+            case VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE:
+                return installShim(functions.outputSurfacePutBitsNative, pFunction, &traceOutputSurfacePutBitsNative<Slot>);
+            case VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE:
+                return installShim(functions.outputSurfaceGetBitsNative, pFunction, &traceOutputSurfaceGetBitsNative<Slot>);
+            case VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS:
+                return installShim(functions.outputSurfaceGetParameters, pFunction, &traceOutputSurfaceGetParameters<Slot>);
+            case VDP_FUNC_ID_VIDEO_SURFACE_CREATE:
+                return installShim(functions.videoSurfaceCreate, pFunction, &traceVideoSurfaceCreate<Slot>);
+            case VDP_FUNC_ID_VIDEO_SURFACE_DESTROY:
+                return installShim(functions.videoSurfaceDestroy, pFunction, &traceVideoSurfaceDestroy<Slot>);
+            case VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR:
+                return installShim(functions.videoSurfacePutBitsYCbCr, pFunction, &traceVideoSurfacePutBitsYCbCr<Slot>);
+            case VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR:
+                return installShim(functions.videoSurfaceGetBitsYCbCr, pFunction, &traceVideoSurfaceGetBitsYCbCr<Slot>);
+            case VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS:
+                return installShim(functions.videoSurfaceGetParameters, pFunction, &traceVideoSurfaceGetParameters<Slot>);
+            case VDP_FUNC_ID_VIDEO_MIXER_CREATE:
+                return installShim(functions.videoMixerCreate, pFunction, &traceVideoMixerCreate<Slot>);
+            case VDP_FUNC_ID_VIDEO_MIXER_DESTROY:
+                return installShim(functions.videoMixerDestroy, pFunction, &traceVideoMixerDestroy<Slot>);
+            case VDP_FUNC_ID_VIDEO_MIXER_RENDER:
+                return installShim(functions.videoMixerRender, pFunction, &traceVideoMixerRender<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11:
+                return installShim(functions.presentationQueueTargetCreateX11, pFunction, &tracePresentationQueueTargetCreateX11<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY:
+                return installShim(functions.presentationQueueTargetDestroy, pFunction, &tracePresentationQueueTargetDestroy<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE:
+                return installShim(functions.presentationQueueCreate, pFunction, &tracePresentationQueueCreate<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY:
+                return installShim(functions.presentationQueueDestroy, pFunction, &tracePresentationQueueDestroy<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR:
+                return installShim(functions.presentationQueueSetBackgroundColor, pFunction, &tracePresentationQueueSetBackgroundColor<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME:
+                return installShim(functions.presentationQueueGetTime, pFunction, &tracePresentationQueueGetTime<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY:
+                return installShim(functions.presentationQueueDisplay, pFunction, &tracePresentationQueueDisplay<Slot>);
+            case VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS:
+                return installShim(functions.presentationQueueQuerySurfaceStatus, pFunction, &tracePresentationQueueQuerySurfaceStatus<Slot>);
+            default:
+                break;
+            }
+
+            // Not traced (VdpGetErrorString...)
+            return pFunction;
+        }
+
+        using WrapFunction = void* (*)(VdpFuncId, void*);
+
+        template<std::size_t... Slots>
+        constexpr std::array<WrapFunction, sizeof...(Slots)> makeWrapFunctions(std::index_sequence<Slots...>) {
+            return { &wrapSlotFunction<Slots>... };
+        }
+    }
+
+    void CallTracer::start(const std::string& szFilename) {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        if (state.file.is_open()) {
+            throw std::runtime_error("[CallTracer] The tracer is already started");
+        }
+
+        state.file.open(szFilename, std::ios::binary | std::ios::trunc);
+        if (!state.file.is_open()) {
+            throw std::runtime_error("[CallTracer] Couldn't open the trace file '" + szFilename + "'");
+        }
+
+        uint32_t iVersion = FormatVersion;
+        state.file.write(TraceMagic, sizeof(TraceMagic));
+        state.file.write(reinterpret_cast<const char*>(&iVersion), sizeof(iVersion));
+
+        state.originTime = std::chrono::steady_clock::now();
+        state.bActive = true;
+    }
+
+    void CallTracer::stop() {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        state.bActive = false;
+        if (state.file.is_open()) {
+            state.file.close();
+        }
+    }
+
+    bool CallTracer::isActive() {
+        return getState().bActive;
+    }
+
+    uint32_t CallTracer::attachDevice() {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        for (uint32_t iSlot = 0; iSlot < MaxTracedDevices; ++iSlot) {
+            auto& tracedDevice = gTracedDevices[iSlot];
+            if (!tracedDevice.bUsed) {
+                tracedDevice.bUsed = true;
+                tracedDevice.deviceID = ++gLastDeviceID;
+                tracedDevice.decoderProfiles.clear();
+                return iSlot;
+            }
+        }
+
+        // The tracing must not break a program which works without it
+        std::cerr << "[CallTracer] Too many traced devices, at most " << MaxTracedDevices << " can be traced at once: the new device isn't traced" << std::endl;
+        return NoSlot;
+    }
+
+    void CallTracer::detachDevice(uint32_t iSlot) {
+        auto& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        if (iSlot < MaxTracedDevices) {
+            gTracedDevices[iSlot].bUsed = false;
+        }
+    }
+
+    void* CallTracer::wrapFunction(uint32_t iSlot, VdpFuncId functionID, void* pFunction) {
+        static constexpr auto wrapFunctions = makeWrapFunctions(std::make_index_sequence<MaxTracedDevices>());
+
+        if (iSlot >= MaxTracedDevices) {
+            throw std::runtime_error("[CallTracer] Invalid trace slot: " + std::to_string(iSlot));
+        }
+
+        return wrapFunctions[iSlot](functionID, pFunction);
+    }
+
+
+    Trace CallTracer::readFile(const std::string& szFilename) {
+        std::ifstream file(szFilename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("[CallTracer] Couldn't open the trace file '" + szFilename + "'");
+        }
+
+        char magic[sizeof(TraceMagic)];
+        uint32_t iVersion = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&iVersion), sizeof(iVersion));
+        if (!file || std::memcmp(magic, TraceMagic, sizeof(TraceMagic)) != 0) {
+            throw std::runtime_error("[CallTracer] '" + szFilename + "' isn't a trace file");
+        }
+
+        if (iVersion != FormatVersion) {
+            throw std::runtime_error("[CallTracer] Unsupported trace format version: " + std::to_string(iVersion));
+        }
+
+        Trace trace;
+        TraceRecord record;
+        while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            std::vector<uint8_t> payload;
+            if (record.functionID == VDP_FUNC_ID_DECODER_RENDER) {
+                payload.resize(static_cast<std::size_t>(record.values[2]) + record.values[3]);
+                if (!payload.empty() && !file.read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+                    throw std::runtime_error("[CallTracer] Truncated payload in '" + szFilename + "'");
+                }
+            }
+
+            trace.records.push_back(record);
+            trace.payloads.push_back(std::move(payload));
+        }
+
+        return trace;
+    }
+
+    std::string CallTracer::getFunctionName(uint32_t functionID) {
+        switch (functionID) {
+        case VDP_FUNC_ID_GET_INFORMATION_STRING:
+            return "GetInformationString";
+        case VDP_FUNC_ID_DEVICE_DESTROY:
+            return "DeviceDestroy";
+        case VDP_FUNC_ID_DECODER_CREATE:
+            return "DecoderCreate";
+        case VDP_FUNC_ID_DECODER_DESTROY:
+            return "DecoderDestroy";
+        case VDP_FUNC_ID_DECODER_RENDER:
+            return "DecoderRender";
+        case VDP_FUNC_ID_OUTPUT_SURFACE_CREATE:
+            return "OutputSurfaceCreate";
+        case VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY:
+            return "OutputSurfaceDestroy";
+        case VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE:
+            return "OutputSurfacePutBitsNative";
+        case VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE:
+            return "OutputSurfaceGetBitsNative";
+        case VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS:
+            return "OutputSurfaceGetParameters";
+        case VDP_FUNC_ID_VIDEO_SURFACE_CREATE:
+            return "VideoSurfaceCreate";
+        case VDP_FUNC_ID_VIDEO_SURFACE_DESTROY:
+            return "VideoSurfaceDestroy";
+        case VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR:
+            return "VideoSurfacePutBitsYCbCr";
+        case VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR:
+            return "VideoSurfaceGetBitsYCbCr";
+        case VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS:
+            return "VideoSurfaceGetParameters";
+        case VDP_FUNC_ID_VIDEO_MIXER_CREATE:
+            return "VideoMixerCreate";
+        case VDP_FUNC_ID_VIDEO_MIXER_DESTROY:
+            return "VideoMixerDestroy";
+        case VDP_FUNC_ID_VIDEO_MIXER_RENDER:
+            return "VideoMixerRender";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11:
+            return "PresentationQueueTargetCreateX11";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY:
+            return "PresentationQueueTargetDestroy";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE:
+            return "PresentationQueueCreate";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY:
+            return "PresentationQueueDestroy";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR:
+            return "PresentationQueueSetBackgroundColor";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME:
+            return "PresentationQueueGetTime";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY:
+            return "PresentationQueueDisplay";
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS:
+            return "PresentationQueueQuerySurfaceStatus";
+        default:
+            break;
+        }
+
+        return "Function#" + std::to_string(functionID);
+    }
+}
@@ -0,0 +1,1143 @@
+#include <VdpWrapper/CpuBackend.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <vdpau/vdpau_x11.h>
+
+namespace {
+    // All the surfaces are stored in NV12 (luma plane + interleaved CbCr plane)
+    struct CpuVideoSurface {
+        VdpDevice device;
+        uint32_t width;
+        uint32_t height;
+        std::shared_mutex mutex; // Protects the planes, the other fields are constant
+        std::vector<uint8_t> luma;
+        std::vector<uint8_t> chroma;
+
+        uint32_t getChromaWidth() const {
+            return (width + 1) / 2;
+        }
+
+        uint32_t getChromaHeight() const {
+            return (height + 1) / 2;
+        }
+    };
+
+    struct CpuOutputSurface {
+        VdpDevice device;
+        VdpRGBAFormat format;
+        uint32_t width;
+        uint32_t height;
+        std::shared_mutex mutex; // Protects the pixels, the other fields are constant
+        std::vector<uint8_t> pixels; // 4 bytes per pixel without padding
+    };
+
+    struct CpuDecoder {
+        VdpDevice device;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct CpuVideoMixer {
+        VdpDevice device;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct CpuPresentationQueueTarget {
+        VdpDevice device;
+    };
+
+    struct CpuDisplayedSurface {
+        VdpOutputSurface surface;
+        VdpTime presentationTime;
+    };
+
+    struct CpuPresentationQueue {
+        VdpDevice device;
+        VdpColor backgroundColor;
+        std::deque<CpuDisplayedSurface> displayedSurfaces;
+    };
+
+    // The VDPAU entry points are plain functions without context, so the
+    // driver state is shared by all the devices created by the CPU backends.
+    // The driver mutex only protects the handle tables: the surfaces are shared
+    // with the calls using them, which copy and convert the pixels under the
+    // lock of each surface so the calls of several threads run in parallel.
+    struct CpuDriver {
+        std::mutex mutex;
+        uint32_t nextHandle = 1;
+        std::unordered_set<VdpDevice> devices;
+        std::unordered_map<uint32_t, std::shared_ptr<CpuVideoSurface>> videoSurfaces;
+        std::unordered_map<uint32_t, std::shared_ptr<CpuOutputSurface>> outputSurfaces;
+        std::unordered_map<uint32_t, CpuDecoder> decoders;
+        std::unordered_map<uint32_t, CpuVideoMixer> videoMixers;
+        std::unordered_map<uint32_t, CpuPresentationQueueTarget> queueTargets;
+        std::unordered_map<uint32_t, CpuPresentationQueue> queues;
+
+        uint32_t createHandle() {
+            return nextHandle++;
+        }
+    };
+
+    CpuDriver& getDriver() {
+        static CpuDriver driver;
+        return driver;
+    }
+
+    template<typename Map>
+    typename Map::mapped_type* findObject(Map& objects, uint32_t handle) {
+        auto it = objects.find(handle);
+        if (it == objects.end()) {
+            return nullptr;
+        }
+
+        return &it->second;
+    }
+
+    template<typename Object>
+    std::shared_ptr<Object> findSharedObject(std::unordered_map<uint32_t, std::shared_ptr<Object>>& objects, uint32_t handle) {
+        auto it = objects.find(handle);
+        if (it == objects.end()) {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    template<typename Object>
+    VdpDevice getObjectDevice(const Object& object) {
+        return object.device;
+    }
+
+    template<typename Object>
+    VdpDevice getObjectDevice(const std::shared_ptr<Object>& pObject) {
+        return pObject->device;
+    }
+
+    template<typename Map>
+    void eraseDeviceObjects(Map& objects, VdpDevice device) {
+        for (auto it = objects.begin(); it != objects.end();) {
+            if (getObjectDevice(it->second) == device) {
+                it = objects.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    VdpTime getSteadyTime() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool isRectValid(const VdpRect& rect, uint32_t width, uint32_t height) {
+        return rect.x0 <= rect.x1 && rect.y0 <= rect.y1 && rect.x1 <= width && rect.y1 <= height;
+    }
+
+    uint8_t clampComponent(int value) {
+        return static_cast<uint8_t>(std::clamp(value, 0, 255));
+    }
+
+    /*
+     * Miscellaneous
+     */
+    const char* cpuGetErrorString(VdpStatus status) {
+        switch (status) {
+        case VDP_STATUS_OK:
+            return "The operation completed successfully";
+        case VDP_STATUS_NO_IMPLEMENTATION:
+            return "Not implemented by the CPU backend";
+        case VDP_STATUS_INVALID_HANDLE:
+            return "An invalid handle value was provided";
+        case VDP_STATUS_INVALID_POINTER:
+            return "An invalid pointer was provided";
+        case VDP_STATUS_INVALID_CHROMA_TYPE:
+            return "An invalid/unsupported VdpChromaType value was supplied";
+        case VDP_STATUS_INVALID_Y_CB_CR_FORMAT:
+            return "An invalid/unsupported VdpYCbCrFormat value was supplied";
+        case VDP_STATUS_INVALID_RGBA_FORMAT:
+            return "An invalid/unsupported VdpRGBAFormat value was supplied";
+        case VDP_STATUS_INVALID_DECODER_PROFILE:
+            return "An invalid/unsupported VdpDecoderProfile value was supplied";
+        case VDP_STATUS_INVALID_VIDEO_MIXER_FEATURE:
+            return "An invalid/unsupported VdpVideoMixerFeature value was supplied";
+        case VDP_STATUS_INVALID_VIDEO_MIXER_PARAMETER:
+            return "An invalid/unsupported VdpVideoMixerParameter value was supplied";
+        case VDP_STATUS_INVALID_FUNC_ID:
+            return "An invalid/unsupported VdpFuncId value was supplied";
+        case VDP_STATUS_INVALID_SIZE:
+            return "The size of a supplied object does not match the object it is being used with";
+        case VDP_STATUS_INVALID_VALUE:
+            return "An invalid/unsupported value was supplied";
+        case VDP_STATUS_INVALID_STRUCT_VERSION:
+            return "An invalid/unsupported structure version was specified";
+        case VDP_STATUS_HANDLE_DEVICE_MISMATCH:
+            return "The handles were created by different devices";
+        default:
+            break;
+        }
+
+        return "A catch-all error, used when no other error code applies";
+    }
+
+    VdpStatus cpuGetInformationString(char const** informationString) {
+        if (informationString == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        *informationString = "VdpWrapper CPU reference backend";
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuDeviceDestroy(VdpDevice device) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (driver.devices.erase(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        // Free the objects not destroyed by the user
+        eraseDeviceObjects(driver.videoSurfaces, device);
+        eraseDeviceObjects(driver.outputSurfaces, device);
+        eraseDeviceObjects(driver.decoders, device);
+        eraseDeviceObjects(driver.videoMixers, device);
+        eraseDeviceObjects(driver.queueTargets, device);
+        eraseDeviceObjects(driver.queues, device);
+
+        return VDP_STATUS_OK;
+    }
+
+    /*
+     * Video surfaces
+     */
+    VdpStatus cpuVideoSurfaceCreate(VdpDevice device, VdpChromaType chromaType, uint32_t width, uint32_t height, VdpVideoSurface* surface) {
+        auto& driver = getDriver();
+
+        if (surface == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        if (chromaType != VDP_CHROMA_TYPE_420) {
+            return VDP_STATUS_INVALID_CHROMA_TYPE;
+        }
+
+        if (width == 0 || height == 0) {
+            return VDP_STATUS_INVALID_SIZE;
+        }
+
+        // The planes are allocated outside of the driver lock
+        auto pVideoSurface = std::make_shared<CpuVideoSurface>();
+        pVideoSurface->device = device;
+        pVideoSurface->width = width;
+        pVideoSurface->height = height;
+        pVideoSurface->luma.assign(width * height, 16);
+        pVideoSurface->chroma.assign(pVideoSurface->getChromaWidth() * 2 * pVideoSurface->getChromaHeight(), 128);
+
+        std::lock_guard<std::mutex> lock(driver.mutex);
+        if (driver.devices.count(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        *surface = driver.createHandle();
+        driver.videoSurfaces.emplace(*surface, std::move(pVideoSurface));
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoSurfaceDestroy(VdpVideoSurface surface) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuVideoSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            auto it = driver.videoSurfaces.find(surface);
+            if (it == driver.videoSurfaces.end()) {
+                return VDP_STATUS_INVALID_HANDLE;
+            }
+
+            // The planes are freed outside of the driver lock, or by the last call using them
+            pSurface = std::move(it->second);
+            driver.videoSurfaces.erase(it);
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoSurfaceGetParameters(VdpVideoSurface surface, VdpChromaType* chromaType, uint32_t* width, uint32_t* height) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuVideoSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.videoSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (chromaType == nullptr || width == nullptr || height == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        *chromaType = VDP_CHROMA_TYPE_420;
+        *width = pSurface->width;
+        *height = pSurface->height;
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoSurfaceGetBitsYCbCr(VdpVideoSurface surface, VdpYCbCrFormat format, void* const* data, uint32_t const* pitches) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuVideoSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.videoSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (data == nullptr || pitches == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        std::shared_lock<std::shared_mutex> surfaceLock(pSurface->mutex);
+
+        uint32_t chromaWidth = pSurface->getChromaWidth();
+        uint32_t chromaHeight = pSurface->getChromaHeight();
+
+        switch (format) {
+        case VDP_YCBCR_FORMAT_NV12:
+            for (uint32_t y = 0; y < pSurface->height; ++y) {
+                std::memcpy(static_cast<uint8_t*>(data[0]) + y * pitches[0], &pSurface->luma[y * pSurface->width], pSurface->width);
+            }
+            for (uint32_t y = 0; y < chromaHeight; ++y) {
+                std::memcpy(static_cast<uint8_t*>(data[1]) + y * pitches[1], &pSurface->chroma[y * chromaWidth * 2], chromaWidth * 2);
+            }
+            break;
+
+        case VDP_YCBCR_FORMAT_YV12:
+            for (uint32_t y = 0; y < pSurface->height; ++y) {
+                std::memcpy(static_cast<uint8_t*>(data[0]) + y * pitches[0], &pSurface->luma[y * pSurface->width], pSurface->width);
+            }
+            // YV12 stores the Cr plane before the Cb plane
+            for (uint32_t y = 0; y < chromaHeight; ++y) {
+                uint8_t* pCr = static_cast<uint8_t*>(data[1]) + y * pitches[1];
+                uint8_t* pCb = static_cast<uint8_t*>(data[2]) + y * pitches[2];
+                const uint8_t* pSource = &pSurface->chroma[y * chromaWidth * 2];
+                for (uint32_t x = 0; x < chromaWidth; ++x) {
+                    pCb[x] = pSource[2 * x];
+                    pCr[x] = pSource[2 * x + 1];
+                }
+            }
+            break;
+
+        default:
+            return VDP_STATUS_INVALID_Y_CB_CR_FORMAT;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoSurfacePutBitsYCbCr(VdpVideoSurface surface, VdpYCbCrFormat format, void const* const* data, uint32_t const* pitches) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuVideoSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.videoSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (data == nullptr || pitches == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        std::unique_lock<std::shared_mutex> surfaceLock(pSurface->mutex);
+
+        uint32_t chromaWidth = pSurface->getChromaWidth();
+        uint32_t chromaHeight = pSurface->getChromaHeight();
+
+        switch (format) {
+        case VDP_YCBCR_FORMAT_NV12:
+            for (uint32_t y = 0; y < pSurface->height; ++y) {
+                std::memcpy(&pSurface->luma[y * pSurface->width], static_cast<const uint8_t*>(data[0]) + y * pitches[0], pSurface->width);
+            }
+            for (uint32_t y = 0; y < chromaHeight; ++y) {
+                std::memcpy(&pSurface->chroma[y * chromaWidth * 2], static_cast<const uint8_t*>(data[1]) + y * pitches[1], chromaWidth * 2);
+            }
+            break;
+
+        case VDP_YCBCR_FORMAT_YV12:
+            for (uint32_t y = 0; y < pSurface->height; ++y) {
+                std::memcpy(&pSurface->luma[y * pSurface->width], static_cast<const uint8_t*>(data[0]) + y * pitches[0], pSurface->width);
+            }
+            // YV12 stores the Cr plane before the Cb plane
+            for (uint32_t y = 0; y < chromaHeight; ++y) {
+                const uint8_t* pCr = static_cast<const uint8_t*>(data[1]) + y * pitches[1];
+                const uint8_t* pCb = static_cast<const uint8_t*>(data[2]) + y * pitches[2];
+                uint8_t* pDestination = &pSurface->chroma[y * chromaWidth * 2];
+                for (uint32_t x = 0; x < chromaWidth; ++x) {
+                    pDestination[2 * x] = pCb[x];
+                    pDestination[2 * x + 1] = pCr[x];
+                }
+            }
+            break;
+
+        default:
+            return VDP_STATUS_INVALID_Y_CB_CR_FORMAT;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    /*
+     * Output surfaces
+     */
+    VdpStatus cpuOutputSurfaceCreate(VdpDevice device, VdpRGBAFormat format, uint32_t width, uint32_t height, VdpOutputSurface* surface) {
+        auto& driver = getDriver();
+
+        if (surface == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        if (format != VDP_RGBA_FORMAT_B8G8R8A8 && format != VDP_RGBA_FORMAT_R8G8B8A8) {
+            return VDP_STATUS_INVALID_RGBA_FORMAT;
+        }
+
+        if (width == 0 || height == 0) {
+            return VDP_STATUS_INVALID_SIZE;
+        }
+
+        // The pixels are allocated outside of the driver lock
+        auto pOutputSurface = std::make_shared<CpuOutputSurface>();
+        pOutputSurface->device = device;
+        pOutputSurface->format = format;
+        pOutputSurface->width = width;
+        pOutputSurface->height = height;
+        pOutputSurface->pixels.assign(width * height * 4, 0);
+
+        std::lock_guard<std::mutex> lock(driver.mutex);
+        if (driver.devices.count(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        *surface = driver.createHandle();
+        driver.outputSurfaces.emplace(*surface, std::move(pOutputSurface));
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuOutputSurfaceDestroy(VdpOutputSurface surface) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuOutputSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            auto it = driver.outputSurfaces.find(surface);
+            if (it == driver.outputSurfaces.end()) {
+                return VDP_STATUS_INVALID_HANDLE;
+            }
+
+            // The pixels are freed outside of the driver lock, or by the last call using them
+            pSurface = std::move(it->second);
+            driver.outputSurfaces.erase(it);
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuOutputSurfaceGetParameters(VdpOutputSurface surface, VdpRGBAFormat* format, uint32_t* width, uint32_t* height) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuOutputSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.outputSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (format == nullptr || width == nullptr || height == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        *format = pSurface->format;
+        *width = pSurface->width;
+        *height = pSurface->height;
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuOutputSurfaceGetBitsNative(VdpOutputSurface surface, VdpRect const* sourceRect, void* const* data, uint32_t const* pitches) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuOutputSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.outputSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (data == nullptr || pitches == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        VdpRect rect = sourceRect != nullptr ? *sourceRect : VdpRect{ 0, 0, pSurface->width, pSurface->height };
+        if (!isRectValid(rect, pSurface->width, pSurface->height)) {
+            return VDP_STATUS_INVALID_VALUE;
+        }
+
+        std::shared_lock<std::shared_mutex> surfaceLock(pSurface->mutex);
+
+        for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+            std::memcpy(
+                static_cast<uint8_t*>(data[0]) + (y - rect.y0) * pitches[0],
+                &pSurface->pixels[(y * pSurface->width + rect.x0) * 4],
+                (rect.x1 - rect.x0) * 4
+            );
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuOutputSurfacePutBitsNative(VdpOutputSurface surface, void const* const* data, uint32_t const* pitches, VdpRect const* destinationRect) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuOutputSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            pSurface = findSharedObject(driver.outputSurfaces, surface);
+        }
+
+        if (pSurface == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (data == nullptr || pitches == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        VdpRect rect = destinationRect != nullptr ? *destinationRect : VdpRect{ 0, 0, pSurface->width, pSurface->height };
+        if (!isRectValid(rect, pSurface->width, pSurface->height)) {
+            return VDP_STATUS_INVALID_VALUE;
+        }
+
+        std::unique_lock<std::shared_mutex> surfaceLock(pSurface->mutex);
+
+        for (uint32_t y = rect.y0; y < rect.y1; ++y) {
+            std::memcpy(
+                &pSurface->pixels[(y * pSurface->width + rect.x0) * 4],
+                static_cast<const uint8_t*>(data[0]) + (y - rect.y0) * pitches[0],
+                (rect.x1 - rect.x0) * 4
+            );
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    /*
+     * Decoder
+     */
+    VdpStatus cpuDecoderCreate(VdpDevice device, VdpDecoderProfile profile, uint32_t width, uint32_t height, uint32_t /*maxReferences*/, VdpDecoder* decoder) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (decoder == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        if (driver.devices.count(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        switch (profile) {
+        case VDP_DECODER_PROFILE_H264_BASELINE:
+        case VDP_DECODER_PROFILE_H264_MAIN:
+        case VDP_DECODER_PROFILE_H264_HIGH:
+        case VDP_DECODER_PROFILE_H264_EXTENDED:
+            break;
+
+        default:
+            return VDP_STATUS_INVALID_DECODER_PROFILE;
+        }
+
+        if (width == 0 || height == 0) {
+            return VDP_STATUS_INVALID_SIZE;
+        }
+
+        *decoder = driver.createHandle();
+        driver.decoders.emplace(*decoder, CpuDecoder{ device, width, height });
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuDecoderDestroy(VdpDecoder decoder) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (driver.decoders.erase(decoder) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuDecoderRender(VdpDecoder decoder, VdpVideoSurface target, VdpPictureInfo const* pictureInfo, uint32_t bitstreamBufferCount, VdpBitstreamBuffer const* bitstreamBuffers) {
+        auto& driver = getDriver();
+        CpuDecoder cpuDecoder = {};
+        std::shared_ptr<CpuVideoSurface> pSurface;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            auto pDecoder = findObject(driver.decoders, decoder);
+            pSurface = findSharedObject(driver.videoSurfaces, target);
+            if (pDecoder == nullptr || pSurface == nullptr) {
+                return VDP_STATUS_INVALID_HANDLE;
+            }
+
+            cpuDecoder = *pDecoder;
+        }
+
+        if (cpuDecoder.device != pSurface->device) {
+            return VDP_STATUS_HANDLE_DEVICE_MISMATCH;
+        }
+
+        if (pictureInfo == nullptr || (bitstreamBufferCount > 0 && bitstreamBuffers == nullptr)) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        for (uint32_t i = 0; i < bitstreamBufferCount; ++i) {
+            if (bitstreamBuffers[i].struct_version != VDP_BITSTREAM_BUFFER_VERSION) {
+                return VDP_STATUS_INVALID_STRUCT_VERSION;
+            }
+        }
+
+        if (pSurface->width < cpuDecoder.width || pSurface->height < cpuDecoder.height) {
+            return VDP_STATUS_INVALID_SIZE;
+        }
+
+        // No bitstream decoding: write a mid-grey picture
+        std::unique_lock<std::shared_mutex> surfaceLock(pSurface->mutex);
+        std::fill(pSurface->luma.begin(), pSurface->luma.end(), 128);
+        std::fill(pSurface->chroma.begin(), pSurface->chroma.end(), 128);
+
+        return VDP_STATUS_OK;
+    }
+
+    /*
+     * Video mixer
+     */
+    VdpStatus cpuVideoMixerCreate(VdpDevice device, uint32_t featureCount, VdpVideoMixerFeature const* /*features*/, uint32_t parameterCount, VdpVideoMixerParameter const* parameters, void const* const* parameterValues, VdpVideoMixer* mixer) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (mixer == nullptr || (parameterCount > 0 && (parameters == nullptr || parameterValues == nullptr))) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        if (driver.devices.count(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        // No feature (deinterlacing, noise reduction...) is implemented
+        if (featureCount > 0) {
+            return VDP_STATUS_INVALID_VIDEO_MIXER_FEATURE;
+        }
+
+        CpuVideoMixer videoMixer = { device, 0, 0 };
+        for (uint32_t i = 0; i < parameterCount; ++i) {
+            uint32_t value = *static_cast<const uint32_t*>(parameterValues[i]);
+            switch (parameters[i]) {
+            case VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_WIDTH:
+                videoMixer.width = value;
+                break;
+
+            case VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_HEIGHT:
+                videoMixer.height = value;
+                break;
+
+            case VDP_VIDEO_MIXER_PARAMETER_CHROMA_TYPE:
+                if (value != VDP_CHROMA_TYPE_420) {
+                    return VDP_STATUS_INVALID_CHROMA_TYPE;
+                }
+                break;
+
+            case VDP_VIDEO_MIXER_PARAMETER_LAYERS:
+                if (value != 0) {
+                    return VDP_STATUS_INVALID_VALUE;
+                }
+                break;
+
+            default:
+                return VDP_STATUS_INVALID_VIDEO_MIXER_PARAMETER;
+            }
+        }
+
+        *mixer = driver.createHandle();
+        driver.videoMixers.emplace(*mixer, videoMixer);
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoMixerDestroy(VdpVideoMixer mixer) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (driver.videoMixers.erase(mixer) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuVideoMixerRender(
+        VdpVideoMixer mixer,
+        VdpOutputSurface backgroundSurface,
+        VdpRect const* /*backgroundSourceRect*/,
+        VdpVideoMixerPictureStructure /*currentPictureStructure*/,
+        uint32_t /*videoSurfacePastCount*/,
+        VdpVideoSurface const* /*videoSurfacePast*/,
+        VdpVideoSurface videoSurfaceCurrent,
+        uint32_t /*videoSurfaceFutureCount*/,
+        VdpVideoSurface const* /*videoSurfaceFuture*/,
+        VdpRect const* videoSourceRect,
+        VdpOutputSurface destinationSurface,
+        VdpRect const* destinationRect,
+        VdpRect const* destinationVideoRect,
+        uint32_t layerCount,
+        VdpLayer const* /*layers*/
+    ) {
+        auto& driver = getDriver();
+        std::shared_ptr<CpuVideoSurface> pSource;
+        std::shared_ptr<CpuOutputSurface> pDestination;
+
+        {
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            auto pMixer = findObject(driver.videoMixers, mixer);
+            pSource = findSharedObject(driver.videoSurfaces, videoSurfaceCurrent);
+            pDestination = findSharedObject(driver.outputSurfaces, destinationSurface);
+            if (pMixer == nullptr || pSource == nullptr || pDestination == nullptr) {
+                return VDP_STATUS_INVALID_HANDLE;
+            }
+        }
+
+        // The background surface and the layers are not implemented,
+        // the field pictures are processed as frames (weave)
+        if (backgroundSurface != VDP_INVALID_HANDLE || layerCount > 0) {
+            return VDP_STATUS_NO_IMPLEMENTATION;
+        }
+
+        VdpRect sourceRect = videoSourceRect != nullptr ? *videoSourceRect : VdpRect{ 0, 0, pSource->width, pSource->height };
+        VdpRect outputRect = destinationRect != nullptr ? *destinationRect : VdpRect{ 0, 0, pDestination->width, pDestination->height };
+        VdpRect videoRect = destinationVideoRect != nullptr ? *destinationVideoRect : outputRect;
+        if (!isRectValid(sourceRect, pSource->width, pSource->height) || !isRectValid(outputRect, pDestination->width, pDestination->height)) {
+            return VDP_STATUS_INVALID_VALUE;
+        }
+
+        bool bIsBGRA = pDestination->format == VDP_RGBA_FORMAT_B8G8R8A8;
+
+        // The video surface is always locked before the output surface
+        std::shared_lock<std::shared_mutex> sourceLock(pSource->mutex);
+        std::unique_lock<std::shared_mutex> destinationLock(pDestination->mutex);
+
+        // Fill the destination with an opaque black background
+        for (uint32_t y = outputRect.y0; y < outputRect.y1; ++y) {
+            uint8_t* pRow = &pDestination->pixels[(y * pDestination->width + outputRect.x0) * 4];
+            for (uint32_t x = outputRect.x0; x < outputRect.x1; ++x, pRow += 4) {
+                pRow[0] = 0;
+                pRow[1] = 0;
+                pRow[2] = 0;
+                pRow[3] = 255;
+            }
+        }
+
+        uint32_t sourceWidth = sourceRect.x1 - sourceRect.x0;
+        uint32_t sourceHeight = sourceRect.y1 - sourceRect.y0;
+        uint32_t videoWidth = videoRect.x1 > videoRect.x0 ? videoRect.x1 - videoRect.x0 : 0;
+        uint32_t videoHeight = videoRect.y1 > videoRect.y0 ? videoRect.y1 - videoRect.y0 : 0;
+        if (sourceWidth == 0 || sourceHeight == 0 || videoWidth == 0 || videoHeight == 0) {
+            return VDP_STATUS_OK;
+        }
+
+        // Clip the video rectangle to the output rectangle
+        uint32_t x0 = std::max(videoRect.x0, outputRect.x0);
+        uint32_t x1 = std::min(videoRect.x1, outputRect.x1);
+        uint32_t y0 = std::max(videoRect.y0, outputRect.y0);
+        uint32_t y1 = std::min(videoRect.y1, outputRect.y1);
+        if (x0 >= x1 || y0 >= y1) {
+            return VDP_STATUS_OK;
+        }
+
+        // Nearest neighbour scaling: precompute the source columns
+        std::vector<uint32_t> sourceColumns(x1 - x0);
+        for (uint32_t x = x0; x < x1; ++x) {
+            sourceColumns[x - x0] = sourceRect.x0 + static_cast<uint32_t>((static_cast<uint64_t>(x - videoRect.x0) * sourceWidth) / videoWidth);
+        }
+
+        uint32_t chromaWidth = pSource->getChromaWidth();
+        for (uint32_t y = y0; y < y1; ++y) {
+            uint32_t sourceY = sourceRect.y0 + static_cast<uint32_t>((static_cast<uint64_t>(y - videoRect.y0) * sourceHeight) / videoHeight);
+            const uint8_t* pLuma = &pSource->luma[sourceY * pSource->width];
+            const uint8_t* pChroma = &pSource->chroma[(sourceY / 2) * chromaWidth * 2];
+            uint8_t* pRow = &pDestination->pixels[(y * pDestination->width + x0) * 4];
+
+            for (uint32_t x = x0; x < x1; ++x, pRow += 4) {
+                uint32_t sourceX = sourceColumns[x - x0];
+
+                // BT.601 limited range YCbCr to RGB
+                int c = static_cast<int>(pLuma[sourceX]) - 16;
+                int d = static_cast<int>(pChroma[(sourceX / 2) * 2]) - 128;
+                int e = static_cast<int>(pChroma[(sourceX / 2) * 2 + 1]) - 128;
+
+                uint8_t red = clampComponent((298 * c + 409 * e + 128) >> 8);
+                uint8_t green = clampComponent((298 * c - 100 * d - 208 * e + 128) >> 8);
+                uint8_t blue = clampComponent((298 * c + 516 * d + 128) >> 8);
+
+                pRow[0] = bIsBGRA ? blue : red;
+                pRow[1] = green;
+                pRow[2] = bIsBGRA ? red : blue;
+                pRow[3] = 255;
+            }
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    /*
+     * Presentation queue
+     */
+    VdpStatus cpuPresentationQueueTargetCreateX11(VdpDevice device, Drawable /*drawable*/, VdpPresentationQueueTarget* target) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (target == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        if (driver.devices.count(device) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        // Nothing is drawn, the drawable is ignored
+        *target = driver.createHandle();
+        driver.queueTargets.emplace(*target, CpuPresentationQueueTarget{ device });
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueTargetDestroy(VdpPresentationQueueTarget target) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (driver.queueTargets.erase(target) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueCreate(VdpDevice device, VdpPresentationQueueTarget target, VdpPresentationQueue* queue) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (queue == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        auto pTarget = findObject(driver.queueTargets, target);
+        if (driver.devices.count(device) == 0 || pTarget == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (pTarget->device != device) {
+            return VDP_STATUS_HANDLE_DEVICE_MISMATCH;
+        }
+
+        *queue = driver.createHandle();
+        driver.queues.emplace(*queue, CpuPresentationQueue{ device, { 0.0f, 0.0f, 0.0f, 1.0f }, {} });
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueDestroy(VdpPresentationQueue queue) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (driver.queues.erase(queue) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueSetBackgroundColor(VdpPresentationQueue queue, VdpColor* const backgroundColor) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        auto pQueue = findObject(driver.queues, queue);
+        if (pQueue == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (backgroundColor == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        pQueue->backgroundColor = *backgroundColor;
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueGetTime(VdpPresentationQueue queue, VdpTime* currentTime) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        if (findObject(driver.queues, queue) == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (currentTime == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        *currentTime = getSteadyTime();
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueDisplay(VdpPresentationQueue queue, VdpOutputSurface surface, uint32_t /*clipWidth*/, uint32_t /*clipHeight*/, VdpTime earliestPresentationTime) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        auto pQueue = findObject(driver.queues, queue);
+        if (pQueue == nullptr || driver.outputSurfaces.count(surface) == 0) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        // A surface can't be displayed before the previous one
+        VdpTime presentationTime = earliestPresentationTime;
+        if (!pQueue->displayedSurfaces.empty()) {
+            presentationTime = std::max(presentationTime, pQueue->displayedSurfaces.back().presentationTime);
+        }
+
+        pQueue->displayedSurfaces.push_back({ surface, presentationTime });
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuPresentationQueueQuerySurfaceStatus(VdpPresentationQueue queue, VdpOutputSurface surface, VdpPresentationQueueStatus* status, VdpTime* firstPresentationTime) {
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        auto pQueue = findObject(driver.queues, queue);
+        if (pQueue == nullptr) {
+            return VDP_STATUS_INVALID_HANDLE;
+        }
+
+        if (status == nullptr || firstPresentationTime == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        // The visible surface is the last one whose time is reached, the previous ones are idle
+        auto& displayedSurfaces = pQueue->displayedSurfaces;
+        VdpTime currentTime = getSteadyTime();
+        while (displayedSurfaces.size() > 1 && displayedSurfaces[1].presentationTime <= currentTime) {
+            displayedSurfaces.pop_front();
+        }
+
+        *status = VDP_PRESENTATION_QUEUE_STATUS_IDLE;
+        *firstPresentationTime = 0;
+        for (std::size_t i = 0; i < displayedSurfaces.size(); ++i) {
+            if (displayedSurfaces[i].surface != surface) {
+                continue;
+            }
+
+            bool bIsVisible = i == 0 && displayedSurfaces[i].presentationTime <= currentTime;
+            *status = bIsVisible ? VDP_PRESENTATION_QUEUE_STATUS_VISIBLE : VDP_PRESENTATION_QUEUE_STATUS_QUEUED;
+            if (bIsVisible) {
+                *firstPresentationTime = displayedSurfaces[i].presentationTime;
+            }
+            break;
+        }
+
+        return VDP_STATUS_OK;
+    }
+
+    VdpStatus cpuGetProcAddress(VdpDevice device, VdpFuncId functionID, void** functionPointer) {
+        {
+            auto& driver = getDriver();
+            std::lock_guard<std::mutex> lock(driver.mutex);
+            if (driver.devices.count(device) == 0) {
+                return VDP_STATUS_INVALID_HANDLE;
+            }
+        }
+
+        if (functionPointer == nullptr) {
+            return VDP_STATUS_INVALID_POINTER;
+        }
+
+        switch (functionID) {
+        case VDP_FUNC_ID_GET_ERROR_STRING:
+            *functionPointer = reinterpret_cast<void*>(&cpuGetErrorString);
+            break;
+
+        case VDP_FUNC_ID_GET_PROC_ADDRESS:
+            *functionPointer = reinterpret_cast<void*>(&cpuGetProcAddress);
+            break;
+
+        case VDP_FUNC_ID_GET_INFORMATION_STRING:
+            *functionPointer = reinterpret_cast<void*>(&cpuGetInformationString);
+            break;
+
+        case VDP_FUNC_ID_DEVICE_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuDeviceDestroy);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_SURFACE_CREATE:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoSurfaceCreate);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_SURFACE_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoSurfaceDestroy);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoSurfaceGetParameters);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoSurfaceGetBitsYCbCr);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoSurfacePutBitsYCbCr);
+            break;
+
+        case VDP_FUNC_ID_OUTPUT_SURFACE_CREATE:
+            *functionPointer = reinterpret_cast<void*>(&cpuOutputSurfaceCreate);
+            break;
+
+        case VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuOutputSurfaceDestroy);
+            break;
+
+        case VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS:
+            *functionPointer = reinterpret_cast<void*>(&cpuOutputSurfaceGetParameters);
+            break;
+
+        case VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE:
+            *functionPointer = reinterpret_cast<void*>(&cpuOutputSurfaceGetBitsNative);
+            break;
+
+        case VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE:
+            *functionPointer = reinterpret_cast<void*>(&cpuOutputSurfacePutBitsNative);
+            break;
+
+        case VDP_FUNC_ID_DECODER_CREATE:
+            *functionPointer = reinterpret_cast<void*>(&cpuDecoderCreate);
+            break;
+
+        case VDP_FUNC_ID_DECODER_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuDecoderDestroy);
+            break;
+
+        case VDP_FUNC_ID_DECODER_RENDER:
+            *functionPointer = reinterpret_cast<void*>(&cpuDecoderRender);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_MIXER_CREATE:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoMixerCreate);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_MIXER_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoMixerDestroy);
+            break;
+
+        case VDP_FUNC_ID_VIDEO_MIXER_RENDER:
+            *functionPointer = reinterpret_cast<void*>(&cpuVideoMixerRender);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueTargetCreateX11);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueTargetDestroy);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueCreate);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueDestroy);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueSetBackgroundColor);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueGetTime);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueDisplay);
+            break;
+
+        case VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS:
+            *functionPointer = reinterpret_cast<void*>(&cpuPresentationQueueQuerySurfaceStatus);
+            break;
+
+        default:
+            *functionPointer = nullptr;
+            return VDP_STATUS_INVALID_FUNC_ID;
+        }
+
+        return VDP_STATUS_OK;
+    }
+}
+
+namespace vw {
+    VdpDevice CpuBackend::createDevice(VdpGetProcAddress** ppGetProcAddress) {
+        if (ppGetProcAddress == nullptr) {
+            throw std::runtime_error("[CpuBackend] The VdpGetProcAddress pointer is null");
+        }
+
+        auto& driver = getDriver();
+        std::lock_guard<std::mutex> lock(driver.mutex);
+
+        VdpDevice device = driver.createHandle();
+        driver.devices.insert(device);
+        *ppGetProcAddress = &cpuGetProcAddress;
+
+        return device;
+    }
+
+    std::string CpuBackend::getName() const {
+        return "CPU";
+    }
+}
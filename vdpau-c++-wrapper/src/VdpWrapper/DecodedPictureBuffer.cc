@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <utility>
 
 #include <VdpWrapper/Device.h>
 
@@ -34,6 +35,9 @@ namespace vw {
         assert(m_currentIndex >= 0 && static_cast<std::size_t>(m_currentIndex) < m_listDecodedPictures.size());
         auto& decodedPicture = m_listDecodedPictures[m_currentIndex];
 
+        // The oldest surface may still be read back by another thread
+        decodedPicture.surface.waitUntilUnpinned();
+
         decodedPicture.referenceType = infos.referenceType;
         decodedPicture.iFrameNum = infos.frame_num;
         decodedPicture.iTopFieldOrderCount = infos.field_order_cnt[0];
@@ -88,6 +92,25 @@ namespace vw {
         m_listIndexReferencePictures.clear();
     }
 
+    void DecodedPictureBuffer::adoptSurfacePool(std::vector<DecodedPicture>&& pictures) {
+        m_listDecodedPictures = std::move(pictures);
+        m_listIndexReferencePictures.clear();
+        m_currentIndex = 0;
+
+        for (auto& decodedPicture : m_listDecodedPictures) {
+            decodedPicture.referenceType = PictureReferenceType::NoReference;
+        }
+    }
+
+    std::vector<DecodedPicture> DecodedPictureBuffer::releaseSurfacePool() {
+        std::vector<DecodedPicture> pictures = std::move(m_listDecodedPictures);
+        m_listDecodedPictures.clear();
+        m_listIndexReferencePictures.clear();
+        m_currentIndex = 0;
+
+        return pictures;
+    }
+
     void DecodedPictureBuffer::initializeSurfacePool(Device& device, const SizeU& surfaceSize, int poolSize) {
         for (int i = 0; i < poolSize; ++i) {
             m_listDecodedPictures.emplace_back(device, surfaceSize);
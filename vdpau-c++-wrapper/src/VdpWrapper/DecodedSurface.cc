@@ -1,59 +1,85 @@
 #include <VdpWrapper/DecodedSurface.h>
 
-#include <fstream>
 #include <iostream>
-#include <iterator>
+#include <memory>
+#include <stdexcept>
 
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/MappedFile.h>
+#include <VdpWrapper/PixelConversion.h>
 #include <VdpWrapper/VdpFunctions.h>
 
 namespace vw {
     DecodedSurface::DecodedSurface(Device& device, SizeU size)
-    : m_vdpVideoSurface(VDP_INVALID_HANDLE)
+    : m_pFunctions(&device.getFunctions())
+    , m_vdpVideoSurface(VDP_INVALID_HANDLE)
     , m_size(size)
-    , m_iPictureOrderCount(-1) {
+    , m_storageSize(size)
+    , m_iPictureOrderCount(-1)
+    , m_presentationTimeStamp(NoTimestamp)
+    , m_pPinState(std::make_shared<PinState>()) {
         allocateVdpSurface(device, size);
     }
 
     DecodedSurface::DecodedSurface(Device& device, const std::string& filename, SizeU size)
     : DecodedSurface(device, size) {
-        // Load raw bytes
-        std::vector<uint8_t> rawBytes;
-        std::ifstream file(filename, std::ios::binary);
-        file.unsetf(std::ios::skipws);
-        rawBytes.insert(rawBytes.begin(), std::istream_iterator<uint8_t>(file), std::istream_iterator<uint8_t>());
+        // Upload the raw bytes straight from the file mapping
+        auto pFile = std::make_shared<const MappedFile>(filename);
+        upload(ImageBuffer::view(PixelFormat::NV12, size, pFile));
+    }
 
-        // Create planes
-        ImageBuffer buffer(size, rawBytes);
+    void DecodedSurface::upload(const ImageBuffer& buffer) {
+        if (buffer.getFormat() != PixelFormat::I420) {
+            putNV12Bits(buffer);
+            return;
+        }
 
-        // Upload bytes to the surface
-        const void* planes[2] = { buffer.getPlane(0), buffer.getPlane(1) };
-        const uint32_t lineSize[2] = { buffer.getLineSize(0), buffer.getLineSize(1) };
-        auto vdpStatus = gVdpFunctionsInstance()->videoSurfacePutBitsYCbCr(
-            m_vdpVideoSurface,
-            VDP_YCBCR_FORMAT_NV12,
-            planes,
-            lineSize
-        );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't upload bytes from source image");
+        ImageBuffer stagingBuffer(PixelFormat::NV12, buffer.getSize());
+        upload(buffer, stagingBuffer);
+    }
+
+    void DecodedSurface::upload(const ImageBuffer& buffer, ImageBuffer& stagingBuffer) {
+        if (buffer.getFormat() == PixelFormat::I420) {
+            // Interleave the chroma planes to upload the native layout of the surface
+            stagingBuffer.resize(PixelFormat::NV12, buffer.getSize());
+            convertImage(buffer, stagingBuffer);
+            putNV12Bits(stagingBuffer);
+            return;
+        }
+
+        putNV12Bits(buffer);
     }
 
     DecodedSurface::~DecodedSurface() {
+        // A reader may still use the surface from another thread
+        if (m_pPinState != nullptr) {
+            waitUntilUnpinned();
+        }
+
         if (m_vdpVideoSurface != VDP_INVALID_HANDLE) {
-            gVdpFunctionsInstance()->videoSurfaceDestroy(m_vdpVideoSurface);
+            m_pFunctions->videoSurfaceDestroy(m_vdpVideoSurface);
         }
     }
 
     DecodedSurface::DecodedSurface(DecodedSurface&& other)
-    : m_vdpVideoSurface(std::exchange(other.m_vdpVideoSurface, VDP_INVALID_HANDLE))
+    : m_pFunctions(other.m_pFunctions)
+    , m_vdpVideoSurface(std::exchange(other.m_vdpVideoSurface, VDP_INVALID_HANDLE))
     , m_size(std::exchange(other.m_size, 0))
-    , m_iPictureOrderCount(std::exchange(other.m_iPictureOrderCount, -1)) {
+    , m_storageSize(std::exchange(other.m_storageSize, 0))
+    , m_iPictureOrderCount(std::exchange(other.m_iPictureOrderCount, -1))
+    , m_presentationTimeStamp(std::exchange(other.m_presentationTimeStamp, NoTimestamp))
+    , m_pPinState(std::move(other.m_pPinState)) {
 
     }
 
     DecodedSurface& DecodedSurface::operator=(DecodedSurface&& other) {
+        std::swap(m_pFunctions, other.m_pFunctions);
         std::swap(m_vdpVideoSurface, other.m_vdpVideoSurface);
         std::swap(m_size, other.m_size);
+        std::swap(m_storageSize, other.m_storageSize);
         std::swap(m_iPictureOrderCount, other.m_iPictureOrderCount);
+        std::swap(m_presentationTimeStamp, other.m_presentationTimeStamp);
+        std::swap(m_pPinState, other.m_pPinState);
 
         return *this;
     }
@@ -74,55 +100,141 @@ namespace vw {
         return m_iPictureOrderCount;
     }
 
+    void DecodedSurface::setPresentationTimeStamp(VdpTime presentationTimeStamp) {
+        m_presentationTimeStamp = presentationTimeStamp;
+    }
+
+    VdpTime DecodedSurface::getPresentationTimeStamp() const {
+        return m_presentationTimeStamp;
+    }
+
     void DecodedSurface::allocateVdpSurface(Device& device, const SizeU& size) {
         // Update the surface size
         m_size = size;
 
-        auto vdpStatus = gVdpFunctionsInstance()->videoSurfaceCreate(
+        auto vdpStatus = m_pFunctions->videoSurfaceCreate(
             device.getVdpHandle(),
             VDP_YCBCR_FORMAT_NV12,
             size.width,
             size.height,
             &m_vdpVideoSurface
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't create an video surface");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't create an video surface");
 
         SizeU realSize;
         VdpYCbCrFormat format;
-        vdpStatus = gVdpFunctionsInstance()->videoSurfaceGetParameters(
+        vdpStatus = m_pFunctions->videoSurfaceGetParameters(
             m_vdpVideoSurface,
             &format,
             &realSize.width,
             &realSize.height
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't retreive surface informations");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't retreive surface informations");
 
         assert(format == VDP_YCBCR_FORMAT_NV12);
-        assert(realSize == m_size); // TODO: VDPAU API says the size may be different form call to align data
-                                    //       So we need to handle this case
+
+        // The driver may round the size up to align the data, the readback must
+        // cover the whole storage
+        m_storageSize = realSize;
     }
 
     ImageBuffer DecodedSurface::copyHardwareMemory() {
-        std::vector<Plane> planes(2);
-        std::vector<uint32_t> linesizes(2);
+        ImageBuffer buffer(PixelFormat::NV12, m_storageSize);
+        copyHardwareMemory(buffer);
+
+        return buffer;
+    }
+
+    void DecodedSurface::copyHardwareMemory(ImageBuffer& buffer) {
+        if (buffer.getFormat() != PixelFormat::I420 && buffer.getFormat() != PixelFormat::YUYV) {
+            getNV12Bits(buffer);
+            return;
+        }
+
+        ImageBuffer stagingBuffer(PixelFormat::NV12, m_storageSize);
+        copyHardwareMemory(buffer, stagingBuffer);
+    }
+
+    void DecodedSurface::copyHardwareMemory(ImageBuffer& buffer, ImageBuffer& stagingBuffer) {
+        if (buffer.getFormat() == PixelFormat::I420 || buffer.getFormat() == PixelFormat::YUYV) {
+            // NV12 is the native layout of the decoded surfaces, the driver reads
+            // it back without conversion: convert it with the SIMD kernels instead
+            getNV12Bits(stagingBuffer);
+            convertImage(stagingBuffer, buffer);
+            return;
+        }
 
-        linesizes[0] = m_size.width;
-        linesizes[1] = m_size.width;
+        getNV12Bits(buffer);
+    }
+
+    ImageFrame DecodedSurface::copyHardwareMemory(ImageBufferPool& pool, PixelFormat format) {
+        ImageFrame frame = pool.acquire(format, m_storageSize);
+        if (format == PixelFormat::I420 || format == PixelFormat::YUYV) {
+            ImageFrame stagingFrame = pool.acquire(PixelFormat::NV12, m_storageSize);
+            copyHardwareMemory(*frame, *stagingFrame);
+        } else {
+            getNV12Bits(*frame);
+        }
+
+        return frame;
+    }
+
+    void DecodedSurface::pin() {
+        std::lock_guard<std::mutex> lock(m_pPinState->mutex);
+        ++m_pPinState->iPins;
+    }
+
+    void DecodedSurface::unpin() {
+        std::lock_guard<std::mutex> lock(m_pPinState->mutex);
+        if (m_pPinState->iPins <= 0) {
+            throw std::runtime_error("[DecodedSurface] The surface isn't pinned");
+        }
+
+        if (--m_pPinState->iPins == 0) {
+            m_pPinState->condition.notify_all();
+        }
+    }
+
+    bool DecodedSurface::isPinned() const {
+        std::lock_guard<std::mutex> lock(m_pPinState->mutex);
+        return m_pPinState->iPins > 0;
+    }
 
-        // Allocate Planes
-        planes[0].resize(m_size.width * m_size.height);
-        planes[1].resize(m_size.width * m_size.height / 2);
+    void DecodedSurface::waitUntilUnpinned() const {
+        std::unique_lock<std::mutex> lock(m_pPinState->mutex);
+        m_pPinState->condition.wait(lock, [this]() {
+            return m_pPinState->iPins == 0;
+        });
+    }
+
+    void DecodedSurface::putNV12Bits(const ImageBuffer& buffer) {
+        if (buffer.getFormat() != PixelFormat::NV12) {
+            throw std::runtime_error("[DecodedSurface] Only NV12 and I420 images can be uploaded");
+        }
+
+        const void* planes[2] = { buffer.getPlane(0), buffer.getPlane(1) };
+        const uint32_t lineSize[2] = { buffer.getLineSize(0), buffer.getLineSize(1) };
+        auto vdpStatus = m_pFunctions->videoSurfacePutBitsYCbCr(
+            m_vdpVideoSurface,
+            VDP_YCBCR_FORMAT_NV12,
+            planes,
+            lineSize
+        );
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't upload bytes from source image");
+    }
+
+    void DecodedSurface::getNV12Bits(ImageBuffer& buffer) {
+        buffer.resize(PixelFormat::NV12, m_storageSize);
 
         // Cast to void pointer
-        void* ppPlanes[2] = { planes[0].data(), planes[1].data() };
-        auto vdpStatus = gVdpFunctionsInstance()->videoSurfaceGetBitsYCbCr(
+        void* ppPlanes[2] = { buffer.getPlane(0), buffer.getPlane(1) };
+        const uint32_t lineSizes[2] = { buffer.getLineSize(0), buffer.getLineSize(1) };
+        auto vdpStatus = m_pFunctions->videoSurfaceGetBitsYCbCr(
             m_vdpVideoSurface,
             VDP_YCBCR_FORMAT_NV12,
             ppPlanes,
-            linesizes.data()
+            lineSizes
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't retreive GPU data");
-
-        return ImageBuffer(std::move(planes), std::move(linesizes));
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[DecodedSurface] Couldn't retreive GPU data");
     }
 }
@@ -1,6 +1,8 @@
 #include <VdpWrapper/Decoder.h>
 
+#include <memory>
 #include <stdexcept>
+#include <utility>
 
 #include <VdpWrapper/Device.h>
 #include <VdpWrapper/NalUnit.h>
@@ -33,14 +35,28 @@ namespace {
 namespace vw {
     Decoder::Decoder(Device& device)
     : m_device(device)
-    , m_decoder(VDP_INVALID_HANDLE) {
+    , m_decoder(VDP_INVALID_HANDLE)
+    , m_decodeMode(DecodeMode::AllPictures)
+    , m_pSessionPool(nullptr)
+    , m_sessionKey{VDP_DECODER_PROFILE_H264_HIGH, SizeU(0, 0), 0} {
 
     }
 
     Decoder::~Decoder() {
-        if (m_decoder != VDP_INVALID_HANDLE) {
-            gVdpFunctionsInstance()->decoderDestroy(m_decoder);
+        if (m_decoder == VDP_INVALID_HANDLE) {
+            return;
+        }
+
+        if (m_pSessionPool != nullptr) {
+            auto pSession = std::make_unique<DecoderSession>();
+            pSession->key = m_sessionKey;
+            pSession->decoder = m_decoder;
+            pSession->pictures = m_decodedPicturesBuffer.releaseSurfacePool();
+            m_pSessionPool->release(std::move(pSession));
+            return;
         }
+
+        m_device->decoderDestroy(m_decoder);
     }
 
     DecodedSurface& Decoder::decode(const NalUnit &nal) {
@@ -48,6 +64,10 @@ namespace vw {
             throw std::runtime_error("[Decoder] The nal to be decoded must be a coded slice");
         }
 
+        if (!isDecodable(nal)) {
+            throw std::runtime_error("[Decoder] The nal is dropped by the current decode mode");
+        }
+
         auto& infos = nal.getH264Infos();
         if (!infos.bFirstSPSReceived) {
             throw std::runtime_error("[Decoder] Couldn't decode picture since no SPS has been received");
@@ -59,15 +79,28 @@ namespace vw {
 
         if (m_decoder == VDP_INVALID_HANDLE) {
             VdpDecoderProfile profile = convertBitstreamProfileToVdpProfile(infos.iProfile);
-            auto vdpStatus = gVdpFunctionsInstance()->decoderCreate(
-                m_device.getVdpHandle(),
-                profile,
-                infos.pictureSize.width,
-                infos.pictureSize.height,
-                infos.num_ref_frames,
-                &m_decoder
-            );
-            gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[Decoder] Couldn't create the decoder");
+            m_sessionKey = DecoderSessionKey{profile, infos.pictureSize, static_cast<uint32_t>(infos.num_ref_frames)};
+
+            // A warm session skips the decoder creation and the surface allocation
+            std::unique_ptr<DecoderSession> pSession;
+            if (m_pSessionPool != nullptr) {
+                pSession = m_pSessionPool->acquire(m_sessionKey);
+            }
+
+            if (pSession != nullptr) {
+                m_decoder = pSession->decoder;
+                m_decodedPicturesBuffer.adoptSurfacePool(std::move(pSession->pictures));
+            } else {
+                auto vdpStatus = m_device->decoderCreate(
+                    m_device.getVdpHandle(),
+                    profile,
+                    infos.pictureSize.width,
+                    infos.pictureSize.height,
+                    infos.num_ref_frames,
+                    &m_decoder
+                );
+                m_device->throwExceptionOnFail(vdpStatus, "[Decoder] Couldn't create the decoder");
+            }
         }
 
         // If it's new IDR frame, we can recreate the DPB
@@ -87,17 +120,30 @@ namespace vw {
         bitstreams[0].struct_version = VDP_BITSTREAM_BUFFER_VERSION;
         bitstreams[0].bitstream = nal.getBitstream().data();
         bitstreams[0].bitstream_bytes = nal.getBitstream().size();
-        auto vdpStatus = gVdpFunctionsInstance()->decoderRender(
+        auto vdpStatus = m_device->decoderRender(
             m_decoder,
             newDecodedPicture.surface.getVdpHandle(),
             &infosUpdated,
             1,
             bitstreams
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[Decoder] Couldn't decode the picture");
+        m_device->throwExceptionOnFail(vdpStatus, "[Decoder] Couldn't decode the picture");
 
         newDecodedPicture.surface.setPictureOrderCount(newDecodedPicture.iPictureOrderCount);
+        newDecodedPicture.surface.setPresentationTimeStamp(infos.presentationTimeStamp);
 
         return newDecodedPicture.surface;
     }
+
+    void Decoder::setDecodeMode(DecodeMode mode) {
+        m_decodeMode = mode;
+    }
+
+    bool Decoder::isDecodable(const NalUnit& nal) const {
+        return nal.isSelected(m_decodeMode);
+    }
+
+    void Decoder::setSessionPool(DecoderSessionPool* pSessionPool) {
+        m_pSessionPool = pSessionPool;
+    }
 }
@@ -0,0 +1,96 @@
+#include <VdpWrapper/DecoderSessionPool.h>
+
+#include <algorithm>
+
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/VdpFunctions.h>
+
+namespace vw {
+    bool DecoderSessionKey::operator==(const DecoderSessionKey& other) const {
+        return profile == other.profile && size == other.size && maxReferences == other.maxReferences;
+    }
+
+    bool DecoderSessionKey::operator!=(const DecoderSessionKey& other) const {
+        return !(*this == other);
+    }
+
+    DecoderSessionPool::DecoderSessionPool(Device& device, std::size_t iMemoryBudget)
+    : m_device(device)
+    , m_iMemoryBudget(iMemoryBudget)
+    , m_iMemoryUsage(0)
+    , m_iHits(0)
+    , m_iMisses(0)
+    , m_iEvictions(0) {
+
+    }
+
+    DecoderSessionPool::~DecoderSessionPool() {
+        for (auto& pSession : m_availableSessions) {
+            destroySession(*pSession);
+        }
+    }
+
+    std::unique_ptr<DecoderSession> DecoderSessionPool::acquire(const DecoderSessionKey& key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Search from the most recently used
+        auto itSession = std::find_if(m_availableSessions.rbegin(), m_availableSessions.rend(), [&key](const auto& pSession) {
+            return pSession->key == key;
+        });
+
+        if (itSession == m_availableSessions.rend()) {
+            ++m_iMisses;
+            return nullptr;
+        }
+
+        std::unique_ptr<DecoderSession> pSession = std::move(*itSession);
+        m_availableSessions.erase(std::next(itSession).base());
+        m_iMemoryUsage -= estimateMemory(pSession->key);
+        ++m_iHits;
+
+        return pSession;
+    }
+
+    void DecoderSessionPool::release(std::unique_ptr<DecoderSession> pSession) {
+        if (pSession == nullptr || pSession->decoder == VDP_INVALID_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_iMemoryUsage += estimateMemory(pSession->key);
+        m_availableSessions.push_back(std::move(pSession));
+
+        while (m_iMemoryUsage > m_iMemoryBudget && !m_availableSessions.empty()) {
+            auto& pEvictedSession = m_availableSessions.front();
+            m_iMemoryUsage -= estimateMemory(pEvictedSession->key);
+            destroySession(*pEvictedSession);
+            m_availableSessions.pop_front();
+            ++m_iEvictions;
+        }
+    }
+
+    SessionPoolStatistics DecoderSessionPool::getStatistics() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        SessionPoolStatistics statistics;
+        statistics.availableSessions = m_availableSessions.size();
+        statistics.memoryUsage = m_iMemoryUsage;
+        statistics.hits = m_iHits;
+        statistics.misses = m_iMisses;
+        statistics.evictions = m_iEvictions;
+
+        return statistics;
+    }
+
+    std::size_t DecoderSessionPool::estimateMemory(const DecoderSessionKey& key) {
+        // The decoded picture buffer holds num_ref_frames + 1 NV12 surfaces
+        std::size_t iSurfaceSize = static_cast<std::size_t>(key.size.width) * key.size.height * 3 / 2;
+        return (key.maxReferences + 1) * iSurfaceSize;
+    }
+
+    void DecoderSessionPool::destroySession(DecoderSession& session) {
+        session.pictures.clear();
+        m_device->decoderDestroy(session.decoder);
+        session.decoder = VDP_INVALID_HANDLE;
+    }
+}
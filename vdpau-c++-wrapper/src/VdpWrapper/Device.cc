@@ -1,46 +1,68 @@
 #include <VdpWrapper/Device.h>
 
-#include <array>
 #include <iostream>
 #include <stdexcept>
 
-#include <vdpau/vdpau_x11.h>
-
+#include <VdpWrapper/Backend.h>
 #include <VdpWrapper/Display.h>
-#include <VdpWrapper/RenderSurface.h>
 #include <VdpWrapper/VdpFunctions.h>
 
 namespace vw {
-    Device::Device(Display& display) {
-        // Create the device
-        VdpGetProcAddress* pGetProcAddress = nullptr;
-        VdpStatus vdpStatus = vdp_device_create_x11(
-            display.getXDisplay(),
-            display.getXScreen(),
-            &m_VdpDevice,
-            &pGetProcAddress
-        );
-        if (vdpStatus != VDP_STATUS_OK) {
-            throw std::runtime_error("[Device] VDPAU device creation failed\n\tError code: " + std::to_string(vdpStatus));
-        }
-
-        // Initialize the VdpFunctionsInstance
-        gVdpFunctionsInstance.create(m_VdpDevice, pGetProcAddress);
-
-        const char *szVdpInfos = nullptr;
-        vdpStatus = gVdpFunctionsInstance()->getInformationString(&szVdpInfos);
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[Device] Couldn't retrive VDPAU device inforamtions");
+    Device::Device(Display& display)
+    : m_pOwnedBackend(std::make_unique<X11Backend>(display))
+    , m_VdpDevice(VDP_INVALID_HANDLE) {
+        initialize(*m_pOwnedBackend);
+    }
 
-        std::cout << "[Device] VDPAU device created" << std::endl;
-        std::cout << "[Device] VDPAU version: " << std::string(szVdpInfos) << std::endl;
+    Device::Device(Backend& backend)
+    : m_VdpDevice(VDP_INVALID_HANDLE) {
+        initialize(backend);
     }
 
     Device::~Device() {
-        gVdpFunctionsInstance()->deviceDestroy(m_VdpDevice);
-        gVdpFunctionsInstance.dispose();
+        m_pFunctions->deviceDestroy(m_VdpDevice);
     }
 
     VdpDevice Device::getVdpHandle() const {
         return m_VdpDevice;
     }
+
+    const VdpFunctions& Device::getFunctions() const {
+        return *m_pFunctions;
+    }
+
+    const VdpFunctions* Device::operator->() const {
+        return m_pFunctions.get();
+    }
+
+    void Device::initialize(Backend& backend) {
+        // Create the device
+        VdpGetProcAddress* pGetProcAddress = nullptr;
+        m_VdpDevice = backend.createDevice(&pGetProcAddress);
+
+        const char *szVdpInfos = nullptr;
+        try {
+            // Retrieve the functions of this device
+            m_pFunctions = std::make_unique<VdpFunctions>(m_VdpDevice, pGetProcAddress);
+
+            VdpStatus vdpStatus = m_pFunctions->getInformationString(&szVdpInfos);
+            m_pFunctions->throwExceptionOnFail(vdpStatus, "[Device] Couldn't retrive VDPAU device inforamtions");
+        } catch (...) {
+            // The destructor won't be called, free the device here
+            if (m_pFunctions != nullptr) {
+                m_pFunctions->deviceDestroy(m_VdpDevice);
+                m_pFunctions.reset();
+            } else {
+                void* pDeviceDestroy = nullptr;
+                if (pGetProcAddress(m_VdpDevice, VDP_FUNC_ID_DEVICE_DESTROY, &pDeviceDestroy) == VDP_STATUS_OK && pDeviceDestroy != nullptr) {
+                    reinterpret_cast<VdpDeviceDestroy*>(pDeviceDestroy)(m_VdpDevice);
+                }
+            }
+
+            throw;
+        }
+
+        std::cout << "[Device] VDPAU device created (" << backend.getName() << " backend)" << std::endl;
+        std::cout << "[Device] VDPAU version: " << std::string(szVdpInfos) << std::endl;
+    }
 }
@@ -0,0 +1,206 @@
+#include <VdpWrapper/Executor.h>
+
+#include <stdexcept>
+#include <utility>
+
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/PresentationQueue.h>
+#include <VdpWrapper/RenderSurface.h>
+#include <VdpWrapper/VideoMixer.h>
+
+namespace vw {
+    /**
+     * Root coroutine of a spawned task: it starts right away and frees itself at its end
+     */
+    struct Executor::DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() const noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() const noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() const noexcept {
+                return {};
+            }
+
+            void return_void() const noexcept {
+            }
+
+            void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    Executor::Executor(std::size_t iThreadCount, std::chrono::microseconds pollInterval)
+    : m_pollInterval(pollInterval)
+    , m_iRunningTasks(0)
+    , m_bStop(false) {
+        if (iThreadCount == 0) {
+            throw std::invalid_argument("[Executor] At least one worker is needed");
+        }
+
+        for (std::size_t i = 0; i < iThreadCount; ++i) {
+            m_workers.emplace_back(&Executor::runWorker, this);
+        }
+    }
+
+    Executor::~Executor() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_workCondition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void Executor::spawn(Task<void> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_iRunningTasks;
+        }
+
+        runDetached(*this, std::move(task));
+    }
+
+    void Executor::waitIdle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCondition.wait(lock, [this] {
+            return m_iRunningTasks == 0;
+        });
+
+        if (m_firstError) {
+            std::rethrow_exception(std::exchange(m_firstError, nullptr));
+        }
+    }
+
+    void Executor::resume(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_readyCoroutines.push_back(handle);
+        }
+        m_workCondition.notify_one();
+    }
+
+    Executor::DetachedTask Executor::runDetached(Executor& executor, Task<void> task) {
+        // The task body runs on the workers, never on the thread calling spawn()
+        co_await executor.schedule();
+
+        std::exception_ptr error;
+        try {
+            co_await std::move(task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        executor.finishTask(error);
+    }
+
+    void Executor::addPendingCondition(std::function<bool()> condition, std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingConditions.push_back({ std::move(condition), handle });
+        }
+        m_workCondition.notify_one();
+    }
+
+    void Executor::runWorker() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (!m_bStop) {
+            if (!m_readyCoroutines.empty()) {
+                auto handle = m_readyCoroutines.front();
+                m_readyCoroutines.pop_front();
+
+                lock.unlock();
+                handle.resume();
+                lock.lock();
+                continue;
+            }
+
+            if (!m_pendingConditions.empty()) {
+                checkPendingConditions(lock);
+                continue;
+            }
+
+            m_workCondition.wait(lock);
+        }
+    }
+
+    void Executor::checkPendingConditions(std::unique_lock<std::mutex>& lock) {
+        // The worker takes all the conditions, the others keep running the ready coroutines
+        std::vector<PendingCondition> pendingConditions;
+        pendingConditions.swap(m_pendingConditions);
+        lock.unlock();
+
+        std::vector<PendingCondition> unsatisfiedConditions;
+        std::vector<std::coroutine_handle<>> satisfiedHandles;
+        for (auto& pendingCondition : pendingConditions) {
+            bool bSatisfied = true;
+            try {
+                bSatisfied = pendingCondition.condition();
+            } catch (...) {
+                // The coroutine is resumed, the error shows up at its next device call
+            }
+
+            if (bSatisfied) {
+                satisfiedHandles.push_back(pendingCondition.handle);
+            } else {
+                unsatisfiedConditions.push_back(std::move(pendingCondition));
+            }
+        }
+
+        lock.lock();
+        for (auto handle : satisfiedHandles) {
+            m_readyCoroutines.push_back(handle);
+        }
+        for (auto& pendingCondition : unsatisfiedConditions) {
+            m_pendingConditions.push_back(std::move(pendingCondition));
+        }
+
+        if (!satisfiedHandles.empty()) {
+            m_workCondition.notify_all();
+        } else if (m_readyCoroutines.empty() && !m_bStop) {
+            // Nothing changed, wait for the next poll unless new work comes in
+            m_workCondition.wait_for(lock, m_pollInterval);
+        }
+    }
+
+    void Executor::finishTask(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (error && !m_firstError) {
+            m_firstError = error;
+        }
+
+        --m_iRunningTasks;
+        m_idleCondition.notify_all();
+    }
+
+    Task<DecodedSurface&> decodeAsync(Executor& executor, Decoder& decoder, const NalUnit& nal) {
+        co_await executor.schedule();
+        co_return decoder.decode(nal);
+    }
+
+    Task<RenderSurface> processAsync(Executor& executor, VideoMixer& mixer, DecodedSurface& inputSurface) {
+        co_await executor.schedule();
+        co_return mixer.process(inputSurface);
+    }
+
+    Task<bool> enqueueAsync(Executor& executor, PresentationQueue& queue, RenderSurface surface, std::chrono::nanoseconds maxAhead) {
+        bool bEnqueued = queue.enqueue(std::move(surface));
+
+        co_await executor.poll([&queue, maxAhead] {
+            return queue.getScheduleEndTime() <= queue.getCurrentTime() + static_cast<VdpTime>(maxAhead.count());
+        });
+
+        co_return bEnqueued;
+    }
+}
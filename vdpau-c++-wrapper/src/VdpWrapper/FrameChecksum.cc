@@ -0,0 +1,293 @@
+#include <VdpWrapper/FrameChecksum.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <VdpWrapper/PixelConversion.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define VW_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace vw {
+    namespace {
+        // Reflected Castagnoli polynomial
+        constexpr uint32_t Crc32cPolynomial = 0x82F63B78;
+
+        std::array<uint32_t, 256> makeCrc32cTable() {
+            std::array<uint32_t, 256> table = {};
+            for (uint32_t i = 0; i < table.size(); ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc >> 1) ^ ((crc & 1) ? Crc32cPolynomial : 0);
+                }
+                table[i] = crc;
+            }
+
+            return table;
+        }
+
+        const std::array<uint32_t, 256> Crc32cTable = makeCrc32cTable();
+
+        uint32_t crc32cScalar(uint32_t crc, const uint8_t* pData, std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) {
+                crc = Crc32cTable[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+            }
+
+            return crc;
+        }
+
+#ifdef VW_X86_KERNELS
+        __attribute__((target("sse4.2")))
+        uint32_t crc32cSse42(uint32_t crc, const uint8_t* pData, std::size_t size) {
+            std::size_t i = 0;
+
+#ifdef __x86_64__
+            uint64_t crc64 = crc;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t value;
+                std::memcpy(&value, pData + i, sizeof(value));
+                crc64 = _mm_crc32_u64(crc64, value);
+            }
+            crc = static_cast<uint32_t>(crc64);
+#endif
+
+            for (; i + 4 <= size; i += 4) {
+                uint32_t value;
+                std::memcpy(&value, pData + i, sizeof(value));
+                crc = _mm_crc32_u32(crc, value);
+            }
+
+            for (; i < size; ++i) {
+                crc = _mm_crc32_u8(crc, pData[i]);
+            }
+
+            return crc;
+        }
+
+        bool hasCrc32cInstruction() {
+            static const bool bSupported = __builtin_cpu_supports("sse4.2");
+            return bSupported;
+        }
+#endif
+
+        // RFC 1321
+        class Md5 {
+        public:
+            Md5()
+            : m_state{ 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476 }
+            , m_iLength(0)
+            , m_iBufferSize(0) {
+            }
+
+            void update(const uint8_t* pData, std::size_t size) {
+                m_iLength += size;
+
+                if (m_iBufferSize > 0) {
+                    std::size_t iCopySize = std::min(size, m_buffer.size() - m_iBufferSize);
+                    std::memcpy(m_buffer.data() + m_iBufferSize, pData, iCopySize);
+                    m_iBufferSize += iCopySize;
+                    pData += iCopySize;
+                    size -= iCopySize;
+
+                    if (m_iBufferSize < m_buffer.size()) {
+                        return;
+                    }
+
+                    processBlock(m_buffer.data());
+                    m_iBufferSize = 0;
+                }
+
+                for (; size >= m_buffer.size(); pData += m_buffer.size(), size -= m_buffer.size()) {
+                    processBlock(pData);
+                }
+
+                std::memcpy(m_buffer.data(), pData, size);
+                m_iBufferSize = size;
+            }
+
+            std::array<uint8_t, 16> finalize() {
+                uint64_t iBitLength = m_iLength * 8;
+
+                // Padding: a 1 bit, zeros up to 56 bytes modulo 64, then the length
+                const uint8_t padding[64] = { 0x80 };
+                std::size_t iPaddingSize = (m_iBufferSize < 56) ? 56 - m_iBufferSize : 120 - m_iBufferSize;
+                update(padding, iPaddingSize);
+
+                uint8_t length[8];
+                for (int i = 0; i < 8; ++i) {
+                    length[i] = static_cast<uint8_t>(iBitLength >> (8 * i));
+                }
+                update(length, sizeof(length));
+
+                std::array<uint8_t, 16> digest;
+                for (int i = 0; i < 16; ++i) {
+                    digest[i] = static_cast<uint8_t>(m_state[i / 4] >> (8 * (i % 4)));
+                }
+
+                return digest;
+            }
+
+        private:
+            static uint32_t rotateLeft(uint32_t value, int shift) {
+                return (value << shift) | (value >> (32 - shift));
+            }
+
+            void processBlock(const uint8_t* pBlock) {
+                static const uint32_t Constants[64] = {
+                    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+                    0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE, 0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+                    0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+                    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+                    0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C, 0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+                    0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+                    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+                    0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1, 0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+                };
+                static const int Shifts[64] = {
+                    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+                    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+                };
+
+                uint32_t words[16];
+                for (int i = 0; i < 16; ++i) {
+                    words[i] = static_cast<uint32_t>(pBlock[4 * i])
+                        | (static_cast<uint32_t>(pBlock[4 * i + 1]) << 8)
+                        | (static_cast<uint32_t>(pBlock[4 * i + 2]) << 16)
+                        | (static_cast<uint32_t>(pBlock[4 * i + 3]) << 24);
+                }
+
+                uint32_t a = m_state[0];
+                uint32_t b = m_state[1];
+                uint32_t c = m_state[2];
+                uint32_t d = m_state[3];
+
+                for (int i = 0; i < 64; ++i) {
+                    uint32_t f;
+                    int g;
+                    if (i < 16) {
+                        f = (b & c) | (~b & d);
+                        g = i;
+                    } else if (i < 32) {
+                        f = (d & b) | (~d & c);
+                        g = (5 * i + 1) % 16;
+                    } else if (i < 48) {
+                        f = b ^ c ^ d;
+                        g = (3 * i + 5) % 16;
+                    } else {
+                        f = c ^ (b | ~d);
+                        g = (7 * i) % 16;
+                    }
+
+                    f += a + Constants[i] + words[g];
+                    a = d;
+                    d = c;
+                    c = b;
+                    b += rotateLeft(f, Shifts[i]);
+                }
+
+                m_state[0] += a;
+                m_state[1] += b;
+                m_state[2] += c;
+                m_state[3] += d;
+            }
+
+        private:
+            uint32_t m_state[4];
+            uint64_t m_iLength;
+            std::array<uint8_t, 64> m_buffer;
+            std::size_t m_iBufferSize;
+        };
+
+        std::string toHexadecimal(const uint8_t* pBytes, std::size_t size) {
+            static const char Digits[] = "0123456789abcdef";
+
+            std::string szHexadecimal(2 * size, '0');
+            for (std::size_t i = 0; i < size; ++i) {
+                szHexadecimal[2 * i] = Digits[pBytes[i] >> 4];
+                szHexadecimal[2 * i + 1] = Digits[pBytes[i] & 0x0F];
+            }
+
+            return szHexadecimal;
+        }
+
+        // Call the function on each visible line of the image
+        template<typename Function>
+        void forEachVisibleLine(const ImageBuffer& image, SizeU visibleSize, Function function) {
+            for (uint32_t index = 0; index < image.getPlaneCount(); ++index) {
+                uint32_t iLineSize = ImageBuffer::getPackedLineSize(image.getFormat(), visibleSize, index);
+                uint32_t iLineCount = (index == 0) ? visibleSize.height : (visibleSize.height + 1) / 2;
+                const uint8_t* pPlane = image.getPlane(index);
+
+                // Contiguous lines are given at once
+                if (image.getLineSize(index) == iLineSize) {
+                    function(pPlane, static_cast<std::size_t>(iLineSize) * iLineCount);
+                    continue;
+                }
+
+                for (uint32_t iLine = 0; iLine < iLineCount; ++iLine) {
+                    function(pPlane + static_cast<std::size_t>(iLine) * image.getLineSize(index), iLineSize);
+                }
+            }
+        }
+    }
+
+    const char* getChecksumName(ChecksumAlgorithm algorithm) {
+        switch (algorithm) {
+        case ChecksumAlgorithm::MD5:
+            return "MD5";
+
+        case ChecksumAlgorithm::CRC32C:
+            return "CRC32C";
+        }
+
+        return "";
+    }
+
+    uint32_t updateCrc32c(uint32_t crc, const void* pData, std::size_t size) {
+        const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+
+        crc = ~crc;
+#ifdef VW_X86_KERNELS
+        if (getSimdLevel() != SimdLevel::Scalar && hasCrc32cInstruction()) {
+            return ~crc32cSse42(crc, pBytes, size);
+        }
+#endif
+
+        return ~crc32cScalar(crc, pBytes, size);
+    }
+
+    std::string computeFrameChecksum(const ImageBuffer& image, SizeU visibleSize, ChecksumAlgorithm algorithm) {
+        if (visibleSize.width > image.getSize().width || visibleSize.height > image.getSize().height) {
+            throw std::runtime_error("[FrameChecksum] The visible size is larger than the image");
+        }
+
+        if (algorithm == ChecksumAlgorithm::CRC32C) {
+            uint32_t crc = 0;
+            forEachVisibleLine(image, visibleSize, [&crc](const uint8_t* pData, std::size_t size) {
+                crc = updateCrc32c(crc, pData, size);
+            });
+
+            uint8_t bytes[4] = {
+                static_cast<uint8_t>(crc >> 24),
+                static_cast<uint8_t>(crc >> 16),
+                static_cast<uint8_t>(crc >> 8),
+                static_cast<uint8_t>(crc),
+            };
+            return toHexadecimal(bytes, sizeof(bytes));
+        }
+
+        Md5 md5;
+        forEachVisibleLine(image, visibleSize, [&md5](const uint8_t* pData, std::size_t size) {
+            md5.update(pData, size);
+        });
+
+        auto digest = md5.finalize();
+        return toHexadecimal(digest.data(), digest.size());
+    }
+}
@@ -1,26 +1,204 @@
 #include <VdpWrapper/ImageBuffer.h>
 
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <VdpWrapper/MappedFile.h>
+#include <VdpWrapper/PixelConversion.h>
+
 namespace vw {
-    ImageBuffer::ImageBuffer(cv::Mat &decodedImage) {
+    namespace {
+        std::size_t alignUp(std::size_t value) {
+            return (value + ImageBuffer::Alignment - 1) & ~(ImageBuffer::Alignment - 1);
+        }
+    }
+
+    void ImageBuffer::AlignedDeleter::operator()(uint8_t* pData) const {
+        ::operator delete[](pData, std::align_val_t(Alignment));
+    }
+
+    ImageBuffer::ImageBuffer()
+    : m_format(PixelFormat::B8G8R8A8)
+    , m_size(0u, 0u)
+    , m_dataSize(0)
+    , m_capacity(0)
+    , m_bWritable(true) {
+
+    }
+
+    ImageBuffer::ImageBuffer(PixelFormat format, SizeU imageSize)
+    : ImageBuffer() {
+        allocate(format, imageSize);
+    }
+
+    ImageBuffer::ImageBuffer(cv::Mat &decodedImage)
+    : ImageBuffer() {
         storeBGRAImage(decodedImage);
     }
 
-    ImageBuffer::ImageBuffer(SizeU imageSize, const std::vector<uint8_t> &rawBytes) {
+    ImageBuffer::ImageBuffer(SizeU imageSize, const std::vector<uint8_t> &rawBytes)
+    : ImageBuffer() {
         storeNV12Image(imageSize, rawBytes);
     }
 
-    ImageBuffer::ImageBuffer(std::vector<Plane>&& planes, std::vector<uint32_t>&& linesizes)
-    : m_planes(planes)
-    , m_lineSizes(linesizes) {
+    ImageBuffer ImageBuffer::view(PixelFormat format, SizeU imageSize, const std::vector<const uint8_t*>& planes, const std::vector<uint32_t>& lineSizes, std::shared_ptr<const void> pOwner, bool bWritable) {
+        ImageBuffer buffer;
+        buffer.setLayout(format, imageSize);
+
+        if (planes.size() != buffer.m_planes.size() || lineSizes.size() != buffer.m_planes.size()) {
+            throw std::runtime_error("[ImageBuffer] Wrong number of planes for the view");
+        }
+
+        // Replace the aligned layout by the one of the external memory
+        auto packedPlanes = getPackedPlanes(format, imageSize);
+        buffer.m_dataSize = 0;
+        for (std::size_t i = 0; i < planes.size(); ++i) {
+            auto& plane = buffer.m_planes[i];
+            if (planes[i] == nullptr || lineSizes[i] < packedPlanes[i].lineSize) {
+                throw std::runtime_error("[ImageBuffer] Invalid plane for the view");
+            }
+
+            plane.pData = const_cast<uint8_t*>(planes[i]);
+            plane.offset = 0;
+            plane.lineSize = lineSizes[i];
+            buffer.m_dataSize += static_cast<std::size_t>(plane.lineSize) * plane.height;
+        }
+
+        buffer.m_pOwner = std::move(pOwner);
+        buffer.m_bWritable = bWritable;
+
+        return buffer;
+    }
+
+    ImageBuffer ImageBuffer::view(PixelFormat format, SizeU imageSize, std::shared_ptr<const MappedFile> pFile, std::size_t offset) {
+        if (offset + getPackedSize(format, imageSize) > pFile->getSize()) {
+            throw std::runtime_error("[ImageBuffer] The mapped file is too small for the image");
+        }
+
+        // The planes of a raw file follow each other without padding
+        std::vector<const uint8_t*> planes;
+        std::vector<uint32_t> lineSizes;
+        const uint8_t* pPlane = pFile->getData() + offset;
+        for (const auto& plane: getPackedPlanes(format, imageSize)) {
+            planes.push_back(pPlane);
+            lineSizes.push_back(plane.lineSize);
+            pPlane += static_cast<std::size_t>(plane.lineSize) * plane.height;
+        }
+
+        return view(format, imageSize, planes, lineSizes, std::move(pFile));
+    }
+
+    ImageBuffer ImageBuffer::view(const cv::Mat& image) {
+        if (image.type() != CV_8UC4) {
+            throw std::runtime_error("[ImageBuffer] Only BGRA matrices can be viewed");
+        }
+
+        // The matrix copy shares the pixels and keeps them alive
+        auto pMatrix = std::make_shared<const cv::Mat>(image);
+        SizeU imageSize(image.size().width, image.size().height);
+
+        return view(PixelFormat::B8G8R8A8, imageSize, { pMatrix->ptr(0) }, { static_cast<uint32_t>(pMatrix->step) }, pMatrix, true);
+    }
+
+    std::size_t ImageBuffer::getPackedSize(PixelFormat format, SizeU imageSize) {
+        std::size_t size = 0;
+        for (const auto& plane: getPackedPlanes(format, imageSize)) {
+            size += static_cast<std::size_t>(plane.lineSize) * plane.height;
+        }
+
+        return size;
+    }
+
+    uint32_t ImageBuffer::getPackedLineSize(PixelFormat format, SizeU imageSize, uint32_t index) {
+        auto planes = getPackedPlanes(format, imageSize);
+        if (index >= planes.size()) {
+            throw std::runtime_error("[ImageBuffer] Plane index out of bounds");
+        }
+
+        return planes[index].lineSize;
+    }
+
+    ImageBuffer::ImageBuffer(const ImageBuffer& other)
+    : ImageBuffer() {
+        if (other.isView()) {
+            // A view shares the external memory
+            m_format = other.m_format;
+            m_size = other.m_size;
+            m_planes = other.m_planes;
+            m_dataSize = other.m_dataSize;
+            m_pOwner = other.m_pOwner;
+            m_bWritable = other.m_bWritable;
+            return;
+        }
+
+        allocate(other.m_format, other.m_size);
+        if (other.m_pData) {
+            std::memcpy(m_pData.get(), other.m_pData.get(), m_dataSize);
+        }
+    }
+
+    ImageBuffer& ImageBuffer::operator=(const ImageBuffer& other) {
+        if (this != &other) {
+            ImageBuffer copy(other);
+            *this = std::move(copy);
+        }
+
+        return *this;
+    }
+
+    bool ImageBuffer::resize(PixelFormat format, SizeU imageSize) {
+        if (isView()) {
+            if (format == m_format && imageSize == m_size) {
+                return false;
+            }
+
+            throw std::runtime_error("[ImageBuffer] Couldn't resize a view");
+        }
+
+        std::size_t capacity = m_pData ? m_capacity : 0;
+        setLayout(format, imageSize);
+
+        if (m_dataSize <= capacity) {
+            m_capacity = capacity;
+            bindPlanes();
+            return false;
+        }
+
+        m_capacity = m_dataSize;
+        m_pData.reset(new (std::align_val_t(Alignment)) uint8_t[m_capacity]);
+        bindPlanes();
+
+        return true;
+    }
+
+    PixelFormat ImageBuffer::getFormat() const {
+        return m_format;
+    }
+
+    SizeU ImageBuffer::getSize() const {
+        return m_size;
+    }
 
+    uint32_t ImageBuffer::getPlaneCount() const {
+        return m_planes.size();
     }
 
     uint32_t ImageBuffer::getLineSize(uint32_t index) const {
-        if (index >= m_lineSizes.size()) {
+        if (index >= m_planes.size()) {
             throw std::runtime_error("[ImageBuffer] Line size index out of bounds");
         }
 
-        return m_lineSizes[index];
+        return m_planes[index].lineSize;
+    }
+
+    uint32_t ImageBuffer::getPlaneHeight(uint32_t index) const {
+        if (index >= m_planes.size()) {
+            throw std::runtime_error("[ImageBuffer] Plane index out of bounds");
+        }
+
+        return m_planes[index].height;
     }
 
     const uint8_t* ImageBuffer::getPlane(uint32_t index) const {
@@ -28,61 +206,126 @@ namespace vw {
             throw std::runtime_error("[ImageBuffer] Plane index out of bounds");
         }
 
-        return m_planes[index].data();
+        return m_planes[index].pData;
+    }
+
+    uint8_t* ImageBuffer::getPlane(uint32_t index) {
+        if (index >= m_planes.size()) {
+            throw std::runtime_error("[ImageBuffer] Plane index out of bounds");
+        }
+
+        if (!m_bWritable) {
+            throw std::runtime_error("[ImageBuffer] The view is read-only");
+        }
+
+        return m_planes[index].pData;
+    }
+
+    bool ImageBuffer::isView() const {
+        return m_pOwner != nullptr;
+    }
+
+    std::size_t ImageBuffer::getDataSize() const {
+        return m_dataSize;
+    }
+
+    std::size_t ImageBuffer::getCapacity() const {
+        return m_capacity;
+    }
+
+    void ImageBuffer::allocate(PixelFormat format, SizeU imageSize) {
+        setLayout(format, imageSize);
+
+        m_capacity = m_dataSize;
+        m_pData.reset(new (std::align_val_t(Alignment)) uint8_t[m_capacity]);
+        m_pOwner.reset();
+        m_bWritable = true;
+        bindPlanes();
+    }
+
+    void ImageBuffer::setLayout(PixelFormat format, SizeU imageSize) {
+        m_format = format;
+        m_size = imageSize;
+        m_planes = getPackedPlanes(format, imageSize);
+
+        // Lay out the planes one after the other, each one on an aligned offset
+        std::size_t offset = 0;
+        for (auto& plane: m_planes) {
+            plane.lineSize = alignUp(plane.lineSize);
+            plane.offset = offset;
+            offset = alignUp(offset + static_cast<std::size_t>(plane.lineSize) * plane.height);
+        }
+
+        m_dataSize = offset;
+    }
+
+    std::vector<ImageBuffer::PlaneLayout> ImageBuffer::getPackedPlanes(PixelFormat format, SizeU imageSize) {
+        uint32_t chromaWidth = (imageSize.width + 1) / 2;
+        uint32_t chromaHeight = (imageSize.height + 1) / 2;
+
+        switch (format) {
+        case PixelFormat::B8G8R8A8:
+            return { { nullptr, 0, imageSize.width * 4, imageSize.height } };
+
+        case PixelFormat::NV12:
+            // The chroma plane holds interleaved U/V samples, so it has the same
+            // line size as the luma plane but only half of its lines
+            return {
+                { nullptr, 0, imageSize.width, imageSize.height },
+                { nullptr, 0, chromaWidth * 2, chromaHeight },
+            };
+
+        case PixelFormat::I420:
+            return {
+                { nullptr, 0, imageSize.width, imageSize.height },
+                { nullptr, 0, chromaWidth, chromaHeight },
+                { nullptr, 0, chromaWidth, chromaHeight },
+            };
+
+        case PixelFormat::YUYV:
+            // One U/V pair is shared by two pixels of a line
+            return { { nullptr, 0, chromaWidth * 4, imageSize.height } };
+        }
+
+        throw std::runtime_error("[ImageBuffer] Unknown pixel format");
+    }
+
+    void ImageBuffer::bindPlanes() {
+        for (auto& plane: m_planes) {
+            plane.pData = m_pData.get() + plane.offset;
+        }
     }
 
     void ImageBuffer::storeBGRAImage(cv::Mat &decodedImage) {
         // Ensure we have a BGR 8bits format (without alpha)
         assert(decodedImage.channels() == 3); // No alpha channel
         assert(decodedImage.depth() == CV_8U); // Only 8 bits color
-        assert(decodedImage.isContinuous()); // Data must be continuous
 
-        // Set planes / sizes vectors
-        m_lineSizes.resize(1);
-        m_planes.resize(1);
+        SizeU imageSize(decodedImage.size().width, decodedImage.size().height);
+        allocate(PixelFormat::B8G8R8A8, imageSize);
 
-        // Set line size
-        m_lineSizes[0] = decodedImage.size().width * 4; // one line is 4 unit8_t color
-        m_planes[0].resize(decodedImage.size().width * decodedImage.size().height * 4);
-
-        // Fill the buffers
-        cv::MatIterator_<cv::Vec3b> it, end;
-        int index = 0;
-        for (it = decodedImage.begin<cv::Vec3b>(), end = decodedImage.end<cv::Vec3b>(); it != end; ++it, index += 4) {
-            m_planes[0][index + 0] = (*it)[0]; // Blue
-            m_planes[0][index + 1] = (*it)[1]; // Green
-            m_planes[0][index + 2] = (*it)[2]; // Red
-            m_planes[0][index + 3] = std::numeric_limits<uint8_t>::max(); // Alpha channel
+        // Fill the buffer line by line to honor both the source step and the destination pitch
+        for (uint32_t y = 0; y < imageSize.height; ++y) {
+            convertBGRToBGRA(decodedImage.ptr<uint8_t>(y), getPlane(0) + static_cast<std::size_t>(y) * getLineSize(0), imageSize.width);
         }
     }
 
     void ImageBuffer::storeNV12Image(SizeU imageSize, const std::vector<uint8_t> &rawBytes) {
         // Check if there are enough bytes
-        assert(rawBytes.size() == imageSize.width * imageSize.height * 12 / 8);
-
-        // Set planes / sizes vectors
-        m_lineSizes.resize(2);
-        m_planes.resize(2);
-
-        // Set line size
-        m_lineSizes[0] = imageSize.width;
-        m_lineSizes[1] = imageSize.width;
-
-        // Fill Y values
-        unsigned i = 0;
-        unsigned bounds = imageSize.width * imageSize.height;
-        for (; i < bounds; ++i) {
-            m_planes[0].push_back(rawBytes[i]);
+        if (rawBytes.size() < getPackedSize(PixelFormat::NV12, imageSize)) {
+            throw std::runtime_error("[ImageBuffer] Not enough bytes for a NV12 image");
         }
 
-        // Fill UV
-        bounds += imageSize.width * imageSize.height / 2;
-        for (; i < bounds; ++i) {
-            m_planes[1].push_back(rawBytes[i]);
-        }
+        allocate(PixelFormat::NV12, imageSize);
 
-        assert(i == rawBytes.size());
-        assert(m_planes[0].size() == imageSize.width * imageSize.height);
-        assert(m_planes[1].size() == imageSize.width * imageSize.height / 2);
+        // The raw file is tightly packed: copy it line by line to the padded planes
+        const uint8_t* pSource = rawBytes.data();
+        auto packedPlanes = getPackedPlanes(PixelFormat::NV12, imageSize);
+        for (uint32_t index = 0; index < m_planes.size(); ++index) {
+            uint32_t packedLineSize = packedPlanes[index].lineSize;
+            for (uint32_t y = 0; y < m_planes[index].height; ++y, pSource += packedLineSize) {
+                std::memcpy(getPlane(index) + static_cast<std::size_t>(y) * m_planes[index].lineSize, pSource, packedLineSize);
+            }
+        }
     }
 }
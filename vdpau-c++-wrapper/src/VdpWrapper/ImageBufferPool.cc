@@ -0,0 +1,139 @@
+#include <VdpWrapper/ImageBufferPool.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace vw {
+    ImageFrame::ImageFrame() noexcept
+    : m_pSlot(nullptr) {
+
+    }
+
+    ImageFrame::ImageFrame(Slot* pSlot) noexcept
+    : m_pSlot(pSlot) {
+
+    }
+
+    ImageFrame::~ImageFrame() {
+        reset();
+    }
+
+    ImageFrame::ImageFrame(const ImageFrame& other) noexcept
+    : m_pSlot(other.m_pSlot) {
+        if (m_pSlot != nullptr) {
+            m_pSlot->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ImageFrame::ImageFrame(ImageFrame&& other) noexcept
+    : m_pSlot(std::exchange(other.m_pSlot, nullptr)) {
+
+    }
+
+    ImageFrame& ImageFrame::operator=(const ImageFrame& other) noexcept {
+        if (m_pSlot != other.m_pSlot) {
+            ImageFrame copy(other);
+            std::swap(m_pSlot, copy.m_pSlot);
+        }
+
+        return *this;
+    }
+
+    ImageFrame& ImageFrame::operator=(ImageFrame&& other) noexcept {
+        std::swap(m_pSlot, other.m_pSlot);
+
+        return *this;
+    }
+
+    ImageBuffer& ImageFrame::operator*() const {
+        return m_pSlot->buffer;
+    }
+
+    ImageBuffer* ImageFrame::operator->() const {
+        return get();
+    }
+
+    ImageBuffer* ImageFrame::get() const {
+        return m_pSlot != nullptr ? &m_pSlot->buffer : nullptr;
+    }
+
+    ImageFrame::operator bool() const {
+        return m_pSlot != nullptr;
+    }
+
+    void ImageFrame::reset() {
+        Slot* pSlot = std::exchange(m_pSlot, nullptr);
+        if (pSlot != nullptr && pSlot->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pSlot->pPool->recycle(pSlot);
+        }
+    }
+
+    ImageBufferPool::ImageBufferPool()
+    : m_peakUsedBuffers(0)
+    , m_allocations(0)
+    , m_allocatedBytes(0) {
+
+    }
+
+    ImageFrame ImageBufferPool::acquire(PixelFormat format, SizeU imageSize) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ImageFrame::Slot* pSlot = nullptr;
+        if (m_availableSlots.empty()) {
+            m_slots.push_back(std::unique_ptr<ImageFrame::Slot>(new ImageFrame::Slot{ this, { 0 }, ImageBuffer(format, imageSize) }));
+            pSlot = m_slots.back().get();
+            ++m_allocations;
+            m_allocatedBytes += pSlot->buffer.getCapacity();
+
+            // Keep room for all the buffers so recycle() never allocates
+            m_availableSlots.reserve(m_slots.size());
+        } else {
+            pSlot = m_availableSlots.back();
+            m_availableSlots.pop_back();
+
+            std::size_t previousCapacity = pSlot->buffer.getCapacity();
+            if (pSlot->buffer.resize(format, imageSize)) {
+                ++m_allocations;
+                m_allocatedBytes += pSlot->buffer.getCapacity() - previousCapacity;
+            }
+        }
+
+        m_peakUsedBuffers = std::max(m_peakUsedBuffers, m_slots.size() - m_availableSlots.size());
+
+        pSlot->references.store(1, std::memory_order_relaxed);
+        return ImageFrame(pSlot);
+    }
+
+    void ImageBufferPool::trim() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto* pSlot: m_availableSlots) {
+            m_allocatedBytes -= pSlot->buffer.getCapacity();
+        }
+
+        auto freedSlots = std::remove_if(m_slots.begin(), m_slots.end(), [this](const auto& pSlot) {
+            return std::find(m_availableSlots.begin(), m_availableSlots.end(), pSlot.get()) != m_availableSlots.end();
+        });
+        m_slots.erase(freedSlots, m_slots.end());
+        m_availableSlots.clear();
+    }
+
+    ImageBufferPoolStatistics ImageBufferPool::getStatistics() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ImageBufferPoolStatistics statistics;
+        statistics.allocatedBuffers = m_slots.size();
+        statistics.availableBuffers = m_availableSlots.size();
+        statistics.usedBuffers = m_slots.size() - m_availableSlots.size();
+        statistics.peakUsedBuffers = m_peakUsedBuffers;
+        statistics.allocations = m_allocations;
+        statistics.allocatedBytes = m_allocatedBytes;
+
+        return statistics;
+    }
+
+    void ImageBufferPool::recycle(ImageFrame::Slot* pSlot) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_availableSlots.push_back(pSlot);
+    }
+}
@@ -0,0 +1,242 @@
+#include <VdpWrapper/ImageMetrics.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <VdpWrapper/PixelConversion.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define VW_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace vw {
+    namespace {
+        // Sums of a 4x4 block: first samples, second samples, squares of both, products
+        using BlockSums = std::array<int32_t, 4>;
+
+        uint64_t squaredErrorScalar(const uint8_t* pFirst, const uint8_t* pSecond, uint32_t width) {
+            uint64_t sum = 0;
+            for (uint32_t x = 0; x < width; ++x) {
+                int32_t difference = static_cast<int32_t>(pFirst[x]) - static_cast<int32_t>(pSecond[x]);
+                sum += static_cast<uint64_t>(difference * difference);
+            }
+
+            return sum;
+        }
+
+        void blockSumsScalar(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, BlockSums* pSums, uint32_t begin, uint32_t blocks) {
+            for (uint32_t z = begin; z < blocks; ++z) {
+                BlockSums sums = { 0, 0, 0, 0 };
+                for (uint32_t y = 0; y < 4; ++y) {
+                    for (uint32_t x = 4 * z; x < 4 * z + 4; ++x) {
+                        int32_t first = pFirst[y * firstLineSize + x];
+                        int32_t second = pSecond[y * secondLineSize + x];
+                        sums[0] += first;
+                        sums[1] += second;
+                        sums[2] += first * first + second * second;
+                        sums[3] += first * second;
+                    }
+                }
+                pSums[z] = sums;
+            }
+        }
+
+#ifdef VW_X86_KERNELS
+        __attribute__((target("avx2")))
+        uint64_t squaredErrorAvx2(const uint8_t* pFirst, const uint8_t* pSecond, uint32_t width) {
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i wideAccumulator = _mm256_setzero_si256();
+
+            // Each 32 bits lane gets at most 4 * 255^2 per iteration, so it would overflow after 16512 iterations
+            // (about 528k samples per line): the lanes are widened to 64 bits every MaxIterations iterations
+            const uint32_t MaxIterations = 16384;
+
+            uint32_t x = 0;
+            while (x + 32 <= width) {
+                uint32_t end = x + 32 * std::min(MaxIterations, (width - x) / 32);
+
+                __m256i accumulator = _mm256_setzero_si256();
+                for (; x < end; x += 32) {
+                    __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pFirst + x));
+                    __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSecond + x));
+
+                    __m256i lowDifference = _mm256_sub_epi16(_mm256_unpacklo_epi8(first, zero), _mm256_unpacklo_epi8(second, zero));
+                    __m256i highDifference = _mm256_sub_epi16(_mm256_unpackhi_epi8(first, zero), _mm256_unpackhi_epi8(second, zero));
+                    accumulator = _mm256_add_epi32(accumulator, _mm256_madd_epi16(lowDifference, lowDifference));
+                    accumulator = _mm256_add_epi32(accumulator, _mm256_madd_epi16(highDifference, highDifference));
+                }
+
+                wideAccumulator = _mm256_add_epi64(wideAccumulator, _mm256_unpacklo_epi32(accumulator, zero));
+                wideAccumulator = _mm256_add_epi64(wideAccumulator, _mm256_unpackhi_epi32(accumulator, zero));
+            }
+
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), wideAccumulator);
+
+            uint64_t sum = 0;
+            for (uint64_t lane: lanes) {
+                sum += lane;
+            }
+
+            return sum + squaredErrorScalar(pFirst + x, pSecond + x, width - x);
+        }
+
+        // Four 4x4 blocks (16 columns) per iteration, the column pairs are summed by madd then by hadd
+        __attribute__((target("avx2")))
+        void blockSumsAvx2(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, BlockSums* pSums, uint32_t blocks) {
+            const __m256i ones = _mm256_set1_epi16(1);
+
+            uint32_t z = 0;
+            for (; z + 4 <= blocks; z += 4) {
+                __m256i firstSum = _mm256_setzero_si256();
+                __m256i secondSum = _mm256_setzero_si256();
+                __m256i squareSum = _mm256_setzero_si256();
+                __m256i productSum = _mm256_setzero_si256();
+
+                for (uint32_t y = 0; y < 4; ++y) {
+                    __m256i first = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pFirst + y * firstLineSize + 4 * z)));
+                    __m256i second = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSecond + y * secondLineSize + 4 * z)));
+
+                    firstSum = _mm256_add_epi32(firstSum, _mm256_madd_epi16(first, ones));
+                    secondSum = _mm256_add_epi32(secondSum, _mm256_madd_epi16(second, ones));
+                    squareSum = _mm256_add_epi32(squareSum, _mm256_add_epi32(_mm256_madd_epi16(first, first), _mm256_madd_epi16(second, second)));
+                    productSum = _mm256_add_epi32(productSum, _mm256_madd_epi16(first, second));
+                }
+
+                // Per 128 bits lane: [s1 b0, s1 b1, s2 b0, s2 b1] then [ss b0, ss b1, s12 b0, s12 b1]
+                __m256i samples = _mm256_hadd_epi32(firstSum, secondSum);
+                __m256i moments = _mm256_hadd_epi32(squareSum, productSum);
+
+                // [s1 b0, s2 b0, s1 b1, s2 b1] then [ss b0, s12 b0, ss b1, s12 b1]
+                samples = _mm256_shuffle_epi32(samples, _MM_SHUFFLE(3, 1, 2, 0));
+                moments = _mm256_shuffle_epi32(moments, _MM_SHUFFLE(3, 1, 2, 0));
+
+                // Blocks 0 and 2, then 1 and 3
+                __m256i evenBlocks = _mm256_unpacklo_epi64(samples, moments);
+                __m256i oddBlocks = _mm256_unpackhi_epi64(samples, moments);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pSums[z].data()), _mm256_castsi256_si128(evenBlocks));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pSums[z + 1].data()), _mm256_castsi256_si128(oddBlocks));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pSums[z + 2].data()), _mm256_extracti128_si256(evenBlocks, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pSums[z + 3].data()), _mm256_extracti128_si256(oddBlocks, 1));
+            }
+
+            blockSumsScalar(pFirst, firstLineSize, pSecond, secondLineSize, pSums, z, blocks);
+        }
+#endif
+
+        uint64_t squaredErrorLine(const uint8_t* pFirst, const uint8_t* pSecond, uint32_t width) {
+#ifdef VW_X86_KERNELS
+            if (getSimdLevel() >= SimdLevel::AVX2) {
+                return squaredErrorAvx2(pFirst, pSecond, width);
+            }
+#endif
+
+            return squaredErrorScalar(pFirst, pSecond, width);
+        }
+
+        void blockSums(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, BlockSums* pSums, uint32_t blocks) {
+#ifdef VW_X86_KERNELS
+            if (getSimdLevel() >= SimdLevel::AVX2) {
+                blockSumsAvx2(pFirst, firstLineSize, pSecond, secondLineSize, pSums, blocks);
+                return;
+            }
+#endif
+
+            blockSumsScalar(pFirst, firstLineSize, pSecond, secondLineSize, pSums, 0, blocks);
+        }
+
+        // SSIM of an 8x8 window from the sums of its four 4x4 blocks (x264 ssim_end1)
+        float windowSsim(int32_t s1, int32_t s2, int32_t ss, int32_t s12) {
+            const int32_t c1 = static_cast<int32_t>(.01 * .01 * 255 * 255 * 64 + .5);
+            const int32_t c2 = static_cast<int32_t>(.03 * .03 * 255 * 255 * 64 * 63 + .5);
+
+            int32_t variances = ss * 64 - s1 * s1 - s2 * s2;
+            int32_t covariance = s12 * 64 - s1 * s2;
+
+            return static_cast<float>(2 * s1 * s2 + c1) * static_cast<float>(2 * covariance + c2)
+                / (static_cast<float>(s1 * s1 + s2 * s2 + c1) * static_cast<float>(variances + c2));
+        }
+    }
+
+    uint64_t computeSquaredError(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, uint32_t width, uint32_t height) {
+        uint64_t sum = 0;
+        for (uint32_t y = 0; y < height; ++y) {
+            sum += squaredErrorLine(pFirst + static_cast<std::size_t>(y) * firstLineSize, pSecond + static_cast<std::size_t>(y) * secondLineSize, width);
+        }
+
+        return sum;
+    }
+
+    double computeSsim(const uint8_t* pFirst, uint32_t firstLineSize, const uint8_t* pSecond, uint32_t secondLineSize, uint32_t width, uint32_t height) {
+        uint32_t blockColumns = width / 4;
+        uint32_t blockRows = height / 4;
+        if (blockColumns < 2 || blockRows < 2) {
+            throw std::runtime_error("[ImageMetrics] The plane is too small to compute the SSIM");
+        }
+
+        // Sums of the current and the previous block rows
+        std::vector<BlockSums> previousSums(blockColumns);
+        std::vector<BlockSums> currentSums(blockColumns);
+        blockSums(pFirst, firstLineSize, pSecond, secondLineSize, previousSums.data(), blockColumns);
+
+        double ssim = 0.0;
+        for (uint32_t blockRow = 1; blockRow < blockRows; ++blockRow) {
+            std::size_t firstOffset = static_cast<std::size_t>(4 * blockRow) * firstLineSize;
+            std::size_t secondOffset = static_cast<std::size_t>(4 * blockRow) * secondLineSize;
+            blockSums(pFirst + firstOffset, firstLineSize, pSecond + secondOffset, secondLineSize, currentSums.data(), blockColumns);
+
+            float rowSsim = 0.0f;
+            for (uint32_t i = 0; i + 1 < blockColumns; ++i) {
+                BlockSums window;
+                for (int k = 0; k < 4; ++k) {
+                    window[k] = previousSums[i][k] + previousSums[i + 1][k] + currentSums[i][k] + currentSums[i + 1][k];
+                }
+                rowSsim += windowSsim(window[0], window[1], window[2], window[3]);
+            }
+            ssim += rowSsim;
+
+            std::swap(previousSums, currentSums);
+        }
+
+        return ssim / (static_cast<double>(blockRows - 1) * (blockColumns - 1));
+    }
+
+    double computePsnr(uint64_t squaredError, uint64_t samples) {
+        if (squaredError == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        return 10.0 * std::log10(255.0 * 255.0 * static_cast<double>(samples) / static_cast<double>(squaredError));
+    }
+
+    std::vector<PlaneQuality> compareImages(const ImageBuffer& image, const ImageBuffer& reference, SizeU visibleSize) {
+        if (image.getFormat() != PixelFormat::I420 || reference.getFormat() != PixelFormat::I420) {
+            throw std::runtime_error("[ImageMetrics] Only I420 images can be compared");
+        }
+
+        if (visibleSize.width > image.getSize().width || visibleSize.height > image.getSize().height
+            || visibleSize.width > reference.getSize().width || visibleSize.height > reference.getSize().height) {
+            throw std::runtime_error("[ImageMetrics] The compared area is larger than the images");
+        }
+
+        std::vector<PlaneQuality> qualities;
+        for (uint32_t index = 0; index < 3; ++index) {
+            uint32_t width = ImageBuffer::getPackedLineSize(PixelFormat::I420, visibleSize, index);
+            uint32_t height = (index == 0) ? visibleSize.height : (visibleSize.height + 1) / 2;
+
+            PlaneQuality quality;
+            quality.squaredError = computeSquaredError(image.getPlane(index), image.getLineSize(index), reference.getPlane(index), reference.getLineSize(index), width, height);
+            quality.samples = static_cast<uint64_t>(width) * height;
+            quality.ssim = computeSsim(image.getPlane(index), image.getLineSize(index), reference.getPlane(index), reference.getLineSize(index), width, height);
+            qualities.push_back(quality);
+        }
+
+        return qualities;
+    }
+}
@@ -0,0 +1,67 @@
+#include <VdpWrapper/MappedFile.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vw {
+    MappedFile::MappedFile(const std::string& szFilename)
+    : m_pData(nullptr)
+    , m_size(0) {
+        int fd = ::open(szFilename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("[MappedFile] Couldn't open '" + szFilename + "'");
+        }
+
+        struct stat fileStatus;
+        if (::fstat(fd, &fileStatus) != 0) {
+            ::close(fd);
+            throw std::runtime_error("[MappedFile] Couldn't get the size of '" + szFilename + "'");
+        }
+
+        m_size = fileStatus.st_size;
+        if (m_size > 0) {
+            void* pMapping = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (pMapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("[MappedFile] Couldn't map '" + szFilename + "'");
+            }
+
+            m_pData = static_cast<uint8_t*>(pMapping);
+        }
+
+        // The mapping keeps its own reference on the file
+        ::close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (m_pData != nullptr) {
+            ::munmap(m_pData, m_size);
+        }
+    }
+
+    const uint8_t* MappedFile::getData() const {
+        return m_pData;
+    }
+
+    std::size_t MappedFile::getSize() const {
+        return m_size;
+    }
+
+    void MappedFile::prefetch(std::size_t offset, std::size_t length) const {
+        if (m_pData == nullptr || offset >= m_size) {
+            return;
+        }
+
+        // madvise() needs a page aligned address
+        static const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+        std::size_t alignedOffset = offset - offset % pageSize;
+        length = std::min(length + offset - alignedOffset, m_size - alignedOffset);
+
+        ::madvise(m_pData + alignedOffset, length, MADV_WILLNEED);
+    }
+}
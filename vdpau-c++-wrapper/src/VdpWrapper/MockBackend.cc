@@ -0,0 +1,233 @@
+#include <VdpWrapper/MockBackend.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace vw {
+    namespace {
+        // The mocked entry points have no context, they use the alive backend
+        MockBackend* gpActiveBackend = nullptr;
+        std::mutex gActiveBackendMutex;
+
+        struct CpuEntryPoints {
+            VdpGetProcAddress* getProcAddress = nullptr;
+            VdpDecoderRender* decoderRender = nullptr;
+            VdpVideoMixerRender* videoMixerRender = nullptr;
+            VdpVideoSurfaceGetBitsYCbCr* videoSurfaceGetBitsYCbCr = nullptr;
+            VdpOutputSurfaceGetBitsNative* outputSurfaceGetBitsNative = nullptr;
+        };
+
+        CpuEntryPoints gCpuEntryPoints;
+
+        VdpStatus mockDecoderRender(VdpDecoder decoder, VdpVideoSurface target, VdpPictureInfo const* pictureInfo, uint32_t bitstreamBufferCount, VdpBitstreamBuffer const* bitstreamBuffers) {
+            gpActiveBackend->simulateLatency(MockCall::DecoderRender);
+            return gCpuEntryPoints.decoderRender(decoder, target, pictureInfo, bitstreamBufferCount, bitstreamBuffers);
+        }
+
+        VdpStatus mockVideoMixerRender(
+            VdpVideoMixer mixer,
+            VdpOutputSurface backgroundSurface,
+            VdpRect const* backgroundSourceRect,
+            VdpVideoMixerPictureStructure currentPictureStructure,
+            uint32_t videoSurfacePastCount,
+            VdpVideoSurface const* videoSurfacePast,
+            VdpVideoSurface videoSurfaceCurrent,
+            uint32_t videoSurfaceFutureCount,
+            VdpVideoSurface const* videoSurfaceFuture,
+            VdpRect const* videoSourceRect,
+            VdpOutputSurface destinationSurface,
+            VdpRect const* destinationRect,
+            VdpRect const* destinationVideoRect,
+            uint32_t layerCount,
+            VdpLayer const* layers
+        ) {
+            gpActiveBackend->simulateLatency(MockCall::VideoMixerRender);
+            return gCpuEntryPoints.videoMixerRender(
+                mixer, backgroundSurface, backgroundSourceRect, currentPictureStructure,
+                videoSurfacePastCount, videoSurfacePast, videoSurfaceCurrent, videoSurfaceFutureCount, videoSurfaceFuture,
+                videoSourceRect, destinationSurface, destinationRect, destinationVideoRect, layerCount, layers
+            );
+        }
+
+        VdpStatus mockVideoSurfaceGetBitsYCbCr(VdpVideoSurface surface, VdpYCbCrFormat format, void* const* data, uint32_t const* pitches) {
+            gpActiveBackend->simulateLatency(MockCall::GetBits);
+            return gCpuEntryPoints.videoSurfaceGetBitsYCbCr(surface, format, data, pitches);
+        }
+
+        VdpStatus mockOutputSurfaceGetBitsNative(VdpOutputSurface surface, VdpRect const* sourceRect, void* const* data, uint32_t const* pitches) {
+            gpActiveBackend->simulateLatency(MockCall::GetBits);
+            return gCpuEntryPoints.outputSurfaceGetBitsNative(surface, sourceRect, data, pitches);
+        }
+
+        VdpStatus mockGetProcAddress(VdpDevice device, VdpFuncId functionID, void** functionPointer) {
+            // The CPU backend checks the parameters and provides the unchanged entry points
+            VdpStatus vdpStatus = gCpuEntryPoints.getProcAddress(device, functionID, functionPointer);
+            if (vdpStatus != VDP_STATUS_OK) {
+                return vdpStatus;
+            }
+
+            switch (functionID) {
+            case VDP_FUNC_ID_GET_PROC_ADDRESS:
+                *functionPointer = reinterpret_cast<void*>(&mockGetProcAddress);
+                break;
+
+            case VDP_FUNC_ID_DECODER_RENDER:
+                *functionPointer = reinterpret_cast<void*>(&mockDecoderRender);
+                break;
+
+            case VDP_FUNC_ID_VIDEO_MIXER_RENDER:
+                *functionPointer = reinterpret_cast<void*>(&mockVideoMixerRender);
+                break;
+
+            case VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR:
+                *functionPointer = reinterpret_cast<void*>(&mockVideoSurfaceGetBitsYCbCr);
+                break;
+
+            case VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE:
+                *functionPointer = reinterpret_cast<void*>(&mockOutputSurfaceGetBitsNative);
+                break;
+
+            default:
+                break;
+            }
+
+            return VDP_STATUS_OK;
+        }
+
+        template<typename Function>
+        Function* getCpuFunction(VdpDevice device, VdpFuncId functionID) {
+            void* pFunction = nullptr;
+            VdpStatus vdpStatus = gCpuEntryPoints.getProcAddress(device, functionID, &pFunction);
+            if (vdpStatus != VDP_STATUS_OK) {
+                throw std::runtime_error("[MockBackend] Couldn't get the CPU function " + std::to_string(functionID));
+            }
+
+            return reinterpret_cast<Function*>(pFunction);
+        }
+    }
+
+    LatencyDistribution::LatencyDistribution()
+    : LatencyDistribution(Type::Constant, std::chrono::microseconds(0), std::chrono::microseconds(0)) {
+
+    }
+
+    LatencyDistribution::LatencyDistribution(Type type, std::chrono::microseconds first, std::chrono::microseconds second)
+    : m_type(type)
+    , m_first(first)
+    , m_second(second) {
+
+    }
+
+    LatencyDistribution LatencyDistribution::constant(std::chrono::microseconds latency) {
+        return LatencyDistribution(Type::Constant, latency, latency);
+    }
+
+    LatencyDistribution LatencyDistribution::uniform(std::chrono::microseconds minimum, std::chrono::microseconds maximum) {
+        if (minimum > maximum) {
+            throw std::invalid_argument("[LatencyDistribution] The minimum is greater than the maximum");
+        }
+
+        return LatencyDistribution(Type::Uniform, minimum, maximum);
+    }
+
+    LatencyDistribution LatencyDistribution::normal(std::chrono::microseconds mean, std::chrono::microseconds standardDeviation) {
+        if (standardDeviation.count() < 0) {
+            throw std::invalid_argument("[LatencyDistribution] The standard deviation is negative");
+        }
+
+        return LatencyDistribution(Type::Normal, mean, standardDeviation);
+    }
+
+    std::chrono::microseconds LatencyDistribution::sample(std::mt19937& engine) const {
+        switch (m_type) {
+        case Type::Constant:
+            break;
+
+        case Type::Uniform: {
+            std::uniform_int_distribution<std::chrono::microseconds::rep> distribution(m_first.count(), m_second.count());
+            return std::chrono::microseconds(distribution(engine));
+        }
+
+        case Type::Normal: {
+            if (m_second.count() == 0) {
+                break;
+            }
+
+            std::normal_distribution<double> distribution(static_cast<double>(m_first.count()), static_cast<double>(m_second.count()));
+            return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(std::max(0.0, distribution(engine))));
+        }
+        }
+
+        return std::max(m_first, std::chrono::microseconds(0));
+    }
+
+    MockBackend::MockBackend(const MockLatencyModel& model)
+    : m_distributions({ model.decoderRender, model.videoMixerRender, model.getBits }) {
+        // One engine per call kind, so the sequences don't depend on the calls interleaving
+        for (std::size_t i = 0; i < CallCount; ++i) {
+            m_engines[i].seed(model.seed + static_cast<uint32_t>(i));
+        }
+
+        std::lock_guard<std::mutex> lock(gActiveBackendMutex);
+        if (gpActiveBackend != nullptr) {
+            throw std::runtime_error("[MockBackend] Only one mock backend can be alive at a time");
+        }
+        gpActiveBackend = this;
+    }
+
+    MockBackend::~MockBackend() {
+        std::lock_guard<std::mutex> lock(gActiveBackendMutex);
+        gpActiveBackend = nullptr;
+    }
+
+    VdpDevice MockBackend::createDevice(VdpGetProcAddress** ppGetProcAddress) {
+        if (ppGetProcAddress == nullptr) {
+            throw std::runtime_error("[MockBackend] The VdpGetProcAddress pointer is null");
+        }
+
+        VdpGetProcAddress* pCpuGetProcAddress = nullptr;
+        VdpDevice device = m_cpuBackend.createDevice(&pCpuGetProcAddress);
+
+        // The CPU entry points are the same for all the devices
+        static std::once_flag entryPointsFlag;
+        std::call_once(entryPointsFlag, [device, pCpuGetProcAddress]() {
+            gCpuEntryPoints.getProcAddress = pCpuGetProcAddress;
+            gCpuEntryPoints.decoderRender = getCpuFunction<VdpDecoderRender>(device, VDP_FUNC_ID_DECODER_RENDER);
+            gCpuEntryPoints.videoMixerRender = getCpuFunction<VdpVideoMixerRender>(device, VDP_FUNC_ID_VIDEO_MIXER_RENDER);
+            gCpuEntryPoints.videoSurfaceGetBitsYCbCr = getCpuFunction<VdpVideoSurfaceGetBitsYCbCr>(device, VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR);
+            gCpuEntryPoints.outputSurfaceGetBitsNative = getCpuFunction<VdpOutputSurfaceGetBitsNative>(device, VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE);
+        });
+
+        *ppGetProcAddress = &mockGetProcAddress;
+
+        return device;
+    }
+
+    std::string MockBackend::getName() const {
+        return "Mock";
+    }
+
+    MockCallStatistics MockBackend::getStatistics(MockCall call) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics[static_cast<std::size_t>(call)];
+    }
+
+    void MockBackend::simulateLatency(MockCall call) {
+        std::size_t iCallIndex = static_cast<std::size_t>(call);
+        std::chrono::microseconds latency;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            latency = m_distributions[iCallIndex].sample(m_engines[iCallIndex]);
+            m_statistics[iCallIndex].calls += 1;
+            m_statistics[iCallIndex].totalLatency += latency;
+        }
+
+        // The GPU is busy: block the caller as a synchronous VDPAU call
+        if (latency.count() > 0) {
+            std::this_thread::sleep_for(latency);
+        }
+    }
+}
@@ -61,6 +61,26 @@ namespace vw {
         bFirstSPSReceived = false;
         bFirstPPSReceived = false;
         referenceType = PictureReferenceType::NoReference;
+        sliceType = SliceType::I;
+        bFirstSliceOfPicture = true;
+
+        presentationTimeStamp = NoTimestamp;
+        iReorderDepth = 0;
+    }
+
+    bool isPictureSelected(const H264Infos& infos, NalType type, DecodeMode mode) {
+        switch (mode) {
+        case DecodeMode::AllPictures:
+            return true;
+
+        case DecodeMode::ReferencePictures:
+            return infos.is_reference == VDP_TRUE;
+
+        case DecodeMode::IntraPictures:
+            return type == NalType::CodedSliceIDR || infos.sliceType == SliceType::I;
+        }
+
+        return true;
     }
 
     NalUnit::NalUnit()
@@ -86,4 +106,24 @@ namespace vw {
     const std::vector<uint8_t>& NalUnit::getBitstream() const {
         return m_data;
     }
+
+    int NalUnit::getPictureOrderCount() const {
+        if (m_h264Infos.bottom_field_flag) {
+            return m_h264Infos.field_order_cnt[1];
+        }
+
+        return m_h264Infos.field_order_cnt[0];
+    }
+
+    bool NalUnit::isReference() const {
+        return m_h264Infos.is_reference == VDP_TRUE;
+    }
+
+    VdpTime NalUnit::getPresentationTimeStamp() const {
+        return m_h264Infos.presentationTimeStamp;
+    }
+
+    bool NalUnit::isSelected(DecodeMode mode) const {
+        return isPictureSelected(m_h264Infos, m_type, mode);
+    }
 }
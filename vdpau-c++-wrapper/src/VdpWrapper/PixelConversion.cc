@@ -0,0 +1,426 @@
+#include <VdpWrapper/PixelConversion.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define VW_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace vw {
+    namespace {
+        using ExpandKernel = void (*)(const uint8_t*, uint8_t*, std::size_t);
+        using DeinterleaveKernel = void (*)(const uint8_t*, uint8_t*, uint8_t*, std::size_t);
+        using InterleaveKernel = void (*)(const uint8_t*, const uint8_t*, uint8_t*, std::size_t);
+        using PackKernel = void (*)(const uint8_t*, const uint8_t*, uint8_t*, std::size_t);
+
+        struct Kernels {
+            ExpandKernel bgrToBgra;
+            ExpandKernel rgbToBgra;
+            DeinterleaveKernel deinterleaveUV;
+            InterleaveKernel interleaveUV;
+            PackKernel nv12ToYuyv;
+        };
+
+        // Position of the blue, green and red components in a 3 bytes pixel
+        template<int Blue, int Green, int Red>
+        void expandScalar(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            for (std::size_t i = 0; i < pixels; ++i, pSource += 3, pDestination += 4) {
+                pDestination[0] = pSource[Blue];
+                pDestination[1] = pSource[Green];
+                pDestination[2] = pSource[Red];
+                pDestination[3] = 0xFF;
+            }
+        }
+
+        void deinterleaveScalar(const uint8_t* pUV, uint8_t* pU, uint8_t* pV, std::size_t pairs) {
+            for (std::size_t i = 0; i < pairs; ++i) {
+                pU[i] = pUV[2 * i];
+                pV[i] = pUV[2 * i + 1];
+            }
+        }
+
+        void interleaveScalar(const uint8_t* pU, const uint8_t* pV, uint8_t* pUV, std::size_t pairs) {
+            for (std::size_t i = 0; i < pairs; ++i) {
+                pUV[2 * i] = pU[i];
+                pUV[2 * i + 1] = pV[i];
+            }
+        }
+
+        void packYuyvScalar(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t begin, std::size_t pixels) {
+            for (std::size_t i = begin; i < pixels; i += 2) {
+                pYUYV[2 * i + 0] = pY[i];
+                pYUYV[2 * i + 1] = pUV[i];
+                pYUYV[2 * i + 2] = i + 1 < pixels ? pY[i + 1] : pY[i]; // Odd width: repeat the last sample
+                pYUYV[2 * i + 3] = pUV[i + 1];
+            }
+        }
+
+        void nv12ToYuyvScalar(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t pixels) {
+            packYuyvScalar(pY, pUV, pYUYV, 0, pixels);
+        }
+
+        const Kernels ScalarKernels = {
+            expandScalar<0, 1, 2>,
+            expandScalar<2, 1, 0>,
+            deinterleaveScalar,
+            interleaveScalar,
+            nv12ToYuyvScalar,
+        };
+
+#ifdef VW_X86_KERNELS
+        // Spread 4 packed pixels of 3 bytes on 4 bytes, the alpha byte is zeroed then set by a OR
+        alignas(16) const int8_t BGRShuffle[16] = { 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 };
+        alignas(16) const int8_t RGBShuffle[16] = { 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 };
+
+        __attribute__((target("ssse3")))
+        void expandSSSE3(const int8_t* pShuffle, const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(pShuffle));
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+            // Each load reads 16 bytes for 12 useful ones: stop before reading past the line
+            std::size_t i = 0;
+            for (; i + 18 <= pixels; i += 16) {
+                for (int j = 0; j < 4; ++j) {
+                    __m128i pixels4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 3 * (i + 4 * j)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 4 * (i + 4 * j)), _mm_or_si128(_mm_shuffle_epi8(pixels4, shuffle), alpha));
+                }
+            }
+
+            if (pShuffle == BGRShuffle) {
+                expandScalar<0, 1, 2>(pSource + 3 * i, pDestination + 4 * i, pixels - i);
+            } else {
+                expandScalar<2, 1, 0>(pSource + 3 * i, pDestination + 4 * i, pixels - i);
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void expandAVX2(const int8_t* pShuffle, const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(pShuffle)));
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+            std::size_t i = 0;
+            for (; i + 18 <= pixels; i += 16) {
+                for (int j = 0; j < 2; ++j) {
+                    const uint8_t* pPixels = pSource + 3 * (i + 8 * j);
+                    __m256i pixels8 = _mm256_inserti128_si256(
+                        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels))),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels + 12)),
+                        1
+                    );
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination + 4 * (i + 8 * j)), _mm256_or_si256(_mm256_shuffle_epi8(pixels8, shuffle), alpha));
+                }
+            }
+
+            if (pShuffle == BGRShuffle) {
+                expandScalar<0, 1, 2>(pSource + 3 * i, pDestination + 4 * i, pixels - i);
+            } else {
+                expandScalar<2, 1, 0>(pSource + 3 * i, pDestination + 4 * i, pixels - i);
+            }
+        }
+
+        void bgrToBgraSSSE3(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            expandSSSE3(BGRShuffle, pSource, pDestination, pixels);
+        }
+
+        void rgbToBgraSSSE3(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            expandSSSE3(RGBShuffle, pSource, pDestination, pixels);
+        }
+
+        void bgrToBgraAVX2(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            expandAVX2(BGRShuffle, pSource, pDestination, pixels);
+        }
+
+        void rgbToBgraAVX2(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+            expandAVX2(RGBShuffle, pSource, pDestination, pixels);
+        }
+
+        __attribute__((target("sse2")))
+        void deinterleaveSSE2(const uint8_t* pUV, uint8_t* pU, uint8_t* pV, std::size_t pairs) {
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+
+            std::size_t i = 0;
+            for (; i + 16 <= pairs; i += 16) {
+                __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pUV + 2 * i));
+                __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pUV + 2 * i + 16));
+                __m128i u = _mm_packus_epi16(_mm_and_si128(first, lowBytes), _mm_and_si128(second, lowBytes));
+                __m128i v = _mm_packus_epi16(_mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pU + i), u);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pV + i), v);
+            }
+
+            deinterleaveScalar(pUV + 2 * i, pU + i, pV + i, pairs - i);
+        }
+
+        __attribute__((target("avx2")))
+        void deinterleaveAVX2(const uint8_t* pUV, uint8_t* pU, uint8_t* pV, std::size_t pairs) {
+            const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+
+            std::size_t i = 0;
+            for (; i + 32 <= pairs; i += 32) {
+                __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pUV + 2 * i));
+                __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pUV + 2 * i + 32));
+
+                // The pack works per 128 bits lane, put the quarters back in order
+                __m256i u = _mm256_packus_epi16(_mm256_and_si256(first, lowBytes), _mm256_and_si256(second, lowBytes));
+                __m256i v = _mm256_packus_epi16(_mm256_srli_epi16(first, 8), _mm256_srli_epi16(second, 8));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pU + i), _mm256_permute4x64_epi64(u, 0xD8));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pV + i), _mm256_permute4x64_epi64(v, 0xD8));
+            }
+
+            deinterleaveScalar(pUV + 2 * i, pU + i, pV + i, pairs - i);
+        }
+
+        __attribute__((target("sse2")))
+        void interleaveSSE2(const uint8_t* pU, const uint8_t* pV, uint8_t* pUV, std::size_t pairs) {
+            std::size_t i = 0;
+            for (; i + 16 <= pairs; i += 16) {
+                __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pU + i));
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pV + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pUV + 2 * i), _mm_unpacklo_epi8(u, v));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pUV + 2 * i + 16), _mm_unpackhi_epi8(u, v));
+            }
+
+            interleaveScalar(pU + i, pV + i, pUV + 2 * i, pairs - i);
+        }
+
+        __attribute__((target("avx2")))
+        void interleaveAVX2(const uint8_t* pU, const uint8_t* pV, uint8_t* pUV, std::size_t pairs) {
+            std::size_t i = 0;
+            for (; i + 32 <= pairs; i += 32) {
+                __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pU + i));
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pV + i));
+
+                // The unpacks work per 128 bits lane, recombine the halves
+                __m256i low = _mm256_unpacklo_epi8(u, v);
+                __m256i high = _mm256_unpackhi_epi8(u, v);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pUV + 2 * i), _mm256_permute2x128_si256(low, high, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pUV + 2 * i + 32), _mm256_permute2x128_si256(low, high, 0x31));
+            }
+
+            interleaveScalar(pU + i, pV + i, pUV + 2 * i, pairs - i);
+        }
+
+        // Y0 U0 Y1 V0 is the byte interleaving of the luma line with the NV12 chroma line
+        __attribute__((target("sse2")))
+        void nv12ToYuyvSSE2(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t pixels) {
+            std::size_t i = 0;
+            for (; i + 16 <= pixels; i += 16) {
+                __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i));
+                __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pUV + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pYUYV + 2 * i), _mm_unpacklo_epi8(y, uv));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pYUYV + 2 * i + 16), _mm_unpackhi_epi8(y, uv));
+            }
+
+            packYuyvScalar(pY, pUV, pYUYV, i, pixels);
+        }
+
+        __attribute__((target("avx2")))
+        void nv12ToYuyvAVX2(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t pixels) {
+            std::size_t i = 0;
+            for (; i + 32 <= pixels; i += 32) {
+                __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pY + i));
+                __m256i uv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pUV + i));
+                __m256i low = _mm256_unpacklo_epi8(y, uv);
+                __m256i high = _mm256_unpackhi_epi8(y, uv);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pYUYV + 2 * i), _mm256_permute2x128_si256(low, high, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pYUYV + 2 * i + 32), _mm256_permute2x128_si256(low, high, 0x31));
+            }
+
+            packYuyvScalar(pY, pUV, pYUYV, i, pixels);
+        }
+
+        const Kernels SSSE3Kernels = {
+            bgrToBgraSSSE3,
+            rgbToBgraSSSE3,
+            deinterleaveSSE2,
+            interleaveSSE2,
+            nv12ToYuyvSSE2,
+        };
+
+        const Kernels AVX2Kernels = {
+            bgrToBgraAVX2,
+            rgbToBgraAVX2,
+            deinterleaveAVX2,
+            interleaveAVX2,
+            nv12ToYuyvAVX2,
+        };
+#endif
+
+        SimdLevel detectSimdLevel() {
+#ifdef VW_X86_KERNELS
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return SimdLevel::AVX2;
+            }
+
+            if (__builtin_cpu_supports("ssse3")) {
+                return SimdLevel::SSSE3;
+            }
+#endif
+
+            return SimdLevel::Scalar;
+        }
+
+        const Kernels* getKernels(SimdLevel level) {
+            switch (level) {
+#ifdef VW_X86_KERNELS
+            case SimdLevel::AVX2:
+                return &AVX2Kernels;
+
+            case SimdLevel::SSSE3:
+                return &SSSE3Kernels;
+#endif
+
+            default:
+                return &ScalarKernels;
+            }
+        }
+
+        struct Dispatcher {
+            Dispatcher()
+            : supportedLevel(detectSimdLevel())
+            , currentLevel(supportedLevel)
+            , pKernels(getKernels(supportedLevel)) {
+            }
+
+            const SimdLevel supportedLevel;
+            std::atomic<SimdLevel> currentLevel;
+            std::atomic<const Kernels*> pKernels;
+        };
+
+        Dispatcher& getDispatcher() {
+            static Dispatcher dispatcher;
+            return dispatcher;
+        }
+
+        const Kernels& kernels() {
+            return *getDispatcher().pKernels.load(std::memory_order_relaxed);
+        }
+
+        void copyPlane(const uint8_t* pSource, uint32_t sourceLineSize, uint8_t* pDestination, uint32_t destinationLineSize, std::size_t lineSize, uint32_t height) {
+            for (uint32_t y = 0; y < height; ++y) {
+                std::memcpy(pDestination + static_cast<std::size_t>(y) * destinationLineSize, pSource + static_cast<std::size_t>(y) * sourceLineSize, lineSize);
+            }
+        }
+    }
+
+    SimdLevel getSupportedSimdLevel() {
+        return getDispatcher().supportedLevel;
+    }
+
+    SimdLevel getSimdLevel() {
+        return getDispatcher().currentLevel.load();
+    }
+
+    void setSimdLevel(SimdLevel level) {
+        auto& dispatcher = getDispatcher();
+        level = std::min(level, dispatcher.supportedLevel);
+
+        dispatcher.currentLevel.store(level);
+        dispatcher.pKernels.store(getKernels(level));
+    }
+
+    const char* getSimdLevelName(SimdLevel level) {
+        switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+
+        case SimdLevel::SSSE3:
+            return "ssse3";
+
+        case SimdLevel::AVX2:
+            return "avx2";
+        }
+
+        return "unknown";
+    }
+
+    void convertBGRToBGRA(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+        kernels().bgrToBgra(pSource, pDestination, pixels);
+    }
+
+    void convertRGBToBGRA(const uint8_t* pSource, uint8_t* pDestination, std::size_t pixels) {
+        kernels().rgbToBgra(pSource, pDestination, pixels);
+    }
+
+    void deinterleaveUV(const uint8_t* pUV, uint8_t* pU, uint8_t* pV, std::size_t pairs) {
+        kernels().deinterleaveUV(pUV, pU, pV, pairs);
+    }
+
+    void interleaveUV(const uint8_t* pU, const uint8_t* pV, uint8_t* pUV, std::size_t pairs) {
+        kernels().interleaveUV(pU, pV, pUV, pairs);
+    }
+
+    void convertNV12ToYUYV(const uint8_t* pY, const uint8_t* pUV, uint8_t* pYUYV, std::size_t pixels) {
+        kernels().nv12ToYuyv(pY, pUV, pYUYV, pixels);
+    }
+
+    void convertImage(const ImageBuffer& source, ImageBuffer& destination) {
+        PixelFormat sourceFormat = source.getFormat();
+        PixelFormat destinationFormat = destination.getFormat();
+        SizeU size = source.getSize();
+        destination.resize(destinationFormat, size);
+
+        const ImageBuffer& output = destination;
+        uint32_t chromaWidth = (size.width + 1) / 2;
+
+        if (sourceFormat == destinationFormat) {
+            for (uint32_t i = 0; i < source.getPlaneCount(); ++i) {
+                std::size_t lineSize = ImageBuffer::getPackedLineSize(sourceFormat, size, i);
+                copyPlane(source.getPlane(i), source.getLineSize(i), destination.getPlane(i), output.getLineSize(i), lineSize, source.getPlaneHeight(i));
+            }
+            return;
+        }
+
+        if (sourceFormat == PixelFormat::NV12 && destinationFormat == PixelFormat::I420) {
+            copyPlane(source.getPlane(0), source.getLineSize(0), destination.getPlane(0), output.getLineSize(0), size.width, size.height);
+
+            uint8_t* pU = destination.getPlane(1);
+            uint8_t* pV = destination.getPlane(2);
+            for (uint32_t y = 0; y < source.getPlaneHeight(1); ++y) {
+                deinterleaveUV(
+                    source.getPlane(1) + static_cast<std::size_t>(y) * source.getLineSize(1),
+                    pU + static_cast<std::size_t>(y) * output.getLineSize(1),
+                    pV + static_cast<std::size_t>(y) * output.getLineSize(2),
+                    chromaWidth
+                );
+            }
+            return;
+        }
+
+        if (sourceFormat == PixelFormat::I420 && destinationFormat == PixelFormat::NV12) {
+            copyPlane(source.getPlane(0), source.getLineSize(0), destination.getPlane(0), output.getLineSize(0), size.width, size.height);
+
+            uint8_t* pUV = destination.getPlane(1);
+            for (uint32_t y = 0; y < source.getPlaneHeight(1); ++y) {
+                interleaveUV(
+                    source.getPlane(1) + static_cast<std::size_t>(y) * source.getLineSize(1),
+                    source.getPlane(2) + static_cast<std::size_t>(y) * source.getLineSize(2),
+                    pUV + static_cast<std::size_t>(y) * output.getLineSize(1),
+                    chromaWidth
+                );
+            }
+            return;
+        }
+
+        if (sourceFormat == PixelFormat::NV12 && destinationFormat == PixelFormat::YUYV) {
+            // Each chroma line is shared by two luma lines
+            uint8_t* pYUYV = destination.getPlane(0);
+            for (uint32_t y = 0; y < size.height; ++y) {
+                convertNV12ToYUYV(
+                    source.getPlane(0) + static_cast<std::size_t>(y) * source.getLineSize(0),
+                    source.getPlane(1) + static_cast<std::size_t>(y / 2) * source.getLineSize(1),
+                    pYUYV + static_cast<std::size_t>(y) * output.getLineSize(0),
+                    size.width
+                );
+            }
+            return;
+        }
+
+        throw std::runtime_error("[PixelConversion] Unsupported conversion");
+    }
+}
@@ -1,13 +1,15 @@
 #include <VdpWrapper/PresentationQueue.h>
 
 #include <algorithm>
-#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 #include <VdpWrapper/Device.h>
 #include <VdpWrapper/Display.h>
 #include <VdpWrapper/VdpFunctions.h>
 #include <VdpWrapper/RenderSurface.h>
+#include <VdpWrapper/RenderSurfacePool.h>
 
 namespace vw {
     QueuedSurface::QueuedSurface(RenderSurface surface)
@@ -19,25 +21,36 @@ namespace vw {
     }
 
     PresentationQueue::PresentationQueue(Display& display, Device &device)
-    : m_bEnablePTS(true)
+    : m_device(device)
+    , m_bEnablePTS(true)
     , m_bDirectOutput(false)
     , m_beginTime(0)
     , m_endTime(0)
-    , m_framerateStep(0)
-    , m_iNextPOC(0) {
-        VdpStatus vdpStatus = gVdpFunctionsInstance()->presentationQueueTargetCreateX11(
+    , m_originTime(0)
+    , m_iFrameIndex(0)
+    , m_iPlaybackSpeed(1)
+    , m_iNextPOC(0)
+    , m_bTimestampMode(false)
+    , m_iReorderDepth(0)
+    , m_timestampOriginTime(0)
+    , m_firstTimestamp(0)
+    , m_pSurfacePool(nullptr)
+    , m_reclaimPollInterval(0)
+    , m_bStopReclaim(false)
+    , m_bReclaimFailed(false) {
+        VdpStatus vdpStatus = m_device->presentationQueueTargetCreateX11(
             device.getVdpHandle(),
             display.getXWindow(),
             &m_vdpQueueTarget
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't create the queue target");
+        m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't create the queue target");
 
-        vdpStatus = gVdpFunctionsInstance()->presentationQueueCreate(
+        vdpStatus = m_device->presentationQueueCreate(
             device.getVdpHandle(),
             m_vdpQueueTarget,
             &m_vdpQueue
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't create the queue");
+        m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't create the queue");
 
         // Set background color
         VdpColor backgroundColor;
@@ -46,22 +59,52 @@ namespace vw {
         backgroundColor.red = 0.0f;
         backgroundColor.alpha = 1.0f;
 
-        vdpStatus = gVdpFunctionsInstance()->presentationQueueSetBackgroundColor(
+        vdpStatus = m_device->presentationQueueSetBackgroundColor(
             m_vdpQueue,
             &backgroundColor
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't set the background color");
+        m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't set the background color");
     }
 
     PresentationQueue::~PresentationQueue() {
-        gVdpFunctionsInstance()->presentationQueueDestroy(m_vdpQueue);
-        gVdpFunctionsInstance()->presentationQueueTargetDestroy(m_vdpQueueTarget);
+        if (m_reclaimThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_queueMutex);
+                m_bStopReclaim = true;
+            }
+            m_reclaimCondition.notify_one();
+            m_reclaimThread.join();
+        }
+
+        m_device->presentationQueueDestroy(m_vdpQueue);
+        m_device->presentationQueueTargetDestroy(m_vdpQueueTarget);
+
+        // The queue is destroyed so all remaining surfaces are idle
+        if (m_pSurfacePool != nullptr) {
+            for (auto& queuedSurface : m_queuedSurfaces) {
+                m_pSurfacePool->release(std::move(queuedSurface.surface));
+            }
+        }
     }
 
-    void PresentationQueue::setFramerate(int iFPS) {
-        double framerateStepAsSeconds = 1.0 / static_cast<double>(iFPS);
-        m_framerateStep = std::round(framerateStepAsSeconds * 1000000000.0);
-        std::cout << "[PresentationQueue] Framerate set to: " << m_framerateStep << " ns (" << m_framerateStep / 1000000 << " ms)" << std::endl;
+    void PresentationQueue::setFramerate(Framerate framerate) {
+        if (!framerate.isValid()) {
+            throw std::runtime_error("[PresentationQueue] The framerate must be positive");
+        }
+
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_framerate = framerate;
+        updateFramerate();
+    }
+
+    void PresentationQueue::setPlaybackSpeed(int iSpeed) {
+        if (iSpeed <= 0) {
+            throw std::runtime_error("[PresentationQueue] The playback speed must be positive");
+        }
+
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_iPlaybackSpeed = iSpeed;
+        updateFramerate();
     }
 
     void PresentationQueue::enablePresentationOrderDisplay(bool bEnabled) {
@@ -72,25 +115,160 @@ namespace vw {
         m_bDirectOutput = bDirectOutput;
     }
 
+    void PresentationQueue::enableSurfaceReclaim(RenderSurfacePool& surfacePool, std::chrono::microseconds pollInterval) {
+        if (m_reclaimThread.joinable()) {
+            throw std::runtime_error("[PresentationQueue] The surface reclaim is already enabled");
+        }
+
+        m_pSurfacePool = &surfacePool;
+        m_reclaimPollInterval = pollInterval;
+        m_reclaimThread = std::thread(&PresentationQueue::reclaimSurfaces, this);
+    }
+
     bool PresentationQueue::enqueue(RenderSurface surface) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+
         // Keep the ownership of the surface
         m_queuedSurfaces.emplace_back(std::move(surface));
         auto& queuedSurface = m_queuedSurfaces.back();
 
-        // Compute the presentation time
-        VdpTime presentationTime = 0;
         // I divide the POC by 2 to have continuous values
         // I guess the POC goes up two by two because we're processing picture
         // frames and not picutures fields
         int iPOC = queuedSurface.surface.getPictureOrderCount() / 2;
         queuedSurface.iPOC = iPOC;
 
+        VdpTime streamTimestamp = queuedSurface.surface.getPresentationTimeStamp();
+        if (m_bEnablePTS && !m_bDirectOutput && streamTimestamp != NoTimestamp) {
+            // The stream provides the PTS, no need to guess the display order from the POC
+            enableTimestampMode();
+            queuedSurface.iPresentationTimeStamp = computeTimestampPresentationTime(streamTimestamp);
+
+            std::sort(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& lhs, auto& rhs) {
+                return lhs.iPresentationTimeStamp < rhs.iPresentationTimeStamp;
+            });
+
+            displayTimestampedSurfaces(m_iReorderDepth);
+        } else if (m_bEnablePTS && !m_bDirectOutput) {
+            queuedSurface.iPresentationTimeStamp = computePresentationTime(iPOC);
+
+            // Sort queue by presentation time
+            std::sort(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& lhs, auto& rhs) {
+                return lhs.iPresentationTimeStamp < rhs.iPresentationTimeStamp;
+            });
+
+            displayPendingSurfaces();
+        } else {
+            queuedSurface.iPresentationTimeStamp = computePresentationTime(iPOC);
+            auto vdpStatus = m_device->presentationQueueDisplay(
+                m_vdpQueue,
+                queuedSurface.surface.getVdpHandle(),
+                0,
+                0,
+                queuedSurface.iPresentationTimeStamp
+            );
+            m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't display the sufrace");
+            queuedSurface.bIsEnqueued = true;
+        }
+
+        if (m_pSurfacePool != nullptr && !m_bReclaimFailed) {
+            // The reclaim worker will release the displayed surfaces
+            m_reclaimCondition.notify_one();
+        } else {
+            releaseIdleSurfaces();
+        }
+
+        return true;
+    }
+
+    void PresentationQueue::skip(int iPictureOrderCount, VdpTime presentationTimeStamp) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+
+        if (m_bDirectOutput) {
+            return;
+        }
+
+        // The time slot comes from the PTS, the schedule must still move forward
+        // otherwise the pictures look late until the next enqueued one
+        if (m_bEnablePTS && presentationTimeStamp != NoTimestamp) {
+            enableTimestampMode();
+            computeTimestampPresentationTime(presentationTimeStamp);
+            return;
+        }
+
+        // Without its PTS, a picture has no slot in the timestamp timeline
+        if (m_bTimestampMode) {
+            return;
+        }
+
+        // Reserve the time slot of the picture to keep the timeline unchanged
+        int iPOC = iPictureOrderCount / 2;
+        computePresentationTime(iPOC);
+
+        if (m_bEnablePTS) {
+            // A new sequence starts, the old skipped pictures are useless
+            if (iPOC == 0) {
+                m_skippedPOCs.clear();
+                m_iNextPOC = 1;
+            } else {
+                m_skippedPOCs.insert(iPOC);
+            }
+
+            // The pending surfaces may wait for this picture
+            displayPendingSurfaces();
+        }
+    }
+
+    void PresentationQueue::setReorderDepth(int iReorderDepth) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_iReorderDepth = std::max(iReorderDepth, 0);
+    }
+
+    void PresentationQueue::flush() {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+
+        // Display the remaining surfaces in presentation order, the missing pictures are ignored
+        displayTimestampedSurfaces(0);
+    }
+
+    VdpTime PresentationQueue::getScheduleEndTime() const {
+        return m_endTime;
+    }
+
+    VdpTime PresentationQueue::getCurrentTime() {
+        VdpTime currentTime = 0;
+        auto vdpStatus = m_device->presentationQueueGetTime(
+            m_vdpQueue,
+            &currentTime
+        );
+        m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't get the presentation time");
+
+        return currentTime;
+    }
+
+    void PresentationQueue::updateFramerate() {
+        m_scaledFramerate = Framerate(m_framerate.numerator * m_iPlaybackSpeed, m_framerate.denominator);
+
+        // Restart the decode order timeline from the end of the schedule
+        if (m_originTime != 0) {
+            m_originTime = m_endTime;
+            m_iFrameIndex = 0;
+        }
+
+        VdpTime frameDuration = m_scaledFramerate.getFrameDuration();
+        std::cout << "[PresentationQueue] Framerate set to: " << m_scaledFramerate.numerator << "/" << m_scaledFramerate.denominator << " (" << frameDuration << " ns ; " << frameDuration / 1000000 << " ms)" << std::endl;
+    }
+
+    VdpTime PresentationQueue::computePresentationTime(int iPOC) {
         // This parameters are useful to handle presentation time
         // When POC == 0, we start a new sequence. Hence, we set
         // m_beginTime to current time for the first sequence (aka
         // if m_endTime == 0) or we set m_beginTime to m_endTime
-        // When POC > 1 we set the presentation time to the  m_beginTime +
-        // m_framerateStep * iPOC and we updated the m_endTime if needed
+        // When POC > 1 we set the presentation time to the m_beginTime +
+        // the time of frame iPOC and we updated the m_endTime if needed
+        // The times are always computed from a frame index to avoid
+        // to accumulate the rounding error of the frame duration
+        VdpTime presentationTime = 0;
 
         // If it's a new sequence
         if (m_bEnablePTS && iPOC == 0 && !m_bDirectOutput) {
@@ -100,112 +278,212 @@ namespace vw {
             } else {
                 m_beginTime = m_endTime;
             }
-            m_endTime = m_beginTime + m_framerateStep;
+            m_endTime = m_beginTime + m_scaledFramerate.getFrameTime(1);
             presentationTime = m_beginTime;
         } else if (m_bEnablePTS && iPOC > 0 && !m_bDirectOutput) {
-            presentationTime = m_beginTime + m_framerateStep * iPOC;
+            presentationTime = m_beginTime + m_scaledFramerate.getFrameTime(iPOC);
             if (presentationTime >= m_endTime) {
-                m_endTime = presentationTime + m_framerateStep;
+                m_endTime = m_beginTime + m_scaledFramerate.getFrameTime(iPOC + 1);
             }
         }
         // If use DTS instead of PTS
         else if (!m_bDirectOutput) {
             // Initialize the first timestamp
-            if (m_beginTime == 0) {
-                m_beginTime = getCurrentTime();
-                m_endTime = m_beginTime + m_framerateStep;
-            } else {
-                m_beginTime = m_endTime;
-                m_endTime += m_framerateStep;
+            if (m_originTime == 0) {
+                m_originTime = getCurrentTime();
+                m_iFrameIndex = 0;
             }
+            m_beginTime = m_originTime + m_scaledFramerate.getFrameTime(m_iFrameIndex);
+            ++m_iFrameIndex;
+            m_endTime = m_originTime + m_scaledFramerate.getFrameTime(m_iFrameIndex);
             presentationTime = m_beginTime;
         }
         // If we display the image directly
         else {
             presentationTime = getCurrentTime();
         }
-        queuedSurface.iPresentationTimeStamp = presentationTime;
 
-        if (m_bEnablePTS && !m_bDirectOutput) {
-            // Sort queue by presentation time
-            std::sort(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& lhs, auto& rhs) {
-                return lhs.iPresentationTimeStamp < rhs.iPresentationTimeStamp;
-            });
+        return presentationTime;
+    }
 
-            // Get the first no queued surface
-            auto nextSurface = std::find_if(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& queuedSurface) {
-                return !queuedSurface.bIsEnqueued;
-            });
+    VdpTime PresentationQueue::computeTimestampPresentationTime(VdpTime streamTimestamp) {
+        // The first picture sets the origin of the timeline. We keep a delay
+        // of the reorder window to let the following pictures be decoded
+        if (m_timestampOriginTime == 0) {
+            VdpTime preroll = m_scaledFramerate.getFrameTime(m_iReorderDepth);
+            m_timestampOriginTime = std::max(getCurrentTime(), m_endTime) + preroll;
+            m_firstTimestamp = streamTimestamp;
+        }
 
-            // Enqueued all possible surfaces
-            while (nextSurface != m_queuedSurfaces.end() && (nextSurface->iPOC == m_iNextPOC || nextSurface->iPOC == 0)) {
-                auto vdpStatus = gVdpFunctionsInstance()->presentationQueueDisplay(
-                    m_vdpQueue,
-                    nextSurface->surface.getVdpHandle(),
-                    0,
-                    0,
-                    nextSurface->iPresentationTimeStamp
-                );
-                gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't display the sufrace");
-                nextSurface->bIsEnqueued = true;
-
-                // Update the next expected POC
-                if (nextSurface->iPOC == 0) {
-                    m_iNextPOC = 1;
-                } else {
-                    m_iNextPOC++;
-                }
+        VdpTime streamOffset = streamTimestamp > m_firstTimestamp ? streamTimestamp - m_firstTimestamp : 0;
+        VdpTime presentationTime = m_timestampOriginTime + streamOffset / m_iPlaybackSpeed;
+        m_endTime = std::max(m_endTime, presentationTime + m_scaledFramerate.getFrameDuration());
+
+        return presentationTime;
+    }
+
+    void PresentationQueue::enableTimestampMode() {
+        if (m_bTimestampMode) {
+            return;
+        }
 
-                // Get the next no queued surface
-                nextSurface = std::find_if(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& queuedSurface) {
-                    return !queuedSurface.bIsEnqueued;
-                });
+        // The pending surfaces are now released by presentation time, the
+        // skipped POCs would only hold back a later POC timeline
+        m_bTimestampMode = true;
+        m_skippedPOCs.clear();
+    }
+
+    void PresentationQueue::displayTimestampedSurfaces(std::size_t maxPendingSurfaces) {
+        auto pendingSurfaceCount = std::count_if(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& queuedSurface) {
+            return !queuedSurface.bIsEnqueued;
+        });
+
+        // The queue is sorted so the first pending surfaces are the earliest
+        for (auto& queuedSurface : m_queuedSurfaces) {
+            if (static_cast<std::size_t>(pendingSurfaceCount) <= maxPendingSurfaces) {
+                break;
             }
-        } else {
-            auto vdpStatus = gVdpFunctionsInstance()->presentationQueueDisplay(
+
+            if (queuedSurface.bIsEnqueued) {
+                continue;
+            }
+
+            auto vdpStatus = m_device->presentationQueueDisplay(
                 m_vdpQueue,
                 queuedSurface.surface.getVdpHandle(),
                 0,
                 0,
                 queuedSurface.iPresentationTimeStamp
             );
-            gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't display the sufrace");
+            m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't display the sufrace");
             queuedSurface.bIsEnqueued = true;
+            --pendingSurfaceCount;
         }
+    }
 
-        // Delete unused surfaces
-        m_queuedSurfaces.erase(std::remove_if(
-            m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [this](auto& queuedSurface) {
-                // Remove only already displayed surface
-                if (!queuedSurface.bIsEnqueued) {
-                    return false;
-                }
+    void PresentationQueue::displayPendingSurfaces() {
+        auto findNextSurface = [this]() {
+            // Jump over the pictures which will never be enqueued
+            while (m_skippedPOCs.erase(m_iNextPOC) != 0) {
+                m_iNextPOC++;
+            }
+
+            // Get the first no queued surface
+            return std::find_if(m_queuedSurfaces.begin(), m_queuedSurfaces.end(), [](auto& queuedSurface) {
+                return !queuedSurface.bIsEnqueued;
+            });
+        };
+
+        // Enqueued all possible surfaces
+        auto nextSurface = findNextSurface();
+        while (nextSurface != m_queuedSurfaces.end() && (nextSurface->iPOC == m_iNextPOC || nextSurface->iPOC == 0)) {
+            auto vdpStatus = m_device->presentationQueueDisplay(
+                m_vdpQueue,
+                nextSurface->surface.getVdpHandle(),
+                0,
+                0,
+                nextSurface->iPresentationTimeStamp
+            );
+            m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't display the sufrace");
+            nextSurface->bIsEnqueued = true;
 
-                VdpPresentationQueueStatus surfaceStatus = VDP_PRESENTATION_QUEUE_STATUS_QUEUED;
-                VdpTime unusedTime = 0;
-                auto vdpStatus = gVdpFunctionsInstance()->presentationQueueQuerySurfaceStatus(
-                    m_vdpQueue,
-                    queuedSurface.surface.getVdpHandle(),
-                    &surfaceStatus,
-                    &unusedTime
-                );
-                gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't query the sufrace status");
-
-                return surfaceStatus == VDP_PRESENTATION_QUEUE_STATUS_IDLE;
+            // Update the next expected POC
+            if (nextSurface->iPOC == 0) {
+                m_iNextPOC = 1;
+            } else {
+                m_iNextPOC++;
             }
-        ), m_queuedSurfaces.end());
 
-        return true;
+            nextSurface = findNextSurface();
+        }
     }
 
-    VdpTime PresentationQueue::getCurrentTime() {
-        VdpTime currentTime = 0;
-        auto vdpStatus = gVdpFunctionsInstance()->presentationQueueGetTime(
+    VdpPresentationQueueStatus PresentationQueue::querySurfaceStatus(VdpOutputSurface surface) {
+        VdpPresentationQueueStatus surfaceStatus = VDP_PRESENTATION_QUEUE_STATUS_QUEUED;
+        VdpTime unusedTime = 0;
+        auto vdpStatus = m_device->presentationQueueQuerySurfaceStatus(
             m_vdpQueue,
-            &currentTime
+            surface,
+            &surfaceStatus,
+            &unusedTime
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't get the presentation time");
+        m_device->throwExceptionOnFail(vdpStatus, "[PresentationQueue] Couldn't query the sufrace status");
 
-        return currentTime;
+        return surfaceStatus;
+    }
+
+    void PresentationQueue::releaseIdleSurfaces() {
+        // Delete unused surfaces
+        for (auto it = m_queuedSurfaces.begin(); it != m_queuedSurfaces.end();) {
+            // Remove only already displayed surface
+            if (!it->bIsEnqueued || querySurfaceStatus(it->surface.getVdpHandle()) != VDP_PRESENTATION_QUEUE_STATUS_IDLE) {
+                ++it;
+                continue;
+            }
+
+            // Without the reclaim worker, the pool still gets its surfaces back
+            if (m_pSurfacePool != nullptr) {
+                m_pSurfacePool->release(std::move(it->surface));
+            }
+            it = m_queuedSurfaces.erase(it);
+        }
+    }
+
+    void PresentationQueue::reclaimSurfaces() {
+        // We poll the surface status instead of calling presentationQueueBlockUntilSurfaceIdle
+        // since the last displayed surface stays visible until a new one is enqueued: the
+        // worker could be blocked forever when the decoding ends.
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+
+        try {
+            while (!m_bStopReclaim) {
+                // Get the surfaces already sent to VDPAU
+                std::vector<VdpOutputSurface> enqueuedSurfaces;
+                for (const auto& queuedSurface : m_queuedSurfaces) {
+                    if (queuedSurface.bIsEnqueued) {
+                        enqueuedSurfaces.push_back(queuedSurface.surface.getVdpHandle());
+                    }
+                }
+
+                if (enqueuedSurfaces.empty()) {
+                    m_reclaimCondition.wait(lock);
+                    continue;
+                }
+
+                // Query the status without blocking enqueue(), the enqueued surfaces
+                // are only removed by this thread so their handles stay valid
+                lock.unlock();
+                std::vector<VdpOutputSurface> idleSurfaces;
+                for (auto surface : enqueuedSurfaces) {
+                    if (querySurfaceStatus(surface) == VDP_PRESENTATION_QUEUE_STATUS_IDLE) {
+                        idleSurfaces.push_back(surface);
+                    }
+                }
+                lock.lock();
+
+                // Give back the idle surfaces to the pool
+                for (auto it = m_queuedSurfaces.begin(); it != m_queuedSurfaces.end();) {
+                    if (it->bIsEnqueued && std::find(idleSurfaces.begin(), idleSurfaces.end(), it->surface.getVdpHandle()) != idleSurfaces.end()) {
+                        m_pSurfacePool->release(std::move(it->surface));
+                        it = m_queuedSurfaces.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+
+                // Wait for the next poll if some surfaces are still on screen
+                if (idleSurfaces.size() != enqueuedSurfaces.size()) {
+                    m_reclaimCondition.wait_for(lock, m_reclaimPollInterval);
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[PresentationQueue] Surface reclaim stopped: " << e.what() << std::endl;
+
+            // enqueue() releases the idle surfaces from now on
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
+            m_bReclaimFailed = true;
+        }
     }
 }
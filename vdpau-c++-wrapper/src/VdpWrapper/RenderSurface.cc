@@ -12,9 +12,12 @@
 
 namespace vw {
     RenderSurface::RenderSurface(Device& device, const SizeU& size)
-    : m_vdpOutputSurface(VDP_INVALID_HANDLE)
+    : m_pFunctions(&device.getFunctions())
+    , m_vdpOutputSurface(VDP_INVALID_HANDLE)
     , m_size(size)
-    , m_iPictureOrderCount(-1) {
+    , m_storageSize(size)
+    , m_iPictureOrderCount(-1)
+    , m_presentationTimeStamp(NoTimestamp) {
         if (m_size != SizeU(0u, 0u)) {
             allocateVdpSurface(device, size);
         }
@@ -23,48 +26,67 @@ namespace vw {
     RenderSurface::RenderSurface(Device& device, const std::string& filename)
     : RenderSurface(device, SizeU(0u, 0u)) {
         // Load the image with openCV
-        cv::Mat decompressedImage = cv::imread(filename);
-
-        // Create planes
-        ImageBuffer buffer(decompressedImage);
+        cv::Mat decompressedImage = cv::imread(filename, cv::IMREAD_UNCHANGED);
 
         // Create VdpSurface
         SizeU imageSize(decompressedImage.size().width, decompressedImage.size().height);
         allocateVdpSurface(device, imageSize);
 
-        // Upload bytes to the surface
+        // An image with an alpha channel is uploaded in place, the others are expanded to BGRA
+        if (decompressedImage.type() == CV_8UC4) {
+            upload(ImageBuffer::view(decompressedImage));
+        } else {
+            upload(ImageBuffer(decompressedImage));
+        }
+    }
+
+    void RenderSurface::upload(const ImageBuffer& buffer) {
+        if (buffer.getFormat() != PixelFormat::B8G8R8A8) {
+            throw std::runtime_error("[RenderSurface] Only BGRA images can be uploaded");
+        }
+
         const void* planes[1] = { buffer.getPlane(0) };
         const uint32_t lineSize[1] = { buffer.getLineSize(0) };
-        auto vdpStatus = gVdpFunctionsInstance()->outputSurfacePutBitsNative(
+        auto vdpStatus = m_pFunctions->outputSurfacePutBitsNative(
             m_vdpOutputSurface,
             planes,
             lineSize,
             nullptr // Update all the surface
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't upload bytes from source image");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't upload bytes from source image");
     }
 
     RenderSurface::~RenderSurface() {
         if (m_vdpOutputSurface != VDP_INVALID_HANDLE) {
-            gVdpFunctionsInstance()->outputSurfaceDestroy(m_vdpOutputSurface);
+            m_pFunctions->outputSurfaceDestroy(m_vdpOutputSurface);
         }
     }
 
     RenderSurface::RenderSurface(RenderSurface&& other)
-    : m_vdpOutputSurface(std::exchange(other.m_vdpOutputSurface, VDP_INVALID_HANDLE))
+    : m_pFunctions(other.m_pFunctions)
+    , m_vdpOutputSurface(std::exchange(other.m_vdpOutputSurface, VDP_INVALID_HANDLE))
     , m_size(std::exchange(other.m_size, 0))
-    , m_iPictureOrderCount(std::exchange(other.m_iPictureOrderCount, -1)) {
+    , m_storageSize(std::exchange(other.m_storageSize, 0))
+    , m_iPictureOrderCount(std::exchange(other.m_iPictureOrderCount, -1))
+    , m_presentationTimeStamp(std::exchange(other.m_presentationTimeStamp, NoTimestamp)) {
 
     }
 
     RenderSurface& RenderSurface::operator=(RenderSurface&& other) {
+        std::swap(m_pFunctions, other.m_pFunctions);
         std::swap(m_vdpOutputSurface, other.m_vdpOutputSurface);
         std::swap(m_size, other.m_size);
+        std::swap(m_storageSize, other.m_storageSize);
         std::swap(m_iPictureOrderCount, other.m_iPictureOrderCount);
+        std::swap(m_presentationTimeStamp, other.m_presentationTimeStamp);
 
         return *this;
     }
 
+    SizeU RenderSurface::getSize() const {
+        return m_size;
+    }
+
     VdpOutputSurface RenderSurface::getVdpHandle() const {
         return m_vdpOutputSurface;
     }
@@ -77,51 +99,70 @@ namespace vw {
         return m_iPictureOrderCount;
     }
 
+    void RenderSurface::setPresentationTimeStamp(VdpTime presentationTimeStamp) {
+        m_presentationTimeStamp = presentationTimeStamp;
+    }
+
+    VdpTime RenderSurface::getPresentationTimeStamp() const {
+        return m_presentationTimeStamp;
+    }
+
     void RenderSurface::allocateVdpSurface(Device& device, const SizeU& size) {
         // Update the surface size
         m_size = size;
 
-        auto vdpStatus = gVdpFunctionsInstance()->outputSurfaceCreate(
+        auto vdpStatus = m_pFunctions->outputSurfaceCreate(
             device.getVdpHandle(),
             VDP_RGBA_FORMAT_B8G8R8A8,
             size.width,
             size.height,
             &m_vdpOutputSurface
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't create an output surface");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't create an output surface");
 
         SizeU realSize;
         VdpRGBAFormat format;
-        vdpStatus = gVdpFunctionsInstance()->outputSurfaceGetParameters(
+        vdpStatus = m_pFunctions->outputSurfaceGetParameters(
             m_vdpOutputSurface,
             &format,
             &realSize.width,
             &realSize.height
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't retreive surface informations");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't retreive surface informations");
 
         assert(format == VDP_RGBA_FORMAT_B8G8R8A8);
-        assert(realSize == m_size); // TODO: VDPAU API says the size may be different form call to align data
-                                    //       So we need to handle this case
+
+        // The driver may round the size up to align the data, the readback must
+        // cover the whole storage
+        m_storageSize = realSize;
     }
 
     ImageBuffer RenderSurface::copyHardwareMemory() {
-        std::vector<Plane> planes(1);
-        std::vector<uint32_t> linesizes(1);
+        ImageBuffer buffer(PixelFormat::B8G8R8A8, m_storageSize);
+        copyHardwareMemory(buffer);
 
-        // Allocate Planes
-        planes[0].resize(m_size.width * m_size.height * 4);
+        return buffer;
+    }
+
+    void RenderSurface::copyHardwareMemory(ImageBuffer& buffer) {
+        buffer.resize(PixelFormat::B8G8R8A8, m_storageSize);
 
         // Cast to void pointer
-        void* ppPlanes[1] = { planes[0].data() };
-        auto vdpStatus = gVdpFunctionsInstance()->outputSurfaceGetBitsNative(
+        void* ppPlanes[1] = { buffer.getPlane(0) };
+        const uint32_t lineSizes[1] = { buffer.getLineSize(0) };
+        auto vdpStatus = m_pFunctions->outputSurfaceGetBitsNative(
             m_vdpOutputSurface,
             nullptr,
             ppPlanes,
-            linesizes.data()
+            lineSizes
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't retreive GPU data");
+        m_pFunctions->throwExceptionOnFail(vdpStatus, "[RenderSurface] Couldn't retreive GPU data");
+    }
+
+    ImageFrame RenderSurface::copyHardwareMemory(ImageBufferPool& pool) {
+        ImageFrame frame = pool.acquire(PixelFormat::B8G8R8A8, m_storageSize);
+        copyHardwareMemory(*frame);
 
-        return ImageBuffer(std::move(planes), std::move(linesizes));
+        return frame;
     }
 }
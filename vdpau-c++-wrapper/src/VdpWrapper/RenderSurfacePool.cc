@@ -0,0 +1,61 @@
+#include <VdpWrapper/RenderSurfacePool.h>
+
+#include <algorithm>
+
+#include <VdpWrapper/Device.h>
+
+namespace vw {
+    RenderSurfacePool::RenderSurfacePool(Device& device)
+    : m_device(device)
+    , m_allocatedSurfaces(0)
+    , m_peakUsedSurfaces(0) {
+
+    }
+
+    RenderSurface RenderSurfacePool::acquire(const SizeU& size) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Free the surfaces which cannot be reused anymore
+        auto obsoleteSurfaces = std::remove_if(m_availableSurfaces.begin(), m_availableSurfaces.end(), [&size](auto& surface) {
+            return surface.getSize() != size;
+        });
+        m_allocatedSurfaces -= std::distance(obsoleteSurfaces, m_availableSurfaces.end());
+        m_availableSurfaces.erase(obsoleteSurfaces, m_availableSurfaces.end());
+
+        std::size_t usedSurfaces = m_allocatedSurfaces - m_availableSurfaces.size() + 1;
+        m_peakUsedSurfaces = std::max(m_peakUsedSurfaces, usedSurfaces);
+
+        if (m_availableSurfaces.empty()) {
+            ++m_allocatedSurfaces;
+            return RenderSurface(m_device, size);
+        }
+
+        RenderSurface surface = std::move(m_availableSurfaces.back());
+        m_availableSurfaces.pop_back();
+
+        return surface;
+    }
+
+    void RenderSurfacePool::release(RenderSurface surface) {
+        if (surface.getVdpHandle() == VDP_INVALID_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        surface.setPictureOrderCount(-1);
+        surface.setPresentationTimeStamp(NoTimestamp);
+        m_availableSurfaces.push_back(std::move(surface));
+    }
+
+    PoolOccupancy RenderSurfacePool::getOccupancy() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        PoolOccupancy occupancy;
+        occupancy.allocatedSurfaces = m_allocatedSurfaces;
+        occupancy.availableSurfaces = m_availableSurfaces.size();
+        occupancy.usedSurfaces = m_allocatedSurfaces - m_availableSurfaces.size();
+        occupancy.peakUsedSurfaces = m_peakUsedSurfaces;
+
+        return occupancy;
+    }
+}
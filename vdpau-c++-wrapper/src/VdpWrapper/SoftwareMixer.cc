@@ -0,0 +1,414 @@
+#include <VdpWrapper/SoftwareMixer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/PixelConversion.h>
+#include <VdpWrapper/RenderSurface.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define VW_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace vw {
+    namespace {
+        // Limited range YCbCr to full range RGB coefficients
+        struct ColorMatrix {
+            float luma;     // Applied to Y - 16
+            float redV;     // Applied to V - 128
+            float greenU;   // Applied to U - 128 (subtracted)
+            float greenV;   // Applied to V - 128 (subtracted)
+            float blueU;    // Applied to U - 128
+        };
+
+        ColorMatrix getColorMatrix(ColorStandard standard) {
+            float kr = standard == ColorStandard::BT709 ? 0.2126f : 0.299f;
+            float kb = standard == ColorStandard::BT709 ? 0.0722f : 0.114f;
+            float kg = 1.0f - kr - kb;
+            float chroma = 255.0f / 224.0f;
+
+            return {
+                255.0f / 219.0f,
+                chroma * 2.0f * (1.0f - kr),
+                chroma * 2.0f * kb * (1.0f - kb) / kg,
+                chroma * 2.0f * kr * (1.0f - kr) / kg,
+                chroma * 2.0f * (1.0f - kb),
+            };
+        }
+
+        // Keys cubic convolution kernel with a = -0.5 (Catmull-Rom)
+        double cubicWeight(double x) {
+            const double a = -0.5;
+            x = std::abs(x);
+            if (x <= 1.0) {
+                return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            }
+
+            if (x < 2.0) {
+                return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            }
+
+            return 0.0;
+        }
+
+        uint8_t clampComponent(float value) {
+            return static_cast<uint8_t>(std::min(std::max(std::lrint(value), 0l), 255l));
+        }
+
+        void filterLinesScalar(const uint8_t* pSource, uint32_t lineSize, const uint32_t* pIndices, const float* pWeights, std::size_t taps, float* pDestination, std::size_t begin, std::size_t count) {
+            for (std::size_t x = begin; x < count; ++x) {
+                float sum = 0.0f;
+                for (std::size_t k = 0; k < taps; ++k) {
+                    sum += pWeights[k] * pSource[static_cast<std::size_t>(pIndices[k]) * lineSize + x];
+                }
+                pDestination[x] = sum;
+            }
+        }
+
+        void convertToBGRAScalar(const ColorMatrix& matrix, const float* pY, const float* pU, const float* pV, uint8_t* pBGRA, std::size_t begin, std::size_t count) {
+            for (std::size_t x = begin; x < count; ++x) {
+                float y = matrix.luma * (pY[x] - 16.0f);
+                float u = pU[x] - 128.0f;
+                float v = pV[x] - 128.0f;
+
+                pBGRA[4 * x + 0] = clampComponent(y + matrix.blueU * u);
+                pBGRA[4 * x + 1] = clampComponent(y - matrix.greenU * u - matrix.greenV * v);
+                pBGRA[4 * x + 2] = clampComponent(y + matrix.redV * v);
+                pBGRA[4 * x + 3] = 0xFF;
+            }
+        }
+
+#ifdef VW_X86_KERNELS
+        __attribute__((target("avx2")))
+        void filterLinesAVX2(const uint8_t* pSource, uint32_t lineSize, const uint32_t* pIndices, const float* pWeights, std::size_t taps, float* pDestination, std::size_t count) {
+            std::size_t x = 0;
+            for (; x + 8 <= count; x += 8) {
+                __m256 sum = _mm256_setzero_ps();
+                for (std::size_t k = 0; k < taps; ++k) {
+                    const uint8_t* pLine = pSource + static_cast<std::size_t>(pIndices[k]) * lineSize + x;
+                    __m256 samples = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pLine))));
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(pWeights[k]), samples));
+                }
+                _mm256_storeu_ps(pDestination + x, sum);
+            }
+
+            filterLinesScalar(pSource, lineSize, pIndices, pWeights, taps, pDestination, x, count);
+        }
+
+        __attribute__((target("avx2")))
+        void convertToBGRAAVX2(const ColorMatrix& matrix, const float* pY, const float* pU, const float* pV, uint8_t* pBGRA, std::size_t count) {
+            const __m256 luma = _mm256_set1_ps(matrix.luma);
+            const __m256 redV = _mm256_set1_ps(matrix.redV);
+            const __m256 greenU = _mm256_set1_ps(matrix.greenU);
+            const __m256 greenV = _mm256_set1_ps(matrix.greenV);
+            const __m256 blueU = _mm256_set1_ps(matrix.blueU);
+            const __m256 lumaOffset = _mm256_set1_ps(16.0f);
+            const __m256 chromaOffset = _mm256_set1_ps(128.0f);
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i maximum = _mm256_set1_epi32(255);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+            std::size_t x = 0;
+            for (; x + 8 <= count; x += 8) {
+                __m256 y = _mm256_mul_ps(luma, _mm256_sub_ps(_mm256_loadu_ps(pY + x), lumaOffset));
+                __m256 u = _mm256_sub_ps(_mm256_loadu_ps(pU + x), chromaOffset);
+                __m256 v = _mm256_sub_ps(_mm256_loadu_ps(pV + x), chromaOffset);
+
+                __m256 blue = _mm256_add_ps(y, _mm256_mul_ps(blueU, u));
+                __m256 green = _mm256_sub_ps(_mm256_sub_ps(y, _mm256_mul_ps(greenU, u)), _mm256_mul_ps(greenV, v));
+                __m256 red = _mm256_add_ps(y, _mm256_mul_ps(redV, v));
+
+                // Round to nearest even like lrint(), clamp, then pack the components of each pixel in 32 bits
+                __m256i b = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvtps_epi32(blue), zero), maximum);
+                __m256i g = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvtps_epi32(green), zero), maximum);
+                __m256i r = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvtps_epi32(red), zero), maximum);
+                __m256i pixels = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(r, 16), alpha));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pBGRA + 4 * x), pixels);
+            }
+
+            convertToBGRAScalar(matrix, pY, pU, pV, pBGRA, x, count);
+        }
+#endif
+
+        void filterLines(const uint8_t* pSource, uint32_t lineSize, const uint32_t* pIndices, const float* pWeights, std::size_t taps, float* pDestination, std::size_t count) {
+#ifdef VW_X86_KERNELS
+            if (getSimdLevel() >= SimdLevel::AVX2) {
+                filterLinesAVX2(pSource, lineSize, pIndices, pWeights, taps, pDestination, count);
+                return;
+            }
+#endif
+            filterLinesScalar(pSource, lineSize, pIndices, pWeights, taps, pDestination, 0, count);
+        }
+
+        void convertToBGRA(const ColorMatrix& matrix, const float* pY, const float* pU, const float* pV, uint8_t* pBGRA, std::size_t count) {
+#ifdef VW_X86_KERNELS
+            if (getSimdLevel() >= SimdLevel::AVX2) {
+                convertToBGRAAVX2(matrix, pY, pU, pV, pBGRA, count);
+                return;
+            }
+#endif
+            convertToBGRAScalar(matrix, pY, pU, pV, pBGRA, 0, count);
+        }
+    }
+
+    SoftwareMixer::SoftwareMixer(SizeU outputSize, std::size_t iThreadCount)
+    : m_outputSize(outputSize)
+    , m_standard(ColorStandard::BT601)
+    , m_filter(ScalingFilter::Bilinear)
+    , m_tapsFilter(ScalingFilter::Bilinear)
+    , m_bTapsValid(false)
+    , m_pInput(nullptr)
+    , m_pOutput(nullptr)
+    , m_readbackBuffer(PixelFormat::NV12, SizeU(0u, 0u))
+    , m_outputBuffer(PixelFormat::B8G8R8A8, SizeU(0u, 0u))
+    , m_iGeneration(0)
+    , m_iStripeCount(0)
+    , m_iNextStripe(0)
+    , m_iFinishedStripes(0)
+    , m_bStopping(false) {
+        if (iThreadCount == 0) {
+            iThreadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_scratches.resize(iThreadCount);
+
+        // The calling thread is the first worker
+        for (std::size_t i = 1; i < iThreadCount; ++i) {
+            m_workers.emplace_back(&SoftwareMixer::runWorker, this, i);
+        }
+    }
+
+    SoftwareMixer::~SoftwareMixer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStopping = true;
+        }
+        m_workCondition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void SoftwareMixer::setOutputSize(SizeU outputSize) {
+        m_outputSize = outputSize;
+    }
+
+    void SoftwareMixer::setColorStandard(ColorStandard standard) {
+        m_standard = standard;
+    }
+
+    void SoftwareMixer::setScalingFilter(ScalingFilter filter) {
+        m_filter = filter;
+    }
+
+    std::size_t SoftwareMixer::getThreadCount() const {
+        return m_workers.size() + 1;
+    }
+
+    void SoftwareMixer::process(const ImageBuffer& input, ImageBuffer& output) {
+        process(input, input.getSize(), output);
+    }
+
+    void SoftwareMixer::process(const ImageBuffer& input, SizeU inputSize, ImageBuffer& output) {
+        if (input.getFormat() != PixelFormat::NV12) {
+            throw std::runtime_error("[SoftwareMixer] Only NV12 pictures can be processed");
+        }
+
+        if (inputSize.width == 0 || inputSize.height == 0 || inputSize.width > input.getSize().width || inputSize.height > input.getSize().height) {
+            throw std::runtime_error("[SoftwareMixer] Invalid input size");
+        }
+
+        output.resize(PixelFormat::B8G8R8A8, m_outputSize);
+        updateTaps(inputSize);
+
+        // Resizing keeps the capacity: no allocation once the sizes are stable
+        uint32_t chromaWidth = (inputSize.width + 1) / 2;
+        for (auto& scratch : m_scratches) {
+            scratch.luma.resize(inputSize.width);
+            scratch.chroma.resize(2 * chromaWidth);
+            scratch.y.resize(m_outputSize.width);
+            scratch.u.resize(m_outputSize.width);
+            scratch.v.resize(m_outputSize.width);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pInput = &input;
+        m_pOutput = &output;
+        m_iStripeCount = m_scratches.size();
+        m_iNextStripe = 0;
+        m_iFinishedStripes = 0;
+        ++m_iGeneration;
+        m_workCondition.notify_all();
+
+        while (m_iNextStripe < m_iStripeCount) {
+            std::size_t iStripe = m_iNextStripe++;
+            lock.unlock();
+            processStripe(iStripe);
+            lock.lock();
+            ++m_iFinishedStripes;
+        }
+
+        m_doneCondition.wait(lock, [this]() {
+            return m_iFinishedStripes == m_iStripeCount;
+        });
+
+        m_pInput = nullptr;
+        m_pOutput = nullptr;
+    }
+
+    ImageFrame SoftwareMixer::process(const ImageBuffer& input, ImageBufferPool& pool) {
+        ImageFrame frame = pool.acquire(PixelFormat::B8G8R8A8, m_outputSize);
+        process(input, *frame);
+
+        return frame;
+    }
+
+    RenderSurface SoftwareMixer::process(Device& device, DecodedSurface& inputSurface) {
+        inputSurface.copyHardwareMemory(m_readbackBuffer);
+        process(m_readbackBuffer, inputSurface.getSize(), m_outputBuffer);
+
+        RenderSurface outputSurface(device, m_outputSize);
+        outputSurface.upload(m_outputBuffer);
+        outputSurface.setPictureOrderCount(inputSurface.getPictureOrderCount());
+        outputSurface.setPresentationTimeStamp(inputSurface.getPresentationTimeStamp());
+
+        return outputSurface;
+    }
+
+    void SoftwareMixer::updateTaps(SizeU inputSize) {
+        if (m_bTapsValid && m_tapsInputSize == inputSize && m_tapsOutputSize == m_outputSize && m_tapsFilter == m_filter) {
+            return;
+        }
+
+        // The chroma planes are sub-sampled by 2, their samples are centered between two luma samples
+        uint32_t chromaWidth = (inputSize.width + 1) / 2;
+        uint32_t chromaHeight = (inputSize.height + 1) / 2;
+        m_lumaColumns = computeTaps(m_filter, inputSize.width, inputSize.width, m_outputSize.width);
+        m_lumaLines = computeTaps(m_filter, inputSize.height, inputSize.height, m_outputSize.height);
+        m_chromaColumns = computeTaps(m_filter, chromaWidth, inputSize.width / 2.0, m_outputSize.width);
+        m_chromaLines = computeTaps(m_filter, chromaHeight, inputSize.height / 2.0, m_outputSize.height);
+
+        m_tapsInputSize = inputSize;
+        m_tapsOutputSize = m_outputSize;
+        m_tapsFilter = m_filter;
+        m_bTapsValid = true;
+    }
+
+    void SoftwareMixer::processStripe(std::size_t iStripe) {
+        uint32_t height = m_outputSize.height;
+        uint32_t firstLine = static_cast<uint32_t>(static_cast<uint64_t>(height) * iStripe / m_iStripeCount);
+        uint32_t lastLine = static_cast<uint32_t>(static_cast<uint64_t>(height) * (iStripe + 1) / m_iStripeCount);
+
+        for (uint32_t line = firstLine; line < lastLine; ++line) {
+            processLine(*m_pInput, *m_pOutput, line, m_scratches[iStripe]);
+        }
+    }
+
+    void SoftwareMixer::processLine(const ImageBuffer& input, ImageBuffer& output, uint32_t line, Scratch& scratch) {
+        // Vertical pass on the full source lines
+        filterLines(
+            input.getPlane(0), input.getLineSize(0),
+            &m_lumaLines.indices[line * m_lumaLines.count], &m_lumaLines.weights[line * m_lumaLines.count], m_lumaLines.count,
+            scratch.luma.data(), scratch.luma.size()
+        );
+        filterLines(
+            input.getPlane(1), input.getLineSize(1),
+            &m_chromaLines.indices[line * m_chromaLines.count], &m_chromaLines.weights[line * m_chromaLines.count], m_chromaLines.count,
+            scratch.chroma.data(), scratch.chroma.size()
+        );
+
+        // Horizontal pass, the chroma samples are still interleaved
+        std::size_t lumaTaps = m_lumaColumns.count;
+        std::size_t chromaTaps = m_chromaColumns.count;
+        for (std::size_t x = 0; x < m_outputSize.width; ++x) {
+            const uint32_t* pLumaIndices = &m_lumaColumns.indices[x * lumaTaps];
+            const float* pLumaWeights = &m_lumaColumns.weights[x * lumaTaps];
+            float y = 0.0f;
+            for (std::size_t k = 0; k < lumaTaps; ++k) {
+                y += pLumaWeights[k] * scratch.luma[pLumaIndices[k]];
+            }
+
+            const uint32_t* pChromaIndices = &m_chromaColumns.indices[x * chromaTaps];
+            const float* pChromaWeights = &m_chromaColumns.weights[x * chromaTaps];
+            float u = 0.0f;
+            float v = 0.0f;
+            for (std::size_t k = 0; k < chromaTaps; ++k) {
+                u += pChromaWeights[k] * scratch.chroma[2 * pChromaIndices[k]];
+                v += pChromaWeights[k] * scratch.chroma[2 * pChromaIndices[k] + 1];
+            }
+
+            scratch.y[x] = y;
+            scratch.u[x] = u;
+            scratch.v[x] = v;
+        }
+
+        uint8_t* pBGRA = output.getPlane(0) + static_cast<std::size_t>(line) * output.getLineSize(0);
+        convertToBGRA(getColorMatrix(m_standard), scratch.y.data(), scratch.u.data(), scratch.v.data(), pBGRA, m_outputSize.width);
+    }
+
+    void SoftwareMixer::runWorker(std::size_t /* iWorker */) {
+        uint64_t iLastGeneration = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true) {
+            m_workCondition.wait(lock, [&]() {
+                return m_bStopping || m_iGeneration != iLastGeneration;
+            });
+
+            if (m_bStopping) {
+                return;
+            }
+
+            iLastGeneration = m_iGeneration;
+            while (m_iNextStripe < m_iStripeCount) {
+                std::size_t iStripe = m_iNextStripe++;
+                lock.unlock();
+                processStripe(iStripe);
+                lock.lock();
+
+                if (++m_iFinishedStripes == m_iStripeCount) {
+                    m_doneCondition.notify_all();
+                }
+            }
+        }
+    }
+
+    SoftwareMixer::Taps SoftwareMixer::computeTaps(ScalingFilter filter, uint32_t sourceSize, double scaleSource, uint32_t destinationSize) {
+        Taps taps;
+        taps.count = filter == ScalingFilter::Bicubic ? 4 : 2;
+        taps.indices.resize(taps.count * destinationSize);
+        taps.weights.resize(taps.count * destinationSize);
+
+        double ratio = scaleSource / destinationSize;
+        for (uint32_t i = 0; i < destinationSize; ++i) {
+            // Position of the output sample center in the source samples
+            double position = (i + 0.5) * ratio - 0.5;
+            double first = std::floor(position);
+            double fraction = position - first;
+
+            for (std::size_t k = 0; k < taps.count; ++k) {
+                double weight = 0.0;
+                long index = 0;
+                if (filter == ScalingFilter::Bicubic) {
+                    index = static_cast<long>(first) - 1 + static_cast<long>(k);
+                    weight = cubicWeight(fraction + 1.0 - static_cast<double>(k));
+                } else {
+                    index = static_cast<long>(first) + static_cast<long>(k);
+                    weight = k == 0 ? 1.0 - fraction : fraction;
+                }
+
+                // Repeat the edge samples
+                index = std::min(std::max(index, 0l), static_cast<long>(sourceSize) - 1);
+                taps.indices[i * taps.count + k] = static_cast<uint32_t>(index);
+                taps.weights[i * taps.count + k] = static_cast<float>(weight);
+            }
+        }
+
+        return taps;
+    }
+}
@@ -1,8 +1,12 @@
 #include <VdpWrapper/VdpFunctions.h>
 
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 
+#include <VdpWrapper/CallTracer.h>
 #include <VdpWrapper/Device.h>
 
 namespace vw {
@@ -34,41 +38,74 @@ namespace vw {
     , presentationQueueDisplay(nullptr)
     , presentationQueueQuerySurfaceStatus(nullptr)
     , m_pGetProcAddress(pGetProcAddress)
-    , m_pGetErrorString(nullptr) {
-        storeFunction(vdpDevice, VDP_FUNC_ID_GET_ERROR_STRING);
-        storeFunction(vdpDevice, VDP_FUNC_ID_GET_INFORMATION_STRING);
-        storeFunction(vdpDevice, VDP_FUNC_ID_DEVICE_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_CREATE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_RENDER);
-        storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_CREATE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_CREATE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_CREATE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_RENDER);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY);
-        storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS);
+    , m_pGetErrorString(nullptr)
+    , m_iTraceSlot(CallTracer::NoSlot) {
+        // Opt-in call tracing, started once even if several devices are created concurrently
+        static std::once_flag traceStartFlag;
+        std::call_once(traceStartFlag, []() {
+            const char* szTraceFile = std::getenv("VW_TRACE_FILE");
+            if (szTraceFile != nullptr && !CallTracer::isActive()) {
+                // A trace file which can't be opened leaves the devices untraced
+                try {
+                    CallTracer::start(szTraceFile);
+                } catch (const std::exception& e) {
+                    std::cerr << "[VdpFunctions] " << e.what() << ", the calls aren't traced" << std::endl;
+                }
+            }
+        });
+
+        // The shims forward the calls to the entry points of this device
+        if (CallTracer::isActive()) {
+            m_iTraceSlot = CallTracer::attachDevice();
+        }
+
+        try {
+            storeFunction(vdpDevice, VDP_FUNC_ID_GET_ERROR_STRING);
+            storeFunction(vdpDevice, VDP_FUNC_ID_GET_INFORMATION_STRING);
+            storeFunction(vdpDevice, VDP_FUNC_ID_DEVICE_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_CREATE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_DECODER_RENDER);
+            storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_CREATE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_CREATE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_CREATE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_VIDEO_MIXER_RENDER);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY);
+            storeFunction(vdpDevice, VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS);
+        } catch (...) {
+            if (m_iTraceSlot != CallTracer::NoSlot) {
+                CallTracer::detachDevice(m_iTraceSlot);
+            }
+            throw;
+        }
+    }
+
+    VdpFunctions::~VdpFunctions() {
+        if (m_iTraceSlot != CallTracer::NoSlot) {
+            CallTracer::detachDevice(m_iTraceSlot);
+        }
     }
 
     std::string VdpFunctions::getErrorString(VdpStatus status) const {
         return std::string(m_pGetErrorString(status));
     }
 
-    void VdpFunctions::throwExceptionOnFail(VdpStatus vdpStatus, const std::string& message) {
+    void VdpFunctions::throwExceptionOnFail(VdpStatus vdpStatus, const std::string& message) const {
         if (vdpStatus != VDP_STATUS_OK) {
             auto szError = getErrorString(vdpStatus);
             throw std::runtime_error(
@@ -84,6 +121,10 @@ namespace vw {
         VdpStatus vdpStatus = m_pGetProcAddress(vdpDevice, functionID, &func);
         throwExceptionOnFail(vdpStatus, "[VdpFunctions] Error getting the #" + std::to_string(functionID) + " callback");
 
+        if (m_iTraceSlot != CallTracer::NoSlot) {
+            func = CallTracer::wrapFunction(m_iTraceSlot, functionID, func);
+        }
+
         // Store the callback
         switch (functionID) {
             case VDP_FUNC_ID_GET_ERROR_STRING:
@@ -198,36 +239,4 @@ namespace vw {
                 break;
         }
     }
-
-    VdpFunctionsInstance::VdpFunctionsInstance()
-    : m_pVdpFunction(nullptr) {
-
-    }
-
-    VdpFunctionsInstance::~VdpFunctionsInstance() {
-        delete m_pVdpFunction;
-    }
-
-    void VdpFunctionsInstance::create(VdpDevice& vdpDevice, VdpGetProcAddress* pGetProcAddress) {
-        if (m_pVdpFunction != nullptr) {
-            throw std::runtime_error("The VDPAU functions are already initialized");
-        }
-
-        m_pVdpFunction = new VdpFunctions(vdpDevice, pGetProcAddress);
-    }
-
-    void VdpFunctionsInstance::dispose() {
-        delete m_pVdpFunction;
-        m_pVdpFunction = nullptr;
-    }
-
-    VdpFunctions* VdpFunctionsInstance::operator()() {
-        if (m_pVdpFunction == nullptr) {
-            throw std::runtime_error("The VDPAU functions are not initialized. You must first create a vw::Device.");
-        }
-
-        return m_pVdpFunction;
-    }
-
-    VdpFunctionsInstance gVdpFunctionsInstance;
 }
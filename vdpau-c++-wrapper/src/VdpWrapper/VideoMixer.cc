@@ -2,6 +2,7 @@
 
 #include <VdpWrapper/Device.h>
 #include <VdpWrapper/RenderSurface.h>
+#include <VdpWrapper/RenderSurfacePool.h>
 #include <VdpWrapper/DecodedSurface.h>
 #include <VdpWrapper/VdpFunctions.h>
 
@@ -9,13 +10,14 @@ namespace vw {
     VideoMixer::VideoMixer(Device& device, SizeU outputSize)
     : m_device(device)
     , m_mixer(VDP_INVALID_HANDLE)
-    , m_outputSize(outputSize) {
+    , m_outputSize(outputSize)
+    , m_pSurfacePool(nullptr) {
 
     }
 
     VideoMixer::~VideoMixer() {
         if (m_mixer != VDP_INVALID_HANDLE) {
-            gVdpFunctionsInstance()->videoMixerDestroy(m_mixer);
+            m_device->videoMixerDestroy(m_mixer);
         }
     }
 
@@ -23,15 +25,19 @@ namespace vw {
         m_outputSize = outputSize;
     }
 
+    void VideoMixer::setSurfacePool(RenderSurfacePool* pSurfacePool) {
+        m_pSurfacePool = pSurfacePool;
+    }
+
     RenderSurface VideoMixer::process(DecodedSurface &inputSurface) {
         if (m_mixer == VDP_INVALID_HANDLE) {
             createMixer(inputSurface.getSize());
         }
 
-        // Create the output surface
-        RenderSurface outputSurface(m_device, m_outputSize);
+        // Create the output surface or reuse a released one
+        RenderSurface outputSurface = (m_pSurfacePool != nullptr) ? m_pSurfacePool->acquire(m_outputSize) : RenderSurface(m_device, m_outputSize);
 
-        VdpStatus vdpStatus = gVdpFunctionsInstance()->videoMixerRender(
+        VdpStatus vdpStatus = m_device->videoMixerRender(
             m_mixer,
             // Background
             VDP_INVALID_HANDLE, // No background surface
@@ -61,9 +67,10 @@ namespace vw {
             0, // No layer
             nullptr
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[VideoMixer] Couldn't render the surface");
+        m_device->throwExceptionOnFail(vdpStatus, "[VideoMixer] Couldn't render the surface");
 
         outputSurface.setPictureOrderCount(inputSurface.getPictureOrderCount());
+        outputSurface.setPresentationTimeStamp(inputSurface.getPresentationTimeStamp());
 
         return std::move(outputSurface);
     }
@@ -79,7 +86,7 @@ namespace vw {
             &size.height
         };
 
-        VdpStatus vdpStatus = gVdpFunctionsInstance()->videoMixerCreate(
+        VdpStatus vdpStatus = m_device->videoMixerCreate(
             m_device.getVdpHandle(),
             0, // No features
             nullptr,
@@ -88,6 +95,6 @@ namespace vw {
             parameterValues,
             &m_mixer
         );
-        gVdpFunctionsInstance()->throwExceptionOnFail(vdpStatus, "[VideoMixer] Couldn't create the video mixer");
+        m_device->throwExceptionOnFail(vdpStatus, "[VideoMixer] Couldn't create the video mixer");
     }
 }
@@ -0,0 +1,62 @@
+#include <VdpWrapper/Y4MHeader.h>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace vw {
+    namespace {
+        const std::size_t SignatureLength = sizeof(Y4MSignature) - 1;
+    }
+
+    bool hasY4MSignature(const void* pData, std::size_t size) {
+        return size >= SignatureLength && std::memcmp(pData, Y4MSignature, SignatureLength) == 0;
+    }
+
+    Y4MHeader parseY4MHeader(const std::string& szLine) {
+        if (!hasY4MSignature(szLine.data(), szLine.size())) {
+            throw std::runtime_error("[Y4MHeader] Invalid Y4M header");
+        }
+
+        Y4MHeader header = { PixelFormat::I420, SizeU(0u, 0u), Framerate(0, 0) };
+
+        std::istringstream parameters(szLine.substr(SignatureLength));
+        std::string szParameter;
+        while (parameters >> szParameter) {
+            std::string szValue = szParameter.substr(1);
+            switch (szParameter[0]) {
+            case 'W':
+                header.size.width = std::stoul(szValue);
+                break;
+
+            case 'H':
+                header.size.height = std::stoul(szValue);
+                break;
+
+            case 'F': {
+                std::size_t iDelimiterIndex = szValue.find(':');
+                if (iDelimiterIndex != std::string::npos) {
+                    header.framerate = Framerate(std::stoul(szValue.substr(0, iDelimiterIndex)), std::stoul(szValue.substr(iDelimiterIndex + 1)));
+                }
+                break;
+            }
+
+            case 'C':
+                if (szValue != "420" && szValue != "420jpeg" && szValue != "420paldv" && szValue != "420mpeg2") {
+                    throw std::runtime_error("[Y4MHeader] Unsupported Y4M colorspace '" + szValue + "'");
+                }
+                break;
+
+            default:
+                // Interlacing, aspect ratio and extensions don't change the layout
+                break;
+            }
+        }
+
+        if (header.size.width == 0 || header.size.height == 0) {
+            throw std::runtime_error("[Y4MHeader] The Y4M header doesn't define the picture size");
+        }
+
+        return header;
+    }
+}
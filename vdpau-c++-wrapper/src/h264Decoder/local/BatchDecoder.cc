@@ -0,0 +1,232 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BatchDecoder.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/NalUnit.h>
+
+#include <h264Parser/H264Parser.h>
+
+namespace {
+    // Nearest-rank percentile of sorted values
+    std::chrono::nanoseconds getPercentile(const std::vector<std::chrono::nanoseconds>& sortedValues, double percentile) {
+        if (sortedValues.empty()) {
+            return std::chrono::nanoseconds(0);
+        }
+
+        std::size_t iRank = static_cast<std::size_t>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+        return sortedValues[std::min(iRank, sortedValues.size() - 1)];
+    }
+}
+
+BatchDecoder::BatchDecoder(vw::Device& device, std::size_t iSessionCount)
+: m_device(device)
+, m_iSessionCount(iSessionCount)
+, m_bThreadPinning(false)
+, m_pSessionPool(nullptr)
+, m_iSteals(0)
+, m_elapsedTime(0) {
+    if (m_iSessionCount == 0) {
+        throw std::invalid_argument("[BatchDecoder] At least one session is needed");
+    }
+}
+
+void BatchDecoder::setThreadPinning(bool bEnabled) {
+    m_bThreadPinning = bEnabled;
+}
+
+void BatchDecoder::setSessionPool(vw::DecoderSessionPool* pSessionPool) {
+    m_pSessionPool = pSessionPool;
+}
+
+void BatchDecoder::addFile(const std::string& filename) {
+    FileResult result;
+    result.filename = filename;
+    m_results.push_back(result);
+}
+
+void BatchDecoder::run() {
+    // Deal the files from the largest to the smallest: the thieves take the small ones
+    std::vector<std::pair<std::uintmax_t, std::size_t>> filesBySize;
+    for (std::size_t i = 0; i < m_results.size(); ++i) {
+        std::error_code error;
+        std::uintmax_t iSize = std::filesystem::file_size(m_results[i].filename, error);
+        filesBySize.emplace_back(error ? 0 : iSize, i);
+    }
+    std::stable_sort(filesBySize.begin(), filesBySize.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    m_queues.clear();
+    for (std::size_t i = 0; i < m_iSessionCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (std::size_t i = 0; i < filesBySize.size(); ++i) {
+        m_queues[i % m_iSessionCount]->files.push_back(filesBySize[i].second);
+    }
+    m_iSteals = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < m_iSessionCount; ++i) {
+        workers.emplace_back(&BatchDecoder::runWorker, this, i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    m_elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+}
+
+const std::vector<FileResult>& BatchDecoder::getResults() const {
+    return m_results;
+}
+
+BatchStatistics BatchDecoder::getStatistics() const {
+    BatchStatistics statistics;
+    std::vector<std::chrono::nanoseconds> fileTimes;
+
+    for (const auto& result : m_results) {
+        ++statistics.files;
+        if (!result.error.empty()) {
+            ++statistics.failures;
+        }
+        statistics.decodedPictures += result.decodedPictures;
+        statistics.bitstreamBytes += result.bitstreamBytes;
+        fileTimes.push_back(result.elapsedTime);
+    }
+    std::sort(fileTimes.begin(), fileTimes.end());
+
+    statistics.steals = m_iSteals;
+    statistics.elapsedTime = m_elapsedTime;
+    statistics.medianFileTime = getPercentile(fileTimes, 50.0);
+    statistics.p99FileTime = getPercentile(fileTimes, 99.0);
+    statistics.maxFileTime = fileTimes.empty() ? std::chrono::nanoseconds(0) : fileTimes.back();
+
+    double elapsedSeconds = std::chrono::duration<double>(m_elapsedTime).count();
+    if (elapsedSeconds > 0.0) {
+        statistics.picturesPerSecond = statistics.decodedPictures / elapsedSeconds;
+        statistics.bitstreamMegabytesPerSecond = statistics.bitstreamBytes / elapsedSeconds / 1000000.0;
+    }
+
+    return statistics;
+}
+
+void BatchDecoder::runWorker(std::size_t iWorker) {
+    if (m_bThreadPinning) {
+        pinCurrentThread(iWorker);
+    }
+
+    std::size_t iFile = 0;
+    while (takeFile(iWorker, iFile)) {
+        decodeFile(iFile, iWorker);
+    }
+}
+
+bool BatchDecoder::takeFile(std::size_t iWorker, std::size_t& iFile) {
+    // Own queue first, from the front
+    {
+        WorkQueue& queue = *m_queues[iWorker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.files.empty()) {
+            iFile = queue.files.front();
+            queue.files.pop_front();
+            return true;
+        }
+    }
+
+    // Then steal from the back of the others, starting with the next worker
+    for (std::size_t i = 1; i < m_queues.size(); ++i) {
+        WorkQueue& victim = *m_queues[(iWorker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.files.empty()) {
+            iFile = victim.files.back();
+            victim.files.pop_back();
+            ++m_iSteals;
+            return true;
+        }
+    }
+
+    // No file is ever added during run(), all the queues are empty
+    return false;
+}
+
+void BatchDecoder::decodeFile(std::size_t iFile, std::size_t iWorker) {
+    FileResult& result = m_results[iFile];
+    result.worker = iWorker;
+
+    std::vector<std::chrono::nanoseconds> decodeTimes;
+    auto startTime = std::chrono::steady_clock::now();
+
+    try {
+        H264Parser parser(result.filename);
+        vw::Decoder decoder(m_device);
+        decoder.setSessionPool(m_pSessionPool);
+        vw::NalUnit nalUnit;
+
+        while (parser.readNextNAL(nalUnit)) {
+            if (nalUnit.getType() != vw::NalType::CodedSliceIDR && nalUnit.getType() != vw::NalType::CodedSliceNonIDR) {
+                continue;
+            }
+
+            auto decodeStartTime = std::chrono::steady_clock::now();
+            decoder.decode(nalUnit);
+            decodeTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodeStartTime));
+
+            ++result.decodedPictures;
+            result.bitstreamBytes += nalUnit.getBitstream().size();
+        }
+    } catch (std::exception& e) {
+        result.error = e.what();
+    }
+
+    result.elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+
+    std::sort(decodeTimes.begin(), decodeTimes.end());
+    result.medianDecodeTime = getPercentile(decodeTimes, 50.0);
+    result.p99DecodeTime = getPercentile(decodeTimes, 99.0);
+    result.maxDecodeTime = decodeTimes.empty() ? std::chrono::nanoseconds(0) : decodeTimes.back();
+}
+
+void BatchDecoder::pinCurrentThread(std::size_t iWorker) {
+    unsigned int iCoreCount = std::max(1u, std::thread::hardware_concurrency());
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(iWorker % iCoreCount, &cpuSet);
+
+    int iError = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (iError != 0) {
+        std::cerr << "[BatchDecoder] Unable to pin the worker " << iWorker << " (error " << iError << ")" << std::endl;
+    }
+}
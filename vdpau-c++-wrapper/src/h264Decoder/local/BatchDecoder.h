@@ -0,0 +1,161 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_BATCH_DECODER_H
+#define LOCAL_BATCH_DECODER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vw {
+    class DecoderSessionPool;
+    class Device;
+}
+
+/**
+ * @brief Decode result of one file of the BatchDecoder
+ */
+struct FileResult {
+    std::string filename;                                                   ///< Path of the bitstream
+    uint64_t decodedPictures = 0;                                           ///< Number of coded slices decoded
+    uint64_t bitstreamBytes = 0;                                            ///< Size of the coded slices sent to the decoder
+    std::size_t worker = 0;                                                 ///< Index of the worker which decoded the file
+    std::chrono::nanoseconds elapsedTime = std::chrono::nanoseconds(0);     ///< Time to parse and decode the whole file
+    std::chrono::nanoseconds medianDecodeTime = std::chrono::nanoseconds(0); ///< 50th percentile of Decoder::decode()
+    std::chrono::nanoseconds p99DecodeTime = std::chrono::nanoseconds(0);   ///< 99th percentile of Decoder::decode()
+    std::chrono::nanoseconds maxDecodeTime = std::chrono::nanoseconds(0);   ///< Longest Decoder::decode()
+    std::string error;                                                      ///< Reason of the failure, empty on success
+};
+
+/**
+ * @brief Aggregate statistics of a BatchDecoder run
+ */
+struct BatchStatistics {
+    std::size_t files = 0;                                                  ///< Number of files processed
+    std::size_t failures = 0;                                               ///< Number of files which failed
+    std::size_t steals = 0;                                                 ///< Files taken from the queue of another worker
+    uint64_t decodedPictures = 0;                                           ///< Number of coded slices decoded
+    uint64_t bitstreamBytes = 0;                                            ///< Size of the coded slices decoded
+    std::chrono::nanoseconds elapsedTime = std::chrono::nanoseconds(0);     ///< Wall time of run()
+    double picturesPerSecond = 0.0;                                         ///< Sustained picture rate
+    double bitstreamMegabytesPerSecond = 0.0;                               ///< Sustained bitstream rate
+    std::chrono::nanoseconds medianFileTime = std::chrono::nanoseconds(0);  ///< 50th percentile of the file durations
+    std::chrono::nanoseconds p99FileTime = std::chrono::nanoseconds(0);     ///< 99th percentile of the file durations
+    std::chrono::nanoseconds maxFileTime = std::chrono::nanoseconds(0);     ///< Longest file duration
+};
+
+/**
+ * @brief BatchDecoder pushes a large set of files through a bounded number of decoder sessions
+ *
+ * Each worker thread is a decoder session: it parses and decodes one file at a time
+ * on the shared Device. The files are dealt to per-worker queues, the largest first.
+ * A worker takes the next file at the front of its own queue and, once it's empty,
+ * steals from the back of the other queues, so the load stays balanced whatever the
+ * file sizes. The parsing runs on the CPU of the worker: the session count defaults
+ * to the number of cores and the workers can be pinned to one core each.
+ */
+class BatchDecoder {
+public:
+    /**
+     * @brief Construct a new BatchDecoder
+     *
+     * @param device The device shared by all the sessions
+     * @param iSessionCount Number of files decoded at the same time
+     */
+    BatchDecoder(vw::Device& device, std::size_t iSessionCount);
+
+    /**
+     * @brief Pin each worker to one core
+     *
+     * The worker i runs on the core i modulo the number of cores.
+     *
+     * @param bEnabled If true, the workers are pinned
+     */
+    void setThreadPinning(bool bEnabled);
+
+    /**
+     * @brief Reuse the decoder sessions of the previous files
+     *
+     * @param pSessionPool The session pool or nullptr to create a decoder per file
+     */
+    void setSessionPool(vw::DecoderSessionPool* pSessionPool);
+
+    /**
+     * @brief Add a bitstream to decode
+     *
+     * The files must be added before run().
+     *
+     * @param filename Filename of the bitstream
+     */
+    void addFile(const std::string& filename);
+
+    /**
+     * @brief Decode all the files
+     *
+     * A failing file is recorded in its result, the batch carries on.
+     */
+    void run();
+
+    /**
+     * @brief Get the result of each file
+     *
+     * @return const std::vector<FileResult>& The results in the order of addFile()
+     */
+    const std::vector<FileResult>& getResults() const;
+
+    /**
+     * @brief Get the aggregate statistics
+     *
+     * @return BatchStatistics The statistics of the last run()
+     */
+    BatchStatistics getStatistics() const;
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> files;
+    };
+
+    void runWorker(std::size_t iWorker);
+    bool takeFile(std::size_t iWorker, std::size_t& iFile);
+    void decodeFile(std::size_t iFile, std::size_t iWorker);
+    void pinCurrentThread(std::size_t iWorker);
+
+private:
+    vw::Device& m_device;
+    std::size_t m_iSessionCount;
+    bool m_bThreadPinning;
+    vw::DecoderSessionPool* m_pSessionPool;
+
+    std::vector<FileResult> m_results;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::atomic<std::size_t> m_iSteals;
+    std::chrono::nanoseconds m_elapsedTime;
+};
+
+#endif // LOCAL_BATCH_DECODER_H
@@ -0,0 +1,243 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GopParallelDecoder.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/Device.h>
+
+#include <h264Parser/H264Parser.h>
+
+GopParallelDecoder::GopParallelDecoder(vw::Device& device, std::size_t iDecoderCount)
+: m_device(device)
+, m_iDecoderCount(iDecoderCount)
+, m_bPictureCopy(false)
+, m_iGopsInFlight(0)
+, m_bEndOfStream(false)
+, m_iNextGop(0) {
+    if (m_iDecoderCount == 0) {
+        throw std::invalid_argument("[GopParallelDecoder] At least one decoder is needed");
+    }
+}
+
+void GopParallelDecoder::setPictureCopy(bool bEnabled) {
+    m_bPictureCopy = bEnabled;
+}
+
+void GopParallelDecoder::setPictureCallback(PictureCallback callback) {
+    m_pictureCallback = std::move(callback);
+}
+
+void GopParallelDecoder::run(const std::string& filename) {
+    H264Parser parser(filename);
+
+    m_statistics = GopStatistics();
+    m_pendingGops.clear();
+    m_decodedGops.clear();
+    m_iGopsInFlight = 0;
+    m_bEndOfStream = false;
+    m_iNextGop = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < m_iDecoderCount; ++i) {
+        workers.emplace_back(&GopParallelDecoder::runWorker, this);
+    }
+
+    // Cut the bitstream at each IDR picture, the slices before the first one can't be decoded.
+    // The other slices of an IDR picture stay in its GOP
+    std::exception_ptr parseError;
+    try {
+        std::unique_ptr<Gop> pGop;
+        std::size_t iGopCount = 0;
+        vw::NalUnit nalUnit;
+        while (parser.readNextNAL(nalUnit)) {
+            bool bFirstSlice = nalUnit.getH264Infos().bFirstSliceOfPicture;
+            if (nalUnit.getType() == vw::NalType::CodedSliceIDR && bFirstSlice) {
+                if (pGop != nullptr) {
+                    pushGop(std::move(pGop));
+                }
+
+                pGop = std::make_unique<Gop>();
+                pGop->index = iGopCount++;
+            } else if (nalUnit.getType() != vw::NalType::CodedSliceIDR && nalUnit.getType() != vw::NalType::CodedSliceNonIDR) {
+                continue;
+            }
+
+            if (pGop == nullptr) {
+                if (bFirstSlice) {
+                    ++m_statistics.droppedPictures;
+                }
+                continue;
+            }
+
+            pGop->slices.push_back(nalUnit);
+        }
+
+        if (pGop != nullptr) {
+            pushGop(std::move(pGop));
+        }
+    } catch (...) {
+        // The workers finish the GOPs already parsed before the error is thrown
+        parseError = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_bEndOfStream = true;
+    }
+    m_queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (parseError) {
+        std::rethrow_exception(parseError);
+    }
+
+    m_statistics.elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+    double elapsedSeconds = std::chrono::duration<double>(m_statistics.elapsedTime).count();
+    if (elapsedSeconds > 0.0) {
+        m_statistics.picturesPerSecond = m_statistics.decodedPictures / elapsedSeconds;
+    }
+}
+
+const GopStatistics& GopParallelDecoder::getStatistics() const {
+    return m_statistics;
+}
+
+vw::ImageBufferPoolStatistics GopParallelDecoder::getImagePoolStatistics() const {
+    return m_imagePool.getStatistics();
+}
+
+void GopParallelDecoder::runWorker() {
+    vw::Decoder decoder(m_device);
+
+    while (true) {
+        std::unique_ptr<Gop> pGop;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this] {
+                return !m_pendingGops.empty() || m_bEndOfStream;
+            });
+
+            if (m_pendingGops.empty()) {
+                return;
+            }
+
+            pGop = std::move(m_pendingGops.front());
+            m_pendingGops.pop_front();
+        }
+
+        // A failed GOP is merged empty, the following ones aren't blocked
+        std::vector<OutputPicture> pictures;
+        std::string error;
+        try {
+            pictures = decodeGop(decoder, *pGop);
+        } catch (std::exception& e) {
+            pictures.clear();
+            error = e.what();
+        }
+
+        mergeGop(pGop->index, std::move(pictures), error);
+    }
+}
+
+std::vector<OutputPicture> GopParallelDecoder::decodeGop(vw::Decoder& decoder, const Gop& gop) {
+    std::vector<OutputPicture> pictures;
+
+    // The first slice is an IDR: the decoder drops the references of its previous GOP
+    for (const auto& slice : gop.slices) {
+        vw::DecodedSurface& surface = decoder.decode(slice);
+
+        OutputPicture picture;
+        picture.gop = gop.index;
+        picture.pictureOrderCount = surface.getPictureOrderCount();
+        picture.presentationTimeStamp = surface.getPresentationTimeStamp();
+        if (m_bPictureCopy) {
+            picture.image = surface.copyHardwareMemory(m_imagePool);
+        }
+
+        pictures.push_back(std::move(picture));
+    }
+
+    // The POC restarts at the IDR, its order is the display order of the GOP
+    std::stable_sort(pictures.begin(), pictures.end(), [](const OutputPicture& lhs, const OutputPicture& rhs) {
+        return lhs.pictureOrderCount < rhs.pictureOrderCount;
+    });
+
+    return pictures;
+}
+
+void GopParallelDecoder::pushGop(std::unique_ptr<Gop> pGop) {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+
+    // Don't parse too far ahead of the merge
+    std::size_t iMaxGopsInFlight = 2 * m_iDecoderCount;
+    m_queueCondition.wait(lock, [this, iMaxGopsInFlight] {
+        return m_iGopsInFlight < iMaxGopsInFlight;
+    });
+
+    ++m_iGopsInFlight;
+    m_pendingGops.push_back(std::move(pGop));
+    m_queueCondition.notify_all();
+}
+
+void GopParallelDecoder::mergeGop(std::size_t iGop, std::vector<OutputPicture> pictures, const std::string& error) {
+    std::lock_guard<std::mutex> lock(m_mergeMutex);
+
+    ++m_statistics.gops;
+    m_statistics.decodedPictures += pictures.size();
+    if (!error.empty()) {
+        ++m_statistics.failedGops;
+        m_statistics.errors.push_back("GOP #" + std::to_string(iGop) + ": " + error);
+    }
+
+    m_decodedGops.emplace(iGop, std::move(pictures));
+    m_statistics.maxPendingGops = std::max(m_statistics.maxPendingGops, m_decodedGops.size() - 1);
+
+    // Deliver the GOPs completed in file order
+    while (!m_decodedGops.empty() && m_decodedGops.begin()->first == m_iNextGop) {
+        if (m_pictureCallback) {
+            for (auto& picture : m_decodedGops.begin()->second) {
+                m_pictureCallback(picture);
+            }
+        }
+
+        m_decodedGops.erase(m_decodedGops.begin());
+        ++m_iNextGop;
+
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueMutex);
+            --m_iGopsInFlight;
+        }
+        m_queueCondition.notify_all();
+    }
+}
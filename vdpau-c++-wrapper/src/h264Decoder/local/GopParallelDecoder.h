@@ -0,0 +1,172 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_GOP_PARALLEL_DECODER_H
+#define LOCAL_GOP_PARALLEL_DECODER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vdpau/vdpau.h>
+
+#include <VdpWrapper/ImageBuffer.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/NalUnit.h>
+
+namespace vw {
+    class Decoder;
+    class Device;
+}
+
+/**
+ * @brief A decoded picture delivered by the GopParallelDecoder
+ */
+struct OutputPicture {
+    std::size_t gop = 0;                        ///< Index of the GOP in the file
+    int pictureOrderCount = 0;                  ///< POC of the picture, relative to the IDR of its GOP
+    VdpTime presentationTimeStamp = 0;          ///< PTS in nanoseconds or NoTimestamp if unknown
+    vw::ImageFrame image;                       ///< YUV picture copied from the GPU memory, empty if the copy is disabled
+};
+
+/**
+ * @brief Statistics of a GopParallelDecoder run
+ */
+struct GopStatistics {
+    std::size_t gops = 0;                                               ///< Number of GOPs decoded
+    std::size_t failedGops = 0;                                         ///< Number of GOPs whose decoding failed
+    std::size_t maxPendingGops = 0;                                     ///< Highest number of decoded GOPs waiting for a previous one
+    uint64_t decodedPictures = 0;                                       ///< Number of coded slices decoded
+    uint64_t droppedPictures = 0;                                       ///< Coded pictures before the first IDR, they can't be decoded
+    std::chrono::nanoseconds elapsedTime = std::chrono::nanoseconds(0); ///< Wall time of run()
+    double picturesPerSecond = 0.0;                                     ///< Sustained picture rate
+    std::vector<std::string> errors;                                    ///< Reason of each GOP failure
+};
+
+/**
+ * @brief GopParallelDecoder decodes a single bitstream with several Decoder instances
+ *
+ * An IDR resets the decoded picture buffer, so the closed GOPs are independent. The
+ * calling thread parses the file and cuts it at each IDR, then the GOPs are decoded
+ * in parallel by a pool of decoders sharing the Device. The decoded GOPs are merged
+ * back in file order, and the pictures of a GOP in POC order, hence the pictures are
+ * delivered in display order.
+ *
+ * The number of GOPs parsed ahead of the merge is bounded, which bounds the memory
+ * used by the coded and the copied pictures.
+ */
+class GopParallelDecoder {
+public:
+    /**
+     * @brief Callback receiving the pictures in display order
+     *
+     * The calls are serialized, but not made from a fixed thread.
+     */
+    using PictureCallback = std::function<void(OutputPicture& picture)>;
+
+    /**
+     * @brief Construct a new GopParallelDecoder
+     *
+     * @param device The device shared by all the decoders
+     * @param iDecoderCount Number of GOPs decoded at the same time
+     */
+    GopParallelDecoder(vw::Device& device, std::size_t iDecoderCount);
+
+    /**
+     * @brief Copy the pictures from the GPU memory
+     *
+     * A decoded surface is reused by its decoder for the next pictures, so the
+     * pixels are only available to the callback when they are copied. The copies
+     * are recycled through an ImageBufferPool once the callback drops them.
+     *
+     * @param bEnabled If true, OutputPicture::image is filled
+     */
+    void setPictureCopy(bool bEnabled);
+
+    /**
+     * @brief Set the callback receiving the pictures
+     *
+     * @param callback The callback, or an empty function to drop the pictures
+     */
+    void setPictureCallback(PictureCallback callback);
+
+    /**
+     * @brief Decode the whole bitstream
+     *
+     * @param filename Filename of the bitstream
+     */
+    void run(const std::string& filename);
+
+    /**
+     * @brief Get the statistics of the last run()
+     *
+     * @return const GopStatistics& The statistics
+     */
+    const GopStatistics& getStatistics() const;
+
+    /**
+     * @brief Get the statistics of the pool holding the picture copies
+     *
+     * @return vw::ImageBufferPoolStatistics The pool statistics
+     */
+    vw::ImageBufferPoolStatistics getImagePoolStatistics() const;
+
+private:
+    struct Gop {
+        std::size_t index = 0;
+        std::vector<vw::NalUnit> slices;
+    };
+
+    void runWorker();
+    std::vector<OutputPicture> decodeGop(vw::Decoder& decoder, const Gop& gop);
+    void pushGop(std::unique_ptr<Gop> pGop);
+    void mergeGop(std::size_t iGop, std::vector<OutputPicture> pictures, const std::string& error);
+
+private:
+    vw::Device& m_device;
+    std::size_t m_iDecoderCount;
+    bool m_bPictureCopy;
+    vw::ImageBufferPool m_imagePool;
+    PictureCallback m_pictureCallback;
+    GopStatistics m_statistics;
+
+    // Parsed GOPs waiting for a decoder, protected by m_queueMutex
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<std::unique_ptr<Gop>> m_pendingGops;
+    std::size_t m_iGopsInFlight;
+    bool m_bEndOfStream;
+
+    // Decoded GOPs waiting for the previous ones, protected by m_mergeMutex
+    std::mutex m_mergeMutex;
+    std::map<std::size_t, std::vector<OutputPicture>> m_decodedGops;
+    std::size_t m_iNextGop;
+};
+
+#endif // LOCAL_GOP_PARALLEL_DECODER_H
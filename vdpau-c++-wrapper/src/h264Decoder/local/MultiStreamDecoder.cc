@@ -0,0 +1,227 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MultiStreamDecoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/Device.h>
+
+#include <h264Parser/H264Parser.h>
+
+MultiStreamDecoder::MultiStreamDecoder(vw::Device& device, std::size_t iSurfaceBudget, std::size_t iWorkerCount)
+: m_device(device)
+, m_iSurfaceBudget(iSurfaceBudget)
+, m_iWorkerCount(iWorkerCount)
+, m_iUnfinishedStreams(0)
+, m_iReservedSurfaces(0)
+, m_iPeakReservedSurfaces(0) {
+    if (m_iWorkerCount == 0) {
+        throw std::invalid_argument("[MultiStreamDecoder] At least one worker is needed");
+    }
+}
+
+MultiStreamDecoder::~MultiStreamDecoder() = default;
+
+std::size_t MultiStreamDecoder::addStream(const std::string& filename) {
+    auto pStream = std::make_unique<Stream>();
+    pStream->filename = filename;
+
+    // An unreadable bitstream is a failed stream, it's never scheduled
+    try {
+        pStream->pParser = std::make_unique<H264Parser>(filename);
+        pStream->pDecoder = std::make_unique<vw::Decoder>(m_device);
+    } catch (std::exception& e) {
+        pStream->pParser.reset();
+        pStream->statistics.error = e.what();
+    }
+
+    m_streams.push_back(std::move(pStream));
+    return m_streams.size() - 1;
+}
+
+void MultiStreamDecoder::setPictureCallback(PictureCallback callback) {
+    m_pictureCallback = std::move(callback);
+}
+
+void MultiStreamDecoder::run() {
+    {
+        std::lock_guard<std::mutex> lock(m_schedulerMutex);
+        m_readyStreams.clear();
+        m_deferredStreams.clear();
+        for (std::size_t i = 0; i < m_streams.size(); ++i) {
+            if (m_streams[i]->pParser != nullptr) {
+                m_readyStreams.push_back(i);
+            }
+        }
+        m_iUnfinishedStreams = m_readyStreams.size();
+        m_iReservedSurfaces = 0;
+        m_iPeakReservedSurfaces = 0;
+    }
+
+    m_startTime = std::chrono::steady_clock::now();
+
+    // The calling thread is the last worker
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < m_iWorkerCount; ++i) {
+        workers.emplace_back(&MultiStreamDecoder::runWorker, this);
+    }
+    runWorker();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t MultiStreamDecoder::getStreamCount() const {
+    return m_streams.size();
+}
+
+const StreamStatistics& MultiStreamDecoder::getStatistics(std::size_t iStream) const {
+    return m_streams.at(iStream)->statistics;
+}
+
+std::size_t MultiStreamDecoder::getPeakReservedSurfaces() const {
+    return m_iPeakReservedSurfaces;
+}
+
+void MultiStreamDecoder::runWorker() {
+    std::unique_lock<std::mutex> lock(m_schedulerMutex);
+
+    while (true) {
+        m_schedulerCondition.wait(lock, [this] {
+            return !m_readyStreams.empty() || m_iUnfinishedStreams == 0;
+        });
+
+        if (m_readyStreams.empty()) {
+            return;
+        }
+
+        std::size_t iStream = m_readyStreams.front();
+        m_readyStreams.pop_front();
+
+        // A stream is held by only one worker at a time, its decoder isn't shared
+        lock.unlock();
+        StepResult result = decodeNextPicture(iStream);
+        if (result == StepResult::Finished) {
+            finishStream(iStream);
+        }
+        lock.lock();
+
+        // Back to the end of the queue: one slice per stream and per turn
+        if (result == StepResult::Decoded) {
+            m_readyStreams.push_back(iStream);
+            m_schedulerCondition.notify_one();
+        }
+    }
+}
+
+MultiStreamDecoder::StepResult MultiStreamDecoder::decodeNextPicture(std::size_t iStream) {
+    Stream& stream = *m_streams[iStream];
+
+    try {
+        while (stream.bPendingNal || stream.pParser->readNextNAL(stream.nalUnit)) {
+            stream.bPendingNal = false;
+
+            if (stream.nalUnit.getType() != vw::NalType::CodedSliceIDR && stream.nalUnit.getType() != vw::NalType::CodedSliceNonIDR) {
+                continue;
+            }
+
+            // The decoded picture buffer allocates its surfaces on the first slice
+            if (stream.statistics.reservedSurfaces == 0) {
+                std::size_t iSurfaces = stream.nalUnit.getH264Infos().num_ref_frames + 1;
+                if (iSurfaces > m_iSurfaceBudget) {
+                    throw std::runtime_error("[MultiStreamDecoder] The stream needs " + std::to_string(iSurfaces)
+                        + " surfaces, more than the budget of " + std::to_string(m_iSurfaceBudget));
+                }
+
+                // Once deferred, the stream may be resumed by another worker
+                stream.bPendingNal = true;
+                if (!reserveSurfacesOrDefer(iStream, iSurfaces)) {
+                    return StepResult::Deferred;
+                }
+                stream.bPendingNal = false;
+            }
+
+            auto startTime = std::chrono::steady_clock::now();
+            const vw::DecodedSurface& surface = stream.pDecoder->decode(stream.nalUnit);
+            auto decodeTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+
+            ++stream.statistics.decodedPictures;
+            stream.statistics.bitstreamBytes += stream.nalUnit.getBitstream().size();
+            stream.statistics.decodeTime += decodeTime;
+            stream.statistics.maxDecodeTime = std::max(stream.statistics.maxDecodeTime, decodeTime);
+
+            if (m_pictureCallback) {
+                m_pictureCallback(iStream, surface);
+            }
+
+            return StepResult::Decoded;
+        }
+    } catch (std::exception& e) {
+        stream.statistics.error = e.what();
+    }
+
+    return StepResult::Finished;
+}
+
+bool MultiStreamDecoder::reserveSurfacesOrDefer(std::size_t iStream, std::size_t iSurfaces) {
+    std::lock_guard<std::mutex> lock(m_schedulerMutex);
+
+    // Deferring under the same lock than the check, a release can't be missed
+    if (m_iReservedSurfaces + iSurfaces > m_iSurfaceBudget) {
+        ++m_streams[iStream]->statistics.deferrals;
+        m_deferredStreams.push_back(iStream);
+        return false;
+    }
+
+    m_streams[iStream]->statistics.reservedSurfaces = iSurfaces;
+    m_iReservedSurfaces += iSurfaces;
+    m_iPeakReservedSurfaces = std::max(m_iPeakReservedSurfaces, m_iReservedSurfaces);
+
+    return true;
+}
+
+void MultiStreamDecoder::finishStream(std::size_t iStream) {
+    Stream& stream = *m_streams[iStream];
+
+    // Free the surfaces before giving them back to the budget
+    stream.pDecoder.reset();
+    stream.pParser.reset();
+    stream.statistics.elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime);
+
+    std::lock_guard<std::mutex> lock(m_schedulerMutex);
+    m_iReservedSurfaces -= stream.statistics.reservedSurfaces;
+    --m_iUnfinishedStreams;
+
+    // The deferred streams retry in arrival order
+    while (!m_deferredStreams.empty()) {
+        m_readyStreams.push_back(m_deferredStreams.front());
+        m_deferredStreams.pop_front();
+    }
+
+    m_schedulerCondition.notify_all();
+}
@@ -0,0 +1,185 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_MULTI_STREAM_DECODER_H
+#define LOCAL_MULTI_STREAM_DECODER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <VdpWrapper/NalUnit.h>
+
+class H264Parser;
+
+namespace vw {
+    class Decoder;
+    class DecodedSurface;
+    class Device;
+}
+
+/**
+ * @brief Decode statistics of one stream of the MultiStreamDecoder
+ */
+struct StreamStatistics {
+    uint64_t decodedPictures = 0;                                       ///< Number of coded slices decoded
+    uint64_t bitstreamBytes = 0;                                        ///< Size of the coded slices sent to the decoder
+    uint64_t deferrals = 0;                                             ///< Times the stream waited for the surface budget
+    std::size_t reservedSurfaces = 0;                                   ///< Surfaces reserved in the budget by the stream
+    std::chrono::nanoseconds decodeTime = std::chrono::nanoseconds(0);  ///< Sum of the Decoder::decode() durations
+    std::chrono::nanoseconds maxDecodeTime = std::chrono::nanoseconds(0); ///< Longest Decoder::decode() duration
+    std::chrono::nanoseconds elapsedTime = std::chrono::nanoseconds(0); ///< Time from the start of run() to the end of the stream
+    std::string error;                                                  ///< Reason of the failure, empty if the stream was fully decoded
+};
+
+/**
+ * @brief MultiStreamDecoder decodes several bitstreams on a shared Device
+ *
+ * Each stream owns its H264Parser and Decoder (hence its DecodedPictureBuffer),
+ * while the VDPAU device is shared. A round-robin scheduler gives each stream
+ * one coded slice per turn: a long or high bitrate stream cannot starve the others.
+ *
+ * The surfaces of the decoded picture buffers are counted in a global budget. A
+ * stream reserves num_ref_frames + 1 surfaces when its first slice is parsed, and
+ * waits while the budget can't hold them. The reservation is given back at the end
+ * of the stream and the waiting streams are admitted in arrival order.
+ */
+class MultiStreamDecoder {
+public:
+    /**
+     * @brief Callback receiving each decoded picture
+     *
+     * It's called from the worker thread which decoded the picture. The surface is
+     * only valid during the call.
+     */
+    using PictureCallback = std::function<void(std::size_t iStream, const vw::DecodedSurface& surface)>;
+
+    /**
+     * @brief Construct a new MultiStreamDecoder
+     *
+     * @param device The device shared by all the streams
+     * @param iSurfaceBudget Maximal number of decoded surfaces allocated at the same time
+     * @param iWorkerCount Number of threads driving the decoders
+     */
+    MultiStreamDecoder(vw::Device& device, std::size_t iSurfaceBudget, std::size_t iWorkerCount = 1);
+    ~MultiStreamDecoder();
+
+    MultiStreamDecoder(const MultiStreamDecoder&) = delete;
+    MultiStreamDecoder(MultiStreamDecoder&&) = delete;
+
+    MultiStreamDecoder& operator=(const MultiStreamDecoder&) = delete;
+    MultiStreamDecoder& operator=(MultiStreamDecoder&&) = delete;
+
+    /**
+     * @brief Add a bitstream to decode
+     *
+     * The streams must be added before run(). If the bitstream can't be read, the
+     * stream is kept as failed in the statistics.
+     *
+     * @param filename Filename of the bitstream
+     * @return std::size_t The index of the stream
+     */
+    std::size_t addStream(const std::string& filename);
+
+    /**
+     * @brief Set the callback receiving the decoded pictures
+     *
+     * @param callback The callback, or an empty function to drop the pictures
+     */
+    void setPictureCallback(PictureCallback callback);
+
+    /**
+     * @brief Decode all the streams until their end
+     *
+     * A failing stream is stopped and its error recorded in its statistics, the
+     * other streams carry on.
+     */
+    void run();
+
+    /**
+     * @brief Get the number of streams
+     *
+     * @return std::size_t The number of streams added
+     */
+    std::size_t getStreamCount() const;
+
+    /**
+     * @brief Get the statistics of a stream
+     *
+     * @param iStream The index of the stream
+     * @return const StreamStatistics& The statistics, complete after run()
+     */
+    const StreamStatistics& getStatistics(std::size_t iStream) const;
+
+    /**
+     * @brief Get the peak of reserved surfaces during run()
+     *
+     * @return std::size_t The highest number of surfaces reserved at the same time
+     */
+    std::size_t getPeakReservedSurfaces() const;
+
+private:
+    enum class StepResult {
+        Decoded,    ///< A slice has been decoded, the stream goes back in the ready queue
+        Deferred,   ///< The surface budget is exhausted, the stream waits for a release
+        Finished,   ///< End of the bitstream or error
+    };
+
+    struct Stream {
+        std::string filename;
+        std::unique_ptr<H264Parser> pParser;
+        std::unique_ptr<vw::Decoder> pDecoder;
+        vw::NalUnit nalUnit;
+        bool bPendingNal = false;
+        StreamStatistics statistics;
+    };
+
+    void runWorker();
+    StepResult decodeNextPicture(std::size_t iStream);
+    bool reserveSurfacesOrDefer(std::size_t iStream, std::size_t iSurfaces);
+    void finishStream(std::size_t iStream);
+
+private:
+    vw::Device& m_device;
+    std::size_t m_iSurfaceBudget;
+    std::size_t m_iWorkerCount;
+    PictureCallback m_pictureCallback;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    // Scheduler state, protected by m_schedulerMutex
+    std::mutex m_schedulerMutex;
+    std::condition_variable m_schedulerCondition;
+    std::deque<std::size_t> m_readyStreams;
+    std::deque<std::size_t> m_deferredStreams;
+    std::size_t m_iUnfinishedStreams;
+    std::size_t m_iReservedSurfaces;
+    std::size_t m_iPeakReservedSurfaces;
+};
+
+#endif // LOCAL_MULTI_STREAM_DECODER_H
@@ -0,0 +1,458 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <VdpWrapper/Backend.h>
+#include <VdpWrapper/CpuBackend.h>
+#include <VdpWrapper/DecoderSessionPool.h>
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/MockBackend.h>
+
+#ifdef VW_ENABLE_COROUTINES
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/Executor.h>
+#include <VdpWrapper/NalUnit.h>
+
+#include <h264Parser/H264Parser.h>
+#endif
+
+#include "local/BatchDecoder.h"
+#include "local/GopParallelDecoder.h"
+#include "local/MultiStreamDecoder.h"
+
+namespace {
+    void printUsage(const std::string& commandName, const std::string& message) {
+        std::cerr << message << std::endl;
+        std::cerr << "Usage:" << std::endl;
+        std::cerr << "\t" << commandName << " [OPTION...] BITSTREAM_FILE..." << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "\t--backend <x11|cpu|mock>\t\tSet the VDPAU backend" << std::endl;
+        std::cerr << "\t--workers <COUNT>\t\t\tSet the number of threads driving the decoders" << std::endl;
+        std::cerr << "\t--surface-budget <COUNT>\t\tLimit the number of decoded surfaces allocated at the same time" << std::endl;
+        std::cerr << "\t--copies <COUNT>\t\t\tDecode COUNT streams of each bitstream file" << std::endl;
+        std::cerr << "\t--batch\t\t\t\t\tDecode the files one after the other on each worker" << std::endl;
+        std::cerr << "\t--file-list <FILE>\t\t\tRead the bitstream files from FILE, one path per line" << std::endl;
+        std::cerr << "\t--pin-threads\t\t\t\tPin each worker to one core in batch mode" << std::endl;
+        std::cerr << "\t--session-pool <MIB>\t\t\tKeep up to MIB MiB of warm decoder sessions in batch mode" << std::endl;
+        std::cerr << "\t--gop-parallel\t\t\t\tDecode the GOPs of a single file in parallel" << std::endl;
+        std::cerr << "\t--copy-yuv\t\t\t\tCopy the YUV pictures from the GPU memory in GOP-parallel mode" << std::endl;
+#ifdef VW_ENABLE_COROUTINES
+        std::cerr << "\t--async\t\t\t\t\tDecode each stream in a coroutine sharing the worker threads" << std::endl;
+#endif
+    }
+
+    bool parseCount(const std::string& szValue, std::size_t& iCount) {
+        try {
+            long long iValue = std::stoll(szValue);
+            if (iValue <= 0) {
+                return false;
+            }
+            iCount = static_cast<std::size_t>(iValue);
+        } catch (std::logic_error &e) {
+            return false;
+        }
+
+        return true;
+    }
+
+    double toMilliseconds(std::chrono::nanoseconds duration) {
+        return static_cast<double>(duration.count()) / 1000000.0;
+    }
+
+    int runMultiStream(vw::Device& device, const std::vector<std::string>& files, std::size_t iWorkerCount, std::size_t iSurfaceBudget) {
+        MultiStreamDecoder decoder(device, iSurfaceBudget, iWorkerCount);
+        for (const auto& filename : files) {
+            decoder.addStream(filename);
+        }
+
+        std::cout << "[main] Decode " << decoder.getStreamCount() << " streams with " << iWorkerCount << " workers" << std::endl;
+
+        auto startTime = std::chrono::steady_clock::now();
+        decoder.run();
+        auto elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+
+        uint64_t totalPictures = 0;
+        std::size_t iFailures = 0;
+        for (std::size_t i = 0; i < decoder.getStreamCount(); ++i) {
+            const auto& statistics = decoder.getStatistics(i);
+            totalPictures += statistics.decodedPictures;
+
+            std::cout << "[main] Stream #" << i << ": pictures = " << statistics.decodedPictures
+                << " ; bitstream = " << statistics.bitstreamBytes / 1024 << " KiB"
+                << " ; surfaces = " << statistics.reservedSurfaces
+                << " ; deferrals = " << statistics.deferrals;
+            if (statistics.decodedPictures > 0) {
+                std::cout << " ; decode mean = " << toMilliseconds(statistics.decodeTime) / statistics.decodedPictures << " ms"
+                    << " ; decode max = " << toMilliseconds(statistics.maxDecodeTime) << " ms";
+            }
+            std::cout << " ; finished at " << toMilliseconds(statistics.elapsedTime) << " ms" << std::endl;
+
+            if (!statistics.error.empty()) {
+                std::cout << "[main] Stream #" << i << " failed: " << statistics.error << std::endl;
+                ++iFailures;
+            }
+        }
+
+        double elapsedSeconds = toMilliseconds(elapsedTime) / 1000.0;
+        std::cout << "[main] " << totalPictures << " pictures in " << elapsedSeconds << " s"
+            << " ; " << (elapsedSeconds > 0.0 ? totalPictures / elapsedSeconds : 0.0) << " pictures/s"
+            << " ; peak surfaces = " << decoder.getPeakReservedSurfaces()
+            << " ; failures = " << iFailures << std::endl;
+
+        return iFailures == 0 ? 0 : 1;
+    }
+
+    int runBatch(vw::Device& device, const std::vector<std::string>& files, std::size_t iWorkerCount, bool bThreadPinning, std::size_t iSessionPoolBudget) {
+        BatchDecoder decoder(device, iWorkerCount);
+        decoder.setThreadPinning(bThreadPinning);
+
+        std::unique_ptr<vw::DecoderSessionPool> pSessionPool;
+        if (iSessionPoolBudget > 0) {
+            pSessionPool = std::make_unique<vw::DecoderSessionPool>(device, iSessionPoolBudget);
+            decoder.setSessionPool(pSessionPool.get());
+        }
+        for (const auto& filename : files) {
+            decoder.addFile(filename);
+        }
+
+        std::cout << "[main] Decode " << files.size() << " files with " << iWorkerCount << " sessions" << std::endl;
+        decoder.run();
+
+        for (const auto& result : decoder.getResults()) {
+            if (!result.error.empty()) {
+                std::cout << "[main] " << result.filename << " failed: " << result.error << std::endl;
+                continue;
+            }
+
+            std::cout << "[main] " << result.filename << ": pictures = " << result.decodedPictures
+                << " ; time = " << toMilliseconds(result.elapsedTime) << " ms"
+                << " ; decode p50 = " << toMilliseconds(result.medianDecodeTime) << " ms"
+                << " ; p99 = " << toMilliseconds(result.p99DecodeTime) << " ms"
+                << " ; max = " << toMilliseconds(result.maxDecodeTime) << " ms"
+                << " ; worker = " << result.worker << std::endl;
+        }
+
+        auto statistics = decoder.getStatistics();
+        std::cout << "[main] " << statistics.files << " files in " << toMilliseconds(statistics.elapsedTime) / 1000.0 << " s"
+            << " ; " << statistics.picturesPerSecond << " pictures/s"
+            << " ; " << statistics.bitstreamMegabytesPerSecond << " MB/s"
+            << " ; file time p50 = " << toMilliseconds(statistics.medianFileTime) << " ms"
+            << " ; p99 = " << toMilliseconds(statistics.p99FileTime) << " ms"
+            << " ; max = " << toMilliseconds(statistics.maxFileTime) << " ms"
+            << " ; steals = " << statistics.steals
+            << " ; failures = " << statistics.failures << std::endl;
+
+        if (pSessionPool != nullptr) {
+            auto poolStatistics = pSessionPool->getStatistics();
+            std::cout << "[main] Session pool: hits = " << poolStatistics.hits
+                << " ; misses = " << poolStatistics.misses
+                << " ; evictions = " << poolStatistics.evictions
+                << " ; kept = " << poolStatistics.availableSessions
+                << " (" << poolStatistics.memoryUsage / (1024 * 1024) << " MiB)" << std::endl;
+        }
+
+        return statistics.failures == 0 ? 0 : 1;
+    }
+
+#ifdef VW_ENABLE_COROUTINES
+    struct AsyncStreamStatistics {
+        uint64_t decodedPictures = 0;
+        uint64_t bitstreamBytes = 0;
+    };
+
+    vw::Task<void> decodeStream(vw::Executor& executor, vw::Device& device, std::string filename, AsyncStreamStatistics& statistics) {
+        H264Parser parser(filename);
+        vw::Decoder decoder(device);
+        vw::NalUnit nalUnit;
+
+        // Each decode goes back through the executor queue, so the streams take turns
+        while (parser.readNextNAL(nalUnit)) {
+            if (nalUnit.getType() != vw::NalType::CodedSliceIDR && nalUnit.getType() != vw::NalType::CodedSliceNonIDR) {
+                continue;
+            }
+
+            co_await vw::decodeAsync(executor, decoder, nalUnit);
+            ++statistics.decodedPictures;
+            statistics.bitstreamBytes += nalUnit.getBitstream().size();
+        }
+    }
+
+    int runAsync(vw::Device& device, const std::vector<std::string>& files, std::size_t iWorkerCount) {
+        std::vector<AsyncStreamStatistics> statistics(files.size());
+        vw::Executor executor(iWorkerCount);
+
+        std::cout << "[main] Decode " << files.size() << " stream tasks on " << iWorkerCount << " threads" << std::endl;
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            executor.spawn(decodeStream(executor, device, files[i], statistics[i]));
+        }
+
+        int iResult = 0;
+        try {
+            executor.waitIdle();
+        } catch (std::exception& e) {
+            std::cout << "[main] A stream failed: " << e.what() << std::endl;
+            iResult = 1;
+        }
+        auto elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+
+        uint64_t totalPictures = 0;
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            totalPictures += statistics[i].decodedPictures;
+            std::cout << "[main] Stream #" << i << ": pictures = " << statistics[i].decodedPictures
+                << " ; bitstream = " << statistics[i].bitstreamBytes / 1024 << " KiB" << std::endl;
+        }
+
+        double elapsedSeconds = toMilliseconds(elapsedTime) / 1000.0;
+        std::cout << "[main] " << totalPictures << " pictures in " << elapsedSeconds << " s"
+            << " ; " << (elapsedSeconds > 0.0 ? totalPictures / elapsedSeconds : 0.0) << " pictures/s" << std::endl;
+
+        return iResult;
+    }
+#endif
+
+    int runGopParallel(vw::Device& device, const std::string& filename, std::size_t iWorkerCount, bool bCopyYUV) {
+        GopParallelDecoder decoder(device, iWorkerCount);
+        decoder.setPictureCopy(bCopyYUV);
+
+        // Check the merge: the GOPs must come in file order and their pictures in POC order
+        std::size_t iOrderErrors = 0;
+        bool bFirstPicture = true;
+        std::size_t iLastGop = 0;
+        int iLastPOC = 0;
+        decoder.setPictureCallback([&](OutputPicture& picture) {
+            if (!bFirstPicture && (picture.gop < iLastGop || (picture.gop == iLastGop && picture.pictureOrderCount < iLastPOC))) {
+                ++iOrderErrors;
+            }
+
+            bFirstPicture = false;
+            iLastGop = picture.gop;
+            iLastPOC = picture.pictureOrderCount;
+        });
+
+        std::cout << "[main] Decode the GOPs of " << filename << " with " << iWorkerCount << " decoders" << std::endl;
+        decoder.run(filename);
+
+        const auto& statistics = decoder.getStatistics();
+        for (const auto& error : statistics.errors) {
+            std::cout << "[main] " << error << std::endl;
+        }
+
+        std::cout << "[main] " << statistics.decodedPictures << " pictures in " << statistics.gops << " GOPs"
+            << " ; " << toMilliseconds(statistics.elapsedTime) / 1000.0 << " s"
+            << " ; " << statistics.picturesPerSecond << " pictures/s"
+            << " ; dropped before the first IDR = " << statistics.droppedPictures
+            << " ; max GOPs waiting for merge = " << statistics.maxPendingGops
+            << " ; out of order = " << iOrderErrors
+            << " ; failed GOPs = " << statistics.failedGops << std::endl;
+
+        if (bCopyYUV) {
+            auto poolStatistics = decoder.getImagePoolStatistics();
+            std::cout << "[main] Image pool: buffers = " << poolStatistics.allocatedBuffers
+                << " ; peak used = " << poolStatistics.peakUsedBuffers
+                << " ; allocations = " << poolStatistics.allocations
+                << " ; memory = " << poolStatistics.allocatedBytes / (1024 * 1024) << " MiB" << std::endl;
+        }
+
+        return statistics.failedGops == 0 && iOrderErrors == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iCurrentArg = 1;
+    std::string szBackend = "x11";
+    std::size_t iWorkerCount = 0;
+    std::size_t iSurfaceBudget = std::numeric_limits<std::size_t>::max();
+    std::size_t iCopies = 1;
+    bool bBatch = false;
+    bool bThreadPinning = false;
+    bool bGopParallel = false;
+    bool bCopyYUV = false;
+    bool bAsync = false;
+    std::size_t iSessionPoolBudget = 0;
+    std::vector<std::string> files;
+
+    while (iCurrentArg < argc && std::string(argv[iCurrentArg]).rfind("--", 0) == 0) {
+        std::string szArg = std::string(argv[iCurrentArg]);
+        if (szArg == "--batch") {
+            bBatch = true;
+            ++iCurrentArg;
+            continue;
+        } else if (szArg == "--pin-threads") {
+            bThreadPinning = true;
+            ++iCurrentArg;
+            continue;
+        } else if (szArg == "--gop-parallel") {
+            bGopParallel = true;
+            ++iCurrentArg;
+            continue;
+        } else if (szArg == "--copy-yuv") {
+            bCopyYUV = true;
+            ++iCurrentArg;
+            continue;
+#ifdef VW_ENABLE_COROUTINES
+        } else if (szArg == "--async") {
+            bAsync = true;
+            ++iCurrentArg;
+            continue;
+#endif
+        }
+
+        if (iCurrentArg >= argc - 1) {
+            printUsage(argv[0], "Missing value for '" + szArg + "'");
+            return 1;
+        }
+
+        std::string szValue = std::string(argv[iCurrentArg + 1]);
+        if (szArg == "--backend") {
+            szBackend = szValue;
+            if (szBackend != "x11" && szBackend != "cpu" && szBackend != "mock") {
+                printUsage(argv[0], "Wrong backend value");
+                return 1;
+            }
+        } else if (szArg == "--workers") {
+            if (!parseCount(szValue, iWorkerCount)) {
+                printUsage(argv[0], "Wrong worker count");
+                return 1;
+            }
+        } else if (szArg == "--surface-budget") {
+            if (!parseCount(szValue, iSurfaceBudget)) {
+                printUsage(argv[0], "Wrong surface budget");
+                return 1;
+            }
+        } else if (szArg == "--copies") {
+            if (!parseCount(szValue, iCopies)) {
+                printUsage(argv[0], "Wrong copy count");
+                return 1;
+            }
+        } else if (szArg == "--session-pool") {
+            if (!parseCount(szValue, iSessionPoolBudget)) {
+                printUsage(argv[0], "Wrong session pool budget");
+                return 1;
+            }
+            iSessionPoolBudget *= 1024 * 1024;
+        } else if (szArg == "--file-list") {
+            std::ifstream fileList(szValue);
+            if (!fileList) {
+                printUsage(argv[0], "Unable to read the file list");
+                return 1;
+            }
+
+            std::string szLine;
+            while (std::getline(fileList, szLine)) {
+                if (!szLine.empty()) {
+                    files.push_back(szLine);
+                }
+            }
+        } else {
+            printUsage(argv[0], "'" + szArg + "' unknown option");
+            return 1;
+        }
+
+        iCurrentArg += 2;
+    }
+
+    for (; iCurrentArg < argc; ++iCurrentArg) {
+        files.push_back(argv[iCurrentArg]);
+    }
+
+    if (files.empty()) {
+        printUsage(argv[0], "Missing parameter");
+        return 1;
+    }
+
+    if ((bBatch || bGopParallel) && iSurfaceBudget != std::numeric_limits<std::size_t>::max()) {
+        printUsage(argv[0], "The surface budget only applies to the multi-stream mode");
+        return 1;
+    }
+
+    if (bBatch + bGopParallel + bAsync > 1) {
+        printUsage(argv[0], "The batch, GOP-parallel and async modes are exclusive");
+        return 1;
+    }
+
+    if (bAsync && iSurfaceBudget != std::numeric_limits<std::size_t>::max()) {
+        printUsage(argv[0], "The surface budget only applies to the multi-stream mode");
+        return 1;
+    }
+
+    if (bGopParallel && (files.size() != 1 || iCopies != 1)) {
+        printUsage(argv[0], "The GOP-parallel mode decodes a single file");
+        return 1;
+    }
+
+    if (iSessionPoolBudget > 0 && !bBatch) {
+        printUsage(argv[0], "The session pool only applies to the batch mode");
+        return 1;
+    }
+
+    if (bCopyYUV && !bGopParallel) {
+        printUsage(argv[0], "The YUV copy only applies to the GOP-parallel mode");
+        return 1;
+    }
+
+    // One decoder per core in batch and GOP-parallel modes
+    if (iWorkerCount == 0) {
+        iWorkerCount = (bBatch || bGopParallel) ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    }
+
+    std::vector<std::string> copies;
+    for (const auto& filename : files) {
+        copies.insert(copies.end(), iCopies, filename);
+    }
+
+    // All the streams share a single device, the X11 backend doesn't need any window
+    std::unique_ptr<vw::Backend> pBackend;
+    if (szBackend == "cpu") {
+        pBackend = std::make_unique<vw::CpuBackend>();
+    } else if (szBackend == "mock") {
+        pBackend = std::make_unique<vw::MockBackend>(vw::MockLatencyModel());
+    } else {
+        pBackend = std::make_unique<vw::X11Backend>(std::string());
+    }
+
+    vw::Device device(*pBackend);
+    if (bGopParallel) {
+        return runGopParallel(device, files.front(), iWorkerCount, bCopyYUV);
+    }
+
+#ifdef VW_ENABLE_COROUTINES
+    if (bAsync) {
+        return runAsync(device, copies, iWorkerCount);
+    }
+#endif
+
+    if (bBatch) {
+        return runBatch(device, copies, iWorkerCount, bThreadPinning, iSessionPoolBudget);
+    }
+
+    return runMultiStream(device, copies, iWorkerCount, iSurfaceBudget);
+}
@@ -19,14 +19,16 @@
  * SOFTWARE.
  */
 
-#include "H264Parser.h"
+#include <h264Parser/H264Parser.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iterator>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
 namespace {
     // Default scaling_lists according to Table 7-2
@@ -65,17 +67,29 @@ namespace {
         22,24,25,27,28,30,32,33,
         24,25,27,28,30,32,33,35
     };
+
+    // Longest read ahead to find the POC step, in NAL units
+    const std::size_t MaxPocStepLookahead = 256;
+
+    bool isSlice(vw::NalType nalType) {
+        return nalType == vw::NalType::CodedSliceIDR || nalType == vw::NalType::CodedSliceNonIDR;
+    }
 }
 
 H264Parser::H264Parser(const std::string& filename)
 : m_h264Stream(h264_new())
 , m_pDataCursor(nullptr)
 , m_unprocessedDataSize(0)
+, m_decodeMode(vw::DecodeMode::AllPictures)
 , m_prevPicOrderCntMsb(0)
 , m_prevPicOrderCntLsb(0)
 , m_prevFrameNumOffset(0)
 , m_prevFrameNum(0)
-, m_iPrevMMCO(0) {
+, m_iPrevMMCO(0)
+, m_bTimingInfoPresent(false)
+, m_iPocStep(0)
+, m_sequenceStartPts(0)
+, m_streamEndPts(0) {
     // Set the scaling lists to Flat_4x4_16 and Flat_8x8_16
     for (int i = 0; i < 6; ++i) {
         for (int j = 0; j < 16; ++j) {
@@ -107,6 +121,73 @@ H264Parser::~H264Parser() {
 }
 
 bool H264Parser::readNextNAL(vw::NalUnit &nalUnit) {
+    // The NAL units read ahead to find the POC step are returned first
+    if (m_pendingNalUnits.empty()) {
+        vw::NalUnit nextNalUnit;
+        if (!parseNextNAL(nextNalUnit)) {
+            return false;
+        }
+
+        m_pendingNalUnits.push_back({ std::move(nextNalUnit), {} });
+        if (m_iPocStep == 0 && m_bTimingInfoPresent && isSlice(m_pendingNalUnits.front().nalUnit.getType())) {
+            detectPocStep();
+        }
+    }
+
+    // The pictures discarded while reading ahead are reported after the unit preceding them
+    auto& pendingNalUnit = m_pendingNalUnits.front();
+    nalUnit = std::move(pendingNalUnit.nalUnit);
+    m_discardedPictures.insert(m_discardedPictures.end(), pendingNalUnit.discardedPictures.begin(), pendingNalUnit.discardedPictures.end());
+    m_pendingNalUnits.pop_front();
+
+    return true;
+}
+
+bool H264Parser::parseNextNAL(vw::NalUnit &nalUnit) {
+    for (;;) {
+        int iNalStart = 0;
+        int iNalEnd = 0;
+
+        if (find_nal_unit(m_pDataCursor, m_unprocessedDataSize, &iNalStart, &iNalEnd) <= 0) {
+            return false;
+        }
+
+        // Keep the begin of NAL
+        // We need to keep the start code for VDPAU API.
+        // Without the start code, the VDPAU decoder cannot
+        // decode properly the bitstream and the surface is empty (filled in black)
+        uint8_t* nalUnitStartData = m_pDataCursor;
+
+        // Process the NAL unit and update the h264 context
+        m_pDataCursor += iNalStart;
+        read_nal_unit(m_h264Stream, m_pDataCursor, iNalEnd - iNalStart);
+        updateH264Infos();
+
+        // Skip to next NAL
+        m_pDataCursor += (iNalEnd - iNalStart);
+        m_unprocessedDataSize -= iNalEnd;
+
+        // Drop the pictures not selected by the trick-play mode before any copy
+        auto nalType = static_cast<vw::NalType>(m_h264Stream->nal->nal_unit_type);
+        if ((nalType == vw::NalType::CodedSliceIDR || nalType == vw::NalType::CodedSliceNonIDR)
+            && !vw::isPictureSelected(m_h264Infos, nalType, m_decodeMode)) {
+            // A picture is reported once whatever its number of slices
+            if (m_h264Infos.bFirstSliceOfPicture) {
+                int iPOC = m_h264Infos.bottom_field_flag ? m_h264Infos.field_order_cnt[1] : m_h264Infos.field_order_cnt[0];
+                m_discardedPictures.push_back(iPOC);
+            }
+            continue;
+        }
+
+        // Copy NAL data
+        std::vector<uint8_t> nalData(nalUnitStartData, nalUnitStartData + iNalEnd);
+        nalUnit = vw::NalUnit(m_h264Infos, nalType, nalData);
+
+        return true;
+    }
+}
+
+bool H264Parser::peekNextNalType(vw::NalType &nalType) const {
     int iNalStart = 0;
     int iNalEnd = 0;
 
@@ -114,26 +195,16 @@ bool H264Parser::readNextNAL(vw::NalUnit &nalUnit) {
         return false;
     }
 
-    // Keep the begin of NAL
-    // We need to keep the start code for VDPAU API.
-    // Without the start code, the VDPAU decoder cannot
-    // decode properly the bitstream and the surface is empty (filled in black)
-    uint8_t* nalUnitStartData = m_pDataCursor;
-
-    // Process the NAL unit and update the h264 context
-    m_pDataCursor += iNalStart;
-    read_nal_unit(m_h264Stream, m_pDataCursor, iNalEnd - iNalStart);
-    updateH264Infos();
-
-    // Copy NAL data
-    std::vector<uint8_t> nalData(nalUnitStartData, nalUnitStartData + iNalEnd);
-    nalUnit = vw::NalUnit(m_h264Infos, static_cast<vw::NalType>(m_h264Stream->nal->nal_unit_type), nalData);
+    nalType = static_cast<vw::NalType>(m_pDataCursor[iNalStart] & 0x1F);
+    return true;
+}
 
-    // Skip to next NAL
-    m_pDataCursor += (iNalEnd - iNalStart);
-    m_unprocessedDataSize -= iNalEnd;
+void H264Parser::setDecodeMode(vw::DecodeMode mode) {
+    m_decodeMode = mode;
+}
 
-    return true;
+std::vector<int> H264Parser::takeDiscardedPictures() {
+    return std::exchange(m_discardedPictures, {});
 }
 
 void H264Parser::updateH264Infos() {
@@ -204,6 +275,7 @@ void H264Parser::updateH264Infos() {
         m_h264Infos.bFirstSPSReceived = true;
         m_h264Infos.iProfile = m_h264Stream->sps->profile_idc;
         computePicutreSize();
+        updateTimingInfos();
         break;
     }
 
@@ -278,6 +350,8 @@ void H264Parser::updateH264Infos() {
         default:
             break;
         }
+        m_h264Infos.sliceType = sliceType;
+        m_h264Infos.bFirstSliceOfPicture = (m_h264Stream->sh->first_mb_in_slice == 0);
 
         if (m_h264Stream->sh->drpm.long_term_reference_flag) {
             throw std::runtime_error("[H264Parser] Long term reference no handled");
@@ -311,6 +385,7 @@ void H264Parser::updateH264Infos() {
         m_h264Infos.bottom_field_flag = m_h264Stream->sh->bottom_field_flag;
         m_h264Infos.slice_count = 1; // We send always 1 slice
         computePoc();
+        m_h264Infos.presentationTimeStamp = computePts(m_h264Infos, nalType);
         break;
     }
 
@@ -320,6 +395,108 @@ void H264Parser::updateH264Infos() {
     }
 }
 
+void H264Parser::updateTimingInfos() {
+    const auto& vui = m_h264Stream->sps->vui;
+    bool bVuiPresent = m_h264Stream->sps->vui_parameters_present_flag;
+
+    // The time_scale counts the ticks of a clock and two ticks make a frame (cf. Annex E.2.1)
+    m_bTimingInfoPresent = bVuiPresent && vui.timing_info_present_flag && vui.num_units_in_tick != 0 && vui.time_scale != 0;
+    if (m_bTimingInfoPresent) {
+        m_fieldRate = vw::Framerate(vui.time_scale, vui.num_units_in_tick);
+        std::cout << "[H264Parser] VUI timing: " << m_fieldRate.toDouble() / 2.0 << " fps" << std::endl;
+    }
+
+    // Size of the reorder window needed to output the pictures in presentation order
+    if (bVuiPresent && vui.bitstream_restriction_flag) {
+        m_h264Infos.iReorderDepth = vui.num_reorder_frames;
+    } else if (m_h264Infos.iProfile == 66) {
+        // Baseline profile has no B slices
+        m_h264Infos.iReorderDepth = 0;
+    } else {
+        m_h264Infos.iReorderDepth = m_h264Stream->sps->num_ref_frames;
+    }
+}
+
+void H264Parser::detectPocStep() {
+    // Most encoders increase the POC by 2 for each frame but some use a step of 1.
+    // A frame with an odd POC can only be found in the second case, it's looked for
+    // in the first GOP so all the pictures get their time stamps with the same step
+    int iPocStep = 2;
+    bool bNonIdrFound = false;
+
+    for (;;) {
+        const vw::NalUnit& nalUnit = m_pendingNalUnits.back().nalUnit;
+        const vw::H264Infos& h264Infos = nalUnit.getH264Infos();
+        if (isSlice(nalUnit.getType())) {
+            bNonIdrFound |= (nalUnit.getType() == vw::NalType::CodedSliceNonIDR);
+            if (!h264Infos.field_pic_flag && h264Infos.field_order_cnt[0] % 2 != 0) {
+                iPocStep = 1;
+                break;
+            }
+        }
+
+        // The GOP ends at the next IDR picture or sequence parameters
+        vw::NalType nextNalType;
+        if (m_pendingNalUnits.size() >= MaxPocStepLookahead || !peekNextNalType(nextNalType)
+            || nextNalType == vw::NalType::SPS || (nextNalType == vw::NalType::CodedSliceIDR && bNonIdrFound)) {
+            break;
+        }
+
+        // The pictures discarded from now on follow the last unit read ahead
+        std::size_t iDiscardedCount = m_discardedPictures.size();
+        vw::NalUnit nextNalUnit;
+        bool bParsed = parseNextNAL(nextNalUnit);
+
+        auto& discardedPictures = m_pendingNalUnits.back().discardedPictures;
+        discardedPictures.insert(discardedPictures.end(), m_discardedPictures.begin() + iDiscardedCount, m_discardedPictures.end());
+        m_discardedPictures.resize(iDiscardedCount);
+
+        if (!bParsed) {
+            break;
+        }
+        m_pendingNalUnits.push_back({ std::move(nextNalUnit), {} });
+    }
+
+    if (iPocStep == 1) {
+        std::cout << "[H264Parser] POC step of 1 detected" << std::endl;
+    }
+    m_iPocStep = iPocStep;
+
+    // The time stamps of the pictures read ahead can now be computed
+    for (auto& pendingNalUnit: m_pendingNalUnits) {
+        vw::NalUnit& nalUnit = pendingNalUnit.nalUnit;
+        if (isSlice(nalUnit.getType())) {
+            vw::H264Infos h264Infos = nalUnit.getH264Infos();
+            h264Infos.presentationTimeStamp = computePts(h264Infos, nalUnit.getType());
+            nalUnit = vw::NalUnit(h264Infos, nalUnit.getType(), nalUnit.getBitstream());
+        }
+    }
+}
+
+VdpTime H264Parser::computePts(const vw::H264Infos& h264Infos, vw::NalType nalType) {
+    // Without POC step, the time stamp is computed by detectPocStep()
+    if (!m_bTimingInfoPresent || m_iPocStep == 0) {
+        return vw::NoTimestamp;
+    }
+
+    // A new sequence follows the last picture of the previous one
+    if (nalType == vw::NalType::CodedSliceIDR) {
+        m_sequenceStartPts = m_streamEndPts;
+    }
+
+    int iPOC = h264Infos.bottom_field_flag ? h264Infos.field_order_cnt[1] : h264Infos.field_order_cnt[0];
+    iPOC = std::max(iPOC, 0);
+
+    // One POC unit is a field period when the step is 2
+    uint64_t iFieldIndex = static_cast<uint64_t>(iPOC) * 2 / m_iPocStep;
+    VdpTime presentationTimeStamp = m_sequenceStartPts + m_fieldRate.getFrameTime(iFieldIndex);
+
+    uint64_t iFieldCount = h264Infos.field_pic_flag ? 1 : 2;
+    m_streamEndPts = std::max<VdpTime>(m_streamEndPts, m_sequenceStartPts + m_fieldRate.getFrameTime(iFieldIndex + iFieldCount));
+
+    return presentationTimeStamp;
+}
+
 int H264Parser::computeSubWidthC() const {
     switch (m_h264Stream->sps->chroma_format_idc) {
     case 0: // monochrome
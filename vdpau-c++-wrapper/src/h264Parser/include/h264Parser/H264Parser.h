@@ -19,14 +19,16 @@
  * SOFTWARE.
  */
 
-#ifndef LOCAL_H264_PARSER_H
-#define LOCAL_H264_PARSER_H
+#ifndef H264_PARSER_H
+#define H264_PARSER_H
 
+#include <deque>
 #include <string>
 #include <vector>
 
 #include <h264_stream.h>
 
+#include <VdpWrapper/Framerate.h>
 #include <VdpWrapper/NalUnit.h>
 
 /**
@@ -52,7 +54,9 @@ public:
      * @brief Read the next NAL unit and update H264 informations
      *
      * The parser keeps the H264 informations to be able to
-     * update the vw::NalUnit object.
+     * update the vw::NalUnit object. The first picture with timing
+     * informations makes the parser read its GOP ahead, to know the
+     * POC step before computing any presentation time stamp.
      *
      * @param nalUnit A NAL unit filled by the bitstream informations
      * @return true If a NAL unit has been parsed
@@ -60,7 +64,38 @@ public:
      */
     bool readNextNAL(vw::NalUnit &nalUnit);
 
+    /**
+     * @brief Set the decode mode used to filter the coded slices
+     *
+     * The slices not selected by the mode are discarded at parse time:
+     * only their header is read to keep the POC computation right, then
+     * readNextNAL() skips to the next NAL unit without copying them.
+     *
+     * @param mode The decode mode
+     */
+    void setDecodeMode(vw::DecodeMode mode);
+
+    /**
+     * @brief Get the Picture Order Counts of the discarded pictures
+     *
+     * A picture is reported once, on its first slice. The pictures are reported
+     * after the NAL unit preceding them in the bitstream has been read. The list
+     * is cleared after the call.
+     *
+     * @return std::vector<int> The POCs of pictures discarded since the last call
+     */
+    std::vector<int> takeDiscardedPictures();
+
+private:
+    // NAL unit read ahead, with the pictures discarded after it in parse order
+    struct PendingNalUnit {
+        vw::NalUnit nalUnit;
+        std::vector<int> discardedPictures;
+    };
+
 private:
+    bool parseNextNAL(vw::NalUnit &nalUnit);
+    bool peekNextNalType(vw::NalType &nalType) const;
     void updateH264Infos();
     int computeSubWidthC() const;
     int computeSubHeightC() const;
@@ -71,6 +106,10 @@ private:
     void computePocType1();
     void computePocType2();
 
+    void updateTimingInfos();
+    void detectPocStep();
+    VdpTime computePts(const vw::H264Infos& h264Infos, vw::NalType nalType);
+
 private:
     h264_stream_t* m_h264Stream;
     vw::H264Infos m_h264Infos;
@@ -78,12 +117,24 @@ private:
     uint8_t* m_pDataCursor;
     int m_unprocessedDataSize;
 
+    // Trick-play
+    vw::DecodeMode m_decodeMode;
+    std::vector<int> m_discardedPictures;
+
     // Picture Order Count
     int m_prevPicOrderCntMsb;
     int m_prevPicOrderCntLsb;
     int m_prevFrameNumOffset;
     int m_prevFrameNum;
     int m_iPrevMMCO;
+
+    // Presentation Time Stamp
+    bool m_bTimingInfoPresent;
+    vw::Framerate m_fieldRate;
+    int m_iPocStep;
+    VdpTime m_sequenceStartPts;
+    VdpTime m_streamEndPts;
+    std::deque<PendingNalUnit> m_pendingNalUnits;
 };
 
-#endif // LOCAL_H264_PARSER_H
+#endif // H264_PARSER_H
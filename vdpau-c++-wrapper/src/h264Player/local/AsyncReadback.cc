@@ -0,0 +1,146 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AsyncReadback.h"
+
+#include <utility>
+
+namespace {
+    // Releases the pin taken by submit() whatever happens to the copy
+    class SurfacePin {
+    public:
+        explicit SurfacePin(vw::DecodedSurface* pSurface)
+        : m_pSurface(pSurface) {
+        }
+
+        ~SurfacePin() {
+            release();
+        }
+
+        SurfacePin(const SurfacePin&) = delete;
+        SurfacePin& operator=(const SurfacePin&) = delete;
+
+        void release() {
+            if (m_pSurface != nullptr) {
+                m_pSurface->unpin();
+                m_pSurface = nullptr;
+            }
+        }
+
+    private:
+        vw::DecodedSurface* m_pSurface;
+    };
+}
+
+AsyncReadback::AsyncReadback(vw::ImageBufferPool& pool, std::size_t iDepth)
+: m_pool(pool)
+, m_frameFormat(vw::PixelFormat::NV12)
+, m_statistics{0, 0, {}, {}, 0}
+, m_queue(iDepth, 1, [this](Job& job) {
+    readBack(job);
+}) {
+}
+
+AsyncReadback::~AsyncReadback() {
+    m_queue.stop();
+}
+
+void AsyncReadback::setFrameHandler(vw::PixelFormat format, FrameHandler handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frameFormat = format;
+    m_frameHandler = std::move(handler);
+}
+
+void AsyncReadback::submit(vw::DecodedSurface& surface) {
+    surface.pin();
+    m_queue.push({ &surface, std::nullopt });
+}
+
+void AsyncReadback::submit(vw::RenderSurface surface) {
+    m_queue.push({ nullptr, std::move(surface) });
+}
+
+std::optional<vw::RenderSurface> AsyncReadback::takeCompletedSurface() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_completedSurfaces.empty()) {
+        return std::nullopt;
+    }
+
+    vw::RenderSurface surface = std::move(m_completedSurfaces.front());
+    m_completedSurfaces.pop_front();
+
+    return surface;
+}
+
+void AsyncReadback::flush() {
+    m_queue.flush();
+}
+
+std::string AsyncReadback::getError() const {
+    return m_queue.getError();
+}
+
+ReadbackStatistics AsyncReadback::getStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ReadbackStatistics statistics = m_statistics;
+    statistics.stalls = m_queue.getStatistics().stalls;
+
+    return statistics;
+}
+
+void AsyncReadback::readBack(Job& job) {
+    // A failed copy or handler is reported by getError(), the surface is unpinned anyway
+    SurfacePin surfacePin(job.pDecodedSurface);
+
+    // Without handler, the copy is dropped right away and its buffer goes back to the pool
+    vw::ImageFrame frame;
+    vw::SizeU frameSize;
+    int iPictureOrderCount = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    if (job.pDecodedSurface != nullptr) {
+        frame = job.pDecodedSurface->copyHardwareMemory(m_pool, m_frameFormat);
+        frameSize = job.pDecodedSurface->getSize();
+        iPictureOrderCount = job.pDecodedSurface->getPictureOrderCount();
+    } else {
+        job.renderSurface->copyHardwareMemory(m_pool);
+    }
+    auto elapsedTime = std::chrono::steady_clock::now() - startTime;
+
+    if (job.pDecodedSurface != nullptr) {
+        surfacePin.release();
+
+        if (m_frameHandler) {
+            m_frameHandler(std::move(frame), frameSize, iPictureOrderCount);
+        }
+    }
+    frame.reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (job.pDecodedSurface != nullptr) {
+        ++m_statistics.decodedSurfaces;
+        m_statistics.decodedSurfaceTime += elapsedTime;
+    } else {
+        ++m_statistics.renderSurfaces;
+        m_statistics.renderSurfaceTime += elapsedTime;
+        m_completedSurfaces.push_back(std::move(*job.renderSurface));
+    }
+}
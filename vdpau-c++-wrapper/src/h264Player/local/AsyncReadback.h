@@ -0,0 +1,169 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_ASYNC_READBACK_H
+#define LOCAL_ASYNC_READBACK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/RenderSurface.h>
+#include <VdpWrapper/WorkerQueue.h>
+
+/**
+ * @brief Statistics of the AsyncReadback worker
+ */
+struct ReadbackStatistics {
+    uint64_t decodedSurfaces;                   ///< Number of YUV readbacks
+    uint64_t renderSurfaces;                    ///< Number of BGRA readbacks
+    std::chrono::nanoseconds decodedSurfaceTime;///< Total time of the YUV readbacks
+    std::chrono::nanoseconds renderSurfaceTime; ///< Total time of the BGRA readbacks
+    uint64_t stalls;                            ///< Number of submissions which waited for a free slot
+};
+
+/**
+ * @brief AsyncReadback copies the surfaces to the CPU memory on a worker thread
+ *
+ * The GPU readback blocks until the surface is ready then copies the whole
+ * picture, so it doesn't belong to the decode loop. The surfaces are queued
+ * to a worker thread which reads them back into buffers of an ImageBufferPool
+ * while the decode loop moves on.
+ *
+ * At most depth surfaces are waiting or being read back, submit() blocks
+ * when all the slots are used. A decoded surface is pinned until its copy
+ * is done, so the decoder doesn't write the next picture in it. A render
+ * surface is owned by the worker during the copy, then it's handed back
+ * through takeCompletedSurface() to be displayed.
+ */
+class AsyncReadback {
+public:
+    /**
+     * @brief Callback receiving the copy of a decoded surface
+     *
+     * The callback is called on the worker thread with the copy, the visible
+     * size and the picture order count of the surface.
+     */
+    using FrameHandler = std::function<void(vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount)>;
+
+    /**
+     * @brief Start the readback worker
+     *
+     * @param pool The pool providing the copies, it must outlive the AsyncReadback
+     * @param iDepth Maximum number of pending readbacks (2 for double buffering)
+     */
+    AsyncReadback(vw::ImageBufferPool& pool, std::size_t iDepth = 2);
+    /**
+     * @brief Finish the pending readbacks and stop the worker
+     */
+    ~AsyncReadback();
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback(AsyncReadback&&) = delete;
+
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(AsyncReadback&&) = delete;
+
+    /**
+     * @brief Hand the decoded surface copies to a callback instead of dropping them
+     *
+     * Must be called before the first submit(). A blocking callback stalls the
+     * worker, then submit() once all the slots are used.
+     *
+     * @param format The format of the copies (NV12, I420 or YUYV)
+     * @param handler The callback receiving the copies
+     */
+    void setFrameHandler(vw::PixelFormat format, FrameHandler handler);
+
+    /**
+     * @brief Queue the readback of a decoded surface
+     *
+     * The surface is pinned until the copy is done.
+     *
+     * @param surface The decoded surface
+     */
+    void submit(vw::DecodedSurface& surface);
+
+    /**
+     * @brief Queue the readback of a render surface
+     *
+     * @param surface The render surface, given back by takeCompletedSurface()
+     */
+    void submit(vw::RenderSurface surface);
+
+    /**
+     * @brief Get a render surface whose readback is done
+     *
+     * The surfaces are returned in submission order.
+     *
+     * @return std::optional<vw::RenderSurface> The surface, or nothing if none is ready
+     */
+    std::optional<vw::RenderSurface> takeCompletedSurface();
+
+    /**
+     * @brief Wait for all the pending readbacks
+     */
+    void flush();
+
+    /**
+     * @brief Get the first error of the worker
+     *
+     * A failed readback or frame handler doesn't stop the worker, the surface
+     * is released and the following jobs are still processed.
+     *
+     * @return std::string The error message, empty if all the readbacks succeeded
+     */
+    std::string getError() const;
+
+    /**
+     * @brief Get the statistics of the worker
+     *
+     * @return ReadbackStatistics The readback counters
+     */
+    ReadbackStatistics getStatistics() const;
+
+private:
+    struct Job {
+        vw::DecodedSurface* pDecodedSurface;
+        std::optional<vw::RenderSurface> renderSurface;
+    };
+
+    void readBack(Job& job);
+
+private:
+    vw::ImageBufferPool& m_pool;
+    vw::PixelFormat m_frameFormat;
+    FrameHandler m_frameHandler;
+
+    mutable std::mutex m_mutex;
+    std::deque<vw::RenderSurface> m_completedSurfaces;
+    ReadbackStatistics m_statistics;
+    vw::WorkerQueue<Job> m_queue;
+};
+
+#endif // LOCAL_ASYNC_READBACK_H
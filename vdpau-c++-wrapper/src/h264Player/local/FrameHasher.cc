@@ -0,0 +1,125 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FrameHasher.h"
+
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+FrameHasher::FrameHasher(const std::string& szLogFile, vw::ChecksumAlgorithm algorithm, vw::Framerate framerate, std::size_t iQueueDepth)
+: m_algorithm(algorithm)
+, m_framerate(framerate)
+, m_log(szLogFile, std::ios::out | std::ios::trunc)
+, m_iWrittenChecksums(0)
+, m_statistics{0, 0, {}, 0}
+, m_queue(iQueueDepth, 1, [this](Frame& frame) {
+    hash(frame);
+}) {
+    if (!m_log.is_open()) {
+        throw std::runtime_error("[FrameHasher] Couldn't open '" + szLogFile + "'");
+    }
+
+    if (!m_framerate.isValid()) {
+        throw std::runtime_error("[FrameHasher] The framerate must be valid");
+    }
+}
+
+FrameHasher::~FrameHasher() {
+    flush();
+    m_queue.stop();
+}
+
+void FrameHasher::setReorderDepth(int iReorderDepth) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reorderChecksums.setReorderDepth(iReorderDepth);
+}
+
+void FrameHasher::submit(vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount) {
+    // Backpressure: the decoder can't get more than depth frames ahead of the worker
+    m_queue.push({ std::move(frame), size, iPictureOrderCount });
+}
+
+void FrameHasher::flush() {
+    m_queue.flush();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reorderChecksums.flush([this](Checksum checksum) {
+        writeChecksum(checksum);
+    });
+
+    m_log.flush();
+}
+
+HasherStatistics FrameHasher::getStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    HasherStatistics statistics = m_statistics;
+    statistics.stalls = m_queue.getStatistics().stalls;
+
+    return statistics;
+}
+
+void FrameHasher::hash(Frame& frame) {
+    auto startTime = std::chrono::steady_clock::now();
+    Checksum checksum = {
+        vw::computeFrameChecksum(*frame.image, frame.size, m_algorithm),
+        frame.size,
+        vw::ImageBuffer::getPackedSize(frame.image->getFormat(), frame.size),
+        frame.iPictureOrderCount,
+    };
+    auto elapsedTime = std::chrono::steady_clock::now() - startTime;
+
+    // The buffer goes back to the pool before waiting for the lock
+    frame.image.reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.frames;
+    m_statistics.bytes += checksum.frameSize;
+    m_statistics.hashTime += elapsedTime;
+    int iPictureOrderCount = checksum.iPictureOrderCount;
+    m_reorderChecksums.push(iPictureOrderCount, std::move(checksum), [this](Checksum reorderedChecksum) {
+        writeChecksum(reorderedChecksum);
+    });
+}
+
+void FrameHasher::writeChecksum(const Checksum& checksum) {
+    // Same header as the ffmpeg framehash muxer (version 2)
+    if (m_iWrittenChecksums == 0) {
+        m_log << "#format: frame checksums" << std::endl;
+        m_log << "#version: 2" << std::endl;
+        m_log << "#hash: " << vw::getChecksumName(m_algorithm) << std::endl;
+        m_log << "#tb 0: " << m_framerate.denominator << "/" << m_framerate.numerator << std::endl;
+        m_log << "#media_type 0: video" << std::endl;
+        m_log << "#codec_id 0: rawvideo" << std::endl;
+        m_log << "#dimensions 0: " << checksum.size.width << "x" << checksum.size.height << std::endl;
+        m_log << "#sar 0: 1/1" << std::endl;
+        m_log << "#stream#, dts,        pts, duration,     size, hash" << std::endl;
+    }
+
+    // One frame per time base unit: the timestamps are the frame index
+    m_log << "0, " << std::setw(10) << m_iWrittenChecksums
+        << ", " << std::setw(10) << m_iWrittenChecksums
+        << ", " << std::setw(8) << 1
+        << ", " << std::setw(8) << checksum.frameSize
+        << ", " << checksum.szValue << "\n";
+
+    ++m_iWrittenChecksums;
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_FRAME_HASHER_H
+#define LOCAL_FRAME_HASHER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include <VdpWrapper/FrameChecksum.h>
+#include <VdpWrapper/Framerate.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/PresentationOrderBuffer.h>
+#include <VdpWrapper/Size.h>
+#include <VdpWrapper/WorkerQueue.h>
+
+/**
+ * @brief Statistics of the FrameHasher worker
+ */
+struct HasherStatistics {
+    uint64_t frames;                    ///< Number of hashed frames
+    uint64_t bytes;                     ///< Number of hashed bytes
+    std::chrono::nanoseconds hashTime;  ///< Total time spent hashing
+    uint64_t stalls;                    ///< Number of submit() calls which waited for a free slot
+};
+
+/**
+ * @brief FrameHasher writes a checksum of each decoded frame to a log
+ *
+ * The frames are hashed on a worker thread, then the checksums are written
+ * in presentation order with the layout of the ffmpeg framemd5 muxer, so a
+ * MD5 log can be compared to the output of:
+ * ffmpeg -i <bitstream> -f framemd5 -pix_fmt yuv420p <log>
+ */
+class FrameHasher {
+public:
+    /**
+     * @brief Create the log and start the worker
+     *
+     * @param szLogFile The checksum log file
+     * @param algorithm The checksum algorithm
+     * @param framerate The framerate, the log time base is its inverse
+     * @param iQueueDepth Maximum number of frames waiting for the worker
+     */
+    FrameHasher(const std::string& szLogFile, vw::ChecksumAlgorithm algorithm, vw::Framerate framerate, std::size_t iQueueDepth = 8);
+    /**
+     * @brief Hash the remaining frames and close the log
+     */
+    ~FrameHasher();
+
+    FrameHasher(const FrameHasher&) = delete;
+    FrameHasher(FrameHasher&&) = delete;
+
+    FrameHasher& operator=(const FrameHasher&) = delete;
+    FrameHasher& operator=(FrameHasher&&) = delete;
+
+    /**
+     * @brief Set the number of checksums kept to restore the presentation order
+     *
+     * @param iReorderDepth The reorder depth of the stream
+     */
+    void setReorderDepth(int iReorderDepth);
+
+    /**
+     * @brief Queue a decoded frame
+     *
+     * A picture order count of 0 starts a new sequence.
+     *
+     * @param frame The frame read back from the GPU
+     * @param size The visible size of the frame
+     * @param iPictureOrderCount The picture order count of the frame
+     */
+    void submit(vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount);
+
+    /**
+     * @brief Hash the pending frames and write all the checksums
+     */
+    void flush();
+
+    /**
+     * @brief Get the worker statistics
+     *
+     * @return HasherStatistics The counters
+     */
+    HasherStatistics getStatistics() const;
+
+private:
+    struct Frame {
+        vw::ImageFrame image;
+        vw::SizeU size;
+        int iPictureOrderCount;
+    };
+
+    struct Checksum {
+        std::string szValue;
+        vw::SizeU size;
+        std::size_t frameSize;
+        int iPictureOrderCount;
+    };
+
+    void hash(Frame& frame);
+    void writeChecksum(const Checksum& checksum);
+
+private:
+    vw::ChecksumAlgorithm m_algorithm;
+    vw::Framerate m_framerate;
+    std::ofstream m_log;
+
+    mutable std::mutex m_mutex;
+    vw::PresentationOrderBuffer<Checksum> m_reorderChecksums;
+    uint64_t m_iWrittenChecksums;
+    HasherStatistics m_statistics;
+    vw::WorkerQueue<Frame> m_queue;
+};
+
+#endif // LOCAL_FRAME_HASHER_H
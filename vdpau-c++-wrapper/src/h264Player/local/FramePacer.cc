@@ -0,0 +1,113 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+FramePacer::FramePacer(vw::Framerate framerate, TimeSource timeSource, std::chrono::nanoseconds spinDuration)
+: m_framerate(framerate)
+, m_timeSource(std::move(timeSource))
+, m_spinDuration(spinDuration)
+, m_bStarted(false)
+, m_originTime(0)
+, m_iFrameIndex(0)
+, m_frames(0)
+, m_lateFrames(0)
+, m_resyncs(0)
+, m_minJitter(std::numeric_limits<int64_t>::max())
+, m_maxJitter(std::numeric_limits<int64_t>::min())
+, m_jitterSum(0.0)
+, m_jitterSquareSum(0.0) {
+    if (!m_framerate.isValid()) {
+        throw std::runtime_error("[FramePacer] The framerate must be positive");
+    }
+}
+
+void FramePacer::waitNextFrame() {
+    VdpTime currentTime = m_timeSource();
+
+    // The first frame starts the timeline
+    if (!m_bStarted) {
+        m_originTime = currentTime;
+        m_iFrameIndex = 0;
+        m_bStarted = true;
+    }
+
+    ++m_iFrameIndex;
+    VdpTime deadline = m_originTime + m_framerate.getFrameTime(m_iFrameIndex);
+
+    if (currentTime >= deadline) {
+        ++m_lateFrames;
+        recordJitter(static_cast<int64_t>(currentTime - deadline));
+
+        // Too late: restart the timeline instead of catching up with a burst
+        if (currentTime - deadline > m_framerate.getFrameDuration()) {
+            m_originTime = currentTime;
+            m_iFrameIndex = 0;
+            ++m_resyncs;
+        }
+        return;
+    }
+
+    // Convert the deadline to the system clock to be able to sleep
+    auto steadyDeadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(deadline - currentTime);
+
+    // Sleep until a short delay before the deadline then spin
+    // since the scheduler wake-up latency is too large
+    std::this_thread::sleep_until(steadyDeadline - m_spinDuration);
+    while (std::chrono::steady_clock::now() < steadyDeadline) {
+        // Busy wait
+    }
+
+    VdpTime wakeUpTime = m_timeSource();
+    recordJitter(static_cast<int64_t>(wakeUpTime) - static_cast<int64_t>(deadline));
+}
+
+PacerStatistics FramePacer::getStatistics() const {
+    PacerStatistics statistics = {m_frames, m_lateFrames, m_resyncs, {}, {}, {}, {}};
+    if (m_frames == 0) {
+        return statistics;
+    }
+
+    double mean = m_jitterSum / m_frames;
+    double variance = std::max(m_jitterSquareSum / m_frames - mean * mean, 0.0);
+
+    statistics.minJitter = std::chrono::nanoseconds(m_minJitter);
+    statistics.maxJitter = std::chrono::nanoseconds(m_maxJitter);
+    statistics.meanJitter = std::chrono::nanoseconds(std::llround(mean));
+    statistics.stddevJitter = std::chrono::nanoseconds(std::llround(std::sqrt(variance)));
+
+    return statistics;
+}
+
+void FramePacer::recordJitter(int64_t jitter) {
+    ++m_frames;
+    m_minJitter = std::min(m_minJitter, jitter);
+    m_maxJitter = std::max(m_maxJitter, jitter);
+    m_jitterSum += static_cast<double>(jitter);
+    m_jitterSquareSum += static_cast<double>(jitter) * static_cast<double>(jitter);
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_FRAME_PACER_H
+#define LOCAL_FRAME_PACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include <vdpau/vdpau.h>
+
+#include <VdpWrapper/Framerate.h>
+
+/**
+ * @brief Statistics of the wake-up error against the frame deadlines
+ */
+struct PacerStatistics {
+    uint64_t frames;                        ///< Number of paced frames
+    uint64_t lateFrames;                    ///< Frames whose work ended after the deadline
+    uint64_t resyncs;                       ///< Number of timeline re-anchors after a long stall
+    std::chrono::nanoseconds minJitter;     ///< Minimum wake-up error
+    std::chrono::nanoseconds maxJitter;     ///< Maximum wake-up error
+    std::chrono::nanoseconds meanJitter;    ///< Mean wake-up error
+    std::chrono::nanoseconds stddevJitter;  ///< Standard deviation of the wake-up error
+};
+
+/**
+ * @brief FramePacer waits for the frame deadlines when the framerate is handled by the program
+ *
+ * The deadlines are absolute: the deadline of the frame N is the origin of the
+ * timeline plus the exact time of N frames, so the pacing error doesn't build up.
+ * The pacer sleeps until a short delay before the deadline then spins to wake up
+ * on time.
+ *
+ * The timeline is locked to an external clock (typically the VDPAU presentation
+ * clock), the system clock is only used to sleep.
+ */
+class FramePacer {
+public:
+    /**
+     * @brief Function returning the current time of the reference clock in nanoseconds
+     */
+    using TimeSource = std::function<VdpTime()>;
+
+    /**
+     * @brief Construct a new FramePacer
+     *
+     * @param framerate The framerate to follow
+     * @param timeSource The reference clock
+     * @param spinDuration The delay before the deadline spent to spin instead of sleeping
+     */
+    FramePacer(vw::Framerate framerate, TimeSource timeSource, std::chrono::nanoseconds spinDuration = std::chrono::microseconds(500));
+
+    /**
+     * @brief Wait for the deadline of the next frame
+     *
+     * The first call starts the timeline. If the caller is late by more
+     * than one frame, the timeline restarts from the current time instead
+     * of displaying a burst of frames.
+     */
+    void waitNextFrame();
+
+    /**
+     * @brief Get the jitter statistics
+     *
+     * @return PacerStatistics The statistics
+     */
+    PacerStatistics getStatistics() const;
+
+private:
+    void recordJitter(int64_t jitter);
+
+private:
+    vw::Framerate m_framerate;
+    TimeSource m_timeSource;
+    std::chrono::nanoseconds m_spinDuration;
+
+    bool m_bStarted;
+    VdpTime m_originTime;
+    uint64_t m_iFrameIndex;
+
+    // Statistics
+    uint64_t m_frames;
+    uint64_t m_lateFrames;
+    uint64_t m_resyncs;
+    int64_t m_minJitter;
+    int64_t m_maxJitter;
+    double m_jitterSum;
+    double m_jitterSquareSum;
+};
+
+#endif // LOCAL_FRAME_PACER_H
@@ -0,0 +1,307 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FrameSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Y4M frame marker, without parameters
+    const char FrameMarker[] = "FRAME\n";
+
+    // Pipe capacity requested for the spliced frames (the default is 64 KiB)
+    constexpr int PipeSize = 1 << 20;
+
+    uint32_t getVisiblePlaneHeight(vw::SizeU size, uint32_t index) {
+        return (index == 0) ? size.height : (size.height + 1) / 2;
+    }
+}
+
+FrameSink::FrameSink(const std::string& szTarget, SinkFormat format, vw::Framerate framerate, std::size_t iQueueDepth)
+: m_format(format)
+, m_framerate(framerate)
+, m_fd(-1)
+, m_bOwnedFd(false)
+, m_bPipe(false)
+, m_statistics{0, 0, 0, 0, {}, false}
+, m_iWrittenBytes(0)
+, m_queue(iQueueDepth, [this](std::vector<Frame>& batch) {
+    // All the waiting frames are written with the same system calls
+    writeBatch(batch);
+}) {
+    if (!m_framerate.isValid()) {
+        throw std::runtime_error("[FrameSink] The framerate must be valid");
+    }
+
+    if (szTarget == "-") {
+        m_fd = STDOUT_FILENO;
+    } else {
+        m_fd = ::open(szTarget.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            throw std::runtime_error("[FrameSink] Couldn't open '" + szTarget + "': " + std::strerror(errno));
+        }
+        m_bOwnedFd = true;
+    }
+
+    struct stat fileStatus;
+    if (::fstat(m_fd, &fileStatus) == 0 && S_ISFIFO(fileStatus.st_mode)) {
+        m_bPipe = true;
+
+        // A larger pipe holds a whole batch, the call may fail without privileges
+        ::fcntl(m_fd, F_SETPIPE_SZ, PipeSize);
+    }
+    m_statistics.bSpliced = m_bPipe;
+}
+
+FrameSink::~FrameSink() {
+    flush();
+    m_queue.stop();
+
+    releaseSplicedFrames(true);
+
+    if (m_bOwnedFd) {
+        ::close(m_fd);
+    }
+}
+
+vw::PixelFormat FrameSink::getPixelFormat() const {
+    return (m_format == SinkFormat::Y4M) ? vw::PixelFormat::I420 : vw::PixelFormat::NV12;
+}
+
+void FrameSink::setReorderDepth(int iReorderDepth) {
+    std::lock_guard<std::mutex> lock(m_reorderMutex);
+    m_reorderFrames.setReorderDepth(iReorderDepth);
+}
+
+void FrameSink::write(vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount) {
+    std::lock_guard<std::mutex> lock(m_reorderMutex);
+
+    m_reorderFrames.push(iPictureOrderCount, { std::move(frame), size, iPictureOrderCount }, [this](Frame reorderedFrame) {
+        push(std::move(reorderedFrame));
+    });
+}
+
+void FrameSink::flush() {
+    {
+        std::lock_guard<std::mutex> lock(m_reorderMutex);
+
+        m_reorderFrames.flush([this](Frame reorderedFrame) {
+            push(std::move(reorderedFrame));
+        });
+    }
+
+    m_queue.flush();
+}
+
+std::string FrameSink::getError() const {
+    return m_queue.getError();
+}
+
+SinkStatistics FrameSink::getStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SinkStatistics statistics = m_statistics;
+
+    vw::WorkerQueueStatistics queueStatistics = m_queue.getStatistics();
+    statistics.stalls = queueStatistics.stalls;
+    statistics.stallTime = queueStatistics.stallTime;
+
+    return statistics;
+}
+
+void FrameSink::push(Frame frame) {
+    // The writer is broken, the frame is dropped
+    if (!m_queue.getError().empty()) {
+        return;
+    }
+
+    // Backpressure: the decoder can't get more than depth frames ahead of the reader
+    m_queue.push(std::move(frame));
+}
+
+void FrameSink::writeBatch(std::vector<Frame>& batch) {
+    std::vector<iovec> vectors;
+    std::vector<uint64_t> frameEnds;
+    uint64_t iBatchBytes = 0;
+    bool bSizeChanged = false;
+
+    for (const Frame& frame: batch) {
+        if (m_format == SinkFormat::Y4M) {
+            if (m_szHeader.empty()) {
+                std::ostringstream header;
+                header << "YUV4MPEG2 W" << frame.size.width << " H" << frame.size.height;
+                header << " F" << m_framerate.numerator << ":" << m_framerate.denominator;
+                header << " Ip A1:1 C420mpeg2\n";
+                m_szHeader = header.str();
+                m_headerSize = frame.size;
+
+                vectors.push_back({ const_cast<char*>(m_szHeader.data()), m_szHeader.size() });
+                iBatchBytes += m_szHeader.size();
+            } else if (frame.size != m_headerSize) {
+                // The frames before the change are still written
+                bSizeChanged = true;
+                break;
+            }
+        }
+
+        iBatchBytes += appendFrame(frame, vectors);
+        frameEnds.push_back(m_iWrittenBytes + iBatchBytes);
+    }
+
+    bool bSpliced = m_bPipe;
+    std::string szError = writeVectors(vectors);
+    if (!szError.empty()) {
+        throw std::runtime_error(szError);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_iWrittenBytes += iBatchBytes;
+    m_statistics.frames += frameEnds.size();
+    m_statistics.bytes += iBatchBytes;
+    ++m_statistics.batches;
+    m_statistics.bSpliced = m_bPipe;
+
+    // The pipe references the frame pages until the reader consumes them
+    if (bSpliced && m_bPipe) {
+        for (std::size_t i = 0; i < frameEnds.size(); ++i) {
+            m_splicedFrames.push_back({ std::move(batch[i].image), frameEnds[i] });
+        }
+    }
+
+    releaseSplicedFrames(false);
+
+    if (bSizeChanged) {
+        throw std::runtime_error("[FrameSink] The picture size changed, it can't be stored in a Y4M stream");
+    }
+}
+
+uint64_t FrameSink::appendFrame(const Frame& frame, std::vector<iovec>& vectors) const {
+    const vw::ImageBuffer& image = *frame.image;
+    uint64_t iFrameBytes = 0;
+
+    if (m_format == SinkFormat::Y4M) {
+        vectors.push_back({ const_cast<char*>(FrameMarker), sizeof(FrameMarker) - 1 });
+        iFrameBytes += sizeof(FrameMarker) - 1;
+    }
+
+    // The buffer has the surface storage size, only the visible area is written
+    for (uint32_t index = 0; index < image.getPlaneCount(); ++index) {
+        uint32_t iPackedLineSize = vw::ImageBuffer::getPackedLineSize(image.getFormat(), frame.size, index);
+        uint32_t iLineCount = getVisiblePlaneHeight(frame.size, index);
+        uint8_t* pPlane = const_cast<uint8_t*>(image.getPlane(index));
+
+        if (image.getLineSize(index) == iPackedLineSize) {
+            vectors.push_back({ pPlane, static_cast<std::size_t>(iPackedLineSize) * iLineCount });
+        } else {
+            for (uint32_t iLine = 0; iLine < iLineCount; ++iLine) {
+                vectors.push_back({ pPlane + static_cast<std::size_t>(iLine) * image.getLineSize(index), iPackedLineSize });
+            }
+        }
+
+        iFrameBytes += static_cast<uint64_t>(iPackedLineSize) * iLineCount;
+    }
+
+    return iFrameBytes;
+}
+
+std::string FrameSink::writeVectors(std::vector<iovec>& vectors) {
+    std::size_t iIndex = 0;
+
+    while (iIndex < vectors.size()) {
+        int iCount = static_cast<int>(std::min<std::size_t>(IOV_MAX, vectors.size() - iIndex));
+
+        ssize_t iWritten = 0;
+        if (m_bPipe) {
+            iWritten = ::vmsplice(m_fd, &vectors[iIndex], iCount, 0);
+        } else {
+            iWritten = ::writev(m_fd, &vectors[iIndex], iCount);
+        }
+
+        if (iWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // Some pipes (e.g. on older kernels or in containers) refuse vmsplice()
+            if (m_bPipe && (errno == EINVAL || errno == ENOSYS)) {
+                m_bPipe = false;
+                continue;
+            }
+
+            return std::string("[FrameSink] Couldn't write the frames: ") + std::strerror(errno);
+        }
+
+        // Skip what was written, a partial write resumes in the middle of a vector
+        std::size_t iRemaining = static_cast<std::size_t>(iWritten);
+        while (iIndex < vectors.size() && iRemaining >= vectors[iIndex].iov_len) {
+            iRemaining -= vectors[iIndex].iov_len;
+            ++iIndex;
+        }
+
+        if (iRemaining > 0) {
+            vectors[iIndex].iov_base = static_cast<uint8_t*>(vectors[iIndex].iov_base) + iRemaining;
+            vectors[iIndex].iov_len -= iRemaining;
+        }
+    }
+
+    return {};
+}
+
+void FrameSink::releaseSplicedFrames(bool bWaitForReader) {
+    while (!m_splicedFrames.empty()) {
+        // Everything but the unread bytes has been copied out of the pipe
+        int iUnreadBytes = 0;
+        if (::ioctl(m_fd, FIONREAD, &iUnreadBytes) != 0) {
+            m_splicedFrames.clear();
+            return;
+        }
+
+        uint64_t iConsumedBytes = m_iWrittenBytes - static_cast<uint64_t>(iUnreadBytes);
+        while (!m_splicedFrames.empty() && m_splicedFrames.front().endOffset <= iConsumedBytes) {
+            m_splicedFrames.pop_front();
+        }
+
+        if (!bWaitForReader || m_splicedFrames.empty()) {
+            return;
+        }
+
+        // The reader is gone, nobody will read the pages anymore
+        pollfd pipeStatus = { m_fd, POLLOUT, 0 };
+        if (::poll(&pipeStatus, 1, 0) > 0 && (pipeStatus.revents & POLLERR) != 0) {
+            m_splicedFrames.clear();
+            return;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
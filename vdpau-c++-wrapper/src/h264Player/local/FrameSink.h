@@ -0,0 +1,184 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_FRAME_SINK_H
+#define LOCAL_FRAME_SINK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <VdpWrapper/Framerate.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/PresentationOrderBuffer.h>
+#include <VdpWrapper/Size.h>
+#include <VdpWrapper/WorkerQueue.h>
+
+/**
+ * @brief Enumeration of the FrameSink output formats
+ */
+enum class SinkFormat {
+    Y4M,    ///< YUV4MPEG2 stream, I420 frames
+    NV12,   ///< Raw NV12 frames without header
+};
+
+/**
+ * @brief Statistics of the FrameSink writer
+ */
+struct SinkStatistics {
+    uint64_t frames;                    ///< Number of written frames
+    uint64_t bytes;                     ///< Number of written bytes, headers included
+    uint64_t batches;                   ///< Number of writev() or vmsplice() batches
+    uint64_t stalls;                    ///< Number of write() calls which waited for a free slot
+    std::chrono::nanoseconds stallTime; ///< Total time spent waiting for a free slot
+    bool bSpliced;                      ///< True if the frames were spliced to a pipe
+};
+
+/**
+ * @brief FrameSink writes the decoded frames to a file, a FIFO or the standard output
+ *
+ * The frames are reordered by picture order count, then queued to a writer
+ * thread which gathers all the waiting frames in a single writev() call. When
+ * the target is a pipe, the frame pages are given to the pipe with vmsplice()
+ * instead of being copied, and the buffers are kept until the reader consumed
+ * them.
+ *
+ * At most queue depth frames are waiting or being written: write() blocks when
+ * the reader is slower than the decoder, which bounds the memory used.
+ */
+class FrameSink {
+public:
+    /**
+     * @brief Open the target and start the writer thread
+     *
+     * Opening a FIFO blocks until a reader opens it.
+     *
+     * @param szTarget The output file, "-" for the standard output
+     * @param format The output format
+     * @param framerate The framerate written in the Y4M header
+     * @param iQueueDepth Maximum number of frames waiting for the writer
+     */
+    FrameSink(const std::string& szTarget, SinkFormat format, vw::Framerate framerate, std::size_t iQueueDepth = 8);
+    /**
+     * @brief Write the remaining frames and close the target
+     */
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink(FrameSink&&) = delete;
+
+    FrameSink& operator=(const FrameSink&) = delete;
+    FrameSink& operator=(FrameSink&&) = delete;
+
+    /**
+     * @brief Get the pixel format expected by write()
+     *
+     * @return vw::PixelFormat I420 for Y4M, NV12 otherwise
+     */
+    vw::PixelFormat getPixelFormat() const;
+
+    /**
+     * @brief Set the number of frames kept to restore the presentation order
+     *
+     * @param iReorderDepth The reorder depth of the stream
+     */
+    void setReorderDepth(int iReorderDepth);
+
+    /**
+     * @brief Queue a decoded frame
+     *
+     * The frames arrive in decode order, they are written in presentation order.
+     * A picture order count of 0 starts a new sequence.
+     *
+     * @param frame The frame read back from the GPU, in the sink pixel format
+     * @param size The visible size of the frame
+     * @param iPictureOrderCount The picture order count of the frame
+     */
+    void write(vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount);
+
+    /**
+     * @brief Write all the pending frames and wait for the writer
+     */
+    void flush();
+
+    /**
+     * @brief Get the error which stopped the writer
+     *
+     * After an error, the frames are dropped.
+     *
+     * @return std::string The error message, empty if none
+     */
+    std::string getError() const;
+
+    /**
+     * @brief Get the writer statistics
+     *
+     * @return SinkStatistics The counters
+     */
+    SinkStatistics getStatistics() const;
+
+private:
+    struct Frame {
+        vw::ImageFrame image;
+        vw::SizeU size;
+        int iPictureOrderCount;
+    };
+
+    struct SplicedFrame {
+        vw::ImageFrame image;
+        uint64_t endOffset;
+    };
+
+    void push(Frame frame);
+    void writeBatch(std::vector<Frame>& batch);
+    uint64_t appendFrame(const Frame& frame, std::vector<iovec>& vectors) const;
+    std::string writeVectors(std::vector<iovec>& vectors);
+    void releaseSplicedFrames(bool bWaitForReader);
+
+private:
+    SinkFormat m_format;
+    vw::Framerate m_framerate;
+    int m_fd;
+    bool m_bOwnedFd;
+    bool m_bPipe;
+
+    // The reorder lock is held while a frame waits for a free slot, the writer never takes it
+    std::mutex m_reorderMutex;
+    vw::PresentationOrderBuffer<Frame> m_reorderFrames;
+
+    mutable std::mutex m_mutex;
+    SinkStatistics m_statistics;
+
+    // Writer thread state
+    std::string m_szHeader;
+    vw::SizeU m_headerSize;
+    uint64_t m_iWrittenBytes;
+    std::deque<SplicedFrame> m_splicedFrames;
+    vw::WorkerQueue<Frame> m_queue;
+};
+
+#endif // LOCAL_FRAME_SINK_H
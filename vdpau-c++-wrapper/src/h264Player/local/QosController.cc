@@ -0,0 +1,118 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "QosController.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Lateness (in number of pictures) needed to reach each degradation level
+    constexpr int64_t DropPresentationThreshold = 1;
+    constexpr int64_t DropPostProcessThreshold = 3;
+    constexpr int64_t DropNonReferenceThreshold = 6;
+}
+
+QosController::QosController(std::chrono::nanoseconds frameDuration)
+: m_frameDuration(frameDuration)
+, m_level(QosLevel::Normal)
+, m_bDecodePicture(true)
+, m_bPostProcessPicture(true)
+, m_bPresentPicture(true)
+, m_statistics({0, 0, 0}) {
+
+}
+
+void QosController::update(VdpTime currentTime, VdpTime scheduleEndTime) {
+    // The stream has caught up
+    if (currentTime <= scheduleEndTime || scheduleEndTime == 0) {
+        if (m_level != QosLevel::Normal) {
+            std::cout << "[QosController] Back to real time" << std::endl;
+        }
+        m_level = QosLevel::Normal;
+        return;
+    }
+
+    int64_t iLatePictures = static_cast<int64_t>(currentTime - scheduleEndTime) / std::max<int64_t>(m_frameDuration.count(), 1);
+
+    QosLevel newLevel = QosLevel::Normal;
+    if (iLatePictures >= DropNonReferenceThreshold) {
+        newLevel = QosLevel::DropNonReference;
+    } else if (iLatePictures >= DropPostProcessThreshold) {
+        newLevel = QosLevel::DropPostProcess;
+    } else if (iLatePictures >= DropPresentationThreshold) {
+        newLevel = QosLevel::DropPresentation;
+    }
+
+    // Keep the highest level until the stream catches up
+    if (newLevel > m_level) {
+        std::cout << "[QosController] " << iLatePictures << " pictures late, degradation level: " << static_cast<int>(newLevel) << std::endl;
+        m_level = newLevel;
+    }
+}
+
+bool QosController::shouldDecode(const vw::NalUnit& nal) {
+    // All the slices of a picture share the decision taken on the first one
+    if (!nal.getH264Infos().bFirstSliceOfPicture) {
+        return m_bDecodePicture;
+    }
+
+    m_bDecodePicture = m_level < QosLevel::DropNonReference || nal.isReference();
+    if (!m_bDecodePicture) {
+        ++m_statistics.droppedDecodes;
+    }
+
+    return m_bDecodePicture;
+}
+
+bool QosController::shouldPostProcess(const vw::NalUnit& nal) {
+    if (!nal.getH264Infos().bFirstSliceOfPicture) {
+        return m_bPostProcessPicture;
+    }
+
+    m_bPostProcessPicture = m_level < QosLevel::DropPostProcess;
+    if (!m_bPostProcessPicture) {
+        ++m_statistics.droppedPostProcesses;
+    }
+
+    return m_bPostProcessPicture;
+}
+
+bool QosController::shouldPresent(bool bFirstSliceOfPicture) {
+    if (!bFirstSliceOfPicture) {
+        return m_bPresentPicture;
+    }
+
+    m_bPresentPicture = m_level < QosLevel::DropPresentation;
+    if (!m_bPresentPicture) {
+        ++m_statistics.droppedPresentations;
+    }
+
+    return m_bPresentPicture;
+}
+
+QosLevel QosController::getLevel() const {
+    return m_level;
+}
+
+const QosStatistics& QosController::getStatistics() const {
+    return m_statistics;
+}
@@ -0,0 +1,134 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_QOS_CONTROLLER_H
+#define LOCAL_QOS_CONTROLLER_H
+
+#include <chrono>
+#include <cstdint>
+
+#include <vdpau/vdpau.h>
+
+#include <VdpWrapper/NalUnit.h>
+
+/**
+ * @brief Degradation steps applied when the decoding falls behind real time
+ *
+ * Each level includes the drops of the previous ones.
+ */
+enum class QosLevel {
+    Normal,                 ///< All pictures are decoded, post-processed and displayed
+    DropPresentation,       ///< The late pictures are not displayed
+    DropPostProcess,        ///< The late pictures are not post-processed
+    DropNonReference,       ///< The non-reference pictures are not decoded
+};
+
+/**
+ * @brief Counters of dropped pictures for each QoS category
+ */
+struct QosStatistics {
+    uint64_t droppedPresentations;  ///< Pictures decoded and post-processed but not displayed
+    uint64_t droppedPostProcesses;  ///< Pictures decoded but neither post-processed nor displayed
+    uint64_t droppedDecodes;        ///< Non-reference pictures not decoded at all
+};
+
+/**
+ * @brief QosController decides which processing steps to skip to catch up with real time
+ *
+ * The controller compares the VDPAU presentation clock with the end of the presentation
+ * schedule. When the schedule is exhausted, the pictures are late and the controller
+ * raises the degradation level according to the lateness. It comes back to normal
+ * processing as soon as the stream catches up.
+ */
+class QosController {
+public:
+    /**
+     * @brief Construct a new QosController
+     *
+     * @param frameDuration The duration of one picture
+     */
+    QosController(std::chrono::nanoseconds frameDuration);
+
+    /**
+     * @brief Update the degradation level
+     *
+     * This must be called once per coded picture, on its first slice, before using the should* methods.
+     *
+     * @param currentTime The current time of the presentation clock
+     * @param scheduleEndTime The time when the last scheduled picture leaves the screen
+     */
+    void update(VdpTime currentTime, VdpTime scheduleEndTime);
+
+    /**
+     * @brief Check if the coded picture must be decoded
+     *
+     * The decision is taken on the first slice of the picture and applies to
+     * its other slices, a dropped picture is counted once.
+     *
+     * @param nal The coded slice to decode
+     * @return true If the picture must be decoded
+     * @return false If the picture is dropped
+     */
+    bool shouldDecode(const vw::NalUnit& nal);
+    /**
+     * @brief Check if the decoded picture must be post-processed
+     *
+     * Like shouldDecode(), the decision is taken once per picture.
+     *
+     * @param nal The coded slice of the decoded surface
+     * @return true If the picture must be post-processed
+     * @return false If the picture is dropped
+     */
+    bool shouldPostProcess(const vw::NalUnit& nal);
+    /**
+     * @brief Check if the post-processed picture must be displayed
+     *
+     * Like shouldDecode(), the decision is taken once per picture.
+     *
+     * @param bFirstSliceOfPicture True if the surface comes from the first slice of its picture
+     * @return true If the picture must be displayed
+     * @return false If the picture is dropped
+     */
+    bool shouldPresent(bool bFirstSliceOfPicture);
+
+    /**
+     * @brief Get the current degradation level
+     *
+     * @return QosLevel The current level
+     */
+    QosLevel getLevel() const;
+    /**
+     * @brief Get the dropped pictures counters
+     *
+     * @return const QosStatistics& The counters
+     */
+    const QosStatistics& getStatistics() const;
+
+private:
+    std::chrono::nanoseconds m_frameDuration;
+    QosLevel m_level;
+    bool m_bDecodePicture;
+    bool m_bPostProcessPicture;
+    bool m_bPresentPicture;
+    QosStatistics m_statistics;
+};
+
+#endif // LOCAL_QOS_CONTROLLER_H
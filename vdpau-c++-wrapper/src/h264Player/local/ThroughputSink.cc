@@ -0,0 +1,79 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ThroughputSink.h"
+
+#include <utility>
+
+#include <VdpWrapper/RenderSurfacePool.h>
+
+ThroughputSink::ThroughputSink(vw::RenderSurfacePool* pSurfacePool)
+: m_pSurfacePool(pSurfacePool)
+, m_startTime(std::chrono::steady_clock::now())
+, m_iFrames(0)
+, m_iBitstreamBytes(0)
+, m_iOutputBytes(0) {
+
+}
+
+void ThroughputSink::start() {
+    m_startTime = std::chrono::steady_clock::now();
+    m_iFrames = 0;
+    m_iBitstreamBytes = 0;
+    m_iOutputBytes = 0;
+}
+
+void ThroughputSink::addBitstreamBytes(std::size_t iSize) {
+    m_iBitstreamBytes += iSize;
+}
+
+void ThroughputSink::consume(vw::RenderSurface surface) {
+    vw::SizeU size = surface.getSize();
+
+    ++m_iFrames;
+    m_iOutputBytes += static_cast<uint64_t>(size.width) * size.height * 4;
+
+    if (m_pSurfacePool != nullptr) {
+        m_pSurfacePool->release(std::move(surface));
+    }
+}
+
+ThroughputStatistics ThroughputSink::getStatistics() const {
+    ThroughputStatistics statistics;
+    statistics.frames = m_iFrames;
+    statistics.bitstreamBytes = m_iBitstreamBytes;
+    statistics.outputBytes = m_iOutputBytes;
+    statistics.elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime);
+
+    double elapsedSeconds = std::chrono::duration<double>(statistics.elapsedTime).count();
+    if (elapsedSeconds <= 0.0) {
+        statistics.framesPerSecond = 0.0;
+        statistics.bitstreamMegabytesPerSecond = 0.0;
+        statistics.outputMegabytesPerSecond = 0.0;
+        return statistics;
+    }
+
+    statistics.framesPerSecond = m_iFrames / elapsedSeconds;
+    statistics.bitstreamMegabytesPerSecond = m_iBitstreamBytes / elapsedSeconds / 1.0e6;
+    statistics.outputMegabytesPerSecond = m_iOutputBytes / elapsedSeconds / 1.0e6;
+
+    return statistics;
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_THROUGHPUT_SINK_H
+#define LOCAL_THROUGHPUT_SINK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <VdpWrapper/RenderSurface.h>
+
+namespace vw {
+    class RenderSurfacePool;
+}
+
+/**
+ * @brief Throughput measured by the ThroughputSink
+ */
+struct ThroughputStatistics {
+    uint64_t frames;                        ///< Number of consumed pictures
+    uint64_t bitstreamBytes;                ///< Size of the coded slices sent to the decoder
+    uint64_t outputBytes;                   ///< Size of the consumed RGBA pictures
+    std::chrono::nanoseconds elapsedTime;   ///< Time since start()
+    double framesPerSecond;                 ///< Sustained picture rate
+    double bitstreamMegabytesPerSecond;     ///< Sustained bitstream rate
+    double outputMegabytesPerSecond;        ///< Sustained rate of RGBA pictures
+};
+
+/**
+ * @brief ThroughputSink replaces the presentation stage in headless mode
+ *
+ * The post-processed surfaces are not displayed but counted, then given back
+ * to the surface pool. Since nothing waits for a display clock, the pipeline
+ * runs as fast as the device allows and the sink reports the sustained throughput.
+ */
+class ThroughputSink {
+public:
+    /**
+     * @brief Construct a new ThroughputSink
+     *
+     * @param pSurfacePool The pool receiving the consumed surfaces, they are freed if null
+     */
+    ThroughputSink(vw::RenderSurfacePool* pSurfacePool = nullptr);
+
+    /**
+     * @brief Reset the counters and start the measure
+     */
+    void start();
+
+    /**
+     * @brief Account a coded slice sent to the decoder
+     *
+     * @param iSize The size of the NAL unit in bytes
+     */
+    void addBitstreamBytes(std::size_t iSize);
+
+    /**
+     * @brief Consume a post-processed surface
+     *
+     * @param surface The surface which would have been displayed
+     */
+    void consume(vw::RenderSurface surface);
+
+    /**
+     * @brief Get the throughput since start()
+     *
+     * @return ThroughputStatistics The counters and the rates
+     */
+    ThroughputStatistics getStatistics() const;
+
+private:
+    vw::RenderSurfacePool* m_pSurfacePool;
+    std::chrono::steady_clock::time_point m_startTime;
+    uint64_t m_iFrames;
+    uint64_t m_iBitstreamBytes;
+    uint64_t m_iOutputBytes;
+};
+
+#endif // LOCAL_THROUGHPUT_SINK_H
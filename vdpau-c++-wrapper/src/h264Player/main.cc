@@ -20,22 +20,39 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <csignal>
 #include <iostream>
+#include <memory>
 #include <numeric>
-#include <thread>
+#include <unordered_set>
 
+#include <VdpWrapper/Backend.h>
+#include <VdpWrapper/CpuBackend.h>
 #include <VdpWrapper/Display.h>
 #include <VdpWrapper/Decoder.h>
 #include <VdpWrapper/Device.h>
+#include <VdpWrapper/FrameChecksum.h>
+#include <VdpWrapper/Framerate.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/MockBackend.h>
 #include <VdpWrapper/NalUnit.h>
 #include <VdpWrapper/PresentationQueue.h>
 #include <VdpWrapper/Size.h>
 #include <VdpWrapper/RenderSurface.h>
+#include <VdpWrapper/RenderSurfacePool.h>
 #include <VdpWrapper/DecodedSurface.h>
 #include <VdpWrapper/VideoMixer.h>
 
+#include <h264Parser/H264Parser.h>
+
+#include "local/AsyncReadback.h"
 #include "local/Clock.h"
-#include "local/H264Parser.h"
+#include "local/FrameHasher.h"
+#include "local/FramePacer.h"
+#include "local/FrameSink.h"
+#include "local/QosController.h"
+#include "local/ThroughputSink.h"
 
 namespace {
     void printUsage(const std::string& commandName, const std::string& message) {
@@ -47,11 +64,49 @@ namespace {
         std::cerr << "\t--initial-size <width>x<height>\t\tSet the initial screen size" << std::endl;
         std::cerr << "\t--disable-pts\t\t\t\tDisplay images in decode order" << std::endl;
         std::cerr << "\t--enable-pts\t\t\t\tDisplay images in presentation order" << std::endl;
-        std::cerr << "\t--fps <FPS>\t\t\t\tSet the video FPS" << std::endl;
+        std::cerr << "\t--fps <FPS>\t\t\t\tSet the video FPS (e.g. 25, 29.97 or 30000/1001)" << std::endl;
         std::cerr << "\t--benchmark\t\t\t\tEnable times benchmark" << std::endl;
         std::cerr << "\t--manual-framerate\t\t\tThe framerate is handle by the program and not by VDPAU" << std::endl;
         std::cerr << "\t--copy-yuv\t\t\t\tCopy YUV images from GPU memory" << std::endl;
         std::cerr << "\t--copy-rgba\t\t\t\tCopy RGBA images from GPU memory" << std::endl;
+        std::cerr << "\t--output <FILE|->\t\t\tWrite the decoded frames to a file, a FIFO or the standard output" << std::endl;
+        std::cerr << "\t--output-format <y4m|nv12>\t\tSet the output format (default: y4m)" << std::endl;
+        std::cerr << "\t--output-queue <DEPTH>\t\t\tSet the number of frames waiting for the output (default: 8)" << std::endl;
+        std::cerr << "\t--checksum-log <FILE>\t\t\tWrite a checksum of each decoded frame to FILE, in the ffmpeg framemd5 layout" << std::endl;
+        std::cerr << "\t--checksum <md5|crc32c>\t\t\tSet the checksum algorithm (default: md5)" << std::endl;
+        std::cerr << "\t--readback-depth <DEPTH>\t\tSet the number of asynchronous readbacks in flight, 0 to copy in the decode loop (default: 2)" << std::endl;
+        std::cerr << "\t--surface-reclaim\t\t\tRecycle the displayed surfaces from a dedicated thread" << std::endl;
+        std::cerr << "\t--qos\t\t\t\t\tDrop late pictures to keep up with real time" << std::endl;
+        std::cerr << "\t--speed <SPEED>\t\t\t\tSet the fast-forward speed factor" << std::endl;
+        std::cerr << "\t--headless\t\t\t\tDecode without window nor display and report the throughput" << std::endl;
+        std::cerr << "\t--backend <x11|cpu|mock>\t\tSet the VDPAU backend" << std::endl;
+        std::cerr << "\t--mock-latency <D>,<M>,<G>\t\tSet the mean latencies in µs of the mock decoder, mixer and get bits" << std::endl;
+    }
+
+    vw::Framerate parseFramerate(const std::string& szValue) {
+        // Rational value: <numerator>/<denominator>
+        auto iDelimiterIndex = szValue.find_first_of("/");
+        if (iDelimiterIndex != std::string::npos) {
+            return vw::Framerate(std::stoul(szValue.substr(0, iDelimiterIndex)), std::stoul(szValue.substr(iDelimiterIndex + 1)));
+        }
+
+        // Decimal value
+        double fps = std::stod(szValue);
+        if (fps <= 0.0) {
+            return vw::Framerate(0, 1);
+        }
+
+        if (fps == std::floor(fps)) {
+            return vw::Framerate(static_cast<uint32_t>(fps), 1);
+        }
+
+        // NTSC framerates (23.976, 29.97, 59.94...) are N * 1000 / 1001
+        double ntscBase = std::round(fps * 1.001);
+        if (std::abs(fps - ntscBase / 1.001) < 0.005) {
+            return vw::Framerate(static_cast<uint32_t>(ntscBase) * 1000, 1001);
+        }
+
+        return vw::Framerate(static_cast<uint32_t>(std::round(fps * 1000.0)), 1000);
     }
 }
 
@@ -59,13 +114,32 @@ int main(int argc, char *argv[]) {
     int iCurrentArg = 1;
     vw::SizeU screenSize(1280, 720);
     bool bEnablePTS = true;
-    int iFPS = 25;
+    vw::Framerate framerate(25);
     bool bBenchmarkEnabled = false;
     bool bManualFramerate = false;
     bool bCopyYUV = false;
     bool bCopyBGRA = false;
+    int iReadbackDepth = 2;
+    std::string szOutput;
+    SinkFormat outputFormat = SinkFormat::Y4M;
+    int iOutputQueueDepth = 8;
+    std::string szChecksumLog;
+    vw::ChecksumAlgorithm checksumAlgorithm = vw::ChecksumAlgorithm::MD5;
+    bool bSurfaceReclaim = false;
+    bool bQosEnabled = false;
+    int iSpeed = 1;
+    bool bHeadless = false;
+    std::string szBackend = "x11";
+    vw::MockLatencyModel mockLatencyModel;
     Clock clock;
 
+    // The frames written to the standard output must not be mixed with the logs
+    for (int iArg = 1; iArg < argc - 1; ++iArg) {
+        if (std::string(argv[iArg]) == "--output" && std::string(argv[iArg + 1]) == "-") {
+            std::cout.rdbuf(std::cerr.rdbuf());
+        }
+    }
+
     while (iCurrentArg < argc - 1) {
         std::string szArg = std::string(argv[iCurrentArg]);
         if (szArg == "--initial-size") {
@@ -111,13 +185,13 @@ int main(int argc, char *argv[]) {
                 szValue = std::string(argv[iCurrentArg + 1]);
 
                 try {
-                    iFPS = std::stoi(szValue);
-                } catch (std::invalid_argument &e) {
+                    framerate = parseFramerate(szValue);
+                } catch (std::logic_error &e) {
                     bOptionParseFailed = true;
                 }
             }
 
-            if (bOptionParseFailed) {
+            if (bOptionParseFailed || !framerate.isValid()) {
                 printUsage(argv[0], "Wrong FPS value");
                 return 1;
             }
@@ -149,6 +223,202 @@ int main(int argc, char *argv[]) {
             bCopyBGRA = true;
             std::cout << "[main] Copy BGRA images from GPU memory" << std::endl;
             ++iCurrentArg;
+        } else if (szArg == "--output") {
+            if (iCurrentArg >= argc - 1) {
+                printUsage(argv[0], "Missing output value");
+                return 1;
+            }
+
+            szOutput = std::string(argv[iCurrentArg + 1]);
+            std::cout << "[main] Write the decoded frames to: " << szOutput << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--output-format") {
+            if (iCurrentArg >= argc - 1) {
+                printUsage(argv[0], "Missing output format value");
+                return 1;
+            }
+
+            std::string szValue = std::string(argv[iCurrentArg + 1]);
+            if (szValue == "y4m") {
+                outputFormat = SinkFormat::Y4M;
+            } else if (szValue == "nv12") {
+                outputFormat = SinkFormat::NV12;
+            } else {
+                printUsage(argv[0], "Wrong output format value");
+                return 1;
+            }
+
+            std::cout << "[main] Set output format to: " << szValue << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--output-queue") {
+            bool bOptionParseFailed = false;
+            std::string szValue;
+
+            if (iCurrentArg >= argc - 1) {
+                bOptionParseFailed = true;
+            }
+            else {
+                szValue = std::string(argv[iCurrentArg + 1]);
+
+                try {
+                    iOutputQueueDepth = std::stoi(szValue);
+                } catch (std::invalid_argument &e) {
+                    bOptionParseFailed = true;
+                }
+            }
+
+            if (bOptionParseFailed || iOutputQueueDepth <= 0) {
+                printUsage(argv[0], "Wrong output queue depth value");
+                return 1;
+            }
+
+            std::cout << "[main] Set output queue depth to: " << szValue << std::endl;
+
+            iCurrentArg += 2;
+        } else if (szArg == "--checksum-log") {
+            if (iCurrentArg >= argc - 1) {
+                printUsage(argv[0], "Missing checksum log value");
+                return 1;
+            }
+
+            szChecksumLog = std::string(argv[iCurrentArg + 1]);
+            std::cout << "[main] Write the frame checksums to: " << szChecksumLog << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--checksum") {
+            if (iCurrentArg >= argc - 1) {
+                printUsage(argv[0], "Missing checksum value");
+                return 1;
+            }
+
+            std::string szValue = std::string(argv[iCurrentArg + 1]);
+            if (szValue == "md5") {
+                checksumAlgorithm = vw::ChecksumAlgorithm::MD5;
+            } else if (szValue == "crc32c") {
+                checksumAlgorithm = vw::ChecksumAlgorithm::CRC32C;
+            } else {
+                printUsage(argv[0], "Wrong checksum value");
+                return 1;
+            }
+
+            std::cout << "[main] Set checksum to: " << szValue << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--readback-depth") {
+            bool bOptionParseFailed = false;
+            std::string szValue;
+
+            if (iCurrentArg >= argc - 1) {
+                bOptionParseFailed = true;
+            }
+            else {
+                szValue = std::string(argv[iCurrentArg + 1]);
+
+                try {
+                    iReadbackDepth = std::stoi(szValue);
+                } catch (std::invalid_argument &e) {
+                    bOptionParseFailed = true;
+                }
+            }
+
+            if (bOptionParseFailed || iReadbackDepth < 0) {
+                printUsage(argv[0], "Wrong readback depth value");
+                return 1;
+            }
+
+            std::cout << "[main] Set readback depth to: " << szValue << std::endl;
+
+            iCurrentArg += 2;
+        } else if (szArg == "--surface-reclaim") {
+            bSurfaceReclaim = true;
+            std::cout << "[main] Recycle the displayed surfaces from a dedicated thread" << std::endl;
+            ++iCurrentArg;
+        } else if (szArg == "--qos") {
+            bQosEnabled = true;
+            std::cout << "[main] Drop late pictures to keep up with real time" << std::endl;
+            ++iCurrentArg;
+        } else if (szArg == "--speed") {
+            bool bOptionParseFailed = false;
+            std::string szValue;
+
+            if (iCurrentArg >= argc - 1) {
+                bOptionParseFailed = true;
+            }
+            else {
+                szValue = std::string(argv[iCurrentArg + 1]);
+
+                try {
+                    iSpeed = std::stoi(szValue);
+                } catch (std::invalid_argument &e) {
+                    bOptionParseFailed = true;
+                }
+            }
+
+            if (bOptionParseFailed || iSpeed <= 0) {
+                printUsage(argv[0], "Wrong speed value");
+                return 1;
+            }
+
+            std::cout << "[main] Set speed to: " << szValue << "x" << std::endl;
+
+            iCurrentArg += 2;
+        } else if (szArg == "--headless") {
+            bHeadless = true;
+            std::cout << "[main] Headless mode" << std::endl;
+            ++iCurrentArg;
+        } else if (szArg == "--backend") {
+            if (iCurrentArg >= argc - 1) {
+                printUsage(argv[0], "Missing backend value");
+                return 1;
+            }
+
+            szBackend = std::string(argv[iCurrentArg + 1]);
+            if (szBackend != "x11" && szBackend != "cpu" && szBackend != "mock") {
+                printUsage(argv[0], "Wrong backend value");
+                return 1;
+            }
+
+            std::cout << "[main] Set backend to: " << szBackend << std::endl;
+            iCurrentArg += 2;
+        } else if (szArg == "--mock-latency") {
+            bool bOptionParseFailed = false;
+            std::string szValue;
+
+            if (iCurrentArg >= argc - 1) {
+                bOptionParseFailed = true;
+            }
+            else {
+                szValue = std::string(argv[iCurrentArg + 1]);
+
+                // Each latency follows a normal distribution with a 10% standard deviation
+                auto parseLatency = [](const std::string& szLatency) {
+                    int iLatency = std::stoi(szLatency);
+                    if (iLatency < 0) {
+                        throw std::invalid_argument("negative latency");
+                    }
+                    return vw::LatencyDistribution::normal(std::chrono::microseconds(iLatency), std::chrono::microseconds(iLatency / 10));
+                };
+
+                try {
+                    auto iFirstDelimiterIndex = szValue.find_first_of(",");
+                    auto iSecondDelimiterIndex = szValue.find_first_of(",", iFirstDelimiterIndex + 1);
+                    if (iFirstDelimiterIndex == std::string::npos || iSecondDelimiterIndex == std::string::npos) {
+                        bOptionParseFailed = true;
+                    } else {
+                        mockLatencyModel.decoderRender = parseLatency(szValue.substr(0, iFirstDelimiterIndex));
+                        mockLatencyModel.videoMixerRender = parseLatency(szValue.substr(iFirstDelimiterIndex + 1, iSecondDelimiterIndex - iFirstDelimiterIndex - 1));
+                        mockLatencyModel.getBits = parseLatency(szValue.substr(iSecondDelimiterIndex + 1));
+                    }
+                } catch (std::invalid_argument &e) {
+                    bOptionParseFailed = true;
+                }
+            }
+
+            if (bOptionParseFailed) {
+                printUsage(argv[0], "Wrong mock latency values");
+                return 1;
+            }
+
+            std::cout << "[main] Set mock latencies to: " << szValue << " µs" << std::endl;
+            iCurrentArg += 2;
         } else {
             printUsage(argv[0], "'" + szArg + "' unknown option");
             return 1;
@@ -160,23 +430,128 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (bQosEnabled && bManualFramerate) {
+        printUsage(argv[0], "The QoS needs the framerate handled by VDPAU");
+        return 1;
+    }
+
+    if (bHeadless && (bQosEnabled || bManualFramerate)) {
+        printUsage(argv[0], "The headless mode runs unthrottled, without QoS nor framerate");
+        return 1;
+    }
+
     std::string szBitstreamFile(argv[iCurrentArg]);
-    vw::Display display(screenSize);
-    vw::Device device(display);
-    vw::Decoder decoder(device);
-    vw::PresentationQueue presentationQueue(display, device);
-    presentationQueue.setFramerate(iFPS);
-    if (!bEnablePTS) {
-        presentationQueue.enablePresentationOrderDisplay(bEnablePTS);
+
+    // The written and hashed frames are the YUV readbacks
+    if (!szOutput.empty()) {
+        bCopyYUV = true;
+
+        // A closed pipe is reported as a write error instead of killing the process
+        std::signal(SIGPIPE, SIG_IGN);
     }
-    if (bManualFramerate) {
-        presentationQueue.enableDirectOutput(bManualFramerate);
+    if (!szChecksumLog.empty()) {
+        bCopyYUV = true;
+    }
+
+    // The headless mode doesn't need any window
+    std::unique_ptr<vw::Display> pDisplay;
+    if (!bHeadless) {
+        pDisplay = std::make_unique<vw::Display>(screenSize);
+    }
+
+    std::unique_ptr<vw::Backend> pBackend;
+    vw::MockBackend* pMockBackend = nullptr;
+    if (szBackend == "cpu") {
+        pBackend = std::make_unique<vw::CpuBackend>();
+    } else if (szBackend == "mock") {
+        auto pOwnedMockBackend = std::make_unique<vw::MockBackend>(mockLatencyModel);
+        pMockBackend = pOwnedMockBackend.get();
+        pBackend = std::move(pOwnedMockBackend);
+    } else if (bHeadless) {
+        pBackend = std::make_unique<vw::X11Backend>(std::string());
+    } else {
+        pBackend = std::make_unique<vw::X11Backend>(*pDisplay);
     }
+
+    vw::Device device(*pBackend);
+    vw::Decoder decoder(device);
+    vw::RenderSurfacePool surfacePool(device);
+    vw::ImageBufferPool readbackPool;
     vw::VideoMixer mixer(device, screenSize);
 
+    // In headless mode, the presentation stage is replaced by a sink
+    std::unique_ptr<vw::PresentationQueue> pPresentationQueue;
+    ThroughputSink throughputSink(&surfacePool);
+    if (bHeadless) {
+        mixer.setSurfacePool(&surfacePool);
+    } else {
+        pPresentationQueue = std::make_unique<vw::PresentationQueue>(*pDisplay, device);
+        pPresentationQueue->setFramerate(framerate);
+        pPresentationQueue->setPlaybackSpeed(iSpeed);
+        if (!bEnablePTS) {
+            pPresentationQueue->enablePresentationOrderDisplay(bEnablePTS);
+        }
+        if (bManualFramerate) {
+            pPresentationQueue->enableDirectOutput(bManualFramerate);
+        }
+        if (bSurfaceReclaim) {
+            mixer.setSurfacePool(&surfacePool);
+            pPresentationQueue->enableSurfaceReclaim(surfacePool);
+        }
+    }
+
+    // The frames are written and hashed by dedicated threads, fed by the readback worker if any
+    std::unique_ptr<FrameSink> pFrameSink;
+    if (!szOutput.empty()) {
+        pFrameSink = std::make_unique<FrameSink>(szOutput, outputFormat, framerate, iOutputQueueDepth);
+    }
+    std::unique_ptr<FrameHasher> pFrameHasher;
+    if (!szChecksumLog.empty()) {
+        pFrameHasher = std::make_unique<FrameHasher>(szChecksumLog, checksumAlgorithm, framerate);
+    }
+
+    // The checksums are computed on the written frames, or on I420 frames like the ffmpeg yuv420p output
+    vw::PixelFormat frameFormat = (pFrameSink != nullptr) ? pFrameSink->getPixelFormat() : vw::PixelFormat::I420;
+    AsyncReadback::FrameHandler frameHandler;
+    if (pFrameSink != nullptr || pFrameHasher != nullptr) {
+        frameHandler = [&pFrameSink, &pFrameHasher](vw::ImageFrame frame, vw::SizeU size, int iPictureOrderCount) {
+            if (pFrameHasher != nullptr) {
+                pFrameHasher->submit(frame, size, iPictureOrderCount);
+            }
+            if (pFrameSink != nullptr) {
+                pFrameSink->write(std::move(frame), size, iPictureOrderCount);
+            }
+        };
+    }
+
+    // The readbacks run on a worker thread, they are finished before the decoder is destroyed
+    std::unique_ptr<AsyncReadback> pAsyncReadback;
+    if ((bCopyYUV || bCopyBGRA) && iReadbackDepth > 0) {
+        pAsyncReadback = std::make_unique<AsyncReadback>(readbackPool, iReadbackDepth);
+        if (frameHandler) {
+            pAsyncReadback->setFrameHandler(frameFormat, frameHandler);
+        }
+    }
+
     H264Parser parser(szBitstreamFile);
     vw::NalUnit nalUnit;
 
+    // Trick-play: drop pictures at parse time to keep the GPU load flat
+    vw::DecodeMode decodeMode = vw::DecodeMode::AllPictures;
+    if (iSpeed >= 8) {
+        decodeMode = vw::DecodeMode::IntraPictures;
+    } else if (iSpeed >= 2) {
+        decodeMode = vw::DecodeMode::ReferencePictures;
+    }
+    parser.setDecodeMode(decodeMode);
+    decoder.setDecodeMode(decodeMode);
+
+    vw::Framerate playbackFramerate(framerate.numerator * iSpeed, framerate.denominator);
+    QosController qosController(std::chrono::nanoseconds(playbackFramerate.getFrameDuration()));
+    FramePacer framePacer(playbackFramerate, [&pPresentationQueue]() {
+        return pPresentationQueue->getCurrentTime();
+    });
+
     // Benchmark variables
     std::chrono::microseconds totalTime;
     std::vector<std::chrono::microseconds> listDecodeTimes;
@@ -186,13 +561,74 @@ int main(int argc, char *argv[]) {
     std::vector<std::chrono::microseconds> listDisplayTimes;
     std::vector<std::chrono::microseconds> listTotalTimes;
 
-    while (parser.readNextNAL(nalUnit) && display.isOpened()) {
-        // Handle XEvent
-        display.processEvent();
-        mixer.setOutputSize(display.getScreenSize());
+    // The surfaces read back asynchronously which don't start their picture
+    std::unordered_set<VdpOutputSurface> readbackContinuationSurfaces;
+
+    // Last stage of a picture: QoS, then display or throughput sink
+    auto presentSurface = [&](vw::RenderSurface outputSurface, bool bFirstSlice) {
+        if (bQosEnabled && !qosController.shouldPresent(bFirstSlice)) {
+            // The time slot of a dropped picture is released once
+            if (bFirstSlice) {
+                pPresentationQueue->skip(outputSurface.getPictureOrderCount(), outputSurface.getPresentationTimeStamp());
+            }
+            if (bSurfaceReclaim) {
+                surfacePool.release(std::move(outputSurface));
+            }
+            return;
+        }
+
+        if (bHeadless) {
+            throughputSink.consume(std::move(outputSurface));
+        } else {
+            pPresentationQueue->enqueue(std::move(outputSurface));
+        }
+        if (bBenchmarkEnabled) {
+            auto elapsedTime = clock.restart();
+            listDisplayTimes.push_back(elapsedTime);
+            totalTime += elapsedTime;
+            listTotalTimes.push_back(totalTime);
+            std::cout << "[main] Display time: " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTime).count() << " ms" << std::endl;
+            std::cout << "[main] Total time: " << std::chrono::duration_cast<std::chrono::milliseconds>(totalTime).count() << " ms" << std::endl;
+            std::cout << std::endl;
+        }
+    };
+
+    throughputSink.start();
+
+    // A failed readback or output write stops the decoding
+    auto hasWorkerError = [&]() {
+        return (pAsyncReadback != nullptr && !pAsyncReadback->getError().empty())
+            || (pFrameSink != nullptr && !pFrameSink->getError().empty());
+    };
+
+    while (parser.readNextNAL(nalUnit) && (bHeadless || pDisplay->isOpened()) && !hasWorkerError()) {
+        if (bHeadless) {
+            throughputSink.addBitstreamBytes(nalUnit.getBitstream().size());
+            parser.takeDiscardedPictures();
+        } else {
+            // Handle XEvent
+            pDisplay->processEvent();
+            mixer.setOutputSize(pDisplay->getScreenSize());
+
+            // Keep the time slots of the pictures dropped by the parser
+            for (int iPOC : parser.takeDiscardedPictures()) {
+                pPresentationQueue->skip(iPOC);
+            }
+        }
 
         switch (nalUnit.getType()) {
         case vw::NalType::SPS:
+            if (!bHeadless) {
+                pPresentationQueue->setReorderDepth(nalUnit.getH264Infos().iReorderDepth);
+            }
+            if (pFrameSink != nullptr) {
+                pFrameSink->setReorderDepth(nalUnit.getH264Infos().iReorderDepth);
+            }
+            if (pFrameHasher != nullptr) {
+                pFrameHasher->setReorderDepth(nalUnit.getH264Infos().iReorderDepth);
+            }
+            break;
+
         case vw::NalType::PPS:
         case vw::NalType::SEI:
             // Nothing to do
@@ -200,6 +636,21 @@ int main(int argc, char *argv[]) {
 
         case vw::NalType::CodedSliceNonIDR:
         case vw::NalType::CodedSliceIDR: {
+            bool bFirstSlice = nalUnit.getH264Infos().bFirstSliceOfPicture;
+            if (bQosEnabled) {
+                if (bFirstSlice) {
+                    qosController.update(pPresentationQueue->getCurrentTime(), pPresentationQueue->getScheduleEndTime());
+                }
+
+                if (!qosController.shouldDecode(nalUnit)) {
+                    // The time slot of a dropped picture is released once
+                    if (bFirstSlice) {
+                        pPresentationQueue->skip(nalUnit.getPictureOrderCount(), nalUnit.getH264Infos().presentationTimeStamp);
+                    }
+                    break;
+                }
+            }
+
             if (bBenchmarkEnabled) {
                 clock.start();
             }
@@ -213,7 +664,14 @@ int main(int argc, char *argv[]) {
             }
 
             if (bCopyYUV) {
-                decodedSurface.copyHardwareMemory();
+                // The asynchronous readback only waits when all the slots are used
+                if (pAsyncReadback != nullptr) {
+                    pAsyncReadback->submit(decodedSurface);
+                } else if (frameHandler) {
+                    frameHandler(decodedSurface.copyHardwareMemory(readbackPool, frameFormat), decodedSurface.getSize(), decodedSurface.getPictureOrderCount());
+                } else {
+                    decodedSurface.copyHardwareMemory(readbackPool);
+                }
                 if (bBenchmarkEnabled) {
                     auto elapsedTime = clock.restart();
                     listDecodedSurfaceTransferTimes.push_back(elapsedTime);
@@ -222,6 +680,13 @@ int main(int argc, char *argv[]) {
                 }
             }
 
+            if (bQosEnabled && !qosController.shouldPostProcess(nalUnit)) {
+                if (bFirstSlice) {
+                    pPresentationQueue->skip(decodedSurface.getPictureOrderCount(), decodedSurface.getPresentationTimeStamp());
+                }
+                break;
+            }
+
             vw::RenderSurface outputSurface = mixer.process(decodedSurface);
             if (bBenchmarkEnabled) {
                 auto elapsedTime = clock.restart();
@@ -231,7 +696,17 @@ int main(int argc, char *argv[]) {
             }
 
             if (bCopyBGRA) {
-                outputSurface.copyHardwareMemory();
+                // With the asynchronous readback, the surface is displayed once copied
+                if (pAsyncReadback != nullptr) {
+                    if (bFirstSlice) {
+                        readbackContinuationSurfaces.erase(outputSurface.getVdpHandle());
+                    } else {
+                        readbackContinuationSurfaces.insert(outputSurface.getVdpHandle());
+                    }
+                    pAsyncReadback->submit(std::move(outputSurface));
+                } else {
+                    outputSurface.copyHardwareMemory(readbackPool);
+                }
                 if (bBenchmarkEnabled) {
                     auto elapsedTime = clock.restart();
                     listRenderSurfaceTransferTimes.push_back(elapsedTime);
@@ -240,20 +715,17 @@ int main(int argc, char *argv[]) {
                 }
             }
 
-            presentationQueue.enqueue(std::move(outputSurface));
-            if (bBenchmarkEnabled) {
-                auto elapsedTime = clock.restart();
-                listDisplayTimes.push_back(elapsedTime);
-                totalTime += elapsedTime;
-                listTotalTimes.push_back(totalTime);
-                std::cout << "[main] Display time: " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTime).count() << " ms" << std::endl;
-                std::cout << "[main] Total time: " << std::chrono::duration_cast<std::chrono::milliseconds>(totalTime).count() << " ms" << std::endl;
-                std::cout << std::endl;
+            if (bCopyBGRA && pAsyncReadback != nullptr) {
+                while (auto completedSurface = pAsyncReadback->takeCompletedSurface()) {
+                    bool bCompletedFirstSlice = readbackContinuationSurfaces.erase(completedSurface->getVdpHandle()) == 0;
+                    presentSurface(std::move(*completedSurface), bCompletedFirstSlice);
+                }
+            } else {
+                presentSurface(std::move(outputSurface), bFirstSlice);
             }
 
             if (bManualFramerate) {
-                std::chrono::duration<double> framerate(1.0 / iFPS);
-                std::this_thread::sleep_for(framerate);
+                framePacer.waitNextFrame();
             }
             break;
         }
@@ -268,6 +740,85 @@ int main(int argc, char *argv[]) {
     }
 
     std::cout << "[main] End of parsing" << std::endl;
+    if (pAsyncReadback != nullptr) {
+        pAsyncReadback->flush();
+        while (auto completedSurface = pAsyncReadback->takeCompletedSurface()) {
+            bool bCompletedFirstSlice = readbackContinuationSurfaces.erase(completedSurface->getVdpHandle()) == 0;
+            presentSurface(std::move(*completedSurface), bCompletedFirstSlice);
+        }
+    }
+    int iExitCode = 0;
+    if (pAsyncReadback != nullptr) {
+        std::string szError = pAsyncReadback->getError();
+        if (!szError.empty()) {
+            std::cerr << "[main] " << szError << std::endl;
+            iExitCode = 1;
+        }
+    }
+    if (pFrameSink != nullptr) {
+        pFrameSink->flush();
+
+        std::string szError = pFrameSink->getError();
+        if (!szError.empty()) {
+            std::cerr << "[main] " << szError << std::endl;
+            iExitCode = 1;
+        }
+
+        auto sinkStatistics = pFrameSink->getStatistics();
+        std::cout << "[main] Output: frames = " << sinkStatistics.frames
+            << " ; bytes = " << sinkStatistics.bytes
+            << " ; batches = " << sinkStatistics.batches
+            << " ; stalls = " << sinkStatistics.stalls
+            << " (" << std::chrono::duration_cast<std::chrono::milliseconds>(sinkStatistics.stallTime).count() << " ms)"
+            << " ; " << (sinkStatistics.bSpliced ? "vmsplice" : "writev") << std::endl;
+    }
+    if (pFrameHasher != nullptr) {
+        pFrameHasher->flush();
+
+        auto hasherStatistics = pFrameHasher->getStatistics();
+        double hashSeconds = std::chrono::duration<double>(hasherStatistics.hashTime).count();
+        std::cout << "[main] Checksums: frames = " << hasherStatistics.frames
+            << " ; " << vw::getChecksumName(checksumAlgorithm)
+            << " ; " << (hashSeconds > 0.0 ? hasherStatistics.bytes / hashSeconds / 1e6 : 0.0) << " MB/s"
+            << " ; stalls = " << hasherStatistics.stalls << std::endl;
+    }
+    if (bHeadless) {
+        auto throughputStatistics = throughputSink.getStatistics();
+        std::cout << "[main] Headless throughput: frames = " << throughputStatistics.frames
+            << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(throughputStatistics.elapsedTime).count() << " ms"
+            << " ; " << throughputStatistics.framesPerSecond << " frames/s"
+            << " ; bitstream = " << throughputStatistics.bitstreamMegabytesPerSecond << " MB/s"
+            << " ; output = " << throughputStatistics.outputMegabytesPerSecond << " MB/s" << std::endl;
+    } else {
+        pPresentationQueue->flush();
+    }
+    if (pMockBackend != nullptr) {
+        auto printMockStatistics = [pMockBackend](vw::MockCall call, const std::string& szName) {
+            auto mockStatistics = pMockBackend->getStatistics(call);
+            std::cout << "[main] Mock " << szName << ": calls = " << mockStatistics.calls
+                << " ; simulated latency = " << std::chrono::duration_cast<std::chrono::milliseconds>(mockStatistics.totalLatency).count() << " ms" << std::endl;
+        };
+
+        printMockStatistics(vw::MockCall::DecoderRender, "decoder render");
+        printMockStatistics(vw::MockCall::VideoMixerRender, "video mixer render");
+        printMockStatistics(vw::MockCall::GetBits, "get bits");
+    }
+    if (bQosEnabled) {
+        const auto& qosStatistics = qosController.getStatistics();
+        std::cout << "[main] QoS dropped pictures: presentation = " << qosStatistics.droppedPresentations
+            << " ; post-process = " << qosStatistics.droppedPostProcesses
+            << " ; decode = " << qosStatistics.droppedDecodes << std::endl;
+    }
+    if (bManualFramerate) {
+        auto pacerStatistics = framePacer.getStatistics();
+        std::cout << "[main] Frame pacing: frames = " << pacerStatistics.frames
+            << " ; late = " << pacerStatistics.lateFrames
+            << " ; resyncs = " << pacerStatistics.resyncs << std::endl;
+        std::cout << "[main] Frame pacing jitter: min = " << pacerStatistics.minJitter.count()
+            << " ns ; max = " << pacerStatistics.maxJitter.count()
+            << " ns ; mean = " << pacerStatistics.meanJitter.count()
+            << " ns ; stddev = " << pacerStatistics.stddevJitter.count() << " ns" << std::endl;
+    }
     if (bBenchmarkEnabled) {
         std::cout << std::endl;
         std::cout << "[main] Benchmarks stats:" << std::endl;
@@ -291,11 +842,34 @@ int main(int argc, char *argv[]) {
         }
         computeState(listDisplayTimes, "Display time");
         computeState(listTotalTimes, "Total time");
+
+        if (bSurfaceReclaim) {
+            auto occupancy = surfacePool.getOccupancy();
+            std::cout << "[main] Surface pool: allocated = " << occupancy.allocatedSurfaces << " ; used = " << occupancy.usedSurfaces << " ; peak used = " << occupancy.peakUsedSurfaces << std::endl;
+        }
+
+        if (bCopyYUV || bCopyBGRA) {
+            auto poolStatistics = readbackPool.getStatistics();
+            std::cout << "[main] Readback pool: buffers = " << poolStatistics.allocatedBuffers << " ; allocations = " << poolStatistics.allocations << std::endl;
+        }
+
+        if (pAsyncReadback != nullptr) {
+            auto readbackStatistics = pAsyncReadback->getStatistics();
+            auto meanTime = [](std::chrono::nanoseconds totalTime, uint64_t count) {
+                return count > 0 ? std::chrono::duration_cast<std::chrono::microseconds>(totalTime).count() / static_cast<double>(count) : 0.0;
+            };
+
+            std::cout << "[main] Async readback: YUV = " << readbackStatistics.decodedSurfaces
+                << " (mean " << meanTime(readbackStatistics.decodedSurfaceTime, readbackStatistics.decodedSurfaces) << " µs)"
+                << " ; BGRA = " << readbackStatistics.renderSurfaces
+                << " (mean " << meanTime(readbackStatistics.renderSurfaceTime, readbackStatistics.renderSurfaces) << " µs)"
+                << " ; stalls = " << readbackStatistics.stalls << std::endl;
+        }
     }
 
-    while (display.isOpened()) {
-        display.waitEvent();
+    while (!bHeadless && pDisplay->isOpened()) {
+        pDisplay->waitEvent();
     }
 
-    return 0;
+    return iExitCode;
 }
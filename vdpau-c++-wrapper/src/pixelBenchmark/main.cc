@@ -0,0 +1,382 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <VdpWrapper/ImageBuffer.h>
+#include <VdpWrapper/PixelConversion.h>
+#include <VdpWrapper/Size.h>
+#include <VdpWrapper/SoftwareMixer.h>
+
+namespace {
+    struct Resolution {
+        std::string name;
+        vw::SizeU size;
+    };
+
+    struct Kernel {
+        std::string name;
+        std::function<void()> run;
+        std::function<std::vector<uint8_t>()> output;
+        std::size_t bytes;  // Bytes read and written by one run
+    };
+
+    void printUsage(const std::string& commandName, const std::string& message) {
+        std::cerr << message << std::endl;
+        std::cerr << "Usage:" << std::endl;
+        std::cerr << "\t" << commandName << " [OPTION...]" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "\t--iterations <COUNT>\t\t\tSet the number of conversions per measure (default: 20)" << std::endl;
+        std::cerr << "\t--size <width>x<height>\t\t\tMeasure this size instead of 1080p, 4K and 8K" << std::endl;
+        std::cerr << "\t--output-size <width>x<height>\t\tSet the software mixer output size (default: 1280x720)" << std::endl;
+    }
+
+    void fillPattern(uint8_t* pData, std::size_t size, uint32_t seed) {
+        for (std::size_t i = 0; i < size; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            pData[i] = seed >> 24;
+        }
+    }
+
+    void fillPattern(vw::ImageBuffer& buffer, uint32_t seed) {
+        fillPattern(buffer.getPlane(0), buffer.getDataSize(), seed);
+    }
+
+    // Only the visible bytes are compared, the padding is left untouched by the kernels
+    std::vector<uint8_t> readVisibleBytes(const vw::ImageBuffer& buffer) {
+        std::vector<uint8_t> bytes;
+        for (uint32_t i = 0; i < buffer.getPlaneCount(); ++i) {
+            uint32_t lineSize = vw::ImageBuffer::getPackedLineSize(buffer.getFormat(), buffer.getSize(), i);
+            for (uint32_t y = 0; y < buffer.getPlaneHeight(i); ++y) {
+                const uint8_t* pLine = buffer.getPlane(i) + static_cast<std::size_t>(y) * buffer.getLineSize(i);
+                bytes.insert(bytes.end(), pLine, pLine + lineSize);
+            }
+        }
+
+        return bytes;
+    }
+
+    std::vector<vw::SimdLevel> getAvailableLevels() {
+        std::vector<vw::SimdLevel> levels = { vw::SimdLevel::Scalar };
+        for (auto level : { vw::SimdLevel::SSSE3, vw::SimdLevel::AVX2 }) {
+            if (level <= vw::getSupportedSimdLevel()) {
+                levels.push_back(level);
+            }
+        }
+
+        return levels;
+    }
+
+    bool parseSize(const std::string& szSize, vw::SizeU& size) {
+        unsigned width = 0;
+        unsigned height = 0;
+        if (std::sscanf(szSize.c_str(), "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+            return false;
+        }
+
+        size = vw::SizeU(width, height);
+        return true;
+    }
+
+    // Straightforward per-pixel scaling and conversion, the reference of the software mixer
+    class NaiveMixer {
+    public:
+        NaiveMixer(vw::ScalingFilter filter)
+        : m_filter(filter) {
+
+        }
+
+        void process(const vw::ImageBuffer& input, vw::ImageBuffer& output) const {
+            vw::SizeU inputSize = input.getSize();
+            vw::SizeU outputSize = output.getSize();
+            uint32_t chromaWidth = (inputSize.width + 1) / 2;
+            uint32_t chromaHeight = (inputSize.height + 1) / 2;
+
+            for (uint32_t y = 0; y < outputSize.height; ++y) {
+                for (uint32_t x = 0; x < outputSize.width; ++x) {
+                    double lumaX = (x + 0.5) * inputSize.width / outputSize.width - 0.5;
+                    double lumaY = (y + 0.5) * inputSize.height / outputSize.height - 0.5;
+                    double chromaX = (x + 0.5) * inputSize.width / 2.0 / outputSize.width - 0.5;
+                    double chromaY = (y + 0.5) * inputSize.height / 2.0 / outputSize.height - 0.5;
+
+                    double luma = sample(input, 0, 1, 0, inputSize.width, inputSize.height, lumaX, lumaY) - 16.0;
+                    double u = sample(input, 1, 2, 0, chromaWidth, chromaHeight, chromaX, chromaY) - 128.0;
+                    double v = sample(input, 1, 2, 1, chromaWidth, chromaHeight, chromaX, chromaY) - 128.0;
+
+                    // BT.601 limited range to full range
+                    luma *= 255.0 / 219.0;
+                    u *= 255.0 / 224.0;
+                    v *= 255.0 / 224.0;
+                    uint8_t* pPixel = output.getPlane(0) + static_cast<std::size_t>(y) * output.getLineSize(0) + 4 * x;
+                    pPixel[0] = clamp(luma + 1.772 * u);
+                    pPixel[1] = clamp(luma - 0.344136 * u - 0.714136 * v);
+                    pPixel[2] = clamp(luma + 1.402 * v);
+                    pPixel[3] = 0xFF;
+                }
+            }
+        }
+
+    private:
+        double weight(double distance) const {
+            distance = std::abs(distance);
+            if (m_filter == vw::ScalingFilter::Bilinear) {
+                return std::max(0.0, 1.0 - distance);
+            }
+
+            if (distance <= 1.0) {
+                return 1.5 * distance * distance * distance - 2.5 * distance * distance + 1.0;
+            }
+
+            if (distance < 2.0) {
+                return -0.5 * distance * distance * distance + 2.5 * distance * distance - 4.0 * distance + 2.0;
+            }
+
+            return 0.0;
+        }
+
+        double sample(const vw::ImageBuffer& input, uint32_t plane, int step, int component, uint32_t width, uint32_t height, double x, double y) const {
+            int radius = m_filter == vw::ScalingFilter::Bicubic ? 2 : 1;
+            int firstX = static_cast<int>(std::floor(x)) - radius + 1;
+            int firstY = static_cast<int>(std::floor(y)) - radius + 1;
+
+            double value = 0.0;
+            for (int j = firstY; j < firstY + 2 * radius; ++j) {
+                int line = std::min(std::max(j, 0), static_cast<int>(height) - 1);
+                for (int i = firstX; i < firstX + 2 * radius; ++i) {
+                    int column = std::min(std::max(i, 0), static_cast<int>(width) - 1);
+                    const uint8_t* pLine = input.getPlane(plane) + static_cast<std::size_t>(line) * input.getLineSize(plane);
+                    value += weight(x - i) * weight(y - j) * pLine[column * step + component];
+                }
+            }
+
+            return value;
+        }
+
+        static uint8_t clamp(double value) {
+            return static_cast<uint8_t>(std::min(std::max(std::lrint(value), 0l), 255l));
+        }
+
+    private:
+        vw::ScalingFilter m_filter;
+    };
+
+    bool runMixerBenchmark(const Resolution& resolution, vw::SizeU outputSize, int iIterations) {
+        vw::ImageBuffer nv12Image(vw::PixelFormat::NV12, resolution.size);
+        fillPattern(nv12Image, 4);
+        vw::ImageBuffer referenceOutput(vw::PixelFormat::B8G8R8A8, outputSize);
+        vw::ImageBuffer mixerOutput(vw::PixelFormat::B8G8R8A8, outputSize);
+        vw::SoftwareMixer mixer(outputSize);
+
+        bool bSuccess = true;
+        for (auto filter : { vw::ScalingFilter::Bilinear, vw::ScalingFilter::Bicubic }) {
+            std::string szFilter = filter == vw::ScalingFilter::Bicubic ? "bicubic" : "bilinear";
+
+            // The naive version is slow, a single run is enough
+            NaiveMixer naiveMixer(filter);
+            auto start = std::chrono::steady_clock::now();
+            naiveMixer.process(nv12Image, referenceOutput);
+            std::chrono::duration<double, std::milli> naiveTime = std::chrono::steady_clock::now() - start;
+            auto reference = readVisibleBytes(referenceOutput);
+
+            mixer.setScalingFilter(filter);
+            mixer.process(nv12Image, mixerOutput);
+            auto output = readVisibleBytes(mixerOutput);
+            int maxDifference = 0;
+            for (std::size_t i = 0; i < output.size(); ++i) {
+                maxDifference = std::max(maxDifference, std::abs(output[i] - reference[i]));
+            }
+
+            // Rounding of the intermediate float values may move a component by one
+            bool bMatch = maxDifference <= 1;
+            bSuccess = bSuccess && bMatch;
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iIterations; ++i) {
+                mixer.process(nv12Image, mixerOutput);
+            }
+            std::chrono::duration<double, std::milli> elapsedTime = std::chrono::steady_clock::now() - start;
+            double frameTime = elapsedTime.count() / iIterations;
+
+            std::cout << "[main] " << std::setw(6) << resolution.name << " ; mixer " << szFilter
+                << " -> " << outputSize.width << "x" << outputSize.height
+                << " ; " << mixer.getThreadCount() << " threads"
+                << " ; naive = " << std::fixed << std::setprecision(3) << naiveTime.count() << " ms"
+                << " ; " << frameTime << " ms"
+                << " ; speedup = " << std::setprecision(2) << naiveTime.count() / frameTime << "x"
+                << " ; max difference = " << maxDifference
+                << (bMatch ? "" : " ; MISMATCH with the naive output") << std::endl;
+        }
+
+        return bSuccess;
+    }
+
+    bool runBenchmark(const Resolution& resolution, int iIterations) {
+        vw::SizeU size = resolution.size;
+        std::size_t pixels = static_cast<std::size_t>(size.width) * size.height;
+
+        // Packed 3 bytes pixels as decoded by OpenCV, one line after the other
+        std::vector<uint8_t> bgrImage(pixels * 3);
+        fillPattern(bgrImage.data(), bgrImage.size(), 1);
+        vw::ImageBuffer bgraImage(vw::PixelFormat::B8G8R8A8, size);
+
+        vw::ImageBuffer nv12Image(vw::PixelFormat::NV12, size);
+        fillPattern(nv12Image, 2);
+        vw::ImageBuffer i420Image(vw::PixelFormat::I420, size);
+        fillPattern(i420Image, 3);
+        vw::ImageBuffer i420Output(vw::PixelFormat::I420, size);
+        vw::ImageBuffer nv12Output(vw::PixelFormat::NV12, size);
+        vw::ImageBuffer yuyvOutput(vw::PixelFormat::YUYV, size);
+
+        std::size_t nv12Bytes = vw::ImageBuffer::getPackedSize(vw::PixelFormat::NV12, size);
+        std::size_t bgraBytes = vw::ImageBuffer::getPackedSize(vw::PixelFormat::B8G8R8A8, size);
+        std::size_t yuyvBytes = vw::ImageBuffer::getPackedSize(vw::PixelFormat::YUYV, size);
+
+        auto expand = [&](bool bRGB) {
+            for (uint32_t y = 0; y < size.height; ++y) {
+                const uint8_t* pSource = bgrImage.data() + static_cast<std::size_t>(y) * size.width * 3;
+                uint8_t* pDestination = bgraImage.getPlane(0) + static_cast<std::size_t>(y) * bgraImage.getLineSize(0);
+                if (bRGB) {
+                    vw::convertRGBToBGRA(pSource, pDestination, size.width);
+                } else {
+                    vw::convertBGRToBGRA(pSource, pDestination, size.width);
+                }
+            }
+        };
+
+        std::vector<Kernel> kernels = {
+            { "bgr -> bgra", [&]() { expand(false); }, [&]() { return readVisibleBytes(bgraImage); }, pixels * 3 + bgraBytes },
+            { "rgb -> bgra", [&]() { expand(true); }, [&]() { return readVisibleBytes(bgraImage); }, pixels * 3 + bgraBytes },
+            { "nv12 -> i420", [&]() { vw::convertImage(nv12Image, i420Output); }, [&]() { return readVisibleBytes(i420Output); }, 2 * nv12Bytes },
+            { "i420 -> nv12", [&]() { vw::convertImage(i420Image, nv12Output); }, [&]() { return readVisibleBytes(nv12Output); }, 2 * nv12Bytes },
+            { "nv12 -> yuyv", [&]() { vw::convertImage(nv12Image, yuyvOutput); }, [&]() { return readVisibleBytes(yuyvOutput); }, nv12Bytes + yuyvBytes },
+        };
+
+        bool bSuccess = true;
+        for (auto& kernel : kernels) {
+            std::vector<uint8_t> reference;
+            double scalarTime = 0.0;
+
+            for (auto level : getAvailableLevels()) {
+                vw::setSimdLevel(level);
+
+                // Warm up the caches and the page tables, then check against the scalar output
+                kernel.run();
+                auto output = kernel.output();
+                bool bMatch = true;
+                if (level == vw::SimdLevel::Scalar) {
+                    reference = std::move(output);
+                } else {
+                    bMatch = output == reference;
+                    bSuccess = bSuccess && bMatch;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iIterations; ++i) {
+                    kernel.run();
+                }
+                std::chrono::duration<double, std::milli> elapsedTime = std::chrono::steady_clock::now() - start;
+                double frameTime = elapsedTime.count() / iIterations;
+                if (level == vw::SimdLevel::Scalar) {
+                    scalarTime = frameTime;
+                }
+
+                std::cout << "[main] " << std::setw(6) << resolution.name << " ; " << std::setw(12) << kernel.name
+                    << " ; " << std::setw(6) << vw::getSimdLevelName(level)
+                    << " ; " << std::fixed << std::setprecision(3) << frameTime << " ms"
+                    << " ; " << std::setprecision(2) << kernel.bytes / (frameTime * 1e6) << " GB/s"
+                    << " ; speedup = " << scalarTime / frameTime << "x"
+                    << (bMatch ? "" : " ; MISMATCH with the scalar output") << std::endl;
+            }
+        }
+
+        vw::setSimdLevel(vw::getSupportedSimdLevel());
+        return bSuccess;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iCurrentArg = 1;
+    int iIterations = 20;
+    vw::SizeU outputSize(1280, 720);
+    std::vector<Resolution> resolutions = {
+        { "1080p", vw::SizeU(1920, 1080) },
+        { "4K", vw::SizeU(3840, 2160) },
+        { "8K", vw::SizeU(7680, 4320) },
+    };
+
+    while (iCurrentArg < argc) {
+        std::string szArg = std::string(argv[iCurrentArg]);
+        if (szArg == "--iterations" && iCurrentArg + 1 < argc) {
+            try {
+                iIterations = std::stoi(argv[iCurrentArg + 1]);
+            } catch (std::logic_error &e) {
+                iIterations = 0;
+            }
+
+            if (iIterations <= 0) {
+                printUsage(argv[0], "Wrong iteration count");
+                return 1;
+            }
+
+            iCurrentArg += 2;
+        } else if (szArg == "--size" && iCurrentArg + 1 < argc) {
+            std::string szSize = argv[iCurrentArg + 1];
+            vw::SizeU size;
+            if (!parseSize(szSize, size)) {
+                printUsage(argv[0], "Wrong size value");
+                return 1;
+            }
+
+            resolutions = { { szSize, size } };
+            iCurrentArg += 2;
+        } else if (szArg == "--output-size" && iCurrentArg + 1 < argc) {
+            if (!parseSize(argv[iCurrentArg + 1], outputSize)) {
+                printUsage(argv[0], "Wrong output size value");
+                return 1;
+            }
+
+            iCurrentArg += 2;
+        } else {
+            printUsage(argv[0], "'" + szArg + "' unknown option");
+            return 1;
+        }
+    }
+
+    std::cout << "[main] Supported SIMD level: " << vw::getSimdLevelName(vw::getSupportedSimdLevel()) << std::endl;
+
+    bool bSuccess = true;
+    for (const auto& resolution : resolutions) {
+        bSuccess = runBenchmark(resolution, iIterations) && bSuccess;
+        bSuccess = runMixerBenchmark(resolution, outputSize, iIterations) && bSuccess;
+    }
+
+    return bSuccess ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FrameComparator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <limits>
+#include <utility>
+
+namespace {
+    // Combined PSNR of the three planes, from their total squared error
+    double getCombinedPsnr(const std::array<uint64_t, 3>& squaredErrors, const std::array<uint64_t, 3>& samples) {
+        uint64_t squaredError = squaredErrors[0] + squaredErrors[1] + squaredErrors[2];
+        return vw::computePsnr(squaredError, samples[0] + samples[1] + samples[2]);
+    }
+
+    // Combined SSIM of the three planes, weighted by their number of samples
+    double getCombinedSsim(const std::array<double, 3>& ssims, const std::array<uint64_t, 3>& samples) {
+        double totalSamples = static_cast<double>(samples[0] + samples[1] + samples[2]);
+        return (ssims[0] * samples[0] + ssims[1] * samples[1] + ssims[2] * samples[2]) / totalSamples;
+    }
+
+    // The identical planes have an infinite PSNR, written as "inf" like ffmpeg
+    void writePsnr(std::ostream& output, double psnr) {
+        if (std::isinf(psnr)) {
+            output << "inf";
+        } else {
+            output << std::fixed << std::setprecision(4) << psnr;
+        }
+    }
+
+    void writeSsim(std::ostream& output, double ssim) {
+        output << std::fixed << std::setprecision(6) << ssim;
+    }
+}
+
+FrameComparator::FrameComparator(std::ostream& frameCsv, std::size_t iThreadCount)
+: m_frameCsv(frameCsv)
+, m_iNextFrameIndex(0)
+, m_iNextWrittenIndex(0)
+, m_summary{0, {}, {}, {}, std::numeric_limits<double>::infinity(), 1.0, 0}
+, m_queue(2 * iThreadCount, iThreadCount, [this](Job& job) {
+    compareJob(job);
+}) {
+    m_frameCsv << "frame,psnr_y,psnr_u,psnr_v,psnr,ssim_y,ssim_u,ssim_v,ssim" << std::endl;
+}
+
+FrameComparator::~FrameComparator() {
+    m_queue.stop();
+}
+
+void FrameComparator::compare(vw::ImageFrame frame, vw::ImageFrame reference, vw::SizeU size) {
+    // Backpressure: the decoder can't get more than depth frames ahead of the workers
+    m_queue.push({ m_iNextFrameIndex, std::move(frame), std::move(reference), size });
+    ++m_iNextFrameIndex;
+}
+
+void FrameComparator::flush() {
+    m_queue.flush();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frameCsv.flush();
+}
+
+std::string FrameComparator::getError() const {
+    return m_queue.getError();
+}
+
+QualitySummary FrameComparator::getSummary() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_summary;
+}
+
+void FrameComparator::writeSummary(const QualitySummary& summary, std::ostream& output) {
+    output << "frames,psnr_y,psnr_u,psnr_v,psnr,psnr_min,ssim_y,ssim_u,ssim_v,ssim,ssim_min,worst_frame" << std::endl;
+    output << summary.frames;
+
+    // The PSNR comes from the mean squared error of the whole stream, the SSIM is the mean of the frames
+    for (int index = 0; index < 3; ++index) {
+        output << ",";
+        writePsnr(output, vw::computePsnr(summary.squaredErrors[index], summary.samples[index]));
+    }
+    output << ",";
+    writePsnr(output, getCombinedPsnr(summary.squaredErrors, summary.samples));
+    output << ",";
+    writePsnr(output, summary.minimumPsnr);
+
+    std::array<double, 3> ssims = {};
+    for (int index = 0; index < 3; ++index) {
+        ssims[index] = (summary.frames > 0) ? summary.ssimSums[index] / summary.frames : 0.0;
+        output << ",";
+        writeSsim(output, ssims[index]);
+    }
+    output << ",";
+    writeSsim(output, (summary.frames > 0) ? getCombinedSsim(ssims, summary.samples) : 0.0);
+    output << ",";
+    writeSsim(output, summary.minimumSsim);
+
+    output << "," << summary.worstFrame << std::endl;
+}
+
+void FrameComparator::compareJob(Job& job) {
+    std::vector<vw::PlaneQuality> qualities;
+    std::exception_ptr pError;
+    try {
+        qualities = vw::compareImages(*job.frame, *job.reference, job.size);
+    } catch (const std::exception&) {
+        pError = std::current_exception();
+    }
+
+    // The buffers go back to the pool before waiting for the lock
+    job.frame.reset();
+    job.reference.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The results are written in frame order, whichever worker finishes first
+        m_completedResults.emplace(job.iFrameIndex, std::move(qualities));
+        while (!m_completedResults.empty() && m_completedResults.begin()->first == m_iNextWrittenIndex) {
+            writeResult(m_iNextWrittenIndex, m_completedResults.begin()->second);
+            m_completedResults.erase(m_completedResults.begin());
+            ++m_iNextWrittenIndex;
+        }
+    }
+
+    // A failed comparison leaves an empty result, so the next frames are still written
+    if (pError != nullptr) {
+        std::rethrow_exception(pError);
+    }
+}
+
+void FrameComparator::writeResult(uint64_t iFrameIndex, const std::vector<vw::PlaneQuality>& qualities) {
+    // A failed comparison is reported by getError()
+    if (qualities.size() != 3) {
+        return;
+    }
+
+    std::array<uint64_t, 3> squaredErrors = {};
+    std::array<uint64_t, 3> samples = {};
+    std::array<double, 3> ssims = {};
+    for (int index = 0; index < 3; ++index) {
+        squaredErrors[index] = qualities[index].squaredError;
+        samples[index] = qualities[index].samples;
+        ssims[index] = qualities[index].ssim;
+    }
+
+    double psnr = getCombinedPsnr(squaredErrors, samples);
+    double ssim = getCombinedSsim(ssims, samples);
+
+    m_frameCsv << iFrameIndex;
+    for (int index = 0; index < 3; ++index) {
+        m_frameCsv << ",";
+        writePsnr(m_frameCsv, vw::computePsnr(squaredErrors[index], samples[index]));
+    }
+    m_frameCsv << ",";
+    writePsnr(m_frameCsv, psnr);
+    for (int index = 0; index < 3; ++index) {
+        m_frameCsv << ",";
+        writeSsim(m_frameCsv, ssims[index]);
+    }
+    m_frameCsv << ",";
+    writeSsim(m_frameCsv, ssim);
+    m_frameCsv << "\n";
+
+    ++m_summary.frames;
+    for (int index = 0; index < 3; ++index) {
+        m_summary.squaredErrors[index] += squaredErrors[index];
+        m_summary.samples[index] += samples[index];
+        m_summary.ssimSums[index] += ssims[index];
+    }
+    m_summary.minimumPsnr = std::min(m_summary.minimumPsnr, psnr);
+    if (ssim < m_summary.minimumSsim || m_summary.frames == 1) {
+        m_summary.minimumSsim = ssim;
+        m_summary.worstFrame = iFrameIndex;
+    }
+}
@@ -0,0 +1,140 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_FRAME_COMPARATOR_H
+#define LOCAL_FRAME_COMPARATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/ImageMetrics.h>
+#include <VdpWrapper/Size.h>
+#include <VdpWrapper/WorkerQueue.h>
+
+/**
+ * @brief Aggregate quality of all the compared frames
+ */
+struct QualitySummary {
+    uint64_t frames;                        ///< Number of compared frames
+    std::array<uint64_t, 3> squaredErrors;  ///< Total squared error of each plane
+    std::array<uint64_t, 3> samples;        ///< Total number of samples of each plane
+    std::array<double, 3> ssimSums;         ///< Sum of the per-frame SSIM of each plane
+    double minimumPsnr;                     ///< Lowest per-frame PSNR of the combined planes
+    double minimumSsim;                     ///< Lowest per-frame SSIM of the combined planes
+    uint64_t worstFrame;                    ///< Index of the frame with the lowest SSIM
+};
+
+/**
+ * @brief FrameComparator computes the PSNR and SSIM of the decoded frames on worker threads
+ *
+ * The frames are compared in parallel, one frame per worker, then the results
+ * are written in frame order as CSV lines. At most twice the thread count of
+ * frames wait or are being compared, compare() blocks beyond, so the memory
+ * doesn't depend on the stream duration.
+ */
+class FrameComparator {
+public:
+    /**
+     * @brief Start the workers and write the CSV header
+     *
+     * @param frameCsv The stream receiving the per-frame CSV, it must outlive the FrameComparator
+     * @param iThreadCount Number of worker threads
+     */
+    FrameComparator(std::ostream& frameCsv, std::size_t iThreadCount);
+    /**
+     * @brief Compare the remaining frames and stop the workers
+     */
+    ~FrameComparator();
+
+    FrameComparator(const FrameComparator&) = delete;
+    FrameComparator(FrameComparator&&) = delete;
+
+    FrameComparator& operator=(const FrameComparator&) = delete;
+    FrameComparator& operator=(FrameComparator&&) = delete;
+
+    /**
+     * @brief Queue the comparison of the next frame
+     *
+     * The frames are numbered in call order, compare() must be called from a single thread.
+     *
+     * @param frame The decoded frame, in I420 format
+     * @param reference The reference frame, in I420 format
+     * @param size The compared area
+     */
+    void compare(vw::ImageFrame frame, vw::ImageFrame reference, vw::SizeU size);
+
+    /**
+     * @brief Wait for all the queued comparisons
+     */
+    void flush();
+
+    /**
+     * @brief Get the error which stopped a worker
+     *
+     * @return std::string The error message, empty if none
+     */
+    std::string getError() const;
+
+    /**
+     * @brief Get the aggregate quality of the written frames
+     *
+     * @return QualitySummary The summary
+     */
+    QualitySummary getSummary() const;
+
+    /**
+     * @brief Write the summary as a CSV header and line
+     *
+     * @param summary The summary
+     * @param output The CSV stream
+     */
+    static void writeSummary(const QualitySummary& summary, std::ostream& output);
+
+private:
+    struct Job {
+        uint64_t iFrameIndex;
+        vw::ImageFrame frame;
+        vw::ImageFrame reference;
+        vw::SizeU size;
+    };
+
+    void compareJob(Job& job);
+    void writeResult(uint64_t iFrameIndex, const std::vector<vw::PlaneQuality>& qualities);
+
+private:
+    std::ostream& m_frameCsv;
+    uint64_t m_iNextFrameIndex;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_iNextWrittenIndex;
+    std::map<uint64_t, std::vector<vw::PlaneQuality>> m_completedResults;
+    QualitySummary m_summary;
+    vw::WorkerQueue<Job> m_queue;
+};
+
+#endif // LOCAL_FRAME_COMPARATOR_H
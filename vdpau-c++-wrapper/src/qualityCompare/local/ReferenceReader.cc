@@ -0,0 +1,213 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ReferenceReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <VdpWrapper/PixelConversion.h>
+#include <VdpWrapper/Y4MHeader.h>
+
+namespace {
+    // The pages already read are dropped from the page cache by chunks
+    const uint64_t DropChunkSize = 64 * 1024 * 1024;
+}
+
+ReferenceReader::ReferenceReader(const std::string& szFilename, vw::PixelFormat format, vw::SizeU size)
+: m_fd(-1)
+, m_bY4M(false)
+, m_format(format)
+, m_size(size)
+, m_iOffset(0)
+, m_iDroppedOffset(0) {
+    m_fd = ::open(szFilename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw std::runtime_error("[ReferenceReader] Couldn't open '" + szFilename + "': " + std::strerror(errno));
+    }
+
+    // The file is read once from the beginning to the end
+    ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    char signature[sizeof(vw::Y4MSignature) - 1];
+    ssize_t iSignatureSize = ::pread(m_fd, signature, sizeof(signature), 0);
+    if (iSignatureSize > 0 && vw::hasY4MSignature(signature, static_cast<std::size_t>(iSignatureSize))) {
+        m_bY4M = true;
+
+        try {
+            vw::Y4MHeader header = vw::parseY4MHeader(readLine());
+            m_format = header.format;
+            m_size = header.size;
+        } catch (...) {
+            ::close(m_fd);
+            throw;
+        }
+    }
+
+    if (m_format != vw::PixelFormat::NV12 && m_format != vw::PixelFormat::I420) {
+        ::close(m_fd);
+        throw std::runtime_error("[ReferenceReader] Only NV12 and I420 raw files are supported");
+    }
+
+    if (m_size.width == 0 || m_size.height == 0) {
+        ::close(m_fd);
+        throw std::runtime_error("[ReferenceReader] The picture size of '" + szFilename + "' isn't defined");
+    }
+}
+
+ReferenceReader::~ReferenceReader() {
+    ::close(m_fd);
+}
+
+bool ReferenceReader::isY4M() const {
+    return m_bY4M;
+}
+
+vw::SizeU ReferenceReader::getSize() const {
+    return m_size;
+}
+
+vw::ImageFrame ReferenceReader::readFrame(vw::ImageBufferPool& pool) {
+    if (m_bY4M) {
+        // Each frame starts with a FRAME line which may carry parameters
+        std::string szLine = readLine();
+        if (szLine.empty()) {
+            return vw::ImageFrame();
+        }
+
+        if (szLine.compare(0, sizeof(vw::Y4MFrameMarker) - 1, vw::Y4MFrameMarker) != 0) {
+            throw std::runtime_error("[ReferenceReader] Invalid Y4M frame header");
+        }
+    }
+
+    vw::ImageFrame frame = pool.acquire(m_format, m_size);
+    if (!readPlanes(*frame)) {
+        return vw::ImageFrame();
+    }
+
+    dropReadPages();
+
+    if (m_format == vw::PixelFormat::I420) {
+        return frame;
+    }
+
+    vw::ImageFrame convertedFrame = pool.acquire(vw::PixelFormat::I420, m_size);
+    vw::convertImage(*frame, *convertedFrame);
+
+    return convertedFrame;
+}
+
+std::string ReferenceReader::readLine() {
+    // The lines are short and only read once per frame, a byte at a time is enough
+    std::string szLine;
+    char character = 0;
+    while (szLine.size() < vw::Y4MMaxLineLength) {
+        ssize_t iRead = ::read(m_fd, &character, 1);
+        if (iRead < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (iRead <= 0) {
+            if (!szLine.empty()) {
+                throw std::runtime_error("[ReferenceReader] Truncated Y4M header");
+            }
+            return szLine;
+        }
+
+        ++m_iOffset;
+        if (character == '\n') {
+            return szLine;
+        }
+
+        szLine.push_back(character);
+    }
+
+    throw std::runtime_error("[ReferenceReader] Invalid Y4M header");
+}
+
+bool ReferenceReader::readPlanes(vw::ImageBuffer& buffer) {
+    // The pooled buffer lines may be padded, contiguous planes are read at once
+    std::vector<iovec> vectors;
+    for (uint32_t index = 0; index < buffer.getPlaneCount(); ++index) {
+        uint32_t iPackedLineSize = vw::ImageBuffer::getPackedLineSize(m_format, m_size, index);
+        uint32_t iLineCount = buffer.getPlaneHeight(index);
+        uint8_t* pPlane = buffer.getPlane(index);
+
+        if (buffer.getLineSize(index) == iPackedLineSize) {
+            vectors.push_back({ pPlane, static_cast<std::size_t>(iPackedLineSize) * iLineCount });
+        } else {
+            for (uint32_t iLine = 0; iLine < iLineCount; ++iLine) {
+                vectors.push_back({ pPlane + static_cast<std::size_t>(iLine) * buffer.getLineSize(index), iPackedLineSize });
+            }
+        }
+    }
+
+    std::size_t iIndex = 0;
+    while (iIndex < vectors.size()) {
+        int iCount = static_cast<int>(std::min<std::size_t>(IOV_MAX, vectors.size() - iIndex));
+        ssize_t iRead = ::readv(m_fd, &vectors[iIndex], iCount);
+        if (iRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw std::runtime_error(std::string("[ReferenceReader] Couldn't read the reference: ") + std::strerror(errno));
+        }
+
+        // Truncated last frame
+        if (iRead == 0) {
+            return false;
+        }
+
+        m_iOffset += static_cast<uint64_t>(iRead);
+
+        // Skip what was read, a partial read resumes in the middle of a vector
+        std::size_t iRemaining = static_cast<std::size_t>(iRead);
+        while (iIndex < vectors.size() && iRemaining >= vectors[iIndex].iov_len) {
+            iRemaining -= vectors[iIndex].iov_len;
+            ++iIndex;
+        }
+
+        if (iRemaining > 0) {
+            vectors[iIndex].iov_base = static_cast<uint8_t*>(vectors[iIndex].iov_base) + iRemaining;
+            vectors[iIndex].iov_len -= iRemaining;
+        }
+    }
+
+    return true;
+}
+
+void ReferenceReader::dropReadPages() {
+    if (m_iOffset - m_iDroppedOffset < DropChunkSize) {
+        return;
+    }
+
+    ::posix_fadvise(m_fd, static_cast<off_t>(m_iDroppedOffset), static_cast<off_t>(m_iOffset - m_iDroppedOffset), POSIX_FADV_DONTNEED);
+    m_iDroppedOffset = m_iOffset;
+}
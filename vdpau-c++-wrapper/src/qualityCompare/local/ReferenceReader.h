@@ -0,0 +1,106 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_REFERENCE_READER_H
+#define LOCAL_REFERENCE_READER_H
+
+#include <cstdint>
+#include <string>
+
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/Size.h>
+
+/**
+ * @brief ReferenceReader reads the frames of a reference YUV file one after the other
+ *
+ * Two kinds of files are supported:
+ *  - raw files where the frames follow each other without header, the format
+ *    and the size must be provided
+ *  - YUV4MPEG2 (Y4M) files, where the size comes from the stream header (only
+ *    the 8 bits 4:2:0 layouts are supported)
+ *
+ * The file is never loaded nor mapped as a whole: each frame is read with a
+ * single readv() call into a pooled buffer, and the pages already read are
+ * dropped from the page cache, so streams of several hours can be compared.
+ */
+class ReferenceReader {
+public:
+    /**
+     * @brief Open a raw or Y4M file
+     *
+     * The Y4M files are recognized by their signature, the format and
+     * the size are then ignored.
+     *
+     * @param szFilename The file to open
+     * @param format The pixel format of a raw file (NV12 or I420)
+     * @param size The picture size of a raw file
+     */
+    ReferenceReader(const std::string& szFilename, vw::PixelFormat format, vw::SizeU size);
+    /**
+     * @brief Close the file
+     */
+    ~ReferenceReader();
+
+    ReferenceReader(const ReferenceReader&) = delete;
+    ReferenceReader(ReferenceReader&&) = delete;
+
+    ReferenceReader& operator=(const ReferenceReader&) = delete;
+    ReferenceReader& operator=(ReferenceReader&&) = delete;
+
+    /**
+     * @brief Check if the file is a Y4M stream
+     *
+     * @return bool True if the file has a YUV4MPEG2 header
+     */
+    bool isY4M() const;
+
+    /**
+     * @brief Get the picture size of the frames
+     *
+     * @return vw::SizeU The picture size
+     */
+    vw::SizeU getSize() const;
+
+    /**
+     * @brief Read the next frame
+     *
+     * A truncated last frame is ignored.
+     *
+     * @param pool The pool providing the frame buffers
+     * @return vw::ImageFrame The frame in I420 format, empty at the end of the file
+     */
+    vw::ImageFrame readFrame(vw::ImageBufferPool& pool);
+
+private:
+    std::string readLine();
+    bool readPlanes(vw::ImageBuffer& buffer);
+    void dropReadPages();
+
+private:
+    int m_fd;
+    bool m_bY4M;
+    vw::PixelFormat m_format;
+    vw::SizeU m_size;
+    uint64_t m_iOffset;
+    uint64_t m_iDroppedOffset;
+};
+
+#endif // LOCAL_REFERENCE_READER_H
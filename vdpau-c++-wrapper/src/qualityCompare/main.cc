@@ -0,0 +1,288 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <VdpWrapper/Backend.h>
+#include <VdpWrapper/CpuBackend.h>
+#include <VdpWrapper/DecodedSurface.h>
+#include <VdpWrapper/Decoder.h>
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/ImageBufferPool.h>
+#include <VdpWrapper/MockBackend.h>
+#include <VdpWrapper/NalUnit.h>
+#include <VdpWrapper/PixelConversion.h>
+#include <VdpWrapper/PresentationOrderBuffer.h>
+
+#include <h264Parser/H264Parser.h>
+
+#include "local/FrameComparator.h"
+#include "local/ReferenceReader.h"
+
+namespace {
+    void printUsage(const std::string& commandName, const std::string& message) {
+        std::cerr << message << std::endl;
+        std::cerr << "Usage:" << std::endl;
+        std::cerr << "\t" << commandName << " [OPTION...] BITSTREAM_FILE REFERENCE_FILE" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "\t--backend <x11|cpu|mock>\t\tSet the VDPAU backend" << std::endl;
+        std::cerr << "\t--threads <COUNT>\t\t\tSet the number of threads comparing the frames" << std::endl;
+        std::cerr << "\t--format <i420|nv12>\t\t\tSet the pixel format of a raw reference file" << std::endl;
+        std::cerr << "\t--size <width>x<height>\t\t\tSet the picture size of a raw reference file" << std::endl;
+        std::cerr << "\t--frame-csv <FILE|->\t\t\tWrite the per-frame qualities to FILE" << std::endl;
+        std::cerr << "\t--summary-csv <FILE|->\t\t\tWrite the aggregate qualities to FILE" << std::endl;
+    }
+
+    bool parseCount(const std::string& szValue, std::size_t& iCount) {
+        try {
+            long long iValue = std::stoll(szValue);
+            if (iValue <= 0) {
+                return false;
+            }
+            iCount = static_cast<std::size_t>(iValue);
+        } catch (std::logic_error &e) {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool parseSize(const std::string& szSize, vw::SizeU& size) {
+        unsigned width = 0;
+        unsigned height = 0;
+        if (std::sscanf(szSize.c_str(), "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+            return false;
+        }
+
+        size = vw::SizeU(width, height);
+        return true;
+    }
+
+    // A decoded picture waiting for the presentation order
+    struct Picture {
+        vw::ImageFrame frame;
+        vw::SizeU size;
+        int iPictureOrderCount;
+    };
+}
+
+int main(int argc, char *argv[]) {
+    int iCurrentArg = 1;
+    std::string szBackend = "x11";
+    std::size_t iThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    vw::PixelFormat referenceFormat = vw::PixelFormat::I420;
+    vw::SizeU referenceSize(0u, 0u);
+    std::string szFrameCsv = "-";
+    std::string szSummaryCsv = "-";
+
+    while (iCurrentArg < argc && std::string(argv[iCurrentArg]).rfind("--", 0) == 0) {
+        std::string szArg = std::string(argv[iCurrentArg]);
+        if (iCurrentArg >= argc - 1) {
+            printUsage(argv[0], "Missing value for '" + szArg + "'");
+            return 1;
+        }
+
+        std::string szValue = std::string(argv[iCurrentArg + 1]);
+        if (szArg == "--backend") {
+            szBackend = szValue;
+            if (szBackend != "x11" && szBackend != "cpu" && szBackend != "mock") {
+                printUsage(argv[0], "Wrong backend value");
+                return 1;
+            }
+        } else if (szArg == "--threads") {
+            if (!parseCount(szValue, iThreadCount)) {
+                printUsage(argv[0], "Wrong thread count");
+                return 1;
+            }
+        } else if (szArg == "--format") {
+            if (szValue == "i420") {
+                referenceFormat = vw::PixelFormat::I420;
+            } else if (szValue == "nv12") {
+                referenceFormat = vw::PixelFormat::NV12;
+            } else {
+                printUsage(argv[0], "Wrong format value");
+                return 1;
+            }
+        } else if (szArg == "--size") {
+            if (!parseSize(szValue, referenceSize)) {
+                printUsage(argv[0], "Wrong size value");
+                return 1;
+            }
+        } else if (szArg == "--frame-csv") {
+            szFrameCsv = szValue;
+        } else if (szArg == "--summary-csv") {
+            szSummaryCsv = szValue;
+        } else {
+            printUsage(argv[0], "'" + szArg + "' unknown option");
+            return 1;
+        }
+
+        iCurrentArg += 2;
+    }
+
+    if (iCurrentArg != argc - 2) {
+        printUsage(argv[0], "Missing parameter");
+        return 1;
+    }
+
+    std::string szBitstreamFile(argv[iCurrentArg]);
+    std::string szReferenceFile(argv[iCurrentArg + 1]);
+
+    // The CSV go to the standard output by default, the logs of the library are moved to the standard error
+    std::ostream standardOutput(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::ofstream frameCsvFile;
+    std::ofstream summaryCsvFile;
+    if (szFrameCsv != "-") {
+        frameCsvFile.open(szFrameCsv);
+        if (!frameCsvFile) {
+            printUsage(argv[0], "Unable to create the frame CSV");
+            return 1;
+        }
+    }
+    if (szSummaryCsv != "-") {
+        summaryCsvFile.open(szSummaryCsv);
+        if (!summaryCsvFile) {
+            printUsage(argv[0], "Unable to create the summary CSV");
+            return 1;
+        }
+    }
+    std::ostream& frameCsv = (szFrameCsv != "-") ? static_cast<std::ostream&>(frameCsvFile) : standardOutput;
+    std::ostream& summaryCsv = (szSummaryCsv != "-") ? static_cast<std::ostream&>(summaryCsvFile) : standardOutput;
+
+    std::cerr << "[main] Compare '" << szBitstreamFile << "' to '" << szReferenceFile << "' with " << iThreadCount << " threads ("
+        << vw::getSimdLevelName(vw::getSimdLevel()) << ")" << std::endl;
+
+    std::unique_ptr<vw::Backend> pBackend;
+    if (szBackend == "cpu") {
+        pBackend = std::make_unique<vw::CpuBackend>();
+    } else if (szBackend == "mock") {
+        pBackend = std::make_unique<vw::MockBackend>(vw::MockLatencyModel());
+    } else {
+        pBackend = std::make_unique<vw::X11Backend>(std::string());
+    }
+
+    vw::Device device(*pBackend);
+    vw::Decoder decoder(device);
+    vw::ImageBufferPool pool;
+    FrameComparator comparator(frameCsv, iThreadCount);
+    H264Parser parser(szBitstreamFile);
+    vw::NalUnit nalUnit;
+
+    // The reference is opened on the first picture, a raw file has the decoded size by default
+    std::unique_ptr<ReferenceReader> pReference;
+    bool bReferenceEnded = false;
+    std::string szError;
+
+    auto comparePicture = [&](Picture picture) {
+        if (bReferenceEnded || !szError.empty()) {
+            return;
+        }
+
+        try {
+            if (pReference == nullptr) {
+                vw::SizeU size = (referenceSize.width != 0) ? referenceSize : picture.size;
+                pReference = std::make_unique<ReferenceReader>(szReferenceFile, referenceFormat, size);
+            }
+
+            if (pReference->getSize() != picture.size) {
+                szError = "The reference size " + std::to_string(pReference->getSize().width) + "x" + std::to_string(pReference->getSize().height)
+                    + " doesn't match the decoded size " + std::to_string(picture.size.width) + "x" + std::to_string(picture.size.height);
+                return;
+            }
+
+            vw::ImageFrame reference = pReference->readFrame(pool);
+            if (!reference) {
+                std::cerr << "[main] The reference ends before the bitstream" << std::endl;
+                bReferenceEnded = true;
+                return;
+            }
+
+            comparator.compare(std::move(picture.frame), std::move(reference), picture.size);
+        } catch (const std::exception& error) {
+            szError = error.what();
+        }
+    };
+
+    // The pictures are compared in presentation order, like the frames of the reference
+    vw::PresentationOrderBuffer<Picture> reorderPictures;
+    auto releasePicture = [&](Picture picture) {
+        if (szError.empty()) {
+            comparePicture(std::move(picture));
+        }
+    };
+
+    while (parser.readNextNAL(nalUnit) && szError.empty()) {
+        switch (nalUnit.getType()) {
+        case vw::NalType::SPS:
+            reorderPictures.setReorderDepth(nalUnit.getH264Infos().iReorderDepth);
+            break;
+
+        case vw::NalType::CodedSliceNonIDR:
+        case vw::NalType::CodedSliceIDR: {
+            vw::DecodedSurface& decodedSurface = decoder.decode(nalUnit);
+            Picture picture = { decodedSurface.copyHardwareMemory(pool, vw::PixelFormat::I420), decodedSurface.getSize(), decodedSurface.getPictureOrderCount() };
+            int iPictureOrderCount = picture.iPictureOrderCount;
+            reorderPictures.push(iPictureOrderCount, std::move(picture), releasePicture);
+            break;
+        }
+
+        default:
+            // Nothing to do
+            break;
+        }
+    }
+
+    reorderPictures.flush(releasePicture);
+
+    comparator.flush();
+
+    if (szError.empty()) {
+        szError = comparator.getError();
+    }
+    if (!szError.empty()) {
+        std::cerr << "[main] " << szError << std::endl;
+        return 1;
+    }
+
+    if (pReference != nullptr && !bReferenceEnded && pReference->readFrame(pool)) {
+        std::cerr << "[main] The bitstream ends before the reference" << std::endl;
+    }
+
+    QualitySummary summary = comparator.getSummary();
+    if (szSummaryCsv == "-" && szFrameCsv == "-") {
+        summaryCsv << std::endl;
+    }
+    FrameComparator::writeSummary(summary, summaryCsv);
+
+    std::cerr << "[main] Compared frames: " << summary.frames << std::endl;
+
+    return 0;
+}
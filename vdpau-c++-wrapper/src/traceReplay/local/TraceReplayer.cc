@@ -0,0 +1,406 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TraceReplayer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <vdpau/vdpau_x11.h>
+
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/VdpFunctions.h>
+
+namespace {
+    // The handles are only unique for a traced device
+    uint64_t makeHandleKey(const vw::TraceRecord& record, uint32_t handle) {
+        return (static_cast<uint64_t>(record.deviceID) << 32) | handle;
+    }
+}
+
+TraceReplayer::TraceReplayer(vw::Device& device, Drawable drawable)
+: m_device(device)
+, m_drawable(drawable)
+, m_bTimingEnabled(true)
+, m_bTimeBaseSet(false)
+, m_originalTimeBase(0)
+, m_replayTimeBase(0) {
+
+}
+
+void TraceReplayer::enableTiming(bool bEnabled) {
+    m_bTimingEnabled = bEnabled;
+}
+
+void TraceReplayer::replay(const vw::Trace& trace) {
+    const auto& records = trace.records;
+    m_replayDurations.assign(records.size(), std::chrono::nanoseconds(0));
+    auto replayStartTime = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const auto& record = records[i];
+        const auto& payload = trace.payloads[i];
+
+        if (m_bTimingEnabled) {
+            std::this_thread::sleep_until(replayStartTime + std::chrono::nanoseconds(record.startTime));
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        VdpStatus status = replayRecord(record, payload);
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+        m_replayDurations[i] = duration;
+
+        auto& statistics = m_statistics[record.functionID];
+        if (isSynthetic(record, payload)) {
+            statistics.syntheticCalls += 1;
+            continue;
+        }
+
+        auto originalDuration = std::chrono::nanoseconds(record.duration);
+        statistics.calls += 1;
+        statistics.originalTotal += originalDuration;
+        statistics.originalMax = std::max(statistics.originalMax, originalDuration);
+        statistics.replayTotal += duration;
+        statistics.replayMax = std::max(statistics.replayMax, duration);
+        if (status != static_cast<VdpStatus>(record.status)) {
+            statistics.statusMismatches += 1;
+        }
+    }
+}
+
+bool TraceReplayer::isSynthetic(const vw::TraceRecord& record, const std::vector<uint8_t>& payload) {
+    return record.functionID == VDP_FUNC_ID_DECODER_RENDER && (record.values[2] != sizeof(VdpPictureInfoH264) || payload.empty());
+}
+
+const std::map<uint32_t, FunctionStatistics>& TraceReplayer::getStatistics() const {
+    return m_statistics;
+}
+
+const std::vector<std::chrono::nanoseconds>& TraceReplayer::getReplayDurations() const {
+    return m_replayDurations;
+}
+
+VdpStatus TraceReplayer::replayRecord(const vw::TraceRecord& record, const std::vector<uint8_t>& payload) {
+    const vw::VdpFunctions* pFunctions = &m_device.getFunctions();
+    VdpDevice device = m_device.getVdpHandle();
+
+    switch (record.functionID) {
+    case VDP_FUNC_ID_GET_INFORMATION_STRING: {
+        const char* szInformations = nullptr;
+        return pFunctions->getInformationString(&szInformations);
+    }
+
+    case VDP_FUNC_ID_DEVICE_DESTROY:
+        // The device is owned by the replayer
+        return static_cast<VdpStatus>(record.status);
+
+    case VDP_FUNC_ID_DECODER_CREATE: {
+        VdpDecoder decoder = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->decoderCreate(device, record.values[0], record.values[1], record.values[2], record.values[3], &decoder);
+        if (status == VDP_STATUS_OK) {
+            m_decoders[makeHandleKey(record, record.handles[0])] = decoder;
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_DECODER_DESTROY: {
+        VdpStatus status = pFunctions->decoderDestroy(mapHandle(m_decoders, makeHandleKey(record, record.handles[0])));
+        m_decoders.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_DECODER_RENDER:
+        return replayDecoderRender(record, payload);
+
+    case VDP_FUNC_ID_OUTPUT_SURFACE_CREATE: {
+        VdpOutputSurface surface = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->outputSurfaceCreate(device, record.values[0], record.values[1], record.values[2], &surface);
+        if (status == VDP_STATUS_OK) {
+            m_outputSurfaces[makeHandleKey(record, record.handles[0])] = { surface, record.values[1], record.values[2] };
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_OUTPUT_SURFACE_DESTROY: {
+        VdpStatus status = pFunctions->outputSurfaceDestroy(mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[0])).handle);
+        m_outputSurfaces.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE:
+    case VDP_FUNC_ID_OUTPUT_SURFACE_GET_BITS_NATIVE: {
+        ReplaySurface surface = mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[0]));
+        uint32_t iWidth = record.values[1] != 0 ? record.values[1] : surface.width;
+        uint32_t iHeight = record.values[2] != 0 ? record.values[2] : surface.height;
+        VdpRect rect = { 0, 0, iWidth, iHeight };
+        uint32_t pitches[1] = { iWidth * 4 };
+        void* data[1] = { getScratchBuffer(static_cast<std::size_t>(pitches[0]) * iHeight) };
+
+        if (record.functionID == VDP_FUNC_ID_OUTPUT_SURFACE_PUT_BITS_NATIVE) {
+            return pFunctions->outputSurfacePutBitsNative(surface.handle, data, pitches, &rect);
+        }
+        return pFunctions->outputSurfaceGetBitsNative(surface.handle, &rect, data, pitches);
+    }
+
+    case VDP_FUNC_ID_OUTPUT_SURFACE_GET_PARAMETERS: {
+        VdpRGBAFormat format;
+        uint32_t iWidth = 0;
+        uint32_t iHeight = 0;
+        return pFunctions->outputSurfaceGetParameters(mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[0])).handle, &format, &iWidth, &iHeight);
+    }
+
+    case VDP_FUNC_ID_VIDEO_SURFACE_CREATE: {
+        VdpVideoSurface surface = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->videoSurfaceCreate(device, record.values[0], record.values[1], record.values[2], &surface);
+        if (status == VDP_STATUS_OK) {
+            m_videoSurfaces[makeHandleKey(record, record.handles[0])] = { surface, record.values[1], record.values[2] };
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_VIDEO_SURFACE_DESTROY: {
+        VdpStatus status = pFunctions->videoSurfaceDestroy(mapSurface(m_videoSurfaces, makeHandleKey(record, record.handles[0])).handle);
+        m_videoSurfaces.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR:
+    case VDP_FUNC_ID_VIDEO_SURFACE_GET_BITS_Y_CB_CR: {
+        ReplaySurface surface = mapSurface(m_videoSurfaces, makeHandleKey(record, record.handles[0]));
+        std::size_t iLumaSize = static_cast<std::size_t>(surface.width) * surface.height;
+        uint8_t* pBuffer = getScratchBuffer(iLumaSize * 2);
+
+        // NV12 layout, or YV12 with separated chroma planes
+        void* data[3] = { pBuffer, pBuffer + iLumaSize, pBuffer + iLumaSize + iLumaSize / 4 };
+        uint32_t pitches[3] = { surface.width, surface.width, surface.width };
+        if (record.values[0] == VDP_YCBCR_FORMAT_YV12) {
+            pitches[1] = surface.width / 2;
+            pitches[2] = surface.width / 2;
+        }
+
+        if (record.functionID == VDP_FUNC_ID_VIDEO_SURFACE_PUT_BITS_Y_CB_CR) {
+            return pFunctions->videoSurfacePutBitsYCbCr(surface.handle, record.values[0], data, pitches);
+        }
+        return pFunctions->videoSurfaceGetBitsYCbCr(surface.handle, record.values[0], data, pitches);
+    }
+
+    case VDP_FUNC_ID_VIDEO_SURFACE_GET_PARAMETERS: {
+        VdpChromaType chromaType;
+        uint32_t iWidth = 0;
+        uint32_t iHeight = 0;
+        return pFunctions->videoSurfaceGetParameters(mapSurface(m_videoSurfaces, makeHandleKey(record, record.handles[0])).handle, &chromaType, &iWidth, &iHeight);
+    }
+
+    case VDP_FUNC_ID_VIDEO_MIXER_CREATE: {
+        VdpVideoMixerParameter parameters[] = {
+            VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_WIDTH,
+            VDP_VIDEO_MIXER_PARAMETER_VIDEO_SURFACE_HEIGHT,
+        };
+        uint32_t iWidth = record.values[2];
+        uint32_t iHeight = record.values[3];
+        const void* parameterValues[] = { &iWidth, &iHeight };
+
+        VdpVideoMixer mixer = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->videoMixerCreate(device, 0, nullptr, iWidth != 0 && iHeight != 0 ? 2 : 0, parameters, parameterValues, &mixer);
+        if (status == VDP_STATUS_OK) {
+            m_videoMixers[makeHandleKey(record, record.handles[0])] = mixer;
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_VIDEO_MIXER_DESTROY: {
+        VdpStatus status = pFunctions->videoMixerDestroy(mapHandle(m_videoMixers, makeHandleKey(record, record.handles[0])));
+        m_videoMixers.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_VIDEO_MIXER_RENDER: {
+        VdpRect destinationVideoRect = { 0, 0, record.values[1], record.values[2] };
+        VdpOutputSurface backgroundSurface = VDP_INVALID_HANDLE;
+        if (record.handles[3] != VDP_INVALID_HANDLE) {
+            backgroundSurface = mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[3])).handle;
+        }
+
+        return pFunctions->videoMixerRender(
+            mapHandle(m_videoMixers, makeHandleKey(record, record.handles[0])),
+            backgroundSurface,
+            nullptr,
+            static_cast<VdpVideoMixerPictureStructure>(record.values[0]),
+            0,
+            nullptr,
+            mapSurface(m_videoSurfaces, makeHandleKey(record, record.handles[1])).handle,
+            0,
+            nullptr,
+            nullptr,
+            mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[2])).handle,
+            nullptr,
+            record.values[1] != 0 ? &destinationVideoRect : nullptr,
+            0,
+            nullptr
+        );
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_CREATE_X11: {
+        VdpPresentationQueueTarget target = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->presentationQueueTargetCreateX11(device, m_drawable, &target);
+        if (status == VDP_STATUS_OK) {
+            m_queueTargets[makeHandleKey(record, record.handles[0])] = target;
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_TARGET_DESTROY: {
+        VdpStatus status = pFunctions->presentationQueueTargetDestroy(mapHandle(m_queueTargets, makeHandleKey(record, record.handles[0])));
+        m_queueTargets.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_CREATE: {
+        VdpPresentationQueue queue = VDP_INVALID_HANDLE;
+        VdpStatus status = pFunctions->presentationQueueCreate(device, mapHandle(m_queueTargets, makeHandleKey(record, record.handles[2])), &queue);
+        if (status == VDP_STATUS_OK) {
+            m_queues[makeHandleKey(record, record.handles[0])] = queue;
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_DESTROY: {
+        VdpStatus status = pFunctions->presentationQueueDestroy(mapHandle(m_queues, makeHandleKey(record, record.handles[0])));
+        m_queues.erase(makeHandleKey(record, record.handles[0]));
+        return status;
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_SET_BACKGROUND_COLOR: {
+        VdpColor backgroundColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+        return pFunctions->presentationQueueSetBackgroundColor(mapHandle(m_queues, makeHandleKey(record, record.handles[0])), &backgroundColor);
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_GET_TIME: {
+        VdpTime currentTime = 0;
+        VdpStatus status = pFunctions->presentationQueueGetTime(mapHandle(m_queues, makeHandleKey(record, record.handles[0])), &currentTime);
+
+        // The first reading links the presentation clock of the trace to the one of the replay
+        if (status == VDP_STATUS_OK && !m_bTimeBaseSet && record.status == VDP_STATUS_OK) {
+            m_originalTimeBase = record.argument;
+            m_replayTimeBase = currentTime;
+            m_bTimeBaseSet = true;
+        }
+        return status;
+    }
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_DISPLAY:
+        return pFunctions->presentationQueueDisplay(
+            mapHandle(m_queues, makeHandleKey(record, record.handles[0])),
+            mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[1])).handle,
+            record.values[0],
+            record.values[1],
+            mapPresentationTime(record.argument)
+        );
+
+    case VDP_FUNC_ID_PRESENTATION_QUEUE_QUERY_SURFACE_STATUS: {
+        VdpPresentationQueueStatus surfaceStatus;
+        VdpTime firstPresentationTime = 0;
+        return pFunctions->presentationQueueQuerySurfaceStatus(
+            mapHandle(m_queues, makeHandleKey(record, record.handles[0])),
+            mapSurface(m_outputSurfaces, makeHandleKey(record, record.handles[1])).handle,
+            &surfaceStatus,
+            &firstPresentationTime
+        );
+    }
+
+    default:
+        break;
+    }
+
+    return VDP_STATUS_NO_IMPLEMENTATION;
+}
+
+VdpStatus TraceReplayer::replayDecoderRender(const vw::TraceRecord& record, const std::vector<uint8_t>& payload) {
+    VdpPictureInfoH264 pictureInfo = {};
+    VdpBitstreamBuffer bitstreamBuffer = {};
+    bitstreamBuffer.struct_version = VDP_BITSTREAM_BUFFER_VERSION;
+
+    if (isSynthetic(record, payload)) {
+        // Synthetic bitstream of the traced size
+        bitstreamBuffer.bitstream = getScratchBuffer(record.values[1]);
+        bitstreamBuffer.bitstream_bytes = record.values[1];
+    } else {
+        std::memcpy(&pictureInfo, payload.data(), sizeof(pictureInfo));
+        bitstreamBuffer.bitstream = payload.data() + sizeof(pictureInfo);
+        bitstreamBuffer.bitstream_bytes = record.values[3];
+
+        // The reference frames are surfaces of the trace
+        for (auto& referenceFrame : pictureInfo.referenceFrames) {
+            if (referenceFrame.surface != VDP_INVALID_HANDLE) {
+                referenceFrame.surface = mapSurface(m_videoSurfaces, makeHandleKey(record, referenceFrame.surface)).handle;
+            }
+        }
+    }
+
+    // The traced buffers are concatenated in a single one
+    return m_device.getFunctions().decoderRender(
+        mapHandle(m_decoders, makeHandleKey(record, record.handles[0])),
+        mapSurface(m_videoSurfaces, makeHandleKey(record, record.handles[1])).handle,
+        reinterpret_cast<VdpPictureInfo*>(&pictureInfo),
+        record.values[0] > 0 ? 1 : 0,
+        &bitstreamBuffer
+    );
+}
+
+uint32_t TraceReplayer::mapHandle(const std::unordered_map<uint64_t, uint32_t>& handles, uint64_t handleKey) const {
+    auto it = handles.find(handleKey);
+    if (it == handles.end()) {
+        return VDP_INVALID_HANDLE;
+    }
+
+    return it->second;
+}
+
+TraceReplayer::ReplaySurface TraceReplayer::mapSurface(const std::unordered_map<uint64_t, ReplaySurface>& surfaces, uint64_t handleKey) const {
+    auto it = surfaces.find(handleKey);
+    if (it == surfaces.end()) {
+        return { VDP_INVALID_HANDLE, 0, 0 };
+    }
+
+    return it->second;
+}
+
+uint8_t* TraceReplayer::getScratchBuffer(std::size_t iSize) {
+    if (m_scratchBuffer.size() < iSize) {
+        m_scratchBuffer.resize(iSize);
+    }
+
+    return m_scratchBuffer.data();
+}
+
+VdpTime TraceReplayer::mapPresentationTime(VdpTime originalTime) const {
+    // Zero means "as soon as possible"
+    if (originalTime == 0 || !m_bTimeBaseSet) {
+        return originalTime;
+    }
+
+    if (originalTime < m_originalTimeBase) {
+        return m_replayTimeBase;
+    }
+
+    return originalTime - m_originalTimeBase + m_replayTimeBase;
+}
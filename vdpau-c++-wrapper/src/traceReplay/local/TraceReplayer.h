@@ -0,0 +1,154 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOCAL_TRACE_REPLAYER_H
+#define LOCAL_TRACE_REPLAYER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <X11/Xlib.h>
+#include <vdpau/vdpau.h>
+
+#include <VdpWrapper/CallTracer.h>
+
+namespace vw {
+    class Device;
+}
+
+/**
+ * @brief Latencies of a VDPAU function in the trace and during the replay
+ */
+struct FunctionStatistics {
+    uint64_t calls = 0;                                                 ///< Number of compared calls
+    uint64_t syntheticCalls = 0;                                        ///< Calls replayed with synthetic data, excluded from the latencies
+    uint64_t statusMismatches = 0;                                      ///< Calls whose replay status differs from the trace
+    std::chrono::nanoseconds originalTotal = std::chrono::nanoseconds(0);  ///< Sum of the traced durations
+    std::chrono::nanoseconds originalMax = std::chrono::nanoseconds(0);    ///< Maximal traced duration
+    std::chrono::nanoseconds replayTotal = std::chrono::nanoseconds(0);    ///< Sum of the replayed durations
+    std::chrono::nanoseconds replayMax = std::chrono::nanoseconds(0);      ///< Maximal replayed duration
+};
+
+/**
+ * @brief TraceReplayer reissues the calls of a trace file on a device
+ *
+ * The handles of the trace are mapped to the objects created during the replay.
+ * Each traced device has its own handle mapping, the calls of all the traced
+ * devices are replayed on the same device.
+ * The pictures aren't recorded, so the surface transfers use synthetic buffers
+ * of the recorded sizes: the replay reproduces the call sequence and the timing,
+ * not the images. The H.264 decodings are replayed with their recorded picture
+ * infos and bitstreams. The other decodings can only be replayed with a synthetic
+ * bitstream, their latencies aren't comparable so they're excluded from the
+ * statistics and counted apart.
+ */
+class TraceReplayer {
+public:
+    /**
+     * @brief Construct a new TraceReplayer
+     *
+     * @param device The device receiving the calls
+     * @param drawable The drawable used for the presentation queue targets
+     */
+    TraceReplayer(vw::Device& device, Drawable drawable);
+
+    /**
+     * @brief Enable the original timing
+     *
+     * When enabled, each call is issued at its traced time relative to the start
+     * of the replay, otherwise the calls are issued back to back.
+     *
+     * @param bEnabled If true, the original timing is followed
+     */
+    void enableTiming(bool bEnabled);
+
+    /**
+     * @brief Replay all the records
+     *
+     * @param trace The records and payloads read from the trace file
+     */
+    void replay(const vw::Trace& trace);
+
+    /**
+     * @brief Check if a record is replayed with synthetic data
+     *
+     * @param record The traced call
+     * @param payload The payload of the record
+     * @return true If the replayed call isn't comparable to the traced one
+     * @return false Otherwise
+     */
+    static bool isSynthetic(const vw::TraceRecord& record, const std::vector<uint8_t>& payload);
+
+    /**
+     * @brief Get the latencies for each function
+     *
+     * @return const std::map<uint32_t, FunctionStatistics>& The statistics by VdpFuncId
+     */
+    const std::map<uint32_t, FunctionStatistics>& getStatistics() const;
+
+    /**
+     * @brief Get the replayed duration of each record
+     *
+     * @return const std::vector<std::chrono::nanoseconds>& The durations in the record order
+     */
+    const std::vector<std::chrono::nanoseconds>& getReplayDurations() const;
+
+private:
+    struct ReplaySurface {
+        uint32_t handle;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    VdpStatus replayRecord(const vw::TraceRecord& record, const std::vector<uint8_t>& payload);
+    VdpStatus replayDecoderRender(const vw::TraceRecord& record, const std::vector<uint8_t>& payload);
+    uint32_t mapHandle(const std::unordered_map<uint64_t, uint32_t>& handles, uint64_t handleKey) const;
+    ReplaySurface mapSurface(const std::unordered_map<uint64_t, ReplaySurface>& surfaces, uint64_t handleKey) const;
+    uint8_t* getScratchBuffer(std::size_t iSize);
+    VdpTime mapPresentationTime(VdpTime originalTime) const;
+
+private:
+    vw::Device& m_device;
+    Drawable m_drawable;
+    bool m_bTimingEnabled;
+
+    // Replayed objects by traced device and handle
+    std::unordered_map<uint64_t, uint32_t> m_decoders;
+    std::unordered_map<uint64_t, ReplaySurface> m_videoSurfaces;
+    std::unordered_map<uint64_t, ReplaySurface> m_outputSurfaces;
+    std::unordered_map<uint64_t, uint32_t> m_videoMixers;
+    std::unordered_map<uint64_t, uint32_t> m_queueTargets;
+    std::unordered_map<uint64_t, uint32_t> m_queues;
+
+    // Presentation clocks of the trace and of the replay
+    bool m_bTimeBaseSet;
+    VdpTime m_originalTimeBase;
+    VdpTime m_replayTimeBase;
+
+    std::vector<uint8_t> m_scratchBuffer;
+    std::map<uint32_t, FunctionStatistics> m_statistics;
+    std::vector<std::chrono::nanoseconds> m_replayDurations;
+};
+
+#endif // LOCAL_TRACE_REPLAYER_H
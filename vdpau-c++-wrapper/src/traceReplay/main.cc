@@ -0,0 +1,193 @@
+/* Copyright (c) 2020 Jet1oeil
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <VdpWrapper/Backend.h>
+#include <VdpWrapper/CallTracer.h>
+#include <VdpWrapper/CpuBackend.h>
+#include <VdpWrapper/Device.h>
+#include <VdpWrapper/Display.h>
+#include <VdpWrapper/MockBackend.h>
+
+#include "local/TraceReplayer.h"
+
+namespace {
+    void printUsage(const std::string& commandName, const std::string& message) {
+        std::cerr << message << std::endl;
+        std::cerr << "Usage:" << std::endl;
+        std::cerr << "\t" << commandName << " [OPTION...] TRACE_FILE" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "\t--backend <x11|cpu|mock>\t\tSet the VDPAU backend receiving the calls" << std::endl;
+        std::cerr << "\t--no-timing\t\t\t\tIssue the calls back to back" << std::endl;
+        std::cerr << "\t--dump\t\t\t\t\tPrint the records as CSV without replaying them" << std::endl;
+        std::cerr << "\t--outlier-factor <FACTOR>\t\tReport the calls slower than FACTOR times the mean" << std::endl;
+    }
+
+    void dumpRecords(const std::vector<vw::TraceRecord>& records) {
+        std::cout << "start_ns,device,function,duration_ns,status,handle0,handle1,handle2,handle3,value0,value1,value2,value3,argument" << std::endl;
+        for (const auto& record : records) {
+            std::cout << record.startTime << "," << record.deviceID << "," << vw::CallTracer::getFunctionName(record.functionID) << ","
+                << record.duration << "," << record.status;
+            for (auto handle : record.handles) {
+                std::cout << "," << handle;
+            }
+            for (auto value : record.values) {
+                std::cout << "," << value;
+            }
+            std::cout << "," << record.argument << std::endl;
+        }
+    }
+
+    void printOutliers(const vw::Trace& trace, const TraceReplayer& replayer, double outlierFactor) {
+        const auto& records = trace.records;
+        const auto& statistics = replayer.getStatistics();
+        const auto& replayDurations = replayer.getReplayDurations();
+
+        std::cout << "[main] Calls slower than " << outlierFactor << "x the mean:" << std::endl;
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const auto& record = records[i];
+            if (TraceReplayer::isSynthetic(record, trace.payloads[i])) {
+                continue;
+            }
+
+            const auto& functionStatistics = statistics.at(record.functionID);
+            double originalMean = static_cast<double>(functionStatistics.originalTotal.count()) / functionStatistics.calls;
+            double replayMean = static_cast<double>(functionStatistics.replayTotal.count()) / functionStatistics.calls;
+
+            bool bOriginalOutlier = record.duration > outlierFactor * originalMean;
+            bool bReplayOutlier = replayDurations[i].count() > outlierFactor * replayMean;
+            if (!bOriginalOutlier && !bReplayOutlier) {
+                continue;
+            }
+
+            std::cout << "[main] #" << i << " " << vw::CallTracer::getFunctionName(record.functionID)
+                << " at " << record.startTime / 1000 << " µs: trace = " << record.duration / 1000
+                << " µs" << (bOriginalOutlier ? " (outlier)" : "")
+                << " ; replay = " << replayDurations[i].count() / 1000
+                << " µs" << (bReplayOutlier ? " (outlier)" : "") << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iCurrentArg = 1;
+    std::string szBackend = "x11";
+    bool bTimingEnabled = true;
+    bool bDump = false;
+    double outlierFactor = 4.0;
+
+    while (iCurrentArg < argc - 1) {
+        std::string szArg = std::string(argv[iCurrentArg]);
+        if (szArg == "--backend") {
+            szBackend = std::string(argv[iCurrentArg + 1]);
+            if (szBackend != "x11" && szBackend != "cpu" && szBackend != "mock") {
+                printUsage(argv[0], "Wrong backend value");
+                return 1;
+            }
+
+            iCurrentArg += 2;
+        } else if (szArg == "--no-timing") {
+            bTimingEnabled = false;
+            ++iCurrentArg;
+        } else if (szArg == "--dump") {
+            bDump = true;
+            ++iCurrentArg;
+        } else if (szArg == "--outlier-factor") {
+            try {
+                outlierFactor = std::stod(argv[iCurrentArg + 1]);
+            } catch (std::logic_error &e) {
+                outlierFactor = 0.0;
+            }
+
+            if (outlierFactor <= 1.0) {
+                printUsage(argv[0], "Wrong outlier factor");
+                return 1;
+            }
+
+            iCurrentArg += 2;
+        } else {
+            printUsage(argv[0], "'" + szArg + "' unknown option");
+            return 1;
+        }
+    }
+
+    if (iCurrentArg != argc - 1) {
+        printUsage(argv[0], "Missing parameter");
+        return 1;
+    }
+
+    auto trace = vw::CallTracer::readFile(argv[iCurrentArg]);
+    std::cout << "[main] " << trace.records.size() << " traced calls" << std::endl;
+
+    if (bDump) {
+        dumpRecords(trace.records);
+        return 0;
+    }
+
+    // The X11 backend needs a window for the presentation queue targets
+    std::unique_ptr<vw::Display> pDisplay;
+    std::unique_ptr<vw::Backend> pBackend;
+    Drawable drawable = 0;
+    if (szBackend == "cpu") {
+        pBackend = std::make_unique<vw::CpuBackend>();
+    } else if (szBackend == "mock") {
+        pBackend = std::make_unique<vw::MockBackend>(vw::MockLatencyModel());
+    } else {
+        pDisplay = std::make_unique<vw::Display>(vw::SizeI(1280, 720));
+        pBackend = std::make_unique<vw::X11Backend>(*pDisplay);
+        drawable = pDisplay->getXWindow();
+    }
+
+    vw::Device device(*pBackend);
+    TraceReplayer replayer(device, drawable);
+    replayer.enableTiming(bTimingEnabled);
+    replayer.replay(trace);
+
+    std::cout << "[main] Latencies (trace / replay):" << std::endl;
+    for (const auto& [functionID, statistics] : replayer.getStatistics()) {
+        if (statistics.syntheticCalls > 0) {
+            std::cout << "[main] " << vw::CallTracer::getFunctionName(functionID) << ": " << statistics.syntheticCalls
+                << " calls replayed with synthetic data, excluded from the comparison" << std::endl;
+        }
+
+        if (statistics.calls == 0) {
+            continue;
+        }
+
+        std::cout << "[main] " << std::left << std::setw(36) << vw::CallTracer::getFunctionName(functionID) << std::right
+            << " calls = " << statistics.calls
+            << " ; mean = " << statistics.originalTotal.count() / statistics.calls / 1000
+            << " / " << statistics.replayTotal.count() / statistics.calls / 1000 << " µs"
+            << " ; max = " << statistics.originalMax.count() / 1000
+            << " / " << statistics.replayMax.count() / 1000 << " µs"
+            << " ; status mismatches = " << statistics.statusMismatches << std::endl;
+    }
+
+    printOutliers(trace, replayer, outlierFactor);
+
+    return 0;
+}